@@ -9,9 +9,6 @@ namespace astrum
   // Game
   const auto visualize_physics = true;
 
-  // Assets
-  const auto import_assets = false;
-
   // Rendering
   // TODO Handle this better, 16 here crashed on my new laptop (Zephyrus G14)
   const auto msaa_samples = uint8_t(8);
@@ -63,5 +60,6 @@ namespace astrum
   // Trees
   const auto tree_type_count = uint32_t(4);
   const auto tree_types = std::vector<std::string> { "fruit", "oak", "palm", "pine" };
+  const auto tree_collapse_iterations = std::vector<uint32_t> { 200, 50, 12 };
   const auto tree_lods = std::vector<lod> { { 0, terra_radius * 1.6f }, { 1, terra_radius * 0.3f }, { 2, terra_radius * 0.2f }, { 3, terra_radius * 0.1f } };
 }
@@ -52,6 +52,7 @@ int main()
     render_programs,
     {
       .format = lod_format,
+      .index_size = sizeof(uint16_t),
       .shader_buffer = ludo::allocate_dual(2 * 2 * sizeof(float)),
       .instance_size = sizeof(ludo::mat4) + sizeof(uint32_t) + 12 // align 16
     }
@@ -96,8 +97,8 @@ int main()
 
     auto rotation = ludo::quat(float((*mouse_movement_accumulator)[1]) / 250.0f, float((*mouse_movement_accumulator)[0]) / 250.0f, 0.0f);
 
-    ludo::instance_transform(lod_render_mesh_0) = ludo::mat4(ludo::vec3(-6.0f, -4.0f, -16.0f), ludo::mat3(rotation));
-    ludo::instance_transform(lod_render_mesh_1) = ludo::mat4(ludo::vec3(6.0f, -4.0f, -16.0f), ludo::mat3(rotation));
+    ludo::set_instance_transform(lod_render_mesh_0, ludo::mat4(ludo::vec3(-6.0f, -4.0f, -16.0f), ludo::mat3(rotation)));
+    ludo::set_instance_transform(lod_render_mesh_1, ludo::mat4(ludo::vec3(6.0f, -4.0f, -16.0f), ludo::mat3(rotation)));
 
     auto time = std::sin(inst.total_time / 2.0f) * 0.5f + 0.5f;
     auto stream = ludo::stream(render_program->shader_buffer.back);
@@ -22,7 +22,7 @@ namespace astrum
     auto render_mesh = ludo::add(inst, ludo::render_mesh(), "people");
     ludo::init(*render_mesh, *render_program, *mesh, indices, vertices, 1);
 
-    ludo::instance_transform(*render_mesh) = ludo::mat4(initial_transform.position, ludo::mat3(initial_transform.rotation));
+    ludo::set_instance_transform(*render_mesh, ludo::mat4(initial_transform.position, ludo::mat3(initial_transform.rotation)));
     ludo::add(*grid, *render_mesh, initial_transform.position);
 
     ludo::add(
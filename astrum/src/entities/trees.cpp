@@ -48,6 +48,7 @@ namespace astrum
       ludo::render_program
       {
         .format = lod_format,
+        .index_size = sizeof(uint16_t),
         .shader_buffer = ludo::allocate_dual(tree_lods.size() * 2 * sizeof(float)),
         .instance_size = tree_instance_size,
         .push_on_bind = false
@@ -83,15 +84,14 @@ namespace astrum
             .max = point_mass.transform.position + bounds_half_dimensions
           },
           .cell_count_1d = 16,
-          .cell_capacity = 48,
+          .cell_capacity = 8,
+          .front_buffer_count = 0 // Culled on the CPU
         },
       "trees"
     );
-    grid->compute_program_id = ludo::add(inst, ludo::build_compute_program(*grid))->id;
     ludo::init(*grid);
 
     ludo::commit(*render_program);
-    ludo::commit(*grid);
   }
 
   void stream_trees(ludo::instance& inst, uint32_t celestial_body_index)
@@ -118,7 +118,6 @@ namespace astrum
     auto bounds_half_dimensions = ludo::vec3 { celestial_body.radius * 1.1f, celestial_body.radius * 1.1f, celestial_body.radius * 1.1f };
     grid->bounds.min = point_mass.transform.position - bounds_half_dimensions;
     grid->bounds.max = point_mass.transform.position + bounds_half_dimensions;
-    ludo::commit_header(*grid);
 
     auto push_required = false;
     for (auto chunk_index = uint32_t(0); chunk_index < terrain.chunks.size(); chunk_index++)
@@ -130,7 +129,7 @@ namespace astrum
       }
 
       auto chunk_position = point_mass.transform.position + chunk.center;
-      auto lod_index = find_lod_index(tree_lods, camera_position, chunk_position, chunk.normal);
+      auto lod_index = chunk.beyond_horizon ? 0 : find_lod_index(tree_lods, camera_position, chunk_position);
 
       if (lod_index > 0 && !chunk.trees_loaded)
       {
@@ -202,6 +201,11 @@ namespace astrum
                 instance_stream.position += tree_instance_size - sizeof(uint32_t);
               }
 
+              for (auto instance_index = uint32_t(0); instance_index < render_mesh->instances.count; instance_index++)
+              {
+                ludo::mark_instance_dirty(*render_mesh, instance_index);
+              }
+
               ludo::remove(*grid, *render_mesh, chunk_position);
               ludo::add(*grid, *render_mesh, chunk_position);
               push_required = true;
@@ -213,9 +217,7 @@ namespace astrum
 
     if (push_required)
     {
-      // TODO not while render could be happening!!!
       ludo::commit(*render_program);
-      ludo::commit(*grid);
     }
   }
 
@@ -260,7 +262,7 @@ namespace astrum
         auto tree_rotation = ludo::mat3(ludo::vec3_unit_y, tree.position) * ludo::mat3(ludo::vec3_unit_y, tree.rotation);
         auto tree_transform = ludo::mat4(tree_position, tree_rotation);
         ludo::scale(tree_transform, { tree.scale, tree.scale, tree.scale });
-        ludo::instance_transform(*render_mesh, tree_index) = tree_transform;
+        ludo::set_instance_transform(*render_mesh, tree_transform, tree_index);
         ludo::cast<uint32_t>(render_mesh->instance_buffer, tree_index * tree_instance_size + sizeof(ludo::mat4)) = lod_index;
       }
 
@@ -11,6 +11,7 @@
 #include "post-processing/pass.h"
 #include "post-processing/util.h"
 #include "solar_system.h"
+#include "terrain/static_bodies.h"
 #include "terrain/terrain.h"
 #include "util.h"
 
@@ -27,10 +28,10 @@ int main()
   auto luna_mesh_counts = astrum::terrain_counts(astrum::luna_lods);
   auto tree_counts = std::array<std::pair<uint32_t, uint32_t>, astrum::tree_type_count>
   {
-    astrum::import_assets ? ludo::import_counts(ludo::asset_folder + "/models/fruit-tree.dae") : ludo::mesh_counts(ludo::asset_folder + "/meshes/fruit-tree-0.lmesh"),
-    astrum::import_assets ? ludo::import_counts(ludo::asset_folder + "/models/oak-tree.dae") : ludo::mesh_counts(ludo::asset_folder + "/meshes/oak-tree-0.lmesh"),
-    astrum::import_assets ? ludo::import_counts(ludo::asset_folder + "/models/palm-tree.dae") : ludo::mesh_counts(ludo::asset_folder + "/meshes/palm-tree-0.lmesh"),
-    astrum::import_assets ? ludo::import_counts(ludo::asset_folder + "/models/pine-tree.dae") : ludo::mesh_counts(ludo::asset_folder + "/meshes/pine-tree-0.lmesh")
+    astrum::lod_mesh_counts(ludo::asset_folder + "/models/fruit-tree.dae", ludo::asset_folder + "/meshes/fruit-tree.lmesh", ludo::vertex_format_pnc, astrum::tree_collapse_iterations),
+    astrum::lod_mesh_counts(ludo::asset_folder + "/models/oak-tree.dae", ludo::asset_folder + "/meshes/oak-tree.lmesh", ludo::vertex_format_pnc, astrum::tree_collapse_iterations),
+    astrum::lod_mesh_counts(ludo::asset_folder + "/models/palm-tree.dae", ludo::asset_folder + "/meshes/palm-tree.lmesh", ludo::vertex_format_pnc, astrum::tree_collapse_iterations),
+    astrum::lod_mesh_counts(ludo::asset_folder + "/models/pine-tree.dae", ludo::asset_folder + "/meshes/pine-tree.lmesh", ludo::vertex_format_pnc, astrum::tree_collapse_iterations)
   };
   auto person_mesh_counts = ludo::import_counts(ludo::asset_folder + "/models/minifig.dae");
   auto spaceship_mesh_counts = ludo::import_counts(ludo::asset_folder + "/models/spaceship.dae");
@@ -92,6 +93,7 @@ int main()
   ludo::allocate<ludo::grid3>(inst, 5);
   ludo::allocate<ludo::kinematic_body>(inst, 2);
   ludo::allocate<ludo::mesh>(inst, max_rendered_instances);
+  ludo::allocate<ludo::occlusion_buffer>(inst, 1);
   ludo::allocate<ludo::render_mesh>(inst, max_rendered_instances);
   ludo::allocate<ludo::render_program>(inst, 12);
   ludo::allocate<ludo::script>(inst, 36);
@@ -129,12 +131,16 @@ int main()
           .min = { -2.0f * astrum::astronomical_unit, -2.0f * astrum::astronomical_unit, -2.0f * astrum::astronomical_unit },
           .max = { 2.0f * astrum::astronomical_unit, 2.0f * astrum::astronomical_unit, 2.0f * astrum::astronomical_unit }
         },
-        .cell_count_1d = 16
+        .cell_count_1d = 16,
+        .track_locations = true
       }
   );
   default_grid->compute_program_id = ludo::add(inst, ludo::build_compute_program(*default_grid))->id;
   ludo::init(*default_grid);
 
+  auto occlusion_buffer = ludo::add(inst, ludo::occlusion_buffer());
+  ludo::init(*occlusion_buffer);
+
   auto msaa_color_texture = ludo::add(inst, ludo::texture { .datatype = ludo::pixel_datatype::FLOAT16, .width = window->width, .height = window->height });
   ludo::init(*msaa_color_texture, { .samples = astrum::msaa_samples });
   auto msaa_depth_texture = ludo::add(inst, ludo::texture { .components = ludo::pixel_components::DEPTH, .datatype = ludo::pixel_datatype::FLOAT32, .width = window->width, .height = window->height });
@@ -184,14 +190,36 @@ int main()
 
   ludo::add<ludo::script>(inst, [](ludo::instance& inst)
   {
-    auto& grids = ludo::data<ludo::grid3>(inst);
+    auto& default_grids = ludo::data<ludo::grid3>(inst, "default");
+    auto& terrain_grids = ludo::data<ludo::grid3>(inst, "terrain");
+    auto& tree_grids = ludo::data<ludo::grid3>(inst, "trees");
+    auto occlusion_buffer = ludo::first<ludo::occlusion_buffer>(inst);
     auto rendering_context = ludo::first<ludo::rendering_context>(inst);
     auto& compute_programs = ludo::data<ludo::compute_program>(inst);
     auto& render_programs = ludo::data<ludo::render_program>(inst);
 
     auto& render_commands = ludo::data_heap(inst, "ludo::vram_render_commands");
 
-    ludo::add_render_commands(grids, compute_programs, render_programs, render_commands, ludo::get_camera(*rendering_context));
+    auto camera = ludo::get_camera(*rendering_context);
+    ludo::add_render_commands(*rendering_context, default_grids, compute_programs, render_programs, render_commands, camera);
+
+    // Terrain and trees are culled on the CPU instead, so that they can also be culled against the terrain nearby.
+    ludo::clear(*occlusion_buffer, camera);
+    astrum::add_terrain_occluders(inst, *occlusion_buffer);
+    ludo::commit(*occlusion_buffer);
+
+    for (auto& grid : terrain_grids)
+    {
+      ludo::add_render_commands(grid, render_programs, camera, *occlusion_buffer);
+    }
+    for (auto& grid : tree_grids)
+    {
+      ludo::add_render_commands(grid, render_programs, camera, *occlusion_buffer);
+    }
+
+    auto render_command_stats = ludo::merge_render_commands(render_programs);
+    astrum::total_render_command_stats.command_count_before += render_command_stats.command_count_before;
+    astrum::total_render_command_stats.command_count_after += render_command_stats.command_count_after;
   });
 
   if (astrum::visualize_physics)
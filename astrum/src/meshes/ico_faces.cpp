@@ -5,6 +5,9 @@ namespace astrum
   std::array<std::array<ludo::vec3, 3>, 20> ico_faces;
   bool built = false;
 
+  std::array<ludo::vec3, 20> ico_face_normals;
+  bool normals_built = false;
+
   const std::array<std::array<ludo::vec3, 3>, 20>& get_ico_faces()
   {
     if (!built)
@@ -70,4 +73,22 @@ namespace astrum
 
     return ico_faces;
   }
+
+  const std::array<ludo::vec3, 20>& get_ico_face_normals()
+  {
+    if (!normals_built)
+    {
+      auto& ico_faces = get_ico_faces();
+      for (auto face_index = uint32_t(0); face_index < ico_faces.size(); face_index++)
+      {
+        // The icosahedron is regular, so the direction of the centroid is the normal.
+        ico_face_normals[face_index] = ico_faces[face_index][0] + ico_faces[face_index][1] + ico_faces[face_index][2];
+        normalize(ico_face_normals[face_index]);
+      }
+
+      normals_built = true;
+    }
+
+    return ico_face_normals;
+  }
 }
@@ -5,4 +5,10 @@
 namespace astrum
 {
   const std::array<std::array<ludo::vec3, 3>, 20>& get_ico_faces();
+
+  ///
+  /// Gets the (unit length) normals of the faces of an icosahedron, in the same order as get_ico_faces.
+  /// The face a direction points through is the one whose normal has the greatest dot product with it.
+  /// \return The face normals.
+  const std::array<ludo::vec3, 20>& get_ico_face_normals();
 }
@@ -2,10 +2,16 @@
 
 namespace astrum
 {
-  std::vector<ludo::mesh> build_lod_meshes(const ludo::mesh& source, const ludo::vertex_format& format, ludo::heap& indices, ludo::heap& vertices, const std::vector<uint32_t>& iterations)
-  {
-    std::vector<ludo::mesh> lod_meshes;
+  // Increment to rebuild the LOD files when the way they are built changes.
+  const auto lod_build_version = uint32_t(2);
 
+  std::vector<ludo::mesh> build_lod_chain(const ludo::mesh& source, const ludo::vertex_format& format, const std::vector<uint32_t>& iterations);
+  ludo::mesh build_lod_mesh(ludo::mesh& base_mesh, const ludo::vertex_format& format, uint32_t iterations);
+  ludo::mesh build_clean_mesh(const ludo::mesh& source, const ludo::vertex_format& destination_format, const ludo::vertex_format& source_format);
+  uint32_t lod_key(const std::string& source_file_name, const ludo::vertex_format& format, const std::vector<uint32_t>& iterations);
+
+  ludo::vertex_format lod_vertex_format(const ludo::vertex_format& format)
+  {
     auto lod_format = format;
     lod_format.components.insert(lod_format.components.end(), format.components.begin(), format.components.end());
     lod_format.size *= 2;
@@ -14,61 +20,210 @@ namespace astrum
     lod_format.color_offset += format.size;
     lod_format.texture_coordinate_offset += format.size;
 
-    auto temp_mesh = ludo::mesh();
-    temp_mesh.index_buffer = ludo::allocate(source.index_buffer.size);
-    temp_mesh.vertex_buffer = ludo::allocate(source.vertex_buffer.size);
+    return lod_format;
+  }
+
+  std::vector<ludo::mesh> build_lod_meshes(const ludo::mesh& source, const ludo::vertex_format& format, ludo::heap& indices, ludo::heap& vertices, const std::vector<uint32_t>& iterations)
+  {
+    auto built_meshes = build_lod_chain(source, format, iterations);
+
+    auto lod_format = lod_vertex_format(format);
+
+    std::vector<ludo::mesh> lod_meshes;
+    for (auto& built_mesh : built_meshes)
+    {
+      auto& lod_mesh = lod_meshes.emplace_back();
+      ludo::init(lod_mesh, indices, vertices, ludo::index_count(built_mesh), static_cast<uint32_t>(built_mesh.vertex_buffer.size / lod_format.size), lod_format.size, built_mesh.index_size);
+      std::memcpy(lod_mesh.index_buffer.data, built_mesh.index_buffer.data, built_mesh.index_buffer.size);
+      std::memcpy(lod_mesh.vertex_buffer.data, built_mesh.vertex_buffer.data, built_mesh.vertex_buffer.size);
+
+      ludo::deallocate(built_mesh.index_buffer);
+      ludo::deallocate(built_mesh.vertex_buffer);
+    }
+
+    return lod_meshes;
+  }
+
+  std::vector<ludo::mesh> build_lod_chain(const ludo::mesh& source, const ludo::vertex_format& format, const std::vector<uint32_t>& iterations)
+  {
+    auto lod_format = lod_vertex_format(format);
 
+    // Each LOD starts from the collapsed copy of the previous LOD, so that they morph into each other.
+    auto lod_meshes = std::vector<ludo::mesh>();
     for (auto lod_iterations : iterations)
     {
-      auto counts = ludo::clean(
-        temp_mesh,
-        lod_meshes.empty() ? source : lod_meshes[lod_meshes.size() - 1],
-        format,
-        lod_meshes.empty() ? format : lod_format
+      auto base_mesh = lod_meshes.empty() ? build_clean_mesh(source, format, format) : build_clean_mesh(lod_meshes.back(), format, lod_format);
+      lod_meshes.push_back(build_lod_mesh(base_mesh, format, lod_iterations));
+    }
+
+    return lod_meshes;
+  }
+
+  ludo::mesh build_lod_mesh(ludo::mesh& base_mesh, const ludo::vertex_format& format, uint32_t iterations)
+  {
+    auto lod_format = lod_vertex_format(format);
+
+    auto index_count = ludo::index_count(base_mesh);
+    auto vertex_count = static_cast<uint32_t>(base_mesh.vertex_buffer.size / format.size);
+    auto lod_mesh = ludo::mesh
+    {
+      .index_buffer = ludo::allocate(index_count * ludo::compact_index_size(vertex_count)),
+      .vertex_buffer = ludo::allocate(vertex_count * lod_format.size),
+      .index_size = ludo::compact_index_size(vertex_count),
+      .vertex_size = lod_format.size
+    };
+
+    for (auto index_index = uint32_t(0); index_index < index_count; index_index++)
+    {
+      ludo::write_index(lod_mesh, index_index, ludo::read_index(base_mesh, index_index));
+    }
+
+    for (auto vertex_index = uint32_t(0); vertex_index < vertex_count; vertex_index++)
+    {
+      auto vertex_position = vertex_index * format.size;
+
+      std::memcpy(
+        lod_mesh.vertex_buffer.data + vertex_position * 2,
+        base_mesh.vertex_buffer.data + vertex_position,
+        format.size
       );
+      std::memcpy(
+        lod_mesh.vertex_buffer.data + vertex_position * 2 + format.size,
+        base_mesh.vertex_buffer.data + vertex_position,
+        format.size
+      );
+    }
+
+    ludo::deallocate(base_mesh.index_buffer);
+    ludo::deallocate(base_mesh.vertex_buffer);
+
+    ludo::collapse(lod_mesh, lod_format, iterations);
+    ludo::optimize(lod_mesh, lod_format);
 
-      auto lod_mesh = ludo::mesh();
-      ludo::init(lod_mesh, indices, vertices, counts.first, counts.second, lod_format.size);
-      std::memcpy(lod_mesh.index_buffer.data, temp_mesh.index_buffer.data, lod_mesh.index_buffer.size);
-      for (auto vertex_index = uint32_t(0); vertex_index < counts.second; vertex_index++)
+    return lod_mesh;
+  }
+
+  ludo::mesh build_clean_mesh(const ludo::mesh& source, const ludo::vertex_format& destination_format, const ludo::vertex_format& source_format)
+  {
+    auto counting_mesh = ludo::mesh();
+    auto counts = ludo::clean(counting_mesh, source, destination_format, source_format, true);
+
+    auto mesh = ludo::mesh
+    {
+      .index_buffer = ludo::allocate(counts.first * sizeof(uint32_t)),
+      .vertex_buffer = ludo::allocate(counts.second * destination_format.size),
+      .vertex_size = destination_format.size
+    };
+    ludo::clean(mesh, source, destination_format, source_format);
+
+    return mesh;
+  }
+
+  std::vector<std::vector<ludo::mesh>> load_lod_meshes(const std::vector<std::string>& source_file_names, const std::vector<std::string>& file_names, const ludo::vertex_format& format, ludo::heap& indices, ludo::heap& vertices, const std::vector<uint32_t>& iterations)
+  {
+    auto lod_format = lod_vertex_format(format);
+
+    // Rebuild the LOD files that are missing, or were built from a different source or with different parameters.
+    auto stale_indices = std::vector<uint32_t>();
+    auto stale_keys = std::vector<uint32_t>();
+    for (auto file_index = uint32_t(0); file_index < file_names.size(); file_index++)
+    {
+      auto key = lod_key(source_file_names[file_index], format, iterations);
+      if (key && ludo::mesh_key(file_names[file_index]) != key)
       {
-        auto vertex_position = vertex_index * format.size;
+        stale_indices.push_back(file_index);
+        stale_keys.push_back(key);
+      }
+    }
 
-        std::memcpy(
-          lod_mesh.vertex_buffer.data + vertex_position * 2,
-          temp_mesh.vertex_buffer.data + vertex_position,
-          format.size
-        );
-        std::memcpy(
-          lod_mesh.vertex_buffer.data + vertex_position * 2 + format.size,
-          temp_mesh.vertex_buffer.data + vertex_position,
-          format.size
+    if (!stale_indices.empty())
+    {
+      // The sources are only needed to build the LODs (which reads them repeatedly), so they are imported to RAM rather than VRAM.
+      auto source_heaps = std::vector<std::pair<ludo::heap, ludo::heap>>();
+      auto sources = std::vector<ludo::mesh>();
+      for (auto stale_index : stale_indices)
+      {
+        auto source_counts = ludo::import_counts(source_file_names[stale_index]);
+        auto& source_heap = source_heaps.emplace_back(
+          ludo::allocate_heap(source_counts.first * sizeof(uint32_t)),
+          ludo::allocate_heap(source_counts.second * format.size)
         );
+
+        sources.emplace_back(ludo::import(source_file_names[stale_index], source_heap.first, source_heap.second, { .merge_meshes = true }).meshes[0]);
       }
 
-      ludo::collapse(lod_mesh, lod_format, lod_iterations);
+      // The LODs of a source are built from each other, so only the sources are built in parallel.
+      auto built_meshes = std::vector<std::vector<ludo::mesh>>(stale_indices.size());
+      ludo::thread_pool_parallel_for(static_cast<uint32_t>(stale_indices.size()), [&](uint32_t source_index)
+      {
+        built_meshes[source_index] = build_lod_chain(sources[source_index], format, iterations);
+      });
 
-      lod_meshes.push_back(lod_mesh);
+      for (auto source_index = uint32_t(0); source_index < stale_indices.size(); source_index++)
+      {
+        ludo::save(built_meshes[source_index], lod_format, file_names[stale_indices[source_index]], true, stale_keys[source_index]);
+
+        for (auto& built_mesh : built_meshes[source_index])
+        {
+          ludo::deallocate(built_mesh.index_buffer);
+          ludo::deallocate(built_mesh.vertex_buffer);
+        }
+
+        ludo::deallocate(source_heaps[source_index].first);
+        ludo::deallocate(source_heaps[source_index].second);
+      }
     }
 
-    ludo::deallocate(temp_mesh.index_buffer);
-    ludo::deallocate(temp_mesh.vertex_buffer);
+    auto lod_meshes = std::vector<std::vector<ludo::mesh>>();
+    for (auto& file_name : file_names)
+    {
+      lod_meshes.emplace_back(ludo::load_all(file_name, indices, vertices));
+    }
 
     return lod_meshes;
   }
 
-  uint32_t find_lod_index(const std::vector<lod>& lods, const ludo::vec3& camera_position, const ludo::vec3& target_position, const ludo::vec3& target_normal)
+  std::pair<uint32_t, uint32_t> lod_mesh_counts(const std::string& source_file_name, const std::string& file_name, const ludo::vertex_format& format, const std::vector<uint32_t>& iterations)
+  {
+    auto key = lod_key(source_file_name, format, iterations);
+    if (!key || ludo::mesh_key(file_name) == key)
+    {
+      return ludo::mesh_counts(file_name);
+    }
+
+    // Collapsing doesn't add indices or vertices, so no LOD can be larger than its source.
+    auto source_counts = ludo::import_counts(source_file_name);
+    auto lod_count = static_cast<uint32_t>(iterations.size());
+
+    return { source_counts.first * lod_count, source_counts.second * lod_count };
+  }
+
+  uint32_t lod_key(const std::string& source_file_name, const ludo::vertex_format& format, const std::vector<uint32_t>& iterations)
   {
-    auto to_camera = camera_position - target_position;
-    auto to_camera_unit = to_camera;
-    ludo::normalize(to_camera_unit);
+    auto source = ludo::map_file(source_file_name);
+    if (!source.data)
+    {
+      return 0;
+    }
 
-    // TODO make this part of frustum culling instead?
-    if (ludo::dot(to_camera_unit, target_normal) < -0.5f)
+    auto hash = ludo::hash(source.data, source.size);
+    ludo::unmap_file(source);
+
+    hash = ludo::hash(reinterpret_cast<const std::byte*>(&lod_build_version), sizeof(lod_build_version), hash);
+    hash = ludo::hash(reinterpret_cast<const std::byte*>(iterations.data()), iterations.size() * sizeof(uint32_t), hash);
+    for (auto& component : format.components)
     {
-      return uint32_t(0);
+      hash = ludo::hash(reinterpret_cast<const std::byte*>(&component.first), sizeof(component.first), hash);
+      hash = ludo::hash(reinterpret_cast<const std::byte*>(&component.second), sizeof(component.second), hash);
     }
 
+    // A key of 0 means that there is no key (see ludo::mesh_key).
+    auto key = static_cast<uint32_t>(hash ^ (hash >> 32));
+    return key ? key : 1;
+  }
+
+  uint32_t find_lod_index(const std::vector<lod>& lods, const ludo::vec3& camera_position, const ludo::vec3& target_position)
+  {
     auto distance_to_camera = ludo::length(camera_position - target_position);
 
     for (auto variant_index = uint32_t(lods.size() - 1); variant_index < lods.size(); variant_index--)
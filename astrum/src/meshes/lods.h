@@ -10,7 +10,13 @@ namespace astrum
     float max_distance;
   };
 
+  ludo::vertex_format lod_vertex_format(const ludo::vertex_format& format);
+
   std::vector<ludo::mesh> build_lod_meshes(const ludo::mesh& source, const ludo::vertex_format& format, ludo::heap& indices, ludo::heap& vertices, const std::vector<uint32_t>& iterations);
 
-  uint32_t find_lod_index(const std::vector<lod>& lods, const ludo::vec3& camera_position, const ludo::vec3& target_position, const ludo::vec3& target_normal);
+  std::vector<std::vector<ludo::mesh>> load_lod_meshes(const std::vector<std::string>& source_file_names, const std::vector<std::string>& file_names, const ludo::vertex_format& format, ludo::heap& indices, ludo::heap& vertices, const std::vector<uint32_t>& iterations);
+
+  std::pair<uint32_t, uint32_t> lod_mesh_counts(const std::string& source_file_name, const std::string& file_name, const ludo::vertex_format& format, const std::vector<uint32_t>& iterations);
+
+  uint32_t find_lod_index(const std::vector<lod>& lods, const ludo::vec3& camera_position, const ludo::vec3& target_position);
 }
@@ -32,7 +32,12 @@ namespace astrum
     {
       grid.bounds.min += delta;
       grid.bounds.max += delta;
-      ludo::commit_header(grid);
+
+      // The terrain and tree grids are only read on the CPU.
+      if (!grid.front_buffers.empty())
+      {
+        ludo::commit_header(grid);
+      }
     }
 
     for (auto& partition_pair : render_meshes.partitions)
@@ -48,8 +53,9 @@ namespace astrum
         {
           for (auto instance_index = uint32_t(0); instance_index < render_mesh.instances.count; instance_index++)
           {
-            auto& transform = ludo::instance_transform(render_mesh, instance_index);
+            auto transform = ludo::instance_transform(render_mesh, instance_index);
             ludo::position(transform, ludo::position(transform) + delta);
+            ludo::set_instance_transform(render_mesh, transform, instance_index);
           }
         }
       }
@@ -99,17 +99,12 @@ namespace astrum
         auto old_transform = ludo::instance_transform(render_mesh);
         auto new_transform = ludo::mat4(point_mass.transform.position, ludo::mat3(point_mass.transform.rotation));
 
-        ludo::instance_transform(render_mesh) = new_transform;
+        ludo::set_instance_transform(render_mesh, new_transform);
 
         auto old_position = ludo::position(old_transform);
         auto new_position = ludo::position(new_transform);
 
-        auto movement = new_position - old_position;
-        if (ludo::length2(movement) > 0.0f)
-        {
-          ludo::remove(grid, render_mesh, old_position);
-          ludo::add(grid, render_mesh, new_position);
-        }
+        ludo::move(grid, render_mesh, old_position, new_position);
       }
     }
   }
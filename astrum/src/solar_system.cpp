@@ -27,30 +27,19 @@ namespace astrum
     auto& indices = ludo::data_heap(inst, "ludo::vram_indices");
     auto& vertices = ludo::data_heap(inst, "ludo::vram_vertices");
 
-    auto tree_collapse_iterations = std::vector<uint32_t> { 200, 50, 12 };
-    auto tree_lod_meshes = std::array<std::vector<ludo::mesh>, tree_type_count>();
-    if (import_assets)
+    auto tree_source_file_names = std::vector<std::string>();
+    auto tree_file_names = std::vector<std::string>();
+    for (auto& tree_type : tree_types)
     {
-      for (auto tree_type_index = uint32_t(0); tree_type_index < tree_types.size(); tree_type_index++)
-      {
-        auto tree_import = ludo::import(ludo::asset_folder + "/models/" + tree_types[tree_type_index] + "-tree.dae", indices, vertices, { .merge_meshes = true });
-        tree_lod_meshes[tree_type_index] = build_lod_meshes(tree_import.meshes[0], ludo::vertex_format_pnc, indices, vertices, tree_collapse_iterations);
-        std::reverse(tree_lod_meshes[tree_type_index].begin(), tree_lod_meshes[tree_type_index].end());
-        for (auto lod_index = uint32_t(0); lod_index < tree_collapse_iterations.size(); lod_index++)
-        {
-          ludo::save(tree_lod_meshes[tree_type_index][lod_index], ludo::asset_folder + "/meshes/" + tree_types[tree_type_index] + "-tree-" + std::to_string(lod_index) + ".lmesh");
-        }
-      }
+      tree_source_file_names.emplace_back(ludo::asset_folder + "/models/" + tree_type + "-tree.dae");
+      tree_file_names.emplace_back(ludo::asset_folder + "/meshes/" + tree_type + "-tree.lmesh");
     }
-    else
+
+    // The LODs are rebuilt (in parallel) whenever the tree models or the collapse iterations change.
+    auto tree_lod_meshes = load_lod_meshes(tree_source_file_names, tree_file_names, ludo::vertex_format_pnc, indices, vertices, tree_collapse_iterations);
+    for (auto& lod_meshes : tree_lod_meshes)
     {
-      for (auto tree_type_index = uint32_t(0); tree_type_index < tree_types.size(); tree_type_index++)
-      {
-        for (auto lod_index = uint32_t(0); lod_index < tree_collapse_iterations.size(); lod_index++)
-        {
-          tree_lod_meshes[tree_type_index].emplace_back(ludo::load(ludo::asset_folder + "/meshes/" + tree_types[tree_type_index] + "-tree-" + std::to_string(lod_index) + ".lmesh", indices, vertices));
-        }
-      }
+      std::reverse(lod_meshes.begin(), lod_meshes.end());
     }
 
     for (auto tree_type_index = uint32_t(0); tree_type_index < tree_types.size(); tree_type_index++)
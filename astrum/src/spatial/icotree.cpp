@@ -2,6 +2,8 @@
  * This file is part of ludo. See the LICENSE file for the full license governing this code.
  */
 
+#include <cmath>
+
 #include "../meshes/ico_faces.h"
 #include "icotree.h"
 
@@ -10,76 +12,151 @@ namespace astrum
   uint32_t find_cell(const icotree& icotree, const std::function<int32_t(const std::array<ludo::vec3, 3>& face)>& test, uint32_t divisions, const std::array<ludo::vec3, 3>& face, uint32_t cumulative_index);
   void find_cells(const icotree& icotree, const std::function<int32_t(const std::array<ludo::vec3, 3>& face)>& test, uint32_t divisions, const std::array<ludo::vec3, 3>& face, uint32_t cumulative_index, std::vector<uint32_t>& results);
   uint32_t cell_element_index(const icotree& icotree, uint32_t cell_index, const ludo::vec3& element);
-  uint64_t cell_offset(const icotree& icotree, uint32_t cell_index);
+  std::array<ludo::vec3, 3> division_normals(const std::array<ludo::vec3, 3>& face);
   std::array<std::array<ludo::vec3, 3>, 4> divided_faces(const std::array<ludo::vec3, 3>& face);
   bool within(const std::array<ludo::vec3, 3>& face, const ludo::vec3& position);
 
   void init(icotree& icotree)
   {
-    auto cell_size = sizeof(uint32_t) + icotree.cell_capacity * sizeof(ludo::vec3);
+    icotree.pool =
+    {
+      .cell_count = astrum::cell_count(icotree),
+      .capacity = icotree.cell_capacity,
+      .entry_size = sizeof(ludo::vec3)
+    };
 
-    auto cell_count = astrum::cell_count(icotree);
-    auto data_size = cell_count * cell_size;
-    icotree.buffer = ludo::allocate(data_size);
+    icotree.buffer = ludo::init(icotree.pool);
 
-    auto offset = uint32_t(0);
-    for (auto cell_index = uint32_t(0); cell_index < cell_count; cell_index++)
+    // Subdivide every layer but the last once up front (in the same order as the cells are indexed) so that locating a cell doesn't need to.
+    icotree.division_normals.clear();
+
+    auto& ico_faces = get_ico_faces();
+    auto layer_faces = std::vector<std::array<ludo::vec3, 3>>(ico_faces.begin(), ico_faces.end());
+    for (auto division = uint32_t(0); division < icotree.divisions; division++)
     {
-      cast<uint32_t>(icotree.buffer, offset) = 0;
-      offset += cell_size;
+      auto next_layer_faces = std::vector<std::array<ludo::vec3, 3>>();
+      next_layer_faces.reserve(layer_faces.size() * 4);
+
+      for (auto& face : layer_faces)
+      {
+        icotree.division_normals.push_back(astrum::division_normals(face));
+
+        auto divided_faces = astrum::divided_faces(face);
+        next_layer_faces.insert(next_layer_faces.end(), divided_faces.begin(), divided_faces.end());
+      }
+
+      layer_faces = std::move(next_layer_faces);
     }
   }
 
   void destroy(icotree& icotree)
   {
     deallocate(icotree.buffer);
+    icotree.division_normals.clear();
   }
 
   void add(icotree& icotree, const ludo::vec3& element, const ludo::vec3& position)
   {
-    auto cell_index = find_cell(icotree, [&](const std::array<ludo::vec3, 3>& face)
+    auto cell_index = find_cell(icotree, position);
+
+    cast<ludo::vec3>(icotree.buffer, ludo::add(icotree.pool, icotree.buffer, cell_index)) = element;
+  }
+
+  void add(icotree& icotree, const std::vector<ludo::vec3>& elements, const std::vector<ludo::vec3>& positions)
+  {
+    assert(elements.size() == positions.size() && "elements and positions must be the same size");
+
+    auto cell_indices = find_cells(icotree, positions);
+    for (auto element_index = uint32_t(0); element_index < elements.size(); element_index++)
     {
-      return within(face, position) ? 1 : -1;
-    });
+      cast<ludo::vec3>(icotree.buffer, ludo::add(icotree.pool, icotree.buffer, cell_indices[element_index])) = elements[element_index];
+    }
+  }
 
-    assert(cell_index != std::numeric_limits<uint32_t>::max() && "cell not found");
+  void remove(icotree& icotree, const ludo::vec3& element, const ludo::vec3& position)
+  {
+    auto cell_index = find_cell(icotree, position);
 
-    auto offset = cell_offset(icotree, cell_index);
-    auto stream = ludo::stream(icotree.buffer, offset);
+    auto element_index = cell_element_index(icotree, cell_index, element);
+    assert(element_index != std::numeric_limits<uint32_t>::max() && "element not found");
 
-    auto element_count = peek<uint32_t>(stream);
-    assert(element_count < icotree.cell_capacity && "cell is full");
+    ludo::remove(icotree.pool, icotree.buffer, cell_index, element_index);
+  }
 
-    write(stream, element_count + 1);
-    stream.position += element_count * sizeof(ludo::vec3);
-    write(stream, element);
+  void remove(icotree& icotree, const std::vector<ludo::vec3>& elements, const std::vector<ludo::vec3>& positions)
+  {
+    assert(elements.size() == positions.size() && "elements and positions must be the same size");
+
+    auto cell_indices = find_cells(icotree, positions);
+    for (auto element_index = uint32_t(0); element_index < elements.size(); element_index++)
+    {
+      auto cell_element_index = astrum::cell_element_index(icotree, cell_indices[element_index], elements[element_index]);
+      assert(cell_element_index != std::numeric_limits<uint32_t>::max() && "element not found");
+
+      ludo::remove(icotree.pool, icotree.buffer, cell_indices[element_index], cell_element_index);
+    }
   }
 
-  void remove(icotree& icotree, const ludo::vec3& element, const ludo::vec3& position)
+  uint32_t find_cell(const icotree& icotree, const ludo::vec3& position)
   {
-    auto cell_index = find_cell(icotree, [&](const std::array<ludo::vec3, 3>& face)
+    assert(ludo::length(position) > 0.0f && "position must not be zero");
+
+    // The face with the closest normal is the one the direction of the position points through.
+    auto& ico_face_normals = get_ico_face_normals();
+    auto cell_index = uint32_t(0);
+    auto max_dot = ludo::dot(ico_face_normals[0], position);
+    for (auto face_index = uint32_t(1); face_index < ico_face_normals.size(); face_index++)
     {
-      return within(face, position) ? 1 : -1;
-    });
+      auto dot = ludo::dot(ico_face_normals[face_index], position);
+      if (dot > max_dot)
+      {
+        cell_index = face_index;
+        max_dot = dot;
+      }
+    }
 
-    assert(cell_index != std::numeric_limits<uint32_t>::max() && "cell not found");
+    // Each division separates the corners of a face from its center with great circles, so the child can be determined by which side of them the position is on.
+    // This is exact on the sphere, so unlike within no epsilon is needed.
+    auto layer_start = uint32_t(0);
+    auto layer_count = uint32_t(ico_face_normals.size());
+    for (auto division = uint32_t(0); division < icotree.divisions; division++)
+    {
+      auto& division_normals = icotree.division_normals[layer_start + cell_index];
 
-    auto element_index = cell_element_index(icotree, cell_index, element);
-    assert(element_index < icotree.cell_capacity && "element not found");
+      auto child_index = uint32_t(3);
+      for (auto corner_index = uint32_t(0); corner_index < 3; corner_index++)
+      {
+        if (ludo::dot(division_normals[corner_index], position) > 0.0f)
+        {
+          child_index = corner_index;
+          break;
+        }
+      }
 
-    // TODO check adjacent cell in case of floating point inaccuracy?
+      cell_index = cell_index * 4 + child_index;
+      layer_start += layer_count;
+      layer_count *= 4;
+    }
 
-    auto offset = cell_offset(icotree, cell_index);
-    auto stream = ludo::stream(icotree.buffer, offset);
+    return cell_index;
+  }
 
-    auto element_count = peek<uint32_t>(stream) - 1;
-    write(stream, element_count);
-    stream.position += element_index * sizeof(ludo::vec3);
-    std::memmove(
-      icotree.buffer.data + stream.position,
-      icotree.buffer.data + stream.position + sizeof(ludo::vec3),
-      (element_count - element_index) * sizeof(ludo::vec3)
-    );
+  std::vector<uint32_t> find_cells(const icotree& icotree, const std::vector<ludo::vec3>& positions)
+  {
+    auto position_count = static_cast<uint32_t>(positions.size());
+    auto cell_indices = std::vector<uint32_t>(position_count);
+
+    auto batch_count = std::max(uint32_t(1), std::min(ludo::thread_pool_size() + 1, position_count / 1024));
+    auto batch_size = (position_count + batch_count - 1) / batch_count;
+    ludo::thread_pool_parallel_for(batch_count, [&](uint32_t batch_index)
+    {
+      for (auto position_index = batch_index * batch_size; position_index < std::min((batch_index + 1) * batch_size, position_count); position_index++)
+      {
+        cell_indices[position_index] = find_cell(icotree, positions[position_index]);
+      }
+    });
+
+    return cell_indices;
   }
 
   uint32_t find_cell(const icotree& icotree, const std::function<int32_t(const std::array<ludo::vec3, 3>& face)>& test)
@@ -160,43 +237,36 @@ namespace astrum
 
   uint32_t cell_count(const icotree& icotree)
   {
-    return static_cast<uint32_t>(20 * std::pow(4, icotree.divisions));
+    return 20 * (uint32_t(1) << (2 * icotree.divisions));
   }
 
-  ludo::buffer cell_element_data(const icotree& icotree, uint32_t cell_index)
+  std::vector<ludo::vec3> cell_elements(const icotree& icotree, uint32_t cell_index)
   {
-    auto offset = cell_offset(icotree, cell_index);
-    auto stream = ludo::stream(icotree.buffer, offset);
-
-    auto element_count = read<uint32_t>(stream);
-
-    return
+    auto elements = std::vector<ludo::vec3>();
+    ludo::for_each_entry(icotree.pool, icotree.buffer, cell_index, [&](uint64_t offset)
     {
-      .data = stream.data + stream.position,
-      .size = element_count * sizeof(ludo::vec3)
-    };
+      elements.push_back(cast<ludo::vec3>(icotree.buffer, offset));
+    });
+
+    return elements;
   }
 
   uint32_t cell_element_index(const icotree& icotree, uint32_t cell_index, const ludo::vec3& element)
   {
-    auto offset = cell_offset(icotree, cell_index);
-    auto stream = ludo::stream(icotree.buffer, offset);
+    auto element_index = uint32_t(0);
+    auto found_element_index = std::numeric_limits<uint32_t>::max();
 
-    auto element_count = read<uint32_t>(stream);
-    for (auto element_index = uint32_t(0); element_index < element_count; element_index++)
+    ludo::for_each_entry(icotree.pool, icotree.buffer, cell_index, [&](uint64_t offset)
     {
-      if (read<ludo::vec3>(stream) == element)
+      if (cast<ludo::vec3>(icotree.buffer, offset) == element)
       {
-        return element_index;
+        found_element_index = element_index;
       }
-    }
 
-    return icotree.cell_capacity;
-  }
+      element_index++;
+    });
 
-  uint64_t cell_offset(const icotree& icotree, uint32_t cell_index)
-  {
-    return cell_index * (sizeof(uint32_t) + icotree.cell_capacity * sizeof(ludo::vec3));
+    return found_element_index;
   }
 
   std::array<std::array<ludo::vec3, 3>, 4> divided_faces(const std::array<ludo::vec3, 3>& face)
@@ -221,6 +291,30 @@ namespace astrum
     }};
   }
 
+  std::array<ludo::vec3, 3> division_normals(const std::array<ludo::vec3, 3>& face)
+  {
+    auto divided_faces = astrum::divided_faces(face);
+
+    // The corner children are the first three divided faces, each with the two subdivision vertices that separate it from the center child.
+    auto normals = std::array<ludo::vec3, 3>
+    {{
+      ludo::cross(divided_faces[0][1], divided_faces[0][2]),
+      ludo::cross(divided_faces[1][0], divided_faces[1][2]),
+      ludo::cross(divided_faces[2][0], divided_faces[2][1])
+    }};
+
+    // Orient the normals towards the corners.
+    for (auto corner_index = uint32_t(0); corner_index < 3; corner_index++)
+    {
+      if (ludo::dot(normals[corner_index], face[corner_index]) < 0.0f)
+      {
+        normals[corner_index] = normals[corner_index] * -1.0f;
+      }
+    }
+
+    return normals;
+  }
+
   bool within(const std::array<ludo::vec3, 3>& face, const ludo::vec3& position)
   {
     // TODO refine
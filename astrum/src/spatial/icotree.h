@@ -15,10 +15,13 @@ namespace astrum
     uint64_t id = 0; ///< The ID of the icotree.
 
     uint32_t divisions = 1; ///< The number of divisions (layers) in the icotree.
-    uint32_t cell_capacity = 16; ///< The maximum number of render meshes that can be added to a cell.
+    uint32_t cell_capacity = 16; ///< The number of elements stored within each cell before it spills into overflow blocks.
     uint32_t max_populated_cells = 1;
 
+    ludo::cell_pool pool; ///< The layout of the cells (and their overflow blocks) within the buffer.
     ludo::buffer buffer;
+
+    std::vector<std::array<ludo::vec3, 3>> division_normals; ///< The normals of the great circles separating the corner children of each node from the center child (ordered by layer), used to locate cells directly.
   };
 
   void init(icotree& icotree);
@@ -32,6 +35,13 @@ namespace astrum
   /// \param position The position of the element.
   void add(icotree& icotree, const ludo::vec3& element, const ludo::vec3& position);
 
+  ///
+  /// Adds elements to an icotree. The cells of the elements are located in parallel.
+  /// \param icotree The icotree to add the elements to.
+  /// \param elements The elements to add to the icotree.
+  /// \param positions The position of each element.
+  void add(icotree& icotree, const std::vector<ludo::vec3>& elements, const std::vector<ludo::vec3>& positions);
+
   ///
   /// Removes an element from an icotree.
   /// \param icotree The icotree to remove the element from.
@@ -39,6 +49,29 @@ namespace astrum
   /// \param position The position of the element.
   void remove(icotree& icotree, const ludo::vec3& element, const ludo::vec3& position);
 
+  ///
+  /// Removes elements from an icotree. The cells of the elements are located in parallel.
+  /// \param icotree The icotree to remove the elements from.
+  /// \param elements The elements to remove from the icotree.
+  /// \param positions The position of each element.
+  void remove(icotree& icotree, const std::vector<ludo::vec3>& elements, const std::vector<ludo::vec3>& positions);
+
+  ///
+  /// Finds the cell containing a position within an icotree.
+  /// The icosahedron face is chosen by its normal and each layer is then descended by testing which side of the great circles between
+  /// the (cached) subdivision vertices the position is on, so this costs a handful of dot products per layer.
+  /// \param icotree The icotree to search.
+  /// \param position The position (does not need to be unit length, but must not be zero).
+  /// \return The cell index.
+  uint32_t find_cell(const icotree& icotree, const ludo::vec3& position);
+
+  ///
+  /// Finds the cells containing positions within an icotree. The positions are processed in parallel.
+  /// \param icotree The icotree to search.
+  /// \param positions The positions (do not need to be unit length, but must not be zero).
+  /// \return The cell index of each position.
+  std::vector<uint32_t> find_cells(const icotree& icotree, const std::vector<ludo::vec3>& positions);
+
   ///
   /// Finds a cell within an icotree.
   /// \param icotree The icotree to search.
@@ -55,5 +88,5 @@ namespace astrum
 
   uint32_t cell_count(const icotree& icotree);
 
-  ludo::buffer cell_element_data(const icotree& icotree, uint32_t cell_index);
+  std::vector<ludo::vec3> cell_elements(const icotree& icotree, uint32_t cell_index);
 }
@@ -95,9 +95,9 @@ namespace astrum
     {
       auto i = vertex_index;
       auto v = vertex_index;
-      ludo::write_vertex(mesh, format, i, v, positions[0], normal, color, { 0.0f, 0.0f }, false);
-      ludo::write_vertex(mesh, format, i, v, positions[1], normal, color, { 0.0f, 0.0f }, false);
-      ludo::write_vertex(mesh, format, i, v, positions[2], normal, color, { 0.0f, 0.0f }, false);
+      ludo::write_vertex(mesh, format, i, v, positions[0], normal, color, { 0.0f, 0.0f });
+      ludo::write_vertex(mesh, format, i, v, positions[1], normal, color, { 0.0f, 0.0f });
+      ludo::write_vertex(mesh, format, i, v, positions[2], normal, color, { 0.0f, 0.0f });
 
       return vertex_index + 3;
     }
@@ -133,9 +133,9 @@ namespace astrum
 
       auto i = vertex_index;
       auto v = vertex_index;
-      ludo::write_vertex(mesh, format, i, v, position_0, normal, color, { 0.0f, 0.0f }, false);
-      ludo::write_vertex(mesh, format, i, v, position_1, normal, color, { 0.0f, 0.0f }, false);
-      ludo::write_vertex(mesh, format, i, v, position_2, normal, color, { 0.0f, 0.0f }, false);
+      ludo::write_vertex(mesh, format, i, v, position_0, normal, color, { 0.0f, 0.0f });
+      ludo::write_vertex(mesh, format, i, v, position_1, normal, color, { 0.0f, 0.0f });
+      ludo::write_vertex(mesh, format, i, v, position_2, normal, color, { 0.0f, 0.0f });
 
       return vertex_index + 3;
     }
@@ -8,11 +8,18 @@
 namespace astrum
 {
   std::vector<ludo::vec3> build_positions(const terrain& terrain, float radius, uint32_t index, uint32_t patch_divisions, uint32_t divisions);
+  void update_horizon_radius(terrain& terrain);
+
+  // Increment when the layout changes so that stale metadata files are rebuilt.
+  const auto metadata_version = uint64_t(1);
 
   void build_terrain_metadata(terrain& terrain, float radius)
   {
     auto& lowest_detail_lod = terrain.lods[0];
 
+    // Higher detail LODs can reach above the lowest detail surface, so the bounds are sampled from a more detailed surface.
+    auto bounds_detail_level = std::min(lowest_detail_lod.level + 2, terrain.lods[terrain.lods.size() - 1].level);
+
     auto patch_count = 20 * static_cast<uint32_t>(std::pow(4, lowest_detail_lod.level - 1));
     terrain.chunks.reserve(patch_count);
 
@@ -23,16 +30,53 @@ namespace astrum
       auto normal = ludo::cross(patch_positions[1] - patch_positions[0], patch_positions[2] - patch_positions[0]);
       ludo::normalize(normal);
 
+      auto center = (patch_positions[0] + patch_positions[1] + patch_positions[2]) / 3.0f;
+
+      // The flat lowest detail surface dips lowest where it is closest to the center of the planet (the distance to its plane).
+      // More detailed surfaces are made of smaller triangles that dip less, so this holds for them too.
+      auto unit_positions = patch_positions;
+      for (auto& unit_position : unit_positions)
+      {
+        ludo::normalize(unit_position);
+      }
+
+      auto unit_normal = ludo::cross(unit_positions[1] - unit_positions[0], unit_positions[2] - unit_positions[0]);
+      ludo::normalize(unit_normal);
+
+      auto bounding_radius = 0.0f;
+      auto min_vertex_radius = radius;
+      auto max_radius = 0.0f;
+      for (auto& position : build_positions(terrain, radius, patch_index, lowest_detail_lod.level, bounds_detail_level))
+      {
+        auto position_radius = ludo::length(position);
+
+        bounding_radius = std::max(bounding_radius, ludo::length(position - center));
+        min_vertex_radius = std::min(min_vertex_radius, position_radius);
+        max_radius = std::max(max_radius, position_radius);
+      }
+
       terrain.chunks.emplace_back(terrain_chunk
       {
-        .center = (patch_positions[0] + patch_positions[1] + patch_positions[2]) / 3.0f,
-        .normal = normal
+        .center = center,
+        .normal = normal,
+        .bounding_radius = bounding_radius,
+        .min_radius = min_vertex_radius * std::abs(ludo::dot(unit_normal, unit_positions[0])),
+        .max_radius = max_radius
       });
     }
+
+    update_horizon_radius(terrain);
   }
 
-  void read_terrain_metadata(std::istream& stream, terrain& terrain)
+  bool read_terrain_metadata(std::istream& stream, terrain& terrain)
   {
+    auto version = uint64_t();
+    stream.read(reinterpret_cast<char*>(&version), sizeof(uint64_t));
+    if (!stream || version != metadata_version)
+    {
+      return false;
+    }
+
     auto chunk_count = uint64_t();
     stream.read(reinterpret_cast<char*>(&chunk_count), sizeof(uint64_t));
     terrain.chunks = std::vector<terrain_chunk>(chunk_count);
@@ -40,17 +84,35 @@ namespace astrum
     {
       stream.read(reinterpret_cast<char*>(&chunk.center), sizeof(ludo::vec3));
       stream.read(reinterpret_cast<char*>(&chunk.normal), sizeof(ludo::vec3));
+      stream.read(reinterpret_cast<char*>(&chunk.bounding_radius), sizeof(float));
+      stream.read(reinterpret_cast<char*>(&chunk.min_radius), sizeof(float));
+      stream.read(reinterpret_cast<char*>(&chunk.max_radius), sizeof(float));
     }
+
+    if (!stream)
+    {
+      terrain.chunks.clear();
+      return false;
+    }
+
+    update_horizon_radius(terrain);
+
+    return true;
   }
 
   void write_terrain_metadata(std::ostream& stream, const terrain& terrain)
   {
+    stream.write(reinterpret_cast<const char*>(&metadata_version), sizeof(uint64_t));
+
     auto chunk_count = terrain.chunks.size();
     stream.write(reinterpret_cast<const char*>(&chunk_count), sizeof(uint64_t));
     for (auto& chunk : terrain.chunks)
     {
       stream.write(reinterpret_cast<const char*>(&chunk.center), sizeof(ludo::vec3));
       stream.write(reinterpret_cast<const char*>(&chunk.normal), sizeof(ludo::vec3));
+      stream.write(reinterpret_cast<const char*>(&chunk.bounding_radius), sizeof(float));
+      stream.write(reinterpret_cast<const char*>(&chunk.min_radius), sizeof(float));
+      stream.write(reinterpret_cast<const char*>(&chunk.max_radius), sizeof(float));
     }
   }
 
@@ -75,4 +137,14 @@ namespace astrum
 
     return patch_positions;
   }
+
+  void update_horizon_radius(terrain& terrain)
+  {
+    // The horizon sphere must be beneath all of the terrain's surface, otherwise it could hide terrain in front of it.
+    terrain.horizon_radius = std::numeric_limits<float>::max();
+    for (auto& chunk : terrain.chunks)
+    {
+      terrain.horizon_radius = std::min(terrain.horizon_radius, chunk.min_radius);
+    }
+  }
 }
@@ -10,7 +10,7 @@ namespace astrum
 {
   void build_terrain_metadata(terrain& terrain, float radius);
 
-  void read_terrain_metadata(std::istream& stream, terrain& terrain);
+  bool read_terrain_metadata(std::istream& stream, terrain& terrain);
 
   void write_terrain_metadata(std::ostream& stream, const terrain& terrain);
 }
@@ -93,4 +93,39 @@ namespace astrum
       static_body_iter = terrain.static_body_ids.erase(static_body_iter);
     }
   }
+
+  void add_terrain_occluders(ludo::instance& inst, ludo::occlusion_buffer& occlusion_buffer)
+  {
+    auto& point_masses = ludo::data<point_mass>(inst, "celestial-bodies");
+    auto& terrains = ludo::data<terrain>(inst, "celestial-bodies");
+
+    auto positions = std::vector<ludo::vec3>();
+    auto indices = std::vector<uint32_t>();
+    for (auto index = uint32_t(0); index < terrains.length; index++)
+    {
+      // Transformed the same way as the terrain is when rendered.
+      auto& point_mass = point_masses[index];
+      auto rotation = ludo::mat3(point_mass.transform.rotation);
+
+      for (auto& [ section_index, static_body_mesh_id ] : terrains[index].static_body_mesh_ids)
+      {
+        auto static_body_mesh = ludo::get<ludo::mesh>(inst, "celestial-bodies", static_body_mesh_id);
+
+        auto vertex_start = static_cast<uint32_t>(positions.size());
+        auto vertex_count = static_cast<uint32_t>(static_body_mesh->vertex_buffer.size / ludo::vertex_format_p.size);
+        for (auto vertex_index = uint32_t(0); vertex_index < vertex_count; vertex_index++)
+        {
+          positions.push_back(rotation * ludo::read_position(*static_body_mesh, ludo::vertex_format_p, vertex_index) + point_mass.transform.position);
+        }
+
+        auto index_count = ludo::index_count(*static_body_mesh);
+        for (auto index_index = uint32_t(0); index_index < index_count; index_index++)
+        {
+          indices.push_back(vertex_start + ludo::read_index(*static_body_mesh, index_index));
+        }
+      }
+    }
+
+    ludo::add_occluders(occlusion_buffer, positions, indices);
+  }
 }
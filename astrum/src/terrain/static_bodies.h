@@ -7,4 +7,7 @@
 namespace astrum
 {
   void update_terrain_static_bodies(ludo::instance& inst, terrain& terrain, float radius, const ludo::vec3& position, float point_mass_max_distance);
+
+  // Adds the meshes of the terrain static bodies (the most detailed terrain around point masses e.g. the person) as occluders.
+  void add_terrain_occluders(ludo::instance& inst, ludo::occlusion_buffer& occlusion_buffer);
 }
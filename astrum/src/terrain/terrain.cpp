@@ -29,12 +29,10 @@ namespace astrum
 
     auto metadata_file_name = ludo::asset_folder + "/meshes/" + celestial_body.name + ".terrain";
     auto read_stream = std::ifstream(metadata_file_name, std::ios::binary);
-    if (read_stream.is_open())
-    {
-      read_terrain_metadata(read_stream, *terrain);
-    }
-    else
+    if (!read_stream.is_open() || !read_terrain_metadata(read_stream, *terrain))
     {
+      read_stream.close();
+
       build_terrain_metadata(*terrain, celestial_body.radius);
       auto write_stream = std::ofstream(metadata_file_name, std::ios::binary);
       write_terrain_metadata(write_stream, *terrain);
@@ -43,11 +41,13 @@ namespace astrum
     terrain->format.components.insert(terrain->format.components.end(), terrain->format.components.begin(), terrain->format.components.end());
     terrain->format.size *= 2;
 
+    auto max_count = 3 * static_cast<uint32_t>(std::pow(4, terrain->lods[terrain->lods.size() - 1].level - terrain->lods[0].level));
     auto render_program = ludo::add(
       inst,
       ludo::render_program
       {
         .format = terrain->format,
+        .index_size = ludo::compact_index_size(max_count),
         .shader_buffer = ludo::allocate_dual(sizeof(ludo::mat4) + terrain->lods.size() * 2 * sizeof(float)),
         .instance_size = sizeof(uint32_t)
       },
@@ -85,11 +85,11 @@ namespace astrum
           .min = point_mass.transform.position - bounds_half_dimensions,
           .max = point_mass.transform.position + bounds_half_dimensions
         },
-        .cell_count_1d = 16
+        .cell_count_1d = 16,
+        .front_buffer_count = 0 // Culled on the CPU
       },
       "terrain"
     );
-    grid->compute_program_id = ludo::add(inst, ludo::build_compute_program(*grid))->id;
     ludo::init(*grid);
 
     auto camera = ludo::get_camera(*rendering_context);
@@ -98,29 +98,32 @@ namespace astrum
     for (auto chunk_index = uint32_t(0); chunk_index < terrain->chunks.size(); chunk_index++)
     {
       auto& chunk = terrain->chunks[chunk_index];
-      chunk.lod_index = find_lod_index(terrain->lods, camera_position, point_mass.transform.position + chunk.center, chunk.normal);
+      chunk.beyond_horizon = beyond_horizon(*terrain, chunk, camera_position, point_mass.transform.position);
+      chunk.lod_index = chunk.beyond_horizon ? 0 : find_lod_index(terrain->lods, camera_position, point_mass.transform.position + chunk.center);
 
       auto count = 3 * static_cast<uint32_t>(std::pow(4, init.lods[chunk.lod_index].level - init.lods[0].level));
 
       auto mesh = ludo::add(inst, ludo::mesh(), "terrain");
-      ludo::init(*mesh, indices, vertices, count, count, render_program->format.size);
+      ludo::init(*mesh, indices, vertices, count, count, render_program->format.size, render_program->index_size);
 
       auto render_mesh = add(inst, ludo::render_mesh { .instances = { .start = chunk_index, .count = 1 } }, "terrain" );
       ludo::init(*render_mesh);
       ludo::connect(*render_mesh, *render_program, 1);
       ludo::connect(*render_mesh, *mesh, indices, vertices);
       ludo::cast<uint32_t>(render_mesh->instance_buffer, 0) = chunk.lod_index;
+      ludo::mark_instance_dirty(*render_mesh);
 
       chunk.mesh_id = mesh->id;
       chunk.render_mesh_id = render_mesh->id;
 
       load_terrain_chunk(*terrain, celestial_body.radius, chunk_index, chunk.lod_index, *mesh);
 
-      ludo::add(*grid, *render_mesh, point_mass.transform.position + chunk.center);
+      if (!chunk.beyond_horizon)
+      {
+        ludo::add(*grid, *render_mesh, point_mass.transform.position + chunk.center);
+      }
     }
 
-    ludo::commit(*grid);
-
     update_terrain_static_bodies(inst, *terrain, celestial_body.radius, point_mass.transform.position, celestial_body.radius * 1.25f);
   }
 
@@ -172,7 +175,6 @@ namespace astrum
       {
         grid.bounds.min += movement;
         grid.bounds.max += movement;
-        ludo::commit_header(grid);
 
         ludo::cast<ludo::mat4>(render_program.shader_buffer.back, 0) = ludo::mat4(new_position, ludo::mat3(point_mass.transform.rotation));
       }
@@ -187,7 +189,30 @@ namespace astrum
           continue;
         }
 
-        auto new_lod_index = find_lod_index(terrain.lods, camera_position, new_position + chunk.center, chunk.normal);
+        // Chunks beyond the horizon are taken out of the grid (so they aren't drawn) and their LOD is left as it is.
+        // Chunks can't cross the horizon while they are locked, so the grid is left alone when their new mesh is connected.
+        auto chunk_beyond_horizon = beyond_horizon(terrain, chunk, camera_position, new_position);
+        if (chunk_beyond_horizon != chunk.beyond_horizon)
+        {
+          auto render_mesh = ludo::get<ludo::render_mesh>(inst, "terrain", chunk.render_mesh_id);
+          if (chunk_beyond_horizon)
+          {
+            ludo::remove(grid, *render_mesh, new_position + chunk.center);
+          }
+          else
+          {
+            ludo::add(grid, *render_mesh, new_position + chunk.center);
+          }
+
+          chunk.beyond_horizon = chunk_beyond_horizon;
+        }
+
+        if (chunk.beyond_horizon)
+        {
+          continue;
+        }
+
+        auto new_lod_index = find_lod_index(terrain.lods, camera_position, new_position + chunk.center);
         if (new_lod_index != chunk.lod_index)
         {
           chunk.locked = true;
@@ -195,7 +220,7 @@ namespace astrum
           auto count = 3 * static_cast<uint32_t>(std::pow(4, terrain.lods[new_lod_index].level - terrain.lods[0].level));
 
           auto new_mesh = ludo::add(inst, ludo::mesh(), "terrain");
-          ludo::init(*new_mesh, indices, vertices, count, count, render_program.format.size);
+          ludo::init(*new_mesh, indices, vertices, count, count, render_program.format.size, render_program.index_size);
 
           // Purposely take a copy of the new mesh!
           // Otherwise, it may get shifted in the partitioned_buffer and cause all sorts of havoc.
@@ -212,9 +237,6 @@ namespace astrum
           });
         }
       }
-
-      // TODO not while render could be happening!!!
-      ludo::commit(grid);
     }
 
     new_chunks_mutex.lock();
@@ -245,9 +267,7 @@ namespace astrum
       ludo::add(grid, *render_mesh, point_mass.transform.position + chunk.center);
 
       ludo::cast<uint32_t>(render_mesh->instance_buffer, 0) = chunk.lod_index;
-
-      // TODO not while render could be happening!!!
-      ludo::commit(grid);
+      ludo::mark_instance_dirty(*render_mesh);
     }
     new_chunks_mutex.unlock();
   }
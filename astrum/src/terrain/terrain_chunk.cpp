@@ -17,4 +17,21 @@ namespace astrum
 
     terrain_mesh(terrain, radius, mesh, low_detail_format, terrain.format, true, chunk_index, lowest_detail_lod.level, low_detail_lod.level, high_detail_lod.level);
   }
+
+  bool beyond_horizon(const terrain& terrain, const terrain_chunk& chunk, const ludo::vec3& camera_position, const ludo::vec3& planet_position)
+  {
+    auto camera_radius = ludo::length(camera_position - planet_position);
+    if (camera_radius <= terrain.horizon_radius)
+    {
+      return false;
+    }
+
+    // A point can only be seen over the horizon if it is no further away than the distance from the camera to the horizon plus the distance from the horizon to the point.
+    // Every point of the chunk is at-least as far away as the nearest point of its bounding sphere, and no higher than its highest point.
+    auto camera_horizon_distance = std::sqrt(camera_radius * camera_radius - terrain.horizon_radius * terrain.horizon_radius);
+    auto chunk_horizon_distance = std::sqrt(std::max(chunk.max_radius * chunk.max_radius - terrain.horizon_radius * terrain.horizon_radius, 0.0f));
+    auto chunk_distance = ludo::length(planet_position + chunk.center - camera_position) - chunk.bounding_radius;
+
+    return chunk_distance > camera_horizon_distance + chunk_horizon_distance;
+  }
 }
@@ -7,4 +7,6 @@
 namespace astrum
 {
   void load_terrain_chunk(const terrain& terrain, float radius, uint32_t chunk_index, uint32_t lod_index, ludo::mesh& mesh);
+
+  bool beyond_horizon(const terrain& terrain, const terrain_chunk& chunk, const ludo::vec3& camera_position, const ludo::vec3& planet_position);
 }
@@ -26,8 +26,13 @@ namespace astrum
 
     ludo::vec3 center;
     ludo::vec3 normal;
+    float bounding_radius = 0.0f; // The radius of a sphere around the center containing the chunk.
+    float min_radius = 0.0f; // The distance from the center of the planet to the lowest point of the chunk's lowest detail surface.
+    float max_radius = 0.0f; // The distance from the center of the planet to the highest point of the chunk.
     uint32_t lod_index = 0;
 
+    bool beyond_horizon = false;
+
     bool trees_loaded = false;
     bool treeless = false;
     bool locked = false;
@@ -44,6 +49,7 @@ namespace astrum
     std::function<std::array<std::vector<tree>, tree_type_count>(const terrain& terrain, float radius, uint32_t chunk_index)> tree_func;
 
     std::vector<terrain_chunk> chunks;
+    float horizon_radius = 0.0f; // The radius of a sphere contained by the terrain, used as the horizon.
 
     std::unordered_map<uint32_t, uint64_t> static_body_ids;
     std::unordered_map<uint32_t, uint64_t> static_body_mesh_ids;
@@ -7,6 +7,8 @@
 
 namespace astrum
 {
+  ludo::render_command_stats total_render_command_stats;
+
   auto last_print_time = 0.0f;
   auto frame_count = 0;
 
@@ -92,8 +94,16 @@ namespace astrum
 
       auto padding_size = longest_script_name_size - std::string("all_scripts").size() + 2;
       std::cout << "  all_scripts" + std::string(padding_size, ' ') << average_frame_time << "ms" << std::endl;
+      std::cout << "Average instance data committed: " << ludo::committed_instance_bytes / std::max(frame_count, 1) << " bytes" << std::endl;
+      std::cout << "Average render state calls: " << ludo::render_state_call_count / std::max(frame_count, 1) << std::endl;
+      std::cout << "Average frame stall time: " << ludo::frame_stall_time / static_cast<float>(std::max(frame_count, 1)) * 1000.0f << "ms" << std::endl;
+      std::cout << "Average render commands (before/after merging): " << total_render_command_stats.command_count_before / std::max(frame_count, 1) << "/" << total_render_command_stats.command_count_after / std::max(frame_count, 1) << std::endl;
 
       ludo::total_script_times.clear();
+      ludo::committed_instance_bytes = 0;
+      ludo::render_state_call_count = 0;
+      ludo::frame_stall_time = 0.0f;
+      total_render_command_stats = {};
       frame_count = 0;
     }
 
@@ -4,5 +4,7 @@
 
 namespace astrum
 {
+  extern ludo::render_command_stats total_render_command_stats; // Accumulated over the frames between prints (see print_timings).
+
   void print_timings(ludo::instance& inst);
 }
@@ -5,6 +5,7 @@
 #include <ludo/animation.h>
 #include <ludo/importing.h>
 #include <ludo/meshes.h>
+#include <ludo/meshes/optimize.h>
 
 #include "animation.h"
 #include "math.h"
@@ -55,6 +56,10 @@ namespace ludo
         auto mesh = ludo::mesh();
         init(mesh, indices, vertices, index_count, vertex_count, format.size);
         write_mesh_data(mesh, assimp_mesh, format, mesh_object.transform, 0, 0);
+        if (options.optimize_meshes && assimp_mesh.mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+        {
+          optimize(mesh, format);
+        }
 
         auto texture = import_texture(folder, assimp_scene, mesh_object);
         if (texture.id)
@@ -86,6 +91,11 @@ namespace ludo
         results.meshes.push_back(mesh);
       }
     }
+
+    if (options.merge_meshes && options.optimize_meshes && !mesh_objects.empty() && assimp_scene.mMeshes[mesh_objects[0].mesh_index]->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+    {
+      optimize(results.meshes[0], ludo::format(assimp_scene, *assimp_scene.mMeshes[0]));
+    }
   }
 
   vertex_format format(const aiScene& assimp_scene, const aiMesh& assimp_mesh)
@@ -161,10 +161,11 @@ namespace ludo
     auto bullet_mesh = btIndexedMesh();
     bullet_mesh.m_vertexBase = reinterpret_cast<const unsigned char*>(mesh.vertex_buffer.data);
     bullet_mesh.m_vertexStride = static_cast<int>(format.size);
-    bullet_mesh.m_numVertices = static_cast<int>(mesh.index_buffer.size / sizeof(uint32_t));
+    bullet_mesh.m_numVertices = static_cast<int>(mesh.index_buffer.size / mesh.index_size);
     bullet_mesh.m_triangleIndexBase = reinterpret_cast<const unsigned char*>(mesh.index_buffer.data);
-    bullet_mesh.m_triangleIndexStride = 3 * sizeof(uint32_t);
-    bullet_mesh.m_numTriangles = static_cast<int>(mesh.index_buffer.size / (3 * sizeof(uint32_t)));
+    bullet_mesh.m_triangleIndexStride = static_cast<int>(3 * mesh.index_size);
+    bullet_mesh.m_numTriangles = static_cast<int>(mesh.index_buffer.size / (3 * mesh.index_size));
+    bullet_mesh.m_indexType = mesh.index_size == sizeof(uint16_t) ? PHY_SHORT : PHY_INTEGER;
     bullet_mesh_interface->addIndexedMesh(bullet_mesh);
 
     auto bullet_shape = new btBvhTriangleMeshShape(bullet_mesh_interface, true);
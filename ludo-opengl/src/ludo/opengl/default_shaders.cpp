@@ -116,7 +116,7 @@ R"--(
 
 in vec3 position;
 )--";
-    if (format.has_normal) stream << "in vec3 normal;" << std::endl;
+    if (format.has_normal) stream << (format.packed_normal ? "in vec2 packed_normal;" : "in vec3 normal;") << std::endl;
     if (format.has_color) stream << "in vec4 color;" << std::endl;
     if (format.has_texture_coordinate) stream << "in vec2 tex_coords;" << std::endl;
     if (format.has_bone_weights) stream << "in ivec4 bone_indices;" << std::endl;
@@ -173,6 +173,18 @@ R"--(
 
     if (format.has_normal)
     {
+      if (format.packed_normal)
+      {
+        // See unpack_octahedral.
+        stream <<
+R"--(
+  vec3 normal = vec3(packed_normal, 1.0 - abs(packed_normal.x) - abs(packed_normal.y));
+  float fold = max(-normal.z, 0.0);
+  normal.xy += vec2(normal.x >= 0.0 ? -fold : fold, normal.y >= 0.0 ? -fold : fold);
+  normal = normalize(normal);
+)--";
+      }
+
       stream <<
 R"--(
   mat4 world_rotation = world_transform;
@@ -37,4 +37,14 @@ namespace ludo
 
     de_init(fence);
   }
+
+  bool signaled(const fence& fence)
+  {
+    assert(fence.id && "fence not initialized");
+
+    auto status = GLint();
+    glGetSynciv(reinterpret_cast<__GLsync*>(fence.id), GL_SYNC_STATUS, 1, nullptr, &status); check_opengl_error();
+
+    return status == GL_SIGNALED;
+  }
 }
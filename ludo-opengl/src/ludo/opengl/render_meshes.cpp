@@ -11,5 +11,6 @@ namespace ludo
   void set_instance_texture(render_mesh &render_mesh, const texture& texture, uint32_t instance_index)
   {
     cast<uint64_t>(render_mesh.instance_buffer, instance_index * render_mesh.instance_size + sizeof(mat4)) = handle(texture);
+    mark_instance_dirty(render_mesh, instance_index);
   }
 }
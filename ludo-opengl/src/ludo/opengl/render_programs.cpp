@@ -13,6 +13,11 @@
 
 namespace ludo
 {
+  void attach_buffers(render_program& render_program, const heap& indices, const heap& vertices);
+  void init_vertex_array(render_program& render_program);
+  uint64_t storage_slice_size(uint64_t size);
+  void validate(const render_program& render_program);
+
   void init(render_program& render_program, const vertex_format& format, heap& render_commands, uint32_t instance_capacity)
   {
     render_program.format = format;
@@ -47,46 +52,44 @@ namespace ludo
   {
     init(render_program, vertex_shader_code, fragment_shader_code);
 
-    render_program.command_buffer = allocate(render_commands, instance_capacity * sizeof(render_command));
+    render_program.command_buffer = allocate(render_commands, render_program.frames.frame_count * instance_capacity * sizeof(render_command));
 
     if (render_program.instance_size)
     {
-      render_program.instance_buffer_front = allocate_vram(instance_capacity * render_program.instance_size);
+      render_program.instance_buffer_front = allocate_vram(render_program.frames.frame_count * storage_slice_size(instance_capacity * render_program.instance_size));
       render_program.instance_buffer_back = allocate_heap(instance_capacity * render_program.instance_size);
+
+      assert(render_program.frames.frame_count <= 8 && "too many frames to track dirty instances");
+      render_program.dirty_instances = allocate(instance_capacity);
+      std::memset(render_program.dirty_instances.data, 0, render_program.dirty_instances.size);
     }
   }
 
   void init(render_program& render_program, std::istream& vertex_shader_code, std::istream& fragment_shader_code)
   {
-    render_program.id = glCreateProgram(); check_opengl_error();
-
-    auto vertex_shader = compile(vertex_shader_code, GL_VERTEX_SHADER);
-    auto fragment_shader = compile(fragment_shader_code, GL_FRAGMENT_SHADER);
-
-    glAttachShader(render_program.id, vertex_shader); check_opengl_error();
-    glAttachShader(render_program.id, fragment_shader); check_opengl_error();
-    glLinkProgram(render_program.id); check_opengl_error();
-
-    auto link_status = GLint();
-    glGetProgramiv(render_program.id, GL_LINK_STATUS, &link_status); check_opengl_error();
-
-    GLchar info_log[1024];
-    glGetProgramInfoLog(render_program.id, sizeof(info_log), nullptr, info_log); check_opengl_error();
-
-    if (info_log[0])
+    render_program.id = next_id++;
+    render_program.program_id = acquire_program(
     {
-      std::cout << "render program link log: " << info_log << std::endl;
-    }
-    assert(link_status && "failed to link render program");
+      { GL_VERTEX_SHADER, read_all(vertex_shader_code) },
+      { GL_FRAGMENT_SHADER, read_all(fragment_shader_code) }
+    });
+
+    init_vertex_array(render_program);
 
-    glDeleteShader(vertex_shader); check_opengl_error();
-    glDeleteShader(fragment_shader); check_opengl_error();
+    init(render_program.frames, 0);
   }
 
   void de_init(render_program& render_program, heap& render_commands)
   {
-    glDeleteProgram(render_program.id); check_opengl_error();
+    release_program(render_program.program_id);
     render_program.id = 0;
+    render_program.program_id = 0;
+
+    auto vertex_array = static_cast<GLuint>(render_program.vertex_array_id);
+    glDeleteVertexArrays(1, &vertex_array); check_opengl_error();
+    render_program.vertex_array_id = 0;
+    render_program.attached_index_buffer_id = 0;
+    render_program.attached_vertex_buffer_id = 0;
 
     if (render_program.command_buffer.data)
     {
@@ -107,39 +110,108 @@ namespace ludo
     {
       deallocate(render_program.instance_buffer_back);
     }
+
+    if (render_program.dirty_instances.data)
+    {
+      deallocate(render_program.dirty_instances);
+    }
+
+    de_init(render_program.frames);
   }
 
   void commit(render_program& render_program)
   {
-    commit(render_program.shader_buffer);
-    std::memcpy(render_program.instance_buffer_front.data, render_program.instance_buffer_back.data, render_program.instance_buffer_front.size);
-  }
+    next_frame(render_program.frames);
+    auto frame_index = render_program.frames.frame_index;
 
-  void use(render_program& render_program)
-  {
-    glValidateProgram(render_program.id); check_opengl_error();
+    auto& shader_buffer = render_program.shader_buffer;
+    if (shader_buffer.back.data)
+    {
+      // The shader buffer is usually allocated without slices (see allocate_dual), so they are added here.
+      auto slice_size = storage_slice_size(shader_buffer.back.size);
+      if (shader_buffer.front.size < render_program.frames.frame_count * slice_size)
+      {
+        deallocate_vram(shader_buffer.front);
+        shader_buffer.front = allocate_vram(render_program.frames.frame_count * slice_size);
+      }
 
-    auto validate_status = GLint();
-    glGetProgramiv(render_program.id, GL_VALIDATE_STATUS, &validate_status); check_opengl_error();
+      std::memcpy(shader_buffer.front.data + frame_index * slice_size, shader_buffer.back.data, shader_buffer.back.size);
+    }
 
-    GLchar info_log[1024];
-    glGetProgramInfoLog(render_program.id, sizeof(info_log), nullptr, info_log); check_opengl_error();
+    if (!render_program.instance_buffer_front.data)
+    {
+      return;
+    }
 
-    if (info_log[0])
+    // Only push the instance data that changed since the slice was last committed to, rather than the whole instance buffer.
+    auto slice_offset = frame_index * storage_slice_size(render_program.instance_buffer_back.size);
+    for (auto& dirty : take_dirty_instance_data(render_program, frame_index))
     {
-      std::cout << "render program validation log: " << info_log << std::endl;
+      std::memcpy(render_program.instance_buffer_front.data + slice_offset + (dirty.data - render_program.instance_buffer_back.data), dirty.data, dirty.size);
+      committed_instance_bytes += dirty.size;
     }
-    assert(validate_status && "failed to validate render program");
+  }
 
-    glUseProgram(render_program.id); check_opengl_error();
+  void use(render_program& render_program)
+  {
+    glUseProgram(render_program.program_id); check_opengl_error();
+    glBindVertexArray(render_program.vertex_array_id); check_opengl_error();
 
     if (render_program.push_on_bind)
     {
       commit(render_program);
     }
 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, render_program.shader_buffer.front.id); check_opengl_error();
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, render_program.instance_buffer_front.id); check_opengl_error();
+    // The slices are only bound once they have been committed to.
+    auto frame_index = render_program.frames.frame_index;
+    auto& shader_buffer = render_program.shader_buffer;
+    if (shader_buffer.back.data && shader_buffer.front.size >= render_program.frames.frame_count * storage_slice_size(shader_buffer.back.size))
+    {
+      auto slice_size = storage_slice_size(shader_buffer.back.size);
+      glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, shader_buffer.front.id, static_cast<GLintptr>(frame_index * slice_size), static_cast<GLsizeiptr>(shader_buffer.back.size)); check_opengl_error();
+    }
+    else
+    {
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, shader_buffer.front.id); check_opengl_error();
+    }
+
+    if (render_program.instance_buffer_front.data)
+    {
+      auto slice_size = storage_slice_size(render_program.instance_buffer_back.size);
+      glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, render_program.instance_buffer_front.id, static_cast<GLintptr>(frame_index * slice_size), static_cast<GLsizeiptr>(render_program.instance_buffer_back.size)); check_opengl_error();
+    }
+    else
+    {
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, 0); check_opengl_error();
+    }
+
+    render_state_call_count += 4;
+  }
+
+  void add_render_command(render_program& render_program, const render_mesh& render_mesh)
+  {
+    auto position = (render_program.active_commands.start + render_program.active_commands.count++) * sizeof(render_command);
+    cast<render_command>(render_program.command_buffer, position) =
+      {
+        .index_count = render_mesh.indices.count,
+        .instance_count = render_mesh.instances.count,
+        .index_start = render_mesh.indices.start,
+        .vertex_start = render_mesh.vertices.start,
+        .instance_start = render_mesh.instances.start
+      };
+  }
+
+  uint64_t storage_slice_size(uint64_t size)
+  {
+    // The slices are bound as storage buffer ranges, so they are kept aligned (256 bytes is the largest offset alignment an implementation may require).
+    return (size + 255) / 256 * 256;
+  }
+
+  void init_vertex_array(render_program& render_program)
+  {
+    auto vertex_array = GLuint();
+    glCreateVertexArrays(1, &vertex_array); check_opengl_error();
+    render_program.vertex_array_id = vertex_array;
 
     // Convert b4 to u4f4
     auto format = render_program.format;
@@ -153,49 +225,79 @@ namespace ludo
       }
     }
 
+    // The attributes all come from the vertex buffer at binding 0, which is attached when drawing (see commit_render_commands).
     auto offset = uint32_t(0);
     for (auto index = 0; index < format.components.size(); index++)
     {
-      glEnableVertexAttribArray(index); check_opengl_error();
+      glEnableVertexArrayAttrib(vertex_array, index); check_opengl_error();
 
       if (format.components[index].first == 'i' || format.components[index].first == 'u')
       {
-        glVertexAttribIPointer(
+        glVertexArrayAttribIFormat(
+          vertex_array,
           index,
           static_cast<GLint>(format.components[index].second),
           format.components[index].first == 'i' ? GL_INT : GL_UNSIGNED_INT,
-          static_cast<GLsizei>(format.size),
-          reinterpret_cast<void*>(offset)
+          offset
         ); check_opengl_error();
-
-        offset += format.components[index].second * sizeof(uint32_t);
       }
       else
       {
-        glVertexAttribPointer(
+        // Packed components are converted to floats when fetched, normalized to [0,1] or [-1,1] where they are unorm or snorm.
+        auto type = GLenum(GL_FLOAT);
+        if (format.components[index].first == 'P') type = GL_HALF_FLOAT;
+        else if (format.components[index].first == 'N') type = GL_SHORT;
+        else if (format.components[index].first == 'C') type = GL_UNSIGNED_BYTE;
+        else if (format.components[index].first == 'T') type = GL_UNSIGNED_SHORT;
+
+        glVertexArrayAttribFormat(
+          vertex_array,
           index,
           static_cast<GLint>(format.components[index].second),
-          GL_FLOAT,
-          GL_FALSE,
-          static_cast<GLsizei>(format.size),
-          reinterpret_cast<void*>(offset)
+          type,
+          type == GL_FLOAT || type == GL_HALF_FLOAT ? GL_FALSE : GL_TRUE,
+          offset
         ); check_opengl_error();
-
-        offset += format.components[index].second * sizeof(float);
       }
+
+      offset += component_size(format.components[index]);
+
+      glVertexArrayAttribBinding(vertex_array, index, 0); check_opengl_error();
     }
   }
 
-  void add_render_command(render_program& render_program, const render_mesh& render_mesh)
+  void attach_buffers(render_program& render_program, const heap& indices, const heap& vertices)
   {
-    auto position = (render_program.active_commands.start + render_program.active_commands.count++) * sizeof(render_command);
-    cast<render_command>(render_program.command_buffer, position) =
-      {
-        .index_count = render_mesh.indices.count,
-        .instance_count = render_mesh.instances.count,
-        .index_start = render_mesh.indices.start,
-        .vertex_start = render_mesh.vertices.start,
-        .instance_start = render_mesh.instances.start
-      };
+    // The buffers are part of the vertex array's state, so they only need to be attached when they change.
+    if (render_program.attached_index_buffer_id != indices.id)
+    {
+      glVertexArrayElementBuffer(render_program.vertex_array_id, indices.id); check_opengl_error();
+      render_program.attached_index_buffer_id = indices.id;
+      render_state_call_count++;
+    }
+    if (render_program.attached_vertex_buffer_id != vertices.id)
+    {
+      glVertexArrayVertexBuffer(render_program.vertex_array_id, 0, vertices.id, 0, static_cast<GLsizei>(render_program.format.size)); check_opengl_error();
+      render_program.attached_vertex_buffer_id = vertices.id;
+      render_state_call_count++;
+    }
+  }
+
+  void validate(const render_program& render_program)
+  {
+    // Validation checks the program against the current state, so this must follow use(render_program&) and attach_buffers.
+    glValidateProgram(render_program.program_id); check_opengl_error();
+
+    auto validate_status = GLint();
+    glGetProgramiv(render_program.program_id, GL_VALIDATE_STATUS, &validate_status); check_opengl_error();
+
+    GLchar info_log[1024];
+    glGetProgramInfoLog(render_program.program_id, sizeof(info_log), nullptr, info_log); check_opengl_error();
+
+    if (info_log[0])
+    {
+      std::cout << "render program validation log: " << info_log << std::endl;
+    }
+    assert(validate_status && "failed to validate render program");
   }
 }
@@ -8,6 +8,10 @@
 
 namespace ludo
 {
+  void attach_buffers(render_program& render_program, const heap& indices, const heap& vertices);
+  uint64_t storage_slice_size(uint64_t size);
+  void validate(const render_program& render_program);
+
   auto draw_modes = std::unordered_map<mesh_primitive, GLenum>
   {
     { mesh_primitive::POINT_LIST, GL_POINTS },
@@ -19,25 +23,30 @@ namespace ludo
 
   void start_render_transaction(rendering_context& rendering_context, array<render_program>& render_programs)
   {
-    if (rendering_context.fence.id)
-    {
-      wait(rendering_context.fence);
-    }
+    // Only waits if the frame about to be reused is still in flight.
+    next_frame(rendering_context.frames);
 
+    // Each frame has its own slice of the command buffers, so the commands of the frames still in flight are left alone.
     for (auto& render_program : render_programs)
     {
-      render_program.active_commands.start = 0;
+      assert(render_program.frames.frame_count >= rendering_context.frames.frame_count && "render programs must have at-least as many frames as the rendering context");
+
+      auto frame_capacity = static_cast<uint32_t>(render_program.command_buffer.size / sizeof(render_command) / render_program.frames.frame_count);
+      render_program.active_commands = { .start = rendering_context.frames.frame_index * frame_capacity };
     }
   }
 
   void commit_render_commands(rendering_context& rendering_context, array<render_program>& render_programs, const heap& render_commands, const heap& indices, const heap& vertices)
   {
     glBindBuffer(GL_DRAW_INDIRECT_BUFFER, render_commands.id); check_opengl_error();
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.id); check_opengl_error();
-    glBindBuffer(GL_ARRAY_BUFFER, vertices.id); check_opengl_error();
 
-    commit(rendering_context.shader_buffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, rendering_context.shader_buffer.front.id); check_opengl_error();
+    // The shader buffer has a slice for each frame, so the data of the frames still in flight is left alone.
+    auto& shader_buffer = rendering_context.shader_buffer;
+    auto slice_offset = rendering_context.frames.frame_index * storage_slice_size(shader_buffer.back.size);
+    std::memcpy(shader_buffer.front.data + slice_offset, shader_buffer.back.data, shader_buffer.back.size);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, shader_buffer.front.id, static_cast<GLintptr>(slice_offset), static_cast<GLsizeiptr>(shader_buffer.back.size)); check_opengl_error();
+
+    render_state_call_count += 2;
 
     for (auto& render_program : render_programs)
     {
@@ -47,15 +56,23 @@ namespace ludo
       }
 
       use(render_program);
+      attach_buffers(render_program, indices, vertices);
+
+#ifndef NDEBUG
+      validate(render_program);
+#endif
 
       glMultiDrawElementsIndirect(
         draw_modes[render_program.primitive],
-        GL_UNSIGNED_INT,
+        render_program.index_size == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
         reinterpret_cast<void*>((render_program.command_buffer.data - render_commands.data) + render_program.active_commands.start * sizeof(render_command)),
         static_cast<GLsizei>(render_program.active_commands.count),
         sizeof(render_command)
       ); check_opengl_error();
 
+      // The render program's slices (see commit(render_program&)) are in flight until this draw completes.
+      commit(render_program.frames);
+
       render_program.active_commands.start += render_program.active_commands.count;
       render_program.active_commands.count = 0;
     }
@@ -63,32 +80,6 @@ namespace ludo
 
   void commit_render_transaction(rendering_context& rendering_context)
   {
-    init(rendering_context.fence);
-  }
-
-  // Based on http://www.cs.otago.ac.nz/postgrads/alexis/planeExtraction.pdf
-  std::array<vec4, 6> frustum_planes(const camera& camera)
-  {
-    auto view_inverse = camera.view;
-    invert(view_inverse);
-    auto view_projection = camera.projection * view_inverse;
-
-    auto rows = std::array<vec4, 4>
-    {
-      vec4 { view_projection[0], view_projection[4], view_projection[8], view_projection[12] },
-      vec4 { view_projection[1], view_projection[5], view_projection[9], view_projection[13] },
-      vec4 { view_projection[2], view_projection[6], view_projection[10], view_projection[14] },
-      vec4 { view_projection[3], view_projection[7], view_projection[11], view_projection[15] },
-    };
-
-    return std::array<vec4, 6>
-    {
-      rows[3] + rows[0], // Left
-      rows[3] - rows[0], // Right
-      rows[3] + rows[1], // Bottom
-      rows[3] - rows[1], // Top
-      rows[3] + rows[2], // Near
-      rows[3] - rows[2] // Far
-    };
+    commit(rendering_context.frames);
   }
 }
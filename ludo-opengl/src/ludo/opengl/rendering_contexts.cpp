@@ -8,6 +8,8 @@
 
 namespace ludo
 {
+  uint64_t storage_slice_size(uint64_t size);
+
   void init(rendering_context& rendering_context, uint32_t light_count)
   {
     rendering_context.id = next_id++;
@@ -37,7 +39,13 @@ namespace ludo
     auto light_size = 112;
     auto data_size = camera_size + 16 + light_count * light_size;
 
-    rendering_context.shader_buffer = allocate_dual(data_size);
+    // The front buffer has a slice for each frame (see commit_render_commands).
+    rendering_context.shader_buffer =
+    {
+      .front = allocate_vram(rendering_context.frames.frame_count * storage_slice_size(data_size)),
+      .back = allocate(data_size)
+    };
+    init(rendering_context.frames, 0);
 
     // Default camera.
     set_camera(rendering_context, camera
@@ -73,6 +81,13 @@ namespace ludo
     {
       deallocate_dual(rendering_context.shader_buffer);
     }
+
+    de_init(rendering_context.frames);
+
+    if (rendering_context.compute_frames.fences.size())
+    {
+      de_init(rendering_context.compute_frames);
+    }
   }
 
   camera get_camera(const rendering_context& rendering_context)
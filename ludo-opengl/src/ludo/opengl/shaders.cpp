@@ -3,24 +3,39 @@
  */
 
 #include <cassert>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+#include <ludo/files.h>
 
 #include "shaders.h"
 
 namespace ludo
 {
-  GLuint compile(std::istream& code, GLenum type)
+  struct cached_program
   {
-    auto shader = glCreateShader(type); check_opengl_error();
+    GLuint id = 0;
+    uint32_t reference_count = 0;
+  };
+
+  uint64_t hash_source(uint64_t seed, const std::string& data);
+  std::string program_binary_file_name(uint64_t source_hash);
+  bool load_program_binary(GLuint program, const std::string& file_name);
+  void save_program_binary(GLuint program, const std::string& file_name);
 
-    code.seekg(0, std::ios_base::end);
-    auto code_size = code.tellg();
-    auto code_string = std::string(code_size, 'x');
-    code.seekg(0);
-    code.read(&code_string[0], code_size);
+  // Programs built from identical sources are shared, keyed by the hash of their sources.
+  auto cached_programs = std::unordered_map<uint64_t, cached_program>();
+  auto cached_program_hashes = std::unordered_map<GLuint, uint64_t>();
+
+  GLuint compile(const std::string& code, GLenum type)
+  {
+    auto shader = glCreateShader(type); check_opengl_error();
 
-    const char* source_ptr = code_string.data();
-    const int source_length = -1;
+    const char* source_ptr = code.data();
+    const int source_length = static_cast<int>(code.size());
     glShaderSource(shader, 1, &source_ptr, &source_length); check_opengl_error();
     glCompileShader(shader); check_opengl_error();
 
@@ -38,4 +53,178 @@ namespace ludo
 
     return shader;
   }
+
+  GLuint acquire_program(const std::vector<std::pair<GLenum, std::string>>& shaders)
+  {
+    auto shader_count = shaders.size();
+    auto source_hash = hash(reinterpret_cast<const std::byte*>(&shader_count), sizeof(shader_count));
+    for (auto& [ type, code ] : shaders)
+    {
+      source_hash = hash(reinterpret_cast<const std::byte*>(&type), sizeof(type), source_hash);
+      source_hash = hash_source(source_hash, code);
+    }
+
+    auto& cached = cached_programs[source_hash];
+    if (cached.reference_count++)
+    {
+      return cached.id;
+    }
+
+    cached.id = glCreateProgram(); check_opengl_error();
+    cached_program_hashes[cached.id] = source_hash;
+
+    auto file_name = program_binary_file_name(source_hash);
+    if (load_program_binary(cached.id, file_name))
+    {
+      return cached.id;
+    }
+
+    auto shader_ids = std::vector<GLuint>();
+    for (auto& [ type, code ] : shaders)
+    {
+      shader_ids.push_back(compile(code, type));
+      glAttachShader(cached.id, shader_ids.back()); check_opengl_error();
+    }
+
+    glProgramParameteri(cached.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); check_opengl_error();
+    glLinkProgram(cached.id); check_opengl_error();
+
+    auto link_status = GLint();
+    glGetProgramiv(cached.id, GL_LINK_STATUS, &link_status); check_opengl_error();
+
+    GLchar info_log[1024];
+    glGetProgramInfoLog(cached.id, sizeof(info_log), nullptr, info_log); check_opengl_error();
+
+    if (info_log[0])
+    {
+      std::cout << "program link log: " << info_log << std::endl;
+    }
+    assert(link_status && "failed to link program");
+
+    for (auto shader_id : shader_ids)
+    {
+      glDetachShader(cached.id, shader_id); check_opengl_error();
+      glDeleteShader(shader_id); check_opengl_error();
+    }
+
+    save_program_binary(cached.id, file_name);
+
+    return cached.id;
+  }
+
+  void release_program(GLuint program)
+  {
+    auto hash_iter = cached_program_hashes.find(program);
+    assert(hash_iter != cached_program_hashes.end() && "program not found");
+
+    auto cached_iter = cached_programs.find(hash_iter->second);
+    if (--cached_iter->second.reference_count)
+    {
+      return;
+    }
+
+    glDeleteProgram(program); check_opengl_error();
+
+    cached_programs.erase(cached_iter);
+    cached_program_hashes.erase(hash_iter);
+  }
+
+  std::string read_all(std::istream& stream)
+  {
+    auto string_stream = std::stringstream();
+    string_stream << stream.rdbuf();
+
+    return string_stream.str();
+  }
+
+  uint64_t hash_source(uint64_t seed, const std::string& data)
+  {
+    return hash(reinterpret_cast<const std::byte*>(data.data()), data.size(), seed);
+  }
+
+  std::string program_binary_file_name(uint64_t source_hash)
+  {
+    // Without a user folder the cache is disabled.
+    if (user_folder.empty())
+    {
+      return "";
+    }
+
+    // Binaries are specific to the driver, so they are keyed by it as well as the sources.
+    auto driver_hash = source_hash;
+    driver_hash = hash_source(driver_hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR))); check_opengl_error();
+    driver_hash = hash_source(driver_hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER))); check_opengl_error();
+    driver_hash = hash_source(driver_hash, reinterpret_cast<const char*>(glGetString(GL_VERSION))); check_opengl_error();
+
+    auto file_name = std::stringstream();
+    file_name << user_folder << "/shaders/" << std::hex << driver_hash << ".bin";
+
+    return file_name.str();
+  }
+
+  bool load_program_binary(GLuint program, const std::string& file_name)
+  {
+    if (file_name.empty())
+    {
+      return false;
+    }
+
+    auto format_count = GLint();
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count); check_opengl_error();
+    if (!format_count)
+    {
+      return false;
+    }
+
+    auto stream = std::ifstream(file_name, std::ios::binary);
+    if (!stream)
+    {
+      return false;
+    }
+
+    auto format = GLenum();
+    stream.read(reinterpret_cast<char*>(&format), sizeof(format));
+    if (!stream)
+    {
+      return false;
+    }
+
+    auto binary = read_all(stream);
+
+    // The driver may reject binaries e.g. after it has been updated. This shows up as an error rather than a failed link, so the error is cleared instead of checked.
+    glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+    glGetError();
+
+    auto link_status = GLint();
+    glGetProgramiv(program, GL_LINK_STATUS, &link_status); check_opengl_error();
+
+    return link_status;
+  }
+
+  void save_program_binary(GLuint program, const std::string& file_name)
+  {
+    if (file_name.empty())
+    {
+      return;
+    }
+
+    auto binary_length = GLint();
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_length); check_opengl_error();
+    if (!binary_length)
+    {
+      return;
+    }
+
+    auto format = GLenum();
+    auto binary = std::string(binary_length, '\0');
+    glGetProgramBinary(program, binary_length, nullptr, &format, binary.data()); check_opengl_error();
+
+    // The cache is only an optimization, so failing to write to it is not an error.
+    auto error_code = std::error_code();
+    std::filesystem::create_directories(std::filesystem::path(file_name).parent_path(), error_code);
+
+    auto stream = std::ofstream(file_name, std::ios::binary);
+    stream.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    stream.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+  }
 }
@@ -5,10 +5,26 @@
 #pragma once
 
 #include <istream>
+#include <string>
+#include <vector>
 
 #include "util.h"
 
 namespace ludo
 {
-  GLuint compile(std::istream& code, GLenum type);
+  GLuint compile(const std::string& code, GLenum type);
+
+  ///
+  /// Acquires a linked program built from shaders. Programs built from identical shader code are shared within a run, and their binaries
+  /// are cached in the user folder across runs (falling back to compiling the shader code if the driver rejects a cached binary).
+  /// \param shaders The type and code of each shader.
+  /// \return The program.
+  GLuint acquire_program(const std::vector<std::pair<GLenum, std::string>>& shaders);
+
+  ///
+  /// Releases a program acquired with acquire_program. The program is deleted once it has been released as many times as it was acquired.
+  /// \param program The program.
+  void release_program(GLuint program);
+
+  std::string read_all(std::istream& stream);
 }
@@ -10,6 +10,11 @@
 
 namespace ludo
 {
+  uint64_t storage_slice_size(uint64_t size);
+
+  // The size of the context's entry for each render program (the stride of render_program_t).
+  const auto context_render_program_size = sizeof(uint64_t) + 4 * sizeof(uint32_t);
+
   compute_program build_compute_program(const grid3& grid)
   {
     auto code = std::stringstream();
@@ -28,6 +33,7 @@ struct render_program_t
   uint64_t id;
   uint active_command_start;
   uint active_command_count;
+  uint initial_command_count;
 };
 
 struct render_command_t
@@ -51,9 +57,11 @@ struct render_mesh_t
   uint vertex_count;
 };
 
+// A cell, or an overflow block of a cell when it is full (see cell_pool).
 struct cell_t
 {
   uint count;
+  uint next_block;
 )--";
 
     code << "  render_mesh_t render_meshes[" << grid.cell_capacity << "];" << std::endl;
@@ -159,24 +167,32 @@ void main()
   aabb_t test_bounds = aabb_t(cell_min - cell_dimensions, cell_min + cell_dimensions * 2);
   if (frustum_test(test_bounds)  != -1)
   {
-    for (uint render_mesh_index = 0; render_mesh_index < cells[cell_index].count; render_mesh_index++)
+    // Follow the chain of overflow blocks (a next block of 0 ends the chain).
+    uint block_index = cell_index;
+    do
     {
-      render_mesh_t render_mesh = cells[cell_index].render_meshes[render_mesh_index];
-
-      int render_program_index = get_render_program_index(render_mesh.render_program_id);
-      if (render_program_index == -1)
+      for (uint render_mesh_index = 0; render_mesh_index < cells[block_index].count; render_mesh_index++)
       {
-        continue;
-      }
+        render_mesh_t render_mesh = cells[block_index].render_meshes[render_mesh_index];
+
+        int render_program_index = get_render_program_index(render_mesh.render_program_id);
+        if (render_program_index == -1)
+        {
+          continue;
+        }
 
-      uint command_index = render_programs[render_program_index].active_command_start + atomicAdd(render_programs[render_program_index].active_command_count, 1);
+        uint command_index = render_programs[render_program_index].active_command_start + atomicAdd(render_programs[render_program_index].active_command_count, 1);
 
-      commands[command_index].index_count = render_mesh.index_count;
-      commands[command_index].instance_count = render_mesh.instance_count;
-      commands[command_index].index_start = render_mesh.index_start;
-      commands[command_index].vertex_start = render_mesh.vertex_start;
-      commands[command_index].instance_start = render_mesh.instance_start;
+        commands[command_index].index_count = render_mesh.index_count;
+        commands[command_index].instance_count = render_mesh.instance_count;
+        commands[command_index].index_start = render_mesh.index_start;
+        commands[command_index].vertex_start = render_mesh.vertex_start;
+        commands[command_index].instance_start = render_mesh.instance_start;
+      }
+
+      block_index = cells[block_index].next_block;
     }
+    while (block_index != 0);
   }
 }
 )--";
@@ -187,12 +203,23 @@ void main()
     return program;
   }
 
-  void add_render_commands(array<grid3>& grids, array<compute_program>& compute_programs, array<render_program>& render_programs, const heap& render_commands, const camera& camera)
+  void add_render_commands(rendering_context& rendering_context, array<grid3>& grids, array<compute_program>& compute_programs, array<render_program>& render_programs, const heap& render_commands, const camera& camera)
   {
     auto planes = frustum_planes(camera);
 
-    // TODO take this allocation out of here?
-    auto context_buffer = allocate_vram(6 * 16 + 8 + render_programs.length * (sizeof(uint64_t) + 2 * sizeof(uint32_t)));
+    // The context is written to a new slice each frame (shared by all of the grids, so that they add to the same command counts).
+    auto context_size = 6 * 16 + 8 + render_programs.length * context_render_program_size;
+    auto& context_frames = rendering_context.compute_frames;
+    if (context_frames.frame_size < storage_slice_size(context_size))
+    {
+      if (context_frames.fences.size())
+      {
+        de_init(context_frames);
+      }
+      init(context_frames, storage_slice_size(context_size));
+    }
+
+    auto context_buffer = next_frame(context_frames);
 
     auto stream = ludo::stream(context_buffer);
     write(stream, planes[0]);
@@ -208,6 +235,8 @@ void main()
       write(stream, render_program.id);
       write(stream, static_cast<uint32_t>((render_program.command_buffer.data - render_commands.data) / sizeof(render_command) + render_program.active_commands.start));
       write(stream, render_program.active_commands.count);
+      write(stream, render_program.active_commands.count);
+      stream.position += 4; // align 8
     }
 
     for (auto& grid : grids)
@@ -215,23 +244,44 @@ void main()
       auto compute_program = find_by_id(compute_programs.begin(), compute_programs.end(), grid.compute_program_id);
       assert(compute_program != compute_programs.end() && "compute program not found");
 
-      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, context_buffer.id); check_opengl_error();
+      glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, context_frames.buffer.id, static_cast<GLintptr>(frame_offset(context_frames)), static_cast<GLsizeiptr>(context_size)); check_opengl_error();
       glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, grid.buffer.front.id); check_opengl_error();
       glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, render_commands.id); check_opengl_error();
 
       ludo::execute(*compute_program, grid.cell_count_1d / 8, grid.cell_count_1d / 4, grid.cell_count_1d); check_opengl_error();
     }
 
-    auto fence = ludo::fence();
-    init(fence);
-    wait(fence);
+    // The commands the draws read are written by the compute programs.
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT); check_opengl_error();
+    commit(context_frames);
 
-    for (auto index = 0; index < render_programs.length; index++)
+    // Rather than waiting for this frame's commands, draw the commands added a frame ago (which are left alone, see start_render_transaction).
+    // The GPU has usually finished with them, so this rarely stalls. The context is zeroed when (re-)initialized, so nothing is drawn for the first frame.
+    auto previous_context_buffer = previous_frame(context_frames);
+    auto previous_render_program_count = cast<uint32_t>(previous_context_buffer, 6 * 16);
+    for (auto index = uint32_t(0); index < previous_render_program_count; index++)
     {
-      auto offset = 6 * 16 + 8 + index * (sizeof(uint64_t) + 2 * sizeof(uint32_t));
-      render_programs[index].active_commands.count = cast<uint32_t>(context_buffer, offset + sizeof(uint64_t) + sizeof(uint32_t));
-    }
+      auto offset = 6 * 16 + 8 + index * context_render_program_size;
+      auto render_program = find_by_id(render_programs.begin(), render_programs.end(), cast<uint64_t>(previous_context_buffer, offset));
+      if (render_program == render_programs.end())
+      {
+        continue;
+      }
 
-    deallocate_vram(context_buffer);
+      // Render programs that the grids didn't add to keep the commands added to them this frame.
+      auto start = cast<uint32_t>(previous_context_buffer, offset + sizeof(uint64_t));
+      auto count = cast<uint32_t>(previous_context_buffer, offset + sizeof(uint64_t) + sizeof(uint32_t));
+      auto initial_count = cast<uint32_t>(previous_context_buffer, offset + sizeof(uint64_t) + 2 * sizeof(uint32_t));
+      if (count == initial_count)
+      {
+        continue;
+      }
+
+      render_program->active_commands =
+      {
+        .start = start - static_cast<uint32_t>((render_program->command_buffer.data - render_commands.data) / sizeof(render_command)),
+        .count = count
+      };
+    }
   }
 }
@@ -0,0 +1,64 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <ludo/rendering.h>
+#include <ludo/spatial/grid3.h>
+
+#include "meshes/clean.h"
+#include "meshes/collapse.h"
+#include "meshes/meshlets.h"
+#include "meshes/optimize.h"
+#include "spatial/frustum.h"
+#include "spatial/grid3.h"
+#include "spatial/loose_octree.h"
+#include "spatial/octree.h"
+
+int main()
+{
+  ludo::benchmark_meshes_clean();
+  ludo::benchmark_meshes_collapse();
+  ludo::benchmark_meshes_meshlets();
+  ludo::benchmark_meshes_optimize();
+  ludo::benchmark_spatial_frustum();
+  ludo::benchmark_spatial_grid3();
+  ludo::benchmark_spatial_loose_octree();
+  ludo::benchmark_spatial_octree();
+
+  return 0;
+}
+
+// stubs
+namespace ludo
+{
+  buffer allocate_vram(uint64_t size, vram_buffer_access_hint access_hint)
+  {
+    return allocate(size);
+  }
+
+  void deallocate_vram(buffer& buffer)
+  {
+    deallocate(buffer);
+  }
+
+  void set_instance_texture(render_mesh& render_mesh, const texture& texture, uint32_t instance_index)
+  {
+  }
+
+  void init(fence& fence)
+  {
+  }
+
+  void de_init(fence& fence)
+  {
+  }
+
+  void wait(fence& fence)
+  {
+  }
+
+  bool signaled(const fence& fence)
+  {
+    return true;
+  }
+}
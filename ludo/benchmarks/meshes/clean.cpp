@@ -0,0 +1,78 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+
+#include <ludo/meshes/clean.h>
+#include <ludo/testing.h>
+
+#include "clean.h"
+
+namespace ludo
+{
+  void benchmark_meshes_clean()
+  {
+    // A triangle soup of a 256x256 height field (~400k indices), in which each vertex is repeated by up to 6 triangles.
+    auto cell_count_1d = uint32_t(256);
+    auto index_count = cell_count_1d * cell_count_1d * 6;
+    auto format = vertex_format_pn;
+
+    auto indices = allocate_heap(index_count * sizeof(uint32_t));
+    auto vertices = allocate_heap(index_count * format.size);
+    auto source = mesh();
+    init(source, indices, vertices, index_count, index_count, format.size);
+
+    auto height = [](uint32_t x, uint32_t z)
+    {
+      return std::sin(static_cast<float>(x) * 0.1f) * std::cos(static_cast<float>(z) * 0.1f);
+    };
+
+    auto index_index = uint32_t(0);
+    for (auto x = uint32_t(0); x < cell_count_1d; x++)
+    {
+      for (auto z = uint32_t(0); z < cell_count_1d; z++)
+      {
+        auto corners = std::array<vec3, 4>
+        {
+          vec3 { static_cast<float>(x), height(x, z), static_cast<float>(z) },
+          vec3 { static_cast<float>(x + 1), height(x + 1, z), static_cast<float>(z) },
+          vec3 { static_cast<float>(x), height(x, z + 1), static_cast<float>(z + 1) },
+          vec3 { static_cast<float>(x + 1), height(x + 1, z + 1), static_cast<float>(z + 1) }
+        };
+
+        for (auto corner_index : { 0, 2, 1, 1, 2, 3 })
+        {
+          cast<uint32_t>(source.index_buffer, index_index * sizeof(uint32_t)) = index_index;
+          cast<vec3>(source.vertex_buffer, index_index * format.size + format.position_offset) = corners[corner_index];
+          cast<vec3>(source.vertex_buffer, index_index * format.size + format.normal_offset) = vec3_unit_y;
+          index_index++;
+        }
+      }
+    }
+
+    auto counts = clean(source, source, format, format, true);
+
+    auto destination_indices = allocate_heap(counts.first * sizeof(uint32_t));
+    auto destination_vertices = allocate_heap(counts.second * format.size);
+    auto destination = mesh();
+    init(destination, destination_indices, destination_vertices, counts.first, counts.second, format.size);
+
+    benchmark("clean: 256x256 triangle soup (dry run)", 10, [&]()
+    {
+      clean(destination, source, format, format, true);
+    });
+
+    benchmark("clean: 256x256 triangle soup", 10, [&]()
+    {
+      clean(destination, source, format, format);
+    });
+
+    de_init(destination, destination_indices, destination_vertices);
+    deallocate(destination_vertices);
+    deallocate(destination_indices);
+    de_init(source, indices, vertices);
+    deallocate(vertices);
+    deallocate(indices);
+  }
+}
@@ -0,0 +1,53 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cstring>
+
+#include <ludo/meshes/collapse.h>
+#include <ludo/meshes/shapes.h>
+#include <ludo/testing.h>
+
+#include "collapse.h"
+
+namespace ludo
+{
+  void benchmark_meshes_collapse()
+  {
+    auto format = vertex_format_pnc;
+    auto options = shape_options { .divisions = 128, .smooth = true };
+    auto [ index_count, vertex_count ] = sphere_uv_counts(format, options);
+
+    auto indices = allocate_heap(2 * index_count * sizeof(uint32_t));
+    auto vertices = allocate_heap(2 * vertex_count * format.size);
+    auto source = mesh();
+    init(source, indices, vertices, index_count, vertex_count, format.size);
+    sphere_uv(source, format, 0, 0, options);
+
+    // Collapsing modifies the mesh, so each iteration starts from a copy of the source.
+    auto destination = mesh();
+    init(destination, indices, vertices, index_count, vertex_count, format.size);
+    auto reset = [&]()
+    {
+      std::memcpy(destination.index_buffer.data, source.index_buffer.data, source.index_buffer.size);
+      std::memcpy(destination.vertex_buffer.data, source.vertex_buffer.data, source.vertex_buffer.size);
+    };
+
+    benchmark("collapse: 128 division sphere (1000 iterations)", 10, [&]()
+    {
+      reset();
+      collapse(destination, format, 1000);
+    });
+
+    benchmark("collapse: 128 division sphere (to 10% of faces)", 10, [&]()
+    {
+      reset();
+      collapse(destination, format, { .target_face_count = index_count / 30 });
+    });
+
+    de_init(destination, indices, vertices);
+    de_init(source, indices, vertices);
+    deallocate(vertices);
+    deallocate(indices);
+  }
+}
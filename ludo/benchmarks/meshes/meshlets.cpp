@@ -0,0 +1,62 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <iostream>
+
+#include <ludo/meshes/meshlets.h>
+#include <ludo/meshes/optimize.h>
+#include <ludo/meshes/shapes.h>
+#include <ludo/testing.h>
+
+#include "meshlets.h"
+
+namespace ludo
+{
+  void benchmark_meshes_meshlets()
+  {
+    auto format = vertex_format_pnc;
+    auto options = shape_options { .divisions = 128, .smooth = true };
+    auto [ index_count, vertex_count ] = sphere_uv_counts(format, options);
+
+    auto indices = allocate_heap(index_count * sizeof(uint32_t));
+    auto vertices = allocate_heap(vertex_count * format.size);
+    auto sphere = mesh();
+    init(sphere, indices, vertices, index_count, vertex_count, format.size);
+    sphere_uv(sphere, format, 0, 0, options);
+    optimize_vertex_cache(sphere, format);
+
+    auto meshlets = std::vector<meshlet>();
+    benchmark("build_meshlets: 128 division sphere", 10, [&]()
+    {
+      meshlets = build_meshlets(sphere, format);
+    });
+
+    auto camera = ludo::camera
+    {
+      .view = mat4_identity,
+      .projection = perspective(60.0f, 16.0f / 9.0f, 0.1f, 100.0f)
+    };
+    auto render_program = ludo::render_program { .command_buffer = allocate(meshlets.size() * sizeof(render_command)) };
+    auto render_mesh = ludo::render_mesh { .indices = { .start = 0, .count = index_count }, .vertices = { .start = 0, .count = vertex_count } };
+
+    // Close enough to the camera for part of the sphere to be outside the view frustum.
+    auto transform = mat4_identity;
+    position(transform, vec3 { 2.0f, 0.0f, -2.0f });
+
+    auto stats = meshlet_culling_stats();
+    benchmark("add_render_commands: 128 division sphere meshlets", 1000, [&]()
+    {
+      render_program.active_commands = {};
+      stats = add_render_commands(render_program, render_mesh, meshlets, transform, camera);
+    });
+
+    std::cout << "add_render_commands: " << stats.meshlet_count << " meshlets, " << stats.frustum_culled_count << " frustum culled, " << stats.cone_culled_count << " cone culled, " <<
+      stats.culled_triangle_count << " of " << stats.triangle_count << " triangles culled in " << stats.command_count << " commands" << std::endl;
+
+    deallocate(render_program.command_buffer);
+    de_init(sphere, indices, vertices);
+    deallocate(vertices);
+    deallocate(indices);
+  }
+}
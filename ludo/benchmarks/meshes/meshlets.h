@@ -0,0 +1,10 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#pragma once
+
+namespace ludo
+{
+  void benchmark_meshes_meshlets();
+}
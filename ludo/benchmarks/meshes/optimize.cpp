@@ -0,0 +1,83 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include <ludo/meshes/optimize.h>
+#include <ludo/meshes/shapes.h>
+#include <ludo/testing.h>
+
+#include "optimize.h"
+
+namespace ludo
+{
+  void print_vertex_cache_statistics(const std::string& name, const mesh& mesh, const vertex_format& format);
+
+  void benchmark_meshes_optimize()
+  {
+    auto format = vertex_format_pnc;
+    auto options = shape_options { .divisions = 128, .smooth = true };
+    auto [ index_count, vertex_count ] = sphere_uv_counts(format, options);
+
+    auto indices = allocate_heap(2 * index_count * sizeof(uint32_t));
+    auto vertices = allocate_heap(2 * vertex_count * format.size);
+    auto source = mesh();
+    init(source, indices, vertices, index_count, vertex_count, format.size);
+    sphere_uv(source, format, 0, 0, options);
+
+    // Shuffle the triangles (deterministically) to resemble a mesh that hasn't been authored with the vertex cache in mind.
+    auto triangles = std::vector<std::array<uint32_t, 3>>(index_count / 3);
+    std::memcpy(triangles.data(), source.index_buffer.data, source.index_buffer.size);
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(0));
+    std::memcpy(source.index_buffer.data, triangles.data(), source.index_buffer.size);
+
+    // Optimizing modifies the mesh, so each iteration starts from a copy of the source.
+    auto destination = mesh();
+    init(destination, indices, vertices, index_count, vertex_count, format.size);
+    auto reset = [&]()
+    {
+      std::memcpy(destination.index_buffer.data, source.index_buffer.data, source.index_buffer.size);
+      std::memcpy(destination.vertex_buffer.data, source.vertex_buffer.data, source.vertex_buffer.size);
+    };
+
+    reset();
+    print_vertex_cache_statistics("optimize: 128 division sphere (shuffled)", destination, format);
+    optimize_vertex_cache(destination, format);
+    print_vertex_cache_statistics("optimize: 128 division sphere (vertex cache)", destination, format);
+    optimize_overdraw(destination, format);
+    print_vertex_cache_statistics("optimize: 128 division sphere (vertex cache, overdraw)", destination, format);
+
+    benchmark("optimize_vertex_cache: 128 division sphere", 10, [&]()
+    {
+      reset();
+      optimize_vertex_cache(destination, format);
+    });
+
+    benchmark("optimize_overdraw: 128 division sphere", 10, [&]()
+    {
+      reset();
+      optimize_overdraw(destination, format);
+    });
+
+    benchmark("optimize_vertex_fetch: 128 division sphere", 10, [&]()
+    {
+      reset();
+      optimize_vertex_fetch(destination, format);
+    });
+
+    de_init(destination, indices, vertices);
+    de_init(source, indices, vertices);
+    deallocate(vertices);
+    deallocate(indices);
+  }
+
+  void print_vertex_cache_statistics(const std::string& name, const mesh& mesh, const vertex_format& format)
+  {
+    auto statistics = analyze_vertex_cache(mesh, format);
+    std::cout << std::fixed << std::setprecision(4) << name << ": ACMR " << statistics.acmr << ", ATVR " << statistics.atvr << std::endl;
+  }
+}
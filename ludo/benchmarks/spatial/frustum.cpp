@@ -0,0 +1,81 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+
+#include <ludo/rendering.h>
+#include <ludo/spatial/frustum.h>
+#include <ludo/testing.h>
+
+#include "frustum.h"
+
+namespace ludo
+{
+  void benchmark_spatial_frustum()
+  {
+    auto camera = ludo::camera
+    {
+      .view = mat4(vec3_zero, mat3(vec3_unit_y, pi / 4.0f)),
+      .projection = perspective(60.0f, 16.0f / 9.0f, 0.1f, 1000.0f)
+    };
+    auto planes = frustum_planes(camera);
+
+    auto box_count = uint32_t(100000);
+    auto boxes = std::vector<aabb3>();
+    auto bounds = aabb3_soa();
+    auto spheres = sphere_soa();
+    for (auto index = uint32_t(0); index < box_count; index++)
+    {
+      // A deterministic scattering of boxes of varying sizes.
+      auto center = vec3
+      {
+        std::fmod(static_cast<float>(index) * 73.1f, 1590.0f) - 795.0f,
+        std::fmod(static_cast<float>(index) * 31.7f, 1590.0f) - 795.0f,
+        std::fmod(static_cast<float>(index) * 55.3f, 1590.0f) - 795.0f
+      };
+      auto half_extent = 1.0f + static_cast<float>(index % 5) * 5.0f;
+
+      boxes.push_back({ .min = center - vec3 { half_extent, half_extent, half_extent }, .max = center + vec3 { half_extent, half_extent, half_extent } });
+
+      bounds.min_x.push_back(boxes.back().min[0]);
+      bounds.min_y.push_back(boxes.back().min[1]);
+      bounds.min_z.push_back(boxes.back().min[2]);
+      bounds.max_x.push_back(boxes.back().max[0]);
+      bounds.max_y.push_back(boxes.back().max[1]);
+      bounds.max_z.push_back(boxes.back().max[2]);
+
+      spheres.center_x.push_back(center[0]);
+      spheres.center_y.push_back(center[1]);
+      spheres.center_z.push_back(center[2]);
+      spheres.radius.push_back(half_extent * std::sqrt(3.0f));
+    }
+
+    auto results = std::vector<int8_t>(box_count);
+    benchmark("frustum_test: 100k boxes (individual)", 100, [&]()
+    {
+      for (auto index = uint32_t(0); index < box_count; index++)
+      {
+        results[index] = static_cast<int8_t>(frustum_test(planes, boxes[index]));
+      }
+    });
+
+    benchmark("frustum_test: 100k boxes (batch)", 100, [&]()
+    {
+      results = frustum_test(planes, bounds);
+    });
+
+    // The first test primes the hints, as the previous frame would have.
+    auto plane_hints = std::vector<uint8_t>();
+    frustum_test(planes, bounds, plane_hints);
+    benchmark("frustum_test: 100k boxes (batch, coherent)", 100, [&]()
+    {
+      results = frustum_test(planes, bounds, plane_hints);
+    });
+
+    benchmark("frustum_test: 100k spheres (batch)", 100, [&]()
+    {
+      results = frustum_test(planes, spheres);
+    });
+  }
+}
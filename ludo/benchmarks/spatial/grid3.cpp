@@ -0,0 +1,117 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <iostream>
+
+#include <ludo/rendering.h>
+#include <ludo/spatial/frustum.h>
+#include <ludo/spatial/grid3.h>
+#include <ludo/testing.h>
+
+#include "grid3.h"
+
+namespace ludo
+{
+  std::vector<uint64_t> cell_render_mesh_ids(const grid3& grid, uint32_t cell_index);
+
+  void benchmark_spatial_grid3()
+  {
+    auto grid = grid3 { .bounds = { .min = { -800.0f, -800.0f, -800.0f }, .max = { 800.0f, 800.0f, 800.0f } }, .cell_count_1d = 16 };
+    init(grid);
+
+    auto render_mesh_id = uint64_t(1);
+    for (auto x = -750.0f; x < 800.0f; x += 100.0f)
+    {
+      for (auto y = -750.0f; y < 800.0f; y += 100.0f)
+      {
+        for (auto z = -750.0f; z < 800.0f; z += 100.0f)
+        {
+          add(grid, render_mesh { .id = render_mesh_id++ }, { x, y, z });
+        }
+      }
+    }
+
+    // Look in 8 directions from the center of the grid.
+    auto plane_sets = std::vector<std::array<vec4, 6>>();
+    for (auto direction_index = 0; direction_index < 8; direction_index++)
+    {
+      auto camera = ludo::camera
+      {
+        .view = mat4(vec3_zero, mat3(vec3_unit_y, static_cast<float>(direction_index) * pi / 4.0f)),
+        .projection = perspective(60.0f, 16.0f / 9.0f, 0.1f, 1000.0f)
+      };
+      plane_sets.push_back(frustum_planes(camera));
+    }
+
+    auto cell_count = uint32_t(16 * 16 * 16);
+    auto cell_dimensions = vec3 { 100.0f, 100.0f, 100.0f };
+
+    auto flat_test_count = uint64_t(0);
+    benchmark("grid3: find frustum (flat)", 1000, [&]()
+    {
+      for (auto& planes : plane_sets)
+      {
+        auto render_mesh_ids = std::vector<uint64_t>();
+        for (auto cell_index = uint32_t(0); cell_index < cell_count; cell_index++)
+        {
+          auto x = cell_index / (16 * 16);
+          auto y = (cell_index / 16) % 16;
+          auto z = cell_index % 16;
+          auto min = grid.bounds.min + vec3 { static_cast<float>(x), static_cast<float>(y), static_cast<float>(z) } * cell_dimensions;
+
+          flat_test_count++;
+          if (frustum_test(planes, { .min = min, .max = min + cell_dimensions }) != -1)
+          {
+            auto ids = cell_render_mesh_ids(grid, cell_index);
+            render_mesh_ids.insert(render_mesh_ids.end(), ids.begin(), ids.end());
+          }
+        }
+      }
+    });
+
+    auto hierarchical_test_count = uint64_t(0);
+    benchmark("grid3: find frustum (hierarchical)", 1000, [&]()
+    {
+      for (auto& planes : plane_sets)
+      {
+        auto render_mesh_ids = find(grid, [&](const aabb3& bounds)
+        {
+          hierarchical_test_count++;
+          return frustum_test(planes, bounds);
+        });
+      }
+    });
+
+    // The render meshes were added without a render program, so they belong to a render program with an ID of 0.
+    auto render_programs = allocate_array<render_program>(1);
+    add(render_programs, render_program { .command_buffer = allocate(cell_count * sizeof(render_command)) });
+
+    auto cameras = std::vector<camera>();
+    for (auto direction_index = 0; direction_index < 8; direction_index++)
+    {
+      cameras.push_back(
+      {
+        .view = mat4(vec3_zero, mat3(vec3_unit_y, static_cast<float>(direction_index) * pi / 4.0f)),
+        .projection = perspective(60.0f, 16.0f / 9.0f, 0.1f, 1000.0f)
+      });
+    }
+
+    benchmark("grid3: add render commands (cpu)", 1000, [&]()
+    {
+      for (auto& camera : cameras)
+      {
+        render_programs[0].active_commands.count = 0;
+        add_render_commands(grid, render_programs, camera);
+      }
+    });
+
+    deallocate(render_programs[0].command_buffer);
+    deallocate(render_programs);
+
+    std::cout << "grid3: tests per query (flat): " << flat_test_count / (1000 * plane_sets.size()) << std::endl;
+    std::cout << "grid3: tests per query (hierarchical): " << hierarchical_test_count / (1000 * plane_sets.size()) << std::endl;
+
+    de_init(grid);
+  }
+}
@@ -0,0 +1,152 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+#include <iostream>
+
+#include <ludo/rendering.h>
+#include <ludo/spatial/frustum.h>
+#include <ludo/spatial/loose_octree.h>
+#include <ludo/spatial/octree.h>
+#include <ludo/testing.h>
+
+#include "loose_octree.h"
+
+namespace ludo
+{
+  void benchmark_spatial_loose_octree()
+  {
+    auto bounds = aabb3 { .min = { -800.0f, -800.0f, -800.0f }, .max = { 800.0f, 800.0f, 800.0f } };
+
+    auto octree = ludo::octree { .bounds = bounds, .divisions = 4, .cell_capacity = 64 };
+    init(octree);
+
+    auto loose_octree = ludo::loose_octree { .bounds = bounds, .divisions = 4 };
+    init(loose_octree);
+
+    auto element_bounds = std::vector<aabb3>();
+    for (auto index = uint32_t(0); index < 32768; index++)
+    {
+      // A deterministic scattering of elements of varying sizes.
+      auto center = vec3
+      {
+        std::fmod(static_cast<float>(index) * 73.1f, 1590.0f) - 795.0f,
+        std::fmod(static_cast<float>(index) * 31.7f, 1590.0f) - 795.0f,
+        std::fmod(static_cast<float>(index) * 55.3f, 1590.0f) - 795.0f
+      };
+      auto half_extent = 1.0f + static_cast<float>(index % 5) * 5.0f;
+
+      element_bounds.push_back({ .min = center - vec3 { half_extent, half_extent, half_extent }, .max = center + vec3 { half_extent, half_extent, half_extent } });
+    }
+
+    benchmark("octree: add", 1, [&]()
+    {
+      for (auto index = uint32_t(0); index < element_bounds.size(); index++)
+      {
+        add(octree, index, (element_bounds[index].min + element_bounds[index].max) / 2.0f);
+      }
+    });
+
+    benchmark("loose_octree: add", 1, [&]()
+    {
+      for (auto index = uint32_t(0); index < element_bounds.size(); index++)
+      {
+        add(loose_octree, index, element_bounds[index]);
+      }
+    });
+
+    // Look in 8 directions from the center.
+    auto plane_sets = std::vector<std::array<vec4, 6>>();
+    for (auto direction_index = 0; direction_index < 8; direction_index++)
+    {
+      auto camera = ludo::camera
+      {
+        .view = mat4(vec3_zero, mat3(vec3_unit_y, static_cast<float>(direction_index) * pi / 4.0f)),
+        .projection = perspective(60.0f, 16.0f / 9.0f, 0.1f, 1000.0f)
+      };
+      plane_sets.push_back(frustum_planes(camera));
+    }
+
+    // Cast rays along the view directions (the normals of the near planes).
+    auto ray_directions = std::vector<vec3>();
+    for (auto& planes : plane_sets)
+    {
+      auto direction = vec3 { planes[4][0], planes[4][1], planes[4][2] };
+      normalize(direction);
+      ray_directions.push_back(direction);
+    }
+
+    auto octree_result_count = uint64_t(0);
+    benchmark("octree: find frustum", 100, [&]()
+    {
+      for (auto& planes : plane_sets)
+      {
+        octree_result_count += find(octree, [&](const aabb3& bounds)
+        {
+          return frustum_test(planes, bounds);
+        }).size();
+      }
+    });
+
+    auto loose_octree_result_count = uint64_t(0);
+    benchmark("loose_octree: find frustum", 100, [&]()
+    {
+      for (auto& planes : plane_sets)
+      {
+        loose_octree_result_count += find(loose_octree, [&](const aabb3& bounds)
+        {
+          return frustum_test(planes, bounds);
+        }).size();
+      }
+    });
+
+    std::cout << "octree: results per query (element positions only): " << octree_result_count / (100 * plane_sets.size()) << std::endl;
+    std::cout << "loose_octree: results per query (element bounds): " << loose_octree_result_count / (100 * plane_sets.size()) << std::endl;
+
+    benchmark("loose_octree: find sphere", 1000, [&]()
+    {
+      find(loose_octree, vec3 { 100.0f, -50.0f, 25.0f }, 150.0f);
+    });
+
+    benchmark("loose_octree: raycast", 1000, [&]()
+    {
+      for (auto& direction : ray_directions)
+      {
+        raycast(loose_octree, vec3_zero, direction, 1000.0f);
+      }
+    });
+
+    benchmark("loose_octree: raycast all", 1000, [&]()
+    {
+      for (auto& direction : ray_directions)
+      {
+        raycast_all(loose_octree, vec3_zero, direction, 1000.0f);
+      }
+    });
+
+    benchmark("loose_octree: nearest (16)", 1000, [&]()
+    {
+      nearest(loose_octree, vec3 { 100.0f, -50.0f, 25.0f }, 16);
+    });
+
+    benchmark("loose_octree: move", 10, [&]()
+    {
+      for (auto index = uint32_t(0); index < element_bounds.size(); index++)
+      {
+        auto offset = vec3 { 1.0f, 0.0f, 0.0f };
+        auto new_bounds = aabb3 { .min = element_bounds[index].min + offset, .max = element_bounds[index].max + offset };
+        if (!contains(bounds, (new_bounds.min + new_bounds.max) / 2.0f))
+        {
+          continue;
+        }
+
+        move(loose_octree, index, element_bounds[index], new_bounds);
+        element_bounds[index] = new_bounds;
+      }
+    });
+
+    de_init(loose_octree);
+    de_init(octree);
+  }
+}
@@ -0,0 +1,86 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+
+#include <ludo/spatial/octree.h>
+#include <ludo/spatial/quadtree.h>
+#include <ludo/testing.h>
+#include <ludo/thread_pool.h>
+
+#include "octree.h"
+
+namespace ludo
+{
+  void benchmark_spatial_octree()
+  {
+    auto bounds = aabb3 { .min = { -800.0f, -800.0f, -800.0f }, .max = { 800.0f, 800.0f, 800.0f } };
+
+    auto elements = std::vector<uint32_t>();
+    auto positions = std::vector<vec3>();
+    for (auto index = uint32_t(0); index < 262144; index++)
+    {
+      // A deterministic scattering of elements.
+      elements.push_back(index);
+      positions.push_back(
+      {
+        std::fmod(static_cast<float>(index) * 73.1f, 1590.0f) - 795.0f,
+        std::fmod(static_cast<float>(index) * 31.7f, 1590.0f) - 795.0f,
+        std::fmod(static_cast<float>(index) * 55.3f, 1590.0f) - 795.0f
+      });
+    }
+
+    auto positions_2d = std::vector<vec2>();
+    for (auto& position : positions)
+    {
+      positions_2d.push_back({ position[0], position[1] });
+    }
+
+    auto octree = ludo::octree { .bounds = bounds, .divisions = 5, .cell_capacity = 8 };
+    auto quadtree = ludo::quadtree { .bounds = { .min = { bounds.min[0], bounds.min[1] }, .max = { bounds.max[0], bounds.max[1] } }, .divisions = 7, .cell_capacity = 16 };
+
+    benchmark("octree: add (262144 elements)", 5, [&]()
+    {
+      init(octree);
+      for (auto index = uint32_t(0); index < elements.size(); index++)
+      {
+        add(octree, elements[index], positions[index]);
+      }
+      de_init(octree);
+    });
+
+    benchmark("quadtree: add (262144 elements)", 5, [&]()
+    {
+      init(quadtree);
+      for (auto index = uint32_t(0); index < elements.size(); index++)
+      {
+        add(quadtree, elements[index], positions_2d[index]);
+      }
+      de_init(quadtree);
+    });
+
+    // Without the thread pool started, the build runs entirely on the calling thread.
+    for (auto threaded : { false, true })
+    {
+      if (threaded)
+      {
+        thread_pool_start();
+      }
+
+      benchmark(threaded ? "octree: build (262144 elements, threaded)" : "octree: build (262144 elements)", 5, [&]()
+      {
+        init(octree);
+        build(octree, elements, positions);
+        de_init(octree);
+      });
+
+      benchmark(threaded ? "quadtree: build (262144 elements, threaded)" : "quadtree: build (262144 elements)", 5, [&]()
+      {
+        init(quadtree);
+        build(quadtree, elements, positions_2d);
+        de_init(quadtree);
+      });
+    }
+  }
+}
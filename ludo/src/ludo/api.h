@@ -16,6 +16,10 @@
 #include "meshes/collapse.h"
 #include "meshes/clean.h"
 #include "meshes/edit.h"
+#include "meshes/lmesh.h"
+#include "meshes/meshlets.h"
+#include "meshes/optimize.h"
+#include "meshes/packing.h"
 #include "meshes/shapes.h"
 #include "meshes/util.h"
 #include "importing.h"
@@ -31,8 +35,13 @@
 #include "rendering.h"
 #include "scripts.h"
 #include "spatial/bounds.h"
+#include "spatial/cell_pool.h"
+#include "spatial/frustum.h"
 #include "spatial/grid2.h"
 #include "spatial/grid3.h"
+#include "spatial/hash_grid3.h"
+#include "spatial/loose_octree.h"
+#include "spatial/occlusion.h"
 #include "spatial/octree.h"
 #include "spatial/quadtree.h"
 #include "timer.h"
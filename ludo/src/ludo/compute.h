@@ -15,6 +15,7 @@ namespace ludo
   struct compute_program
   {
     uint64_t id = 0; ///< The ID of this compute program.
+    uint64_t program_id = 0; ///< The ID of the compiled program (shared by compute programs built from identical code).
 
     buffer shader_buffer; ///< A buffer containing data available to this compute program.
   };
@@ -11,7 +11,7 @@
 
 namespace ludo
 {
-  uint64_t next_id = 1;
+  std::atomic<uint64_t> next_id = 1;
 
   // TODO arghhh! global!
   std::vector<float> total_script_times;
@@ -4,14 +4,15 @@
 
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <unordered_map>
 
 namespace ludo
 {
   ///
-  /// A counter used to provide unique IDs.
-  extern uint64_t next_id;
+  /// A counter used to provide unique IDs. Atomic since buffers (for example) may be allocated by the thread pool.
+  extern std::atomic<uint64_t> next_id;
 
   ///
   /// An instance of ludo.
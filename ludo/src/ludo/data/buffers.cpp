@@ -56,4 +56,16 @@ namespace ludo
   {
     return stream.position >= stream.size;
   }
+
+  uint64_t hash(const std::byte* data, uint64_t size, uint64_t seed)
+  {
+    auto hash = seed;
+    for (auto byte_index = uint64_t(0); byte_index < size; byte_index++)
+    {
+      hash ^= static_cast<uint64_t>(data[byte_index]);
+      hash *= uint64_t(1099511628211u); // FNV-1a prime
+    }
+
+    return hash;
+  }
 }
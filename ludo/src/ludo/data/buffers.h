@@ -130,6 +130,14 @@ namespace ludo
   /// \param stream The stream to check.
   /// \return True the stream has reached the end of the data, false otherwise.
   bool ended(stream& stream);
+
+  ///
+  /// Hashes a range of bytes (FNV-1a). Suitable for detecting changes to data, but not for cryptographic purposes.
+  /// \param data The bytes.
+  /// \param size The number of bytes.
+  /// \param seed The hash to continue from, so that several ranges of bytes can be hashed together.
+  /// \return The hash.
+  uint64_t hash(const std::byte* data, uint64_t size, uint64_t seed = 14695981039346656037u);
 }
 
 #include "buffers.hpp"
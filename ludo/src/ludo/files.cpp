@@ -2,10 +2,108 @@
  * This file is part of ludo. See the LICENSE file for the full license governing this code.
  */
 
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdlib>
+
 #include "files.h"
 
 namespace ludo
 {
+  std::string find_user_folder();
+
   std::string asset_folder = "./assets";
-  std::string user_folder = "~/.ludo";
+  std::string user_folder = find_user_folder();
+
+  buffer map_file(const std::string& file_name)
+  {
+    auto buffer = ludo::buffer();
+
+#ifdef _WIN32
+    auto file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+      return buffer;
+    }
+
+    auto size = LARGE_INTEGER();
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+      // The view keeps the mapping (and the file) open once their handles are closed.
+      auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mapping)
+      {
+        buffer.data = static_cast<std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        buffer.size = buffer.data ? static_cast<uint64_t>(size.QuadPart) : 0;
+        CloseHandle(mapping);
+      }
+    }
+
+    CloseHandle(file);
+#else
+    auto file = open(file_name.c_str(), O_RDONLY);
+    if (file == -1)
+    {
+      return buffer;
+    }
+
+    // The mapping keeps the file open once its descriptor is closed.
+    struct stat file_stat;
+    if (fstat(file, &file_stat) == 0 && file_stat.st_size > 0)
+    {
+      auto data = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+      if (data != MAP_FAILED)
+      {
+        buffer.data = static_cast<std::byte*>(data);
+        buffer.size = static_cast<uint64_t>(file_stat.st_size);
+      }
+    }
+
+    close(file);
+#endif
+
+    return buffer;
+  }
+
+  void unmap_file(buffer& buffer)
+  {
+    assert(buffer.data && "buffer not mapped");
+
+#ifdef _WIN32
+    UnmapViewOfFile(buffer.data);
+#else
+    munmap(buffer.data, static_cast<size_t>(buffer.size));
+#endif
+
+    buffer.data = nullptr;
+    buffer.size = 0;
+  }
+
+  std::string find_user_folder()
+  {
+#ifdef _WIN32
+    auto root = std::getenv("APPDATA");
+    auto folder = "/ludo";
+#else
+    auto root = std::getenv("HOME");
+    auto folder = "/.ludo";
+#endif
+
+    // Nothing expands e.g. '~', so without an absolute root there is nowhere to put the user's files.
+    if (!root || !*root)
+    {
+      return "";
+    }
+
+    return std::string(root) + folder;
+  }
 }
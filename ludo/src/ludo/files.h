@@ -6,8 +6,21 @@
 
 #include <string>
 
+#include "data/buffers.h"
+
 namespace ludo
 {
   extern std::string asset_folder; ///< Read-only files packaged with the application
-  extern std::string user_folder; ///< Read-write files specific to the current user
+  extern std::string user_folder; ///< Read-write files specific to the current user. Resolved from HOME (or APPDATA on Windows) at startup, empty if neither is set
+
+  ///
+  /// Maps a file into (read-only) memory. The pages of the file are only read as they are accessed.
+  /// \param file_name The name of the file.
+  /// \return A buffer containing the file, or an empty buffer if the file could not be mapped (including when it is empty).
+  buffer map_file(const std::string& file_name);
+
+  ///
+  /// Unmaps a file mapped into memory.
+  /// \param buffer The buffer containing the file.
+  void unmap_file(buffer& buffer);
 }
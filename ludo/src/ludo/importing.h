@@ -25,6 +25,7 @@ namespace ludo
   struct import_options
   {
     bool merge_meshes = false; ///< Determines if the meshes being imported should be merged into a single mesh.
+    bool optimize_meshes = true; ///< Determines if the meshes being imported should be optimized for the vertex cache and vertex fetches (see optimize). Only applies to triangles.
   };
 
   ///
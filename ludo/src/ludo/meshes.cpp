@@ -2,45 +2,49 @@
  * This file is part of ludo. See the LICENSE file for the full license governing this code.
  */
 
-#include <fstream>
+#include <limits>
 
 #include "animation.h"
 #include "meshes.h"
 
 namespace ludo
 {
-  vertex_format format(bool normal, bool color, bool texture_coordinate, bool bone_weights)
+  vertex_format format(bool normal, bool color, bool texture_coordinate, bool bone_weights, bool packed)
   {
     auto format = vertex_format();
 
-    format.components.emplace_back(std::pair { 'p', 3 });
-    format.size += 3 * sizeof(float);
+    format.packed_position = packed;
+    format.components.emplace_back(packed ? std::pair { 'P', 4 } : std::pair { 'p', 3 });
+    format.size += component_size(format.components.back());
 
     if (normal)
     {
       format.has_normal = true;
+      format.packed_normal = packed;
       format.normal_offset = format.size;
 
-      format.components.emplace_back(std::pair { 'n', 3 });
-      format.size += 3 * sizeof(float);
+      format.components.emplace_back(packed ? std::pair { 'N', 2 } : std::pair { 'n', 3 });
+      format.size += component_size(format.components.back());
     }
 
     if (color)
     {
       format.has_color = true;
+      format.packed_color = packed;
       format.color_offset = format.size;
 
-      format.components.emplace_back(std::pair { 'c', 4 });
-      format.size += 4 * sizeof(float);
+      format.components.emplace_back(packed ? std::pair { 'C', 4 } : std::pair { 'c', 4 });
+      format.size += component_size(format.components.back());
     }
 
     if (texture_coordinate)
     {
       format.has_texture_coordinate = true;
+      format.packed_texture_coordinate = packed;
       format.texture_coordinate_offset = format.size;
 
-      format.components.emplace_back(std::pair { 't', 2 });
-      format.size += 2 * sizeof(float);
+      format.components.emplace_back(packed ? std::pair { 'T', 2 } : std::pair { 't', 2 });
+      format.size += component_size(format.components.back());
     }
 
     if (bone_weights)
@@ -49,98 +53,138 @@ namespace ludo
       format.bone_weights_offset = format.size;
 
       format.components.emplace_back(std::pair { 'b', max_bone_weights_per_vertex });
-      format.size += max_bone_weights_per_vertex * (sizeof(uint32_t) + sizeof(float));
+      format.size += component_size(format.components.back());
     }
 
     return format;
   }
 
-  void init(mesh& mesh, heap& indices, heap& vertices, uint32_t index_count, uint32_t vertex_count, uint8_t vertex_size)
+  vertex_format format(const std::vector<std::pair<char, uint32_t>>& components)
   {
-    mesh.id = next_id++;
+    auto format = vertex_format();
+    format.components = components;
 
-    mesh.index_buffer = allocate(indices, index_count * sizeof(uint32_t));
-    mesh.vertex_buffer = allocate(vertices, vertex_count * vertex_size, vertex_size);
-    mesh.vertex_size = vertex_size;
+    for (auto& component : components)
+    {
+      auto type = component.first;
+      if (type == 'p' || type == 'P')
+      {
+        format.packed_position = type == 'P';
+        format.position_offset = format.size;
+      }
+      else if (type == 'n' || type == 'N')
+      {
+        format.has_normal = true;
+        format.packed_normal = type == 'N';
+        format.normal_offset = format.size;
+      }
+      else if (type == 'c' || type == 'C')
+      {
+        format.has_color = true;
+        format.packed_color = type == 'C';
+        format.color_offset = format.size;
+      }
+      else if (type == 't' || type == 'T')
+      {
+        format.has_texture_coordinate = true;
+        format.packed_texture_coordinate = type == 'T';
+        format.texture_coordinate_offset = format.size;
+      }
+      else if (type == 'b')
+      {
+        format.has_bone_weights = true;
+        format.bone_weights_offset = format.size;
+      }
+
+      format.size += component_size(component);
+    }
+
+    return format;
   }
 
-  void de_init(mesh& mesh, heap& indices, heap& vertices)
+  uint32_t component_size(const std::pair<char, uint32_t>& component)
   {
-    mesh.id = 0;
-
-    if (mesh.index_buffer.data)
+    auto type = component.first;
+    if (type == 'P' || type == 'T')
     {
-      deallocate(indices, mesh.index_buffer);
+      return component.second * sizeof(uint16_t);
     }
-
-    if (mesh.vertex_buffer.data)
+    else if (type == 'N')
     {
-      deallocate(vertices, mesh.vertex_buffer);
+      return component.second * sizeof(int16_t);
+    }
+    else if (type == 'C')
+    {
+      return component.second * sizeof(uint8_t);
+    }
+    else if (type == 'b')
+    {
+      return component.second * (sizeof(uint32_t) + sizeof(float));
+    }
+    else if (type == 'i' || type == 'u')
+    {
+      return component.second * sizeof(uint32_t);
     }
+
+    return component.second * sizeof(float);
   }
 
-  mesh load(const std::string& file_name, heap& indices, heap& vertices)
+  uint8_t compact_index_size(uint32_t vertex_count)
   {
-    auto stream = std::ifstream(file_name, std::ios::binary);
-
-    return load(stream, indices, vertices);
+    return vertex_count <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
   }
 
-  mesh load(std::istream& stream, heap& indices, heap& vertices)
+  uint32_t index_count(const mesh& mesh)
   {
-    auto mesh = ludo::mesh();
-    mesh.id = next_id++;
-
-    stream.read(reinterpret_cast<char*>(&mesh.index_buffer.size), sizeof(uint64_t));
-    mesh.index_buffer = allocate(indices, mesh.index_buffer.size);
-    stream.read(reinterpret_cast<char*>(mesh.index_buffer.data), static_cast<int64_t>(mesh.index_buffer.size));
-
-    stream.read(reinterpret_cast<char*>(&mesh.vertex_size), sizeof(uint32_t));
-
-    stream.read(reinterpret_cast<char*>(&mesh.vertex_buffer.size), sizeof(uint64_t));
-    mesh.vertex_buffer = allocate(vertices, mesh.vertex_buffer.size, mesh.vertex_size);
-    stream.read(reinterpret_cast<char*>(mesh.vertex_buffer.data), static_cast<int64_t>(mesh.vertex_buffer.size));
-
-    return mesh;
+    return static_cast<uint32_t>(mesh.index_buffer.size / mesh.index_size);
   }
 
-  void save(const mesh& mesh, const std::string& file_name)
+  uint32_t read_index(const mesh& mesh, uint32_t index_index)
   {
-    auto stream = std::ofstream(file_name, std::ios::binary);
+    if (mesh.index_size == sizeof(uint16_t))
+    {
+      return cast<uint16_t>(mesh.index_buffer, index_index * sizeof(uint16_t));
+    }
 
-    save(mesh, stream);
+    return cast<uint32_t>(mesh.index_buffer, index_index * sizeof(uint32_t));
   }
 
-  void save(const mesh& mesh, std::ostream& stream)
+  void write_index(mesh& mesh, uint32_t index_index, uint32_t index)
   {
-    stream.write(reinterpret_cast<const char*>(&mesh.index_buffer.size), sizeof(uint64_t));
-    stream.write(reinterpret_cast<const char*>(mesh.index_buffer.data), static_cast<int64_t>(mesh.index_buffer.size));
-
-    stream.write(reinterpret_cast<const char*>(&mesh.vertex_size), sizeof(uint32_t));
+    if (mesh.index_size == sizeof(uint16_t))
+    {
+      assert(index <= std::numeric_limits<uint16_t>::max() && "index out of range");
+      cast<uint16_t>(mesh.index_buffer, index_index * sizeof(uint16_t)) = static_cast<uint16_t>(index);
+      return;
+    }
 
-    stream.write(reinterpret_cast<const char*>(&mesh.vertex_buffer.size), sizeof(uint64_t));
-    stream.write(reinterpret_cast<const char*>(mesh.vertex_buffer.data), static_cast<int64_t>(mesh.vertex_buffer.size));
+    cast<uint32_t>(mesh.index_buffer, index_index * sizeof(uint32_t)) = index;
   }
 
-  std::pair<uint32_t, uint32_t> mesh_counts(const std::string& file_name)
+  void init(mesh& mesh, heap& indices, heap& vertices, uint32_t index_count, uint32_t vertex_count, uint8_t vertex_size, uint8_t index_size)
   {
-    auto stream = std::ifstream(file_name);
+    assert((index_size == sizeof(uint16_t) || index_size == sizeof(uint32_t)) && "invalid index size");
 
-    return mesh_counts(stream);
+    mesh.id = next_id++;
+
+    mesh.index_buffer = allocate(indices, index_count * index_size, index_size);
+    mesh.index_size = index_size;
+    mesh.vertex_buffer = allocate(vertices, vertex_count * vertex_size, vertex_size);
+    mesh.vertex_size = vertex_size;
   }
 
-  std::pair<uint32_t, uint32_t> mesh_counts(std::istream& stream)
+  void de_init(mesh& mesh, heap& indices, heap& vertices)
   {
-    auto index_buffer_size = uint64_t(0);
-    stream.read(reinterpret_cast<char*>(&index_buffer_size), sizeof(uint64_t));
-    stream.seekg(static_cast<int64_t>(index_buffer_size), std::ios_base::cur);
-
-    auto vertex_size = uint32_t(0);
-    stream.read(reinterpret_cast<char*>(&vertex_size), sizeof(uint32_t));
+    mesh.id = 0;
 
-    auto vertex_buffer_size = uint64_t(0);
-    stream.read(reinterpret_cast<char*>(&vertex_buffer_size), sizeof(uint64_t));
+    if (mesh.index_buffer.data)
+    {
+      deallocate(indices, mesh.index_buffer);
+    }
 
-    return { index_buffer_size / sizeof(uint32_t), vertex_buffer_size / vertex_size };
+    if (mesh.vertex_buffer.data)
+    {
+      deallocate(vertices, mesh.vertex_buffer);
+    }
   }
 }
@@ -4,9 +4,6 @@
 
 #pragma once
 
-#include <istream>
-#include <ostream>
-
 #include "data/buffers.h"
 #include "data/data.h"
 #include "math/mat.h"
@@ -37,8 +34,13 @@ namespace ludo
   ///   i: int
   ///   u: unsigned int
   ///   f: float
-  /// All components except for i and u represent floats. i and u represent int32_t and uint32_t respectively.
-  /// Component counts represent the number of float/int32_t/uint32_t values within the component e.g. the component p3 represents a position consisting of 3 floats.
+  /// The following component types are packed equivalents of the above:
+  ///   P: position of half floats (P4, with the fourth unused so that the vertices remain 4-byte aligned)
+  ///   N: normal as an octahedral-mapped pair of snorm int16_t (N2)
+  ///   C: color of unorm uint8_t (C4)
+  ///   T: texture coordinate of unorm uint16_t (T2, so limited to the range [0,1])
+  /// All components except for i, u and the packed components represent floats. i and u represent int32_t and uint32_t respectively.
+  /// Component counts represent the number of values within the component e.g. the component p3 represents a position consisting of 3 floats.
   struct vertex_format // TODO split into vertex_format and vertex_options?
   {
     std::vector<std::pair<char, uint32_t>> components; ///< The components. They are of the form { <type>, <count> }.
@@ -49,6 +51,11 @@ namespace ludo
     bool has_texture_coordinate = false; ///< Determines ifa texture coordinate is included.
     bool has_bone_weights = false; ///< Determines if bone weights are included.
 
+    bool packed_position = false; ///< Determines if the position is packed (see P).
+    bool packed_normal = false; ///< Determines if the normal is packed (see N).
+    bool packed_color = false; ///< Determines if the color is packed (see C).
+    bool packed_texture_coordinate = false; ///< Determines if the texture coordinate is packed (see T).
+
     uint32_t position_offset = 0; ///< The offset in bytes to the position.
     uint32_t normal_offset = 0; ///< The offset in bytes to the normal.
     uint32_t color_offset = 0; ///< The offset in bytes to the color.
@@ -67,6 +74,7 @@ namespace ludo
 
     buffer index_buffer; ///< A buffer containing the indices.
     buffer vertex_buffer; ///< A buffer containing the vertices.
+    uint32_t index_size = sizeof(uint32_t); ///< The size in bytes of an index within this mesh (sizeof(uint16_t) or sizeof(uint32_t)).
     uint32_t vertex_size = 0; ///< The size in bytes of a vertex within this mesh.
   };
 
@@ -120,74 +128,85 @@ namespace ludo
     .texture_coordinate_offset = 3 * sizeof(float)
   };
 
+  const auto vertex_format_pnc_packed = vertex_format ///< A vertex format containing packed position, normal and color information
+  {
+    .components = { { 'P', 4 }, { 'N', 2 }, { 'C', 4 } },
+    .size = 4 * sizeof(uint16_t) + 2 * sizeof(int16_t) + 4 * sizeof(uint8_t),
+    .has_normal = true,
+    .has_color = true,
+    .packed_position = true,
+    .packed_normal = true,
+    .packed_color = true,
+    .normal_offset = 4 * sizeof(uint16_t),
+    .color_offset = 4 * sizeof(uint16_t) + 2 * sizeof(int16_t)
+  };
+
   ///
   /// Creates a vertex format based on the options provided.
-  /// It will be of the form p3[n3][c4][t2_0...t2_n][u4f4] where the optional components are only included if specified.
+  /// It will be of the form p3[n3][c4][t2_0...t2_n][u4f4] (or P4[N2][C4][T2][u4f4] if packed) where the optional components are only included if specified.
   /// \param normal Determines if a normal should be included.
   /// \param color Determines if a color should be included.
   /// \param texture_coordinate Determines if a texture coordinate should be included.
   /// \param bone_weights Determines if bone weights should be included.
+  /// \param packed Determines if the position, normal, color and texture coordinate should be packed.
   /// \return A vertex format based on the options provided.
-  vertex_format format(bool normal = false, bool color = false, bool texture_coordinate = false, bool bone_weights = false);
+  vertex_format format(bool normal = false, bool color = false, bool texture_coordinate = false, bool bone_weights = false, bool packed = false);
 
   ///
-  /// Initializes a mesh with index and vertex buffers.
-  /// \param mesh The mesh.
-  /// \param indices The indices to allocate from.
-  /// \param vertices The vertices to allocate from.
-  /// \param index_count The number of indices to allocate.
-  /// \param vertex_count The number of vertices to allocate.
-  /// \param vertex_size The size (in bytes) of a vertex.
-  void init(mesh& mesh, heap& indices, heap& vertices, uint32_t index_count, uint32_t vertex_count, uint8_t vertex_size);
+  /// Creates a vertex format from its components, determining which information is included (and where) from the component types.
+  /// Where a type appears more than once, its last occurrence is used.
+  /// \param components The components. They are of the form { <type>, <count> }.
+  /// \return A vertex format containing the components provided.
+  vertex_format format(const std::vector<std::pair<char, uint32_t>>& components);
 
   ///
-  /// De-initializes a mesh and reclaims the index and vertex buffers.
-  /// \param mesh The mesh.
-  /// \param indices The indices to reclaim to.
-  /// \param vertices The vertices to reclaim to.
-  void de_init(mesh& mesh, heap& indices, heap& vertices);
+  /// Determines the size of a vertex format component.
+  /// \param component The component.
+  /// \return The size (in bytes) of the component.
+  uint32_t component_size(const std::pair<char, uint32_t>& component);
 
   ///
-  /// Loads a mesh from a ludo mesh file.
-  /// \param file_name The name of the file containing the mesh data.
-  /// \param indices The indices to allocate from.
-  /// \param vertices The vertices to allocate from.
-  /// \return The mesh.
-  mesh load(const std::string& file_name, heap& indices, heap& vertices);
+  /// Determines the smallest size of index that can address every vertex of a mesh.
+  /// \param vertex_count The number of vertices.
+  /// \return sizeof(uint16_t) for meshes of up to 65536 vertices, otherwise sizeof(uint32_t).
+  uint8_t compact_index_size(uint32_t vertex_count);
 
   ///
-  /// Loads a mesh from a stream.
-  /// \param stream The mesh data.
-  /// \param indices The indices to allocate from.
-  /// \param vertices The vertices to allocate from.
-  /// \return The mesh.
-  mesh load(std::istream& stream, heap& indices, heap& vertices);
+  /// Determines the number of indices in a mesh.
+  /// \param mesh The mesh.
+  /// \return The number of indices.
+  uint32_t index_count(const mesh& mesh);
 
   ///
-  /// Saves a mesh to a ludo mesh file.
+  /// Reads an index of a mesh, regardless of its index size.
   /// \param mesh The mesh.
-  /// \param file_name The name of the file to save to.
-  void save(const mesh& mesh, const std::string& file_name);
+  /// \param index_index The position of the index within the index buffer.
+  /// \return The index.
+  uint32_t read_index(const mesh& mesh, uint32_t index_index);
 
   ///
-  /// Saves a mesh to a stream.
+  /// Writes an index of a mesh, regardless of its index size.
   /// \param mesh The mesh.
-  /// \param stream The mesh data.
-  void save(const mesh& mesh, std::ostream& stream);
+  /// \param index_index The position of the index within the index buffer.
+  /// \param index The index. Must fit within the index size of the mesh.
+  void write_index(mesh& mesh, uint32_t index_index, uint32_t index);
 
   ///
-  /// Reads mesh counts from a ludo mesh file.
-  /// \param file_name The name of the file containing the mesh data.
+  /// Initializes a mesh with index and vertex buffers.
+  /// Indices of either size can share a heap, since each buffer is aligned to its index size.
+  /// \param mesh The mesh.
   /// \param indices The indices to allocate from.
   /// \param vertices The vertices to allocate from.
-  /// \return The mesh counts.
-  std::pair<uint32_t, uint32_t> mesh_counts(const std::string& file_name);
+  /// \param index_count The number of indices to allocate.
+  /// \param vertex_count The number of vertices to allocate.
+  /// \param vertex_size The size (in bytes) of a vertex.
+  /// \param index_size The size (in bytes) of an index (see compact_index_size).
+  void init(mesh& mesh, heap& indices, heap& vertices, uint32_t index_count, uint32_t vertex_count, uint8_t vertex_size, uint8_t index_size = sizeof(uint32_t));
 
   ///
-  /// Reads mesh counts mesh from a stream.
-  /// \param stream The mesh data.
-  /// \param indices The indices to allocate from.
-  /// \param vertices The vertices to allocate from.
-  /// \return The mesh counts.
-  std::pair<uint32_t, uint32_t> mesh_counts(std::istream& stream);
+  /// De-initializes a mesh and reclaims the index and vertex buffers.
+  /// \param mesh The mesh.
+  /// \param indices The indices to reclaim to.
+  /// \param vertices The vertices to reclaim to.
+  void de_init(mesh& mesh, heap& indices, heap& vertices);
 }
@@ -11,11 +11,12 @@ namespace ludo
   {
     auto index_index = start_index;
     auto vertex_index = start_vertex;
+    auto welder = vertex_welder();
 
-    box(mesh, format, index_index, vertex_index, options, true, false);
+    box(mesh, format, welder, index_index, vertex_index, options, true, false);
   }
 
-  void box(mesh& mesh, const vertex_format& format, uint32_t& index_index, uint32_t& vertex_index, const shape_options& options, bool unique_only, bool no_normal_check)
+  void box(mesh& mesh, const vertex_format& format, vertex_welder& welder, uint32_t& index_index, uint32_t& vertex_index, const shape_options& options, bool unique_only, bool no_normal_check)
   {
     assert(options.divisions >= 1 && "must have at-least 1 division");
     assert(options.outward_faces || options.inward_faces && "outward and/or inward faces must be specified");
@@ -28,6 +29,7 @@ namespace ludo
       rectangle(
         mesh,
         format,
+        welder,
         index_index,
         vertex_index,
         options.center + vec3 { options.dimensions[0] * -0.5f, options.dimensions[1] * -0.5f, options.dimensions[2] * 0.5f },
@@ -45,6 +47,7 @@ namespace ludo
       rectangle(
         mesh,
         format,
+        welder,
         index_index,
         vertex_index,
         options.center + vec3 { options.dimensions[0] * 0.5f, options.dimensions[1] * -0.5f, options.dimensions[2] * -0.5f },
@@ -62,6 +65,7 @@ namespace ludo
       rectangle(
         mesh,
         format,
+        welder,
         index_index,
         vertex_index,
         options.center + vec3 { options.dimensions[0] * -0.5f, options.dimensions[1] * -0.5f, options.dimensions[2] * -0.5f },
@@ -79,6 +83,7 @@ namespace ludo
       rectangle(
         mesh,
         format,
+        welder,
         index_index,
         vertex_index,
         options.center + vec3 { options.dimensions[0] * 0.5f, options.dimensions[1] * -0.5f, options.dimensions[2] * 0.5f },
@@ -96,6 +101,7 @@ namespace ludo
       rectangle(
         mesh,
         format,
+        welder,
         index_index,
         vertex_index,
         options.center + vec3 { options.dimensions[0] * -0.5f, options.dimensions[1] * 0.5f, options.dimensions[2] * 0.5f },
@@ -113,6 +119,7 @@ namespace ludo
       rectangle(
         mesh,
         format,
+        welder,
         index_index,
         vertex_index,
         options.center + vec3 { options.dimensions[0] * -0.5f, options.dimensions[1] * -0.5f, options.dimensions[2] * -0.5f },
@@ -133,6 +140,7 @@ namespace ludo
       rectangle(
         mesh,
         format,
+        welder,
         index_index,
         vertex_index,
         options.center + vec3 { options.dimensions[0] * 0.5f, options.dimensions[1] * -0.5f, options.dimensions[2] * 0.5f },
@@ -150,6 +158,7 @@ namespace ludo
       rectangle(
         mesh,
         format,
+        welder,
         index_index,
         vertex_index,
         options.center + vec3 { -options.dimensions[0] * 0.5f, options.dimensions[1] * -0.5f, options.dimensions[2] * -0.5f },
@@ -167,6 +176,7 @@ namespace ludo
       rectangle(
         mesh,
         format,
+        welder,
         index_index,
         vertex_index,
         options.center + vec3 { options.dimensions[0] * -0.5f, options.dimensions[1] * -0.5f, options.dimensions[2] * 0.5f },
@@ -184,6 +194,7 @@ namespace ludo
       rectangle(
         mesh,
         format,
+        welder,
         index_index,
         vertex_index,
         options.center + vec3 { options.dimensions[0] * 0.5f, options.dimensions[1] * -0.5f, options.dimensions[2] * -0.5f },
@@ -201,6 +212,7 @@ namespace ludo
       rectangle(
         mesh,
         format,
+        welder,
         index_index,
         vertex_index,
         options.center + vec3 { options.dimensions[0] * 0.5f, options.dimensions[1] * 0.5f, options.dimensions[2] * 0.5f },
@@ -218,6 +230,7 @@ namespace ludo
       rectangle(
         mesh,
         format,
+        welder,
         index_index,
         vertex_index,
         options.center + vec3 { options.dimensions[0] * 0.5f, options.dimensions[1] * -0.5f, options.dimensions[2] * -0.5f },
@@ -5,8 +5,9 @@
 #pragma once
 
 #include "shapes.h"
+#include "util.h"
 
 namespace ludo
 {
-  void box(mesh& mesh, const vertex_format& format, uint32_t& index_index, uint32_t& vertex_index, const shape_options& options, bool unique_only, bool no_normal_check);
+  void box(mesh& mesh, const vertex_format& format, vertex_welder& welder, uint32_t& index_index, uint32_t& vertex_index, const shape_options& options, bool unique_only, bool no_normal_check);
 }
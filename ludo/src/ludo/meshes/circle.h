@@ -5,8 +5,9 @@
 #pragma once
 
 #include "shapes.h"
+#include "util.h"
 
 namespace ludo
 {
-  void circle(mesh& mesh, const vertex_format& format, uint32_t& index_index, uint32_t& vertex_index, const vec3& center, float radius, uint32_t divisions, const vec4& color, bool invert);
+  void circle(mesh& mesh, const vertex_format& format, vertex_welder& welder, uint32_t& index_index, uint32_t& vertex_index, const vec3& center, float radius, uint32_t divisions, const vec4& color, bool invert);
 }
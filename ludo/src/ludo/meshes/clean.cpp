@@ -6,61 +6,107 @@
 #include <map>
 
 #include "clean.h"
+#include "packing.h"
 #include "util.h"
 
 namespace ludo
 {
+  bool clean_vertices_match(const mesh& source, const vertex_format& destination_format, const vertex_format& source_format, uint32_t index_a, uint32_t index_b, float epsilon);
+
   std::pair<uint32_t, uint32_t> clean(mesh& destination, const mesh& source, const vertex_format& destination_format, const vertex_format& source_format, bool dry_run)
   {
     auto counts = std::pair<uint32_t, uint32_t> { 0, 0 };
 
-    auto to_mesh = destination;
-    if (dry_run)
-    {
-      to_mesh = ludo::mesh();
-      to_mesh.index_buffer = allocate(destination.index_buffer.size);
-      to_mesh.vertex_buffer = allocate(destination.vertex_buffer.size);
-    }
+    // When counting, the welder holds source vertex indices so that nothing needs to be written.
+    auto welder = vertex_welder();
 
-    auto index_stream = stream(source.index_buffer);
-    while (!ended(index_stream))
+    auto source_index_count = index_count(source);
+    for (auto source_index_index = uint32_t(0); source_index_index + 2 < source_index_count; source_index_index += 3)
     {
       auto indices = std::array<uint32_t, 3>
       {
-        read<uint32_t>(index_stream),
-        read<uint32_t>(index_stream),
-        read<uint32_t>(index_stream)
+        read_index(source, source_index_index),
+        read_index(source, source_index_index + 1),
+        read_index(source, source_index_index + 2)
       };
 
       auto positions = std::array<vec3, 3>
       {
-        cast<vec3>(source.vertex_buffer, indices[0] * source_format.size + source_format.position_offset),
-        cast<vec3>(source.vertex_buffer, indices[1] * source_format.size + source_format.position_offset),
-        cast<vec3>(source.vertex_buffer, indices[2] * source_format.size + source_format.position_offset)
+        read_position(source, source_format, indices[0]),
+        read_position(source, source_format, indices[1]),
+        read_position(source, source_format, indices[2])
       };
 
       auto perpendicular = cross(positions[1] - positions[0], positions[2] - positions[0]);
       auto area = length(perpendicular) / 2.0f;
       if (!near(area, 0.0f))
       {
-        for (auto index : indices)
+        for (auto corner = 0; corner < 3; corner++)
         {
-          auto& position = cast<vec3>(source.vertex_buffer, index * source_format.size + source_format.position_offset);
-          auto normal = source_format.has_normal ? cast<vec3>(source.vertex_buffer, index * source_format.size + source_format.normal_offset) : vec3();
-          auto color = source_format.has_color ? cast<vec4>(source.vertex_buffer, index * source_format.size + source_format.color_offset) : vec4();
-          auto texture_coordinate = source_format.has_texture_coordinate ? cast<vec2>(source.vertex_buffer, index * source_format.size + source_format.texture_coordinate_offset): vec2();
+          auto index = indices[corner];
+          auto& position = positions[corner];
+
+          if (dry_run)
+          {
+            auto existing_index = find(welder, position, [&](uint32_t existing_index)
+            {
+              return clean_vertices_match(source, destination_format, source_format, existing_index, index, welder.epsilon);
+            });
+
+            if (existing_index == std::numeric_limits<uint32_t>::max())
+            {
+              add(welder, position, index);
+              counts.second++;
+            }
+
+            counts.first++;
+            continue;
+          }
+
+          auto normal = source_format.has_normal ? read_normal(source, source_format, index) : vec3();
+          auto color = source_format.has_color ? read_color(source, source_format, index) : vec4();
+          auto texture_coordinate = source_format.has_texture_coordinate ? read_texture_coordinate(source, source_format, index) : vec2();
 
-          write_vertex(to_mesh, destination_format, counts.first, counts.second, position, normal, color, texture_coordinate);
+          write_vertex(destination, destination_format, welder, counts.first, counts.second, position, normal, color, texture_coordinate);
         }
       }
     }
 
-    if (dry_run)
+    return counts;
+  }
+
+  bool clean_vertices_match(const mesh& source, const vertex_format& destination_format, const vertex_format& source_format, uint32_t index_a, uint32_t index_b, float epsilon)
+  {
+    // Only the components that would be written to the destination are compared (see write_vertex).
+    if (!near(read_position(source, source_format, index_a), read_position(source, source_format, index_b), epsilon))
     {
-      deallocate(to_mesh.index_buffer);
-      deallocate(to_mesh.vertex_buffer);
+      return false;
     }
 
-    return counts;
+    if (destination_format.has_normal && source_format.has_normal && !near(read_normal(source, source_format, index_a), read_normal(source, source_format, index_b)))
+    {
+      return false;
+    }
+
+    // The colors are compared component by component since near compares vec4s as homogeneous coordinates.
+    if (destination_format.has_color && source_format.has_color)
+    {
+      auto color_a = read_color(source, source_format, index_a);
+      auto color_b = read_color(source, source_format, index_b);
+      for (auto component = 0; component < 4; component++)
+      {
+        if (!near(color_a[component], color_b[component]))
+        {
+          return false;
+        }
+      }
+    }
+
+    if (destination_format.has_texture_coordinate && source_format.has_texture_coordinate && !near(read_texture_coordinate(source, source_format, index_a), read_texture_coordinate(source, source_format, index_b)))
+    {
+      return false;
+    }
+
+    return true;
   }
 }
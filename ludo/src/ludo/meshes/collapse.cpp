@@ -2,295 +2,482 @@
  * This file is part of ludo. See the LICENSE file for the full license governing this code.
  */
 
-#include <limits>
-#include <map>
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
 
 #include "collapse.h"
+#include "packing.h"
+#include "util.h"
 
 namespace ludo
 {
+  struct collapse_quadric
+  {
+    std::array<double, 10> coefficients = {}; // The upper triangle of a symmetric 4x4 matrix, row by row.
+    double weight = 0.0;
+  };
+
   struct collapsable_vertex
   {
-    std::vector<uint32_t> mesh_vertex_indices;
+    uint32_t first_mesh_vertex_index = 0;
+    vec3 position;
+    vec3 normal;
+    vec4 color;
 
-    std::vector<uint32_t> face_indices;
-    std::vector<uint32_t> adjacent_vertex_indices;
+    std::vector<uint32_t> face_indices; // May contain faces that have since become degenerate.
+    collapse_quadric quadric;
 
-    bool collapsed = false;
-    float collapse_cost = 0.0f;
-    uint32_t collapse_to_vertex_index = 0;
+    uint32_t collapse_to_index = std::numeric_limits<uint32_t>::max();
+    uint32_t version = 0;
   };
 
-  struct face
+  struct collapsable_face
   {
-    vec3 normal;
+    std::array<uint32_t, 3> vertex_indices;
+    bool degenerate = false;
   };
 
-  void update_collapse_cost(const mesh& mesh, const vertex_format& format, const std::vector<face>& faces, std::vector<collapsable_vertex>& vertices, collapsable_vertex& vertex);
-  float edge_collapse_cost(const mesh& mesh, const vertex_format& format, const std::vector<face>& faces, const collapsable_vertex& collapse_vertex, const collapsable_vertex& collapse_to_vertex);
-  void collapse(mesh& mesh, const vertex_format& format, std::vector<face>& faces, std::vector<collapsable_vertex>& vertices, uint32_t collapse_index, uint32_t collapse_to_index);
-  std::function<bool(const collapsable_vertex& vertex)> contains_mesh_vertex(uint32_t mesh_vertex);
+  struct collapse_candidate
+  {
+    float cost = 0.0f;
+    uint32_t vertex_index = 0;
+    uint32_t collapse_to_index = 0;
+    uint32_t version = 0;
+  };
 
-  // Based on http://pomax.nihongoresources.com/downloads/PolygonReduction.pdf
-  void collapse(mesh& mesh, const vertex_format& format, uint32_t iterations)
+  auto compare_collapse_candidates = [](const collapse_candidate& a, const collapse_candidate& b)
   {
+    return a.cost > b.cost;
+  };
+
+  using collapse_queue = std::priority_queue<collapse_candidate, std::vector<collapse_candidate>, decltype(compare_collapse_candidates)>;
+
+  collapse_quadric plane_quadric(const vec3& normal, const vec3& point, double weight);
+  void accumulate(collapse_quadric& quadric, const collapse_quadric& other);
+  double quadric_error(const collapse_quadric& quadric, const vec3& position);
+  void push_collapse_candidate(collapse_queue& queue, std::vector<collapsable_vertex>& vertices, const std::vector<collapsable_face>& faces, uint32_t vertex_index, float attribute_weight, bool check_flips);
+  float edge_collapse_cost(const std::vector<collapsable_vertex>& vertices, uint32_t vertex_index, uint32_t collapse_to_index, float attribute_weight);
+  bool collapse_flips_faces(const std::vector<collapsable_vertex>& vertices, const std::vector<collapsable_face>& faces, uint32_t vertex_index, uint32_t collapse_to_index);
+  uint32_t collapse(std::vector<collapsable_vertex>& vertices, std::vector<collapsable_face>& faces, uint32_t vertex_index, uint32_t collapse_to_index);
+  uint32_t collapsed_vertex_index(std::vector<collapsable_vertex>& vertices, uint32_t vertex_index);
+
+  // Based on "Surface Simplification Using Quadric Error Metrics" (Garland & Heckbert), restricted to collapsing onto one of the vertices of an edge so that the vertices don't need to be re-written.
+  uint32_t collapse(mesh& mesh, const vertex_format& format, const collapse_options& options)
+  {
+    auto mesh_vertex_count = static_cast<uint32_t>(mesh.vertex_buffer.size / format.size);
+    auto face_count = index_count(mesh) / 3;
+
+    // Mesh vertices sharing a position (e.g. those with different normals) are collapsed together. Each is linked to the next sharing its position.
     auto vertices = std::vector<collapsable_vertex>();
-    vertices.reserve(mesh.vertex_buffer.size / format.size);
+    auto mesh_vertex_vertex_indices = std::vector<uint32_t>(mesh_vertex_count);
+    auto next_mesh_vertex_indices = std::vector<uint32_t>(mesh_vertex_count, std::numeric_limits<uint32_t>::max());
 
-    for (auto vertex_index = uint32_t(0); vertex_index < vertices.capacity(); vertex_index++)
+    auto welder = vertex_welder();
+    for (auto mesh_vertex_index = uint32_t(0); mesh_vertex_index < mesh_vertex_count; mesh_vertex_index++)
     {
-      auto& position = cast<vec3>(mesh.vertex_buffer, vertex_index * format.size + format.position_offset);
-      auto vertex_iter = std::find_if(vertices.begin(), vertices.end(), [&](const collapsable_vertex& vertex)
+      auto position = read_position(mesh, format, mesh_vertex_index);
+
+      auto vertex_index = find(welder, position, [&](uint32_t vertex_index)
       {
-        return cast<vec3>(mesh.vertex_buffer, vertex.mesh_vertex_indices[0] * format.size + format.position_offset) == position;
+        return vertices[vertex_index].position == position;
       });
 
-      if (vertex_iter != vertices.end())
+      if (vertex_index != std::numeric_limits<uint32_t>::max())
       {
-        vertex_iter->mesh_vertex_indices.push_back(vertex_index);
+        auto& vertex = vertices[vertex_index];
+        next_mesh_vertex_indices[mesh_vertex_index] = next_mesh_vertex_indices[vertex.first_mesh_vertex_index];
+        next_mesh_vertex_indices[vertex.first_mesh_vertex_index] = mesh_vertex_index;
+        mesh_vertex_vertex_indices[mesh_vertex_index] = vertex_index;
         continue;
       }
 
-      vertices.emplace_back(collapsable_vertex { .mesh_vertex_indices = {vertex_index } });
+      vertex_index = static_cast<uint32_t>(vertices.size());
+      add(welder, position, vertex_index);
+      mesh_vertex_vertex_indices[mesh_vertex_index] = vertex_index;
+
+      vertices.emplace_back(collapsable_vertex
+      {
+        .first_mesh_vertex_index = mesh_vertex_index,
+        .position = position,
+        .normal = format.has_normal ? read_normal(mesh, format, mesh_vertex_index) : vec3(),
+        .color = format.has_color ? read_color(mesh, format, mesh_vertex_index) : vec4()
+      });
     }
 
-    auto faces = std::vector<face>();
-    faces.reserve(mesh.index_buffer.size / (3 * sizeof(uint32_t)));
+    // Each edge is counted by the faces it borders, so that the edges with only one face (i.e. on a boundary) can be found.
+    auto faces = std::vector<collapsable_face>();
+    faces.reserve(face_count);
+    auto edge_face_indices = std::unordered_map<uint64_t, uint32_t>();
+    auto active_face_count = uint32_t(0);
 
-    auto index_stream = stream(mesh.index_buffer);
-    for (auto face_index = uint32_t(0); !ended(index_stream); face_index++)
+    for (auto face_index = uint32_t(0); face_index < face_count; face_index++)
     {
-      auto indices = std::array<uint32_t, 3>
+      auto& face = faces.emplace_back(collapsable_face
       {
-        read<uint32_t>(index_stream),
-        read<uint32_t>(index_stream),
-        read<uint32_t>(index_stream)
-      };
+        .vertex_indices =
+        {
+          mesh_vertex_vertex_indices[read_index(mesh, face_index * 3)],
+          mesh_vertex_vertex_indices[read_index(mesh, face_index * 3 + 1)],
+          mesh_vertex_vertex_indices[read_index(mesh, face_index * 3 + 2)]
+        }
+      });
 
-      auto positions = std::array<vec3, 3>
+      auto& indices = face.vertex_indices;
+      if (indices[0] == indices[1] || indices[1] == indices[2] || indices[2] == indices[0])
       {
-        cast<vec3>(mesh.vertex_buffer, indices[0] * format.size + format.position_offset),
-        cast<vec3>(mesh.vertex_buffer, indices[1] * format.size + format.position_offset),
-        cast<vec3>(mesh.vertex_buffer, indices[2] * format.size + format.position_offset)
-      };
+        face.degenerate = true;
+        continue;
+      }
 
-      auto vertex_indices = std::array<uint32_t, 3>
+      auto& position_0 = vertices[indices[0]].position;
+      auto normal = cross(vertices[indices[1]].position - position_0, vertices[indices[2]].position - position_0);
+      auto area = length(normal) / 2.0f;
+      if (area > 0.0f)
       {
-        uint32_t(std::find_if(vertices.begin(), vertices.end(), contains_mesh_vertex(indices[0])) - vertices.begin()),
-        uint32_t(std::find_if(vertices.begin(), vertices.end(), contains_mesh_vertex(indices[1])) - vertices.begin()),
-        uint32_t(std::find_if(vertices.begin(), vertices.end(), contains_mesh_vertex(indices[2])) - vertices.begin())
-      };
+        normalize(normal);
+      }
 
-      vertices[vertex_indices[0]].face_indices.push_back(face_index);
-      vertices[vertex_indices[1]].face_indices.push_back(face_index);
-      vertices[vertex_indices[2]].face_indices.push_back(face_index);
+      auto quadric = plane_quadric(normal, position_0, area);
+      for (auto corner = 0; corner < 3; corner++)
+      {
+        auto& vertex = vertices[indices[corner]];
+        vertex.face_indices.push_back(face_index);
+        accumulate(vertex.quadric, quadric);
+
+        auto next_index = indices[(corner + 1) % 3];
+        auto edge_key = uint64_t(std::min(indices[corner], next_index)) << 32 | std::max(indices[corner], next_index);
+        auto [ edge_iter, inserted ] = edge_face_indices.try_emplace(edge_key, face_index);
+        if (!inserted)
+        {
+          edge_iter->second = std::numeric_limits<uint32_t>::max();
+        }
+      }
 
-      for (auto vertex_index_0 = uint32_t(0); vertex_index_0 < 2; vertex_index_0++)
+      active_face_count++;
+    }
+
+    // Constrain the boundary edges with planes perpendicular to their faces, so that collapses along a boundary are preferred to those that would pull it inwards.
+    for (auto [ edge_key, face_index ] : edge_face_indices)
+    {
+      if (face_index == std::numeric_limits<uint32_t>::max())
       {
-        auto& adjacent_vertex_indices_0 = vertices[vertex_indices[vertex_index_0]].adjacent_vertex_indices;
+        continue;
+      }
 
-        for (auto vertex_index_1 = vertex_index_0 + 1; vertex_index_1 < 3; vertex_index_1++)
-        {
-          auto& adjacent_vertex_indices_1 = vertices[vertex_indices[vertex_index_1]].adjacent_vertex_indices;
+      auto& indices = faces[face_index].vertex_indices;
+      auto& position_0 = vertices[indices[0]].position;
+      auto face_normal = cross(vertices[indices[1]].position - position_0, vertices[indices[2]].position - position_0);
 
-          if (std::find(adjacent_vertex_indices_0.begin(), adjacent_vertex_indices_0.end(), vertex_indices[vertex_index_1]) == adjacent_vertex_indices_0.end())
-          {
-            adjacent_vertex_indices_0.push_back(vertex_indices[vertex_index_1]);
-            adjacent_vertex_indices_1.push_back(vertex_indices[vertex_index_0]);
-          }
-        }
+      auto& vertex_0 = vertices[edge_key >> 32];
+      auto& vertex_1 = vertices[edge_key & 0xFFFFFFFF];
+      auto edge = vertex_1.position - vertex_0.position;
+      auto normal = cross(edge, face_normal);
+      if (length2(normal) == 0.0f)
+      {
+        continue;
       }
 
-      auto normal = cross(positions[1] - positions[0], positions[2] - positions[0]);
       normalize(normal);
 
-      faces.emplace_back(face { .normal = normal });
+      auto quadric = plane_quadric(normal, vertex_0.position, length2(edge));
+      quadric.weight = 0.0; // Only the faces contribute to the weight, the mean distance is from the faces' planes.
+      accumulate(vertex_0.quadric, quadric);
+      accumulate(vertex_1.quadric, quadric);
     }
 
+    auto queue = collapse_queue(compare_collapse_candidates);
     for (auto vertex_index = uint32_t(0); vertex_index < vertices.size(); vertex_index++)
     {
-      update_collapse_cost(mesh, format, faces, vertices, vertices[vertex_index]);
+      push_collapse_candidate(queue, vertices, faces, vertex_index, options.attribute_weight, false);
     }
 
-    for (auto iteration = uint32_t(0); iteration < iterations; iteration++)
+    auto iteration = uint32_t(0);
+    auto neighbour_indices = std::vector<uint32_t>();
+    while (!queue.empty() && iteration < options.iterations && active_face_count > options.target_face_count)
     {
-      auto collapse_cost = std::numeric_limits<float>::max();
-      auto collapse_vertex_index = uint32_t(0);
-      for (auto vertex_index = uint32_t(0); vertex_index < vertices.size(); vertex_index++)
+      auto candidate = queue.top();
+      queue.pop();
+
+      // Candidates are superseded (rather than updated in place) when their vertex or its neighbourhood changes.
+      auto& vertex = vertices[candidate.vertex_index];
+      if (vertex.collapse_to_index != std::numeric_limits<uint32_t>::max() || candidate.version != vertex.version)
       {
-        auto& vertex = vertices[vertex_index];
-        if (!vertex.collapsed && vertex.collapse_cost < collapse_cost)
-        {
-          auto minimum_adjacent_not_met = false;
-          for (auto adjacent_vertex_index : vertex.adjacent_vertex_indices)
-          {
-            if (adjacent_vertex_index != vertex.collapse_to_vertex_index && vertices[adjacent_vertex_index].adjacent_vertex_indices.size() <= 3)
-            {
-              minimum_adjacent_not_met = true;
-            }
-          }
-
-          if (minimum_adjacent_not_met)
-          {
-            continue;
-          }
-
-          collapse_cost = vertex.collapse_cost;
-          collapse_vertex_index = vertex_index;
-        }
+        continue;
       }
 
-      if (collapse_cost < std::numeric_limits<float>::max())
+      if (candidate.cost > options.max_error)
       {
-        collapse(mesh, format, faces, vertices, collapse_vertex_index, vertices[collapse_vertex_index].collapse_to_vertex_index);
+        break;
       }
-    }
-  }
 
-  void update_collapse_cost(const mesh& mesh, const vertex_format& format, const std::vector<face>& faces, std::vector<collapsable_vertex>& vertices, collapsable_vertex& vertex)
-  {
-    vertex.collapse_cost = std::numeric_limits<float>::max();
-    for (auto adjacent_vertex_index : vertex.adjacent_vertex_indices)
-    {
-      auto collapse_cost = edge_collapse_cost(mesh, format, faces, vertex, vertices[adjacent_vertex_index]);
-      if (collapse_cost < vertex.collapse_cost)
+      // Checking for flipped faces is relatively expensive, so it is only done for the candidates that reach the top of the queue.
+      // If the cheapest collapse of the vertex would flip faces, it is replaced by the cheapest that wouldn't.
+      if (collapse_flips_faces(vertices, faces, candidate.vertex_index, candidate.collapse_to_index))
       {
-        vertex.collapse_cost = collapse_cost;
-        vertex.collapse_to_vertex_index = adjacent_vertex_index;
+        push_collapse_candidate(queue, vertices, faces, candidate.vertex_index, options.attribute_weight, true);
+        continue;
       }
-    }
-  }
 
-  float edge_collapse_cost(const mesh& mesh, const vertex_format& format, const std::vector<face>& faces, const collapsable_vertex& collapse_vertex, const collapsable_vertex& collapse_to_vertex)
-  {
-    std::vector<uint32_t> shared_face_indices;
-    std::vector<uint32_t> collapse_only_face_indices;
-    for (auto collapse_face_index : collapse_vertex.face_indices)
-    {
-      auto shared = false;
-      for (auto collapse_to_face_index : collapse_to_vertex.face_indices)
+      // The cost of collapsing the surviving vertex and the neighbours of either vertex has changed.
+      // The neighbours of the collapsed vertex include those only sharing a face that becomes degenerate, whose candidates would otherwise still collapse onto it.
+      neighbour_indices.clear();
+      for (auto face_index : vertex.face_indices)
       {
-        if (collapse_to_face_index == collapse_face_index)
-        {
-          shared_face_indices.push_back(collapse_face_index);
-          shared = true;
-          break;
-        }
+        neighbour_indices.insert(neighbour_indices.end(), faces[face_index].vertex_indices.begin(), faces[face_index].vertex_indices.end());
       }
 
-      if (!shared)
+      active_face_count -= collapse(vertices, faces, candidate.vertex_index, candidate.collapse_to_index);
+      iteration++;
+
+      for (auto face_index : vertices[candidate.collapse_to_index].face_indices)
       {
-        collapse_only_face_indices.push_back(collapse_face_index);
+        neighbour_indices.insert(neighbour_indices.end(), faces[face_index].vertex_indices.begin(), faces[face_index].vertex_indices.end());
+      }
+
+      std::sort(neighbour_indices.begin(), neighbour_indices.end());
+      neighbour_indices.erase(std::unique(neighbour_indices.begin(), neighbour_indices.end()), neighbour_indices.end());
+      for (auto neighbour_index : neighbour_indices)
+      {
+        push_collapse_candidate(queue, vertices, faces, neighbour_index, options.attribute_weight, false);
       }
     }
 
-    // Use the collapse-adjacent face facing most away from the shared-adjacent faces to determine our curvature term
-    auto curvature = 0.0f;
-    for (auto collapse_only_face_index : collapse_only_face_indices)
+    for (auto vertex_index = uint32_t(0); vertex_index < vertices.size(); vertex_index++)
     {
-      for (auto shared_face_index : shared_face_indices)
+      auto collapse_to_index = collapsed_vertex_index(vertices, vertex_index);
+      if (collapse_to_index == vertex_index)
+      {
+        continue;
+      }
+
+      auto collapse_to_mesh_vertex_index = vertices[collapse_to_index].first_mesh_vertex_index;
+      auto collapse_to_color = format.has_color ? read_color(mesh, format, collapse_to_mesh_vertex_index) : vec4();
+      auto collapse_to_texture_coordinate = format.has_texture_coordinate ? read_texture_coordinate(mesh, format, collapse_to_mesh_vertex_index) : vec2();
+
+      for (auto mesh_vertex_index = vertices[vertex_index].first_mesh_vertex_index; mesh_vertex_index != std::numeric_limits<uint32_t>::max(); mesh_vertex_index = next_mesh_vertex_indices[mesh_vertex_index])
       {
-        auto dot = ludo::dot(faces[collapse_only_face_index].normal, faces[shared_face_index].normal) * -1.0f;
-        curvature = std::max(curvature, dot * 0.5f + 0.5f);
+        write_position(mesh, format, mesh_vertex_index, vertices[collapse_to_index].position);
+        // We're not updating normals at the moment, any attempt I made just looked worse...
+        if (format.has_color)
+        {
+          write_color(mesh, format, mesh_vertex_index, collapse_to_color);
+        }
+        if (format.has_texture_coordinate)
+        {
+          write_texture_coordinate(mesh, format, mesh_vertex_index, collapse_to_texture_coordinate);
+        }
       }
     }
 
-    auto collapse_position = cast<vec3>(mesh.vertex_buffer, collapse_vertex.mesh_vertex_indices[0] * format.size + format.position_offset);
-    auto collapse_to_position = cast<vec3>(mesh.vertex_buffer, collapse_to_vertex.mesh_vertex_indices[0] * format.size + format.position_offset);
-
-    return length2(collapse_to_position - collapse_position) * curvature;
+    return active_face_count;
   }
 
-  void collapse(mesh& mesh, const vertex_format& format, std::vector<face>& faces, std::vector<collapsable_vertex>& vertices, uint32_t collapse_index, uint32_t collapse_to_index)
+  void collapse(mesh& mesh, const vertex_format& format, uint32_t iterations)
   {
-    auto& collapse_vertex = vertices[collapse_index];
-    auto& collapse_to_vertex = vertices[collapse_to_index];
+    collapse(mesh, format, { .iterations = iterations });
+  }
 
-    collapse_to_vertex.mesh_vertex_indices.insert(collapse_to_vertex.mesh_vertex_indices.end(), collapse_vertex.mesh_vertex_indices.begin(), collapse_vertex.mesh_vertex_indices.end());
+  collapse_quadric plane_quadric(const vec3& normal, const vec3& point, double weight)
+  {
+    auto a = static_cast<double>(normal[0]);
+    auto b = static_cast<double>(normal[1]);
+    auto c = static_cast<double>(normal[2]);
+    auto d = -static_cast<double>(dot(normal, point));
 
-    for (auto collapse_face_index : collapse_vertex.face_indices)
+    return
     {
-      auto collapse_face_iter = std::find(collapse_to_vertex.face_indices.begin(), collapse_to_vertex.face_indices.end(), collapse_face_index);
-      if (collapse_face_iter == collapse_to_vertex.face_indices.end())
+      .coefficients =
       {
-        collapse_to_vertex.face_indices.push_back(collapse_face_index);
+        weight * a * a, weight * a * b, weight * a * c, weight * a * d,
+        weight * b * b, weight * b * c, weight * b * d,
+        weight * c * c, weight * c * d,
+        weight * d * d
+      },
+      .weight = weight
+    };
+  }
 
-        auto index_stream = stream(mesh.index_buffer, collapse_face_index * (3 * sizeof(uint32_t)));
-        auto indices = std::array<uint32_t, 3>
-        {
-          read<uint32_t>(index_stream),
-          read<uint32_t>(index_stream),
-          read<uint32_t>(index_stream)
-        };
+  void accumulate(collapse_quadric& quadric, const collapse_quadric& other)
+  {
+    for (auto index = 0; index < 10; index++)
+    {
+      quadric.coefficients[index] += other.coefficients[index];
+    }
 
-        auto positions = std::array<vec3, 3>
-        {
-          cast<vec3>(mesh.vertex_buffer, indices[0] * format.size + format.position_offset),
-          cast<vec3>(mesh.vertex_buffer, indices[1] * format.size + format.position_offset),
-          cast<vec3>(mesh.vertex_buffer, indices[2] * format.size + format.position_offset),
-        };
+    quadric.weight += other.weight;
+  }
 
-        auto normal = cross(positions[1] - positions[0], positions[2] - positions[0]);
-        normalize(normal);
+  double quadric_error(const collapse_quadric& quadric, const vec3& position)
+  {
+    auto& q = quadric.coefficients;
+    auto x = static_cast<double>(position[0]);
+    auto y = static_cast<double>(position[1]);
+    auto z = static_cast<double>(position[2]);
+
+    auto error =
+      q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x +
+      q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y +
+      q[7] * z * z + 2.0 * q[8] * z +
+      q[9];
+
+    // Rounding can make the error of a position on every plane slightly negative.
+    return std::max(error, 0.0);
+  }
 
-        faces[collapse_face_index].normal = normal;
+  void push_collapse_candidate(collapse_queue& queue, std::vector<collapsable_vertex>& vertices, const std::vector<collapsable_face>& faces, uint32_t vertex_index, float attribute_weight, bool check_flips)
+  {
+    auto& vertex = vertices[vertex_index];
+    vertex.version++;
+
+    auto candidate = collapse_candidate { .cost = std::numeric_limits<float>::max(), .vertex_index = vertex_index, .version = vertex.version };
+    for (auto face_index : vertex.face_indices)
+    {
+      auto& face = faces[face_index];
+      if (face.degenerate)
+      {
+        continue;
       }
-      else
+
+      for (auto neighbour_index : face.vertex_indices)
       {
-        collapse_to_vertex.face_indices.erase(collapse_face_iter);
+        if (neighbour_index == vertex_index)
+        {
+          continue;
+        }
+
+        auto cost = edge_collapse_cost(vertices, vertex_index, neighbour_index, attribute_weight);
+        if (cost < candidate.cost && (!check_flips || !collapse_flips_faces(vertices, faces, vertex_index, neighbour_index)))
+        {
+          candidate.cost = cost;
+          candidate.collapse_to_index = neighbour_index;
+        }
       }
     }
 
-    for (auto collapse_adjacent_vertex_index : collapse_vertex.adjacent_vertex_indices)
+    if (candidate.cost < std::numeric_limits<float>::max())
+    {
+      queue.push(candidate);
+    }
+  }
+
+  float edge_collapse_cost(const std::vector<collapsable_vertex>& vertices, uint32_t vertex_index, uint32_t collapse_to_index, float attribute_weight)
+  {
+    auto& vertex = vertices[vertex_index];
+    auto& collapse_to_vertex = vertices[collapse_to_index];
+
+    auto quadric = vertex.quadric;
+    accumulate(quadric, collapse_to_vertex.quadric);
+
+    auto error = quadric_error(quadric, collapse_to_vertex.position);
+    if (quadric.weight > 0.0)
+    {
+      error /= quadric.weight;
+    }
+
+    // The length of a vec4 is that of a homogeneous coordinate (scaled by w), so the colors are compared component by component.
+    auto attribute_error = length2(collapse_to_vertex.normal - vertex.normal);
+    auto color_difference = collapse_to_vertex.color - vertex.color;
+    for (auto component = 0; component < 4; component++)
     {
-      auto& collapse_adjacent_vertex = vertices[collapse_adjacent_vertex_index];
+      attribute_error += color_difference[component] * color_difference[component];
+    }
+
+    return static_cast<float>(error) + attribute_weight * attribute_error * length2(collapse_to_vertex.position - vertex.position);
+  }
 
-      auto collapse_vertex_iter = std::find(collapse_adjacent_vertex.adjacent_vertex_indices.begin(), collapse_adjacent_vertex.adjacent_vertex_indices.end(), collapse_index);
-      collapse_adjacent_vertex.adjacent_vertex_indices.erase(collapse_vertex_iter);
+  bool collapse_flips_faces(const std::vector<collapsable_vertex>& vertices, const std::vector<collapsable_face>& faces, uint32_t vertex_index, uint32_t collapse_to_index)
+  {
+    auto& vertex = vertices[vertex_index];
+    auto& collapse_to_vertex = vertices[collapse_to_index];
 
-      if (collapse_adjacent_vertex_index != collapse_to_index)
+    for (auto face_index : vertex.face_indices)
+    {
+      auto& face = faces[face_index];
+      if (face.degenerate || std::find(face.vertex_indices.begin(), face.vertex_indices.end(), collapse_to_index) != face.vertex_indices.end())
       {
-        auto collapse_adjacent_vertex_iter = std::find(collapse_to_vertex.adjacent_vertex_indices.begin(), collapse_to_vertex.adjacent_vertex_indices.end(), collapse_adjacent_vertex_index);
-        if (collapse_adjacent_vertex_iter == collapse_to_vertex.adjacent_vertex_indices.end())
+        continue;
+      }
+
+      auto positions = std::array<vec3, 3>
+      {
+        vertices[face.vertex_indices[0]].position,
+        vertices[face.vertex_indices[1]].position,
+        vertices[face.vertex_indices[2]].position
+      };
+      auto normal = cross(positions[1] - positions[0], positions[2] - positions[0]);
+
+      for (auto corner = 0; corner < 3; corner++)
+      {
+        if (face.vertex_indices[corner] == vertex_index)
         {
-          collapse_to_vertex.adjacent_vertex_indices.push_back(collapse_adjacent_vertex_index);
-          collapse_adjacent_vertex.adjacent_vertex_indices.push_back(collapse_to_index);
+          positions[corner] = collapse_to_vertex.position;
         }
       }
+      auto collapsed_normal = cross(positions[1] - positions[0], positions[2] - positions[0]);
 
-      update_collapse_cost(mesh, format, faces, vertices, collapse_adjacent_vertex);
+      if (dot(normal, collapsed_normal) < 0.0f)
+      {
+        return true;
+      }
     }
 
-    auto& collapse_to_position = cast<vec3>(mesh.vertex_buffer, collapse_to_vertex.mesh_vertex_indices[0] * format.size + format.position_offset);
-    auto collapse_to_color = format.has_color ? cast<vec4>(mesh.vertex_buffer, collapse_to_vertex.mesh_vertex_indices[0] * format.size + format.color_offset) : vec4();
-    auto collapse_to_texture_coordinate = format.has_texture_coordinate ? cast<vec2>(mesh.vertex_buffer, collapse_to_vertex.mesh_vertex_indices[0] * format.size + format.texture_coordinate_offset): vec2();
-    for (auto mesh_vertex_index : collapse_vertex.mesh_vertex_indices)
+    return false;
+  }
+
+  uint32_t collapse(std::vector<collapsable_vertex>& vertices, std::vector<collapsable_face>& faces, uint32_t vertex_index, uint32_t collapse_to_index)
+  {
+    auto& vertex = vertices[vertex_index];
+    auto& collapse_to_vertex = vertices[collapse_to_index];
+
+    auto degenerate_face_count = uint32_t(0);
+    for (auto face_index : vertex.face_indices)
     {
-      cast<vec3>(mesh.vertex_buffer, mesh_vertex_index * format.size + format.position_offset) = collapse_to_position;
-      // We're not updating normals at the moment, any attempt I made just looked worse...
-      if (format.has_color)
+      auto& face = faces[face_index];
+      if (face.degenerate)
       {
-        cast<vec4>(mesh.vertex_buffer, mesh_vertex_index * format.size + format.color_offset) = collapse_to_color;
+        continue;
       }
-      if (format.has_texture_coordinate)
+
+      if (std::find(face.vertex_indices.begin(), face.vertex_indices.end(), collapse_to_index) != face.vertex_indices.end())
       {
-        cast<vec2>(mesh.vertex_buffer, mesh_vertex_index * format.size + format.texture_coordinate_offset) = collapse_to_texture_coordinate;
+        face.degenerate = true;
+        degenerate_face_count++;
+        continue;
       }
+
+      std::replace(face.vertex_indices.begin(), face.vertex_indices.end(), vertex_index, collapse_to_index);
+      collapse_to_vertex.face_indices.push_back(face_index);
     }
 
-    collapse_vertex.collapsed = true;
-  }
+    // Drop the faces that are now degenerate so that the face lists don't keep growing as vertices are collapsed onto each other.
+    std::erase_if(collapse_to_vertex.face_indices, [&](uint32_t face_index)
+    {
+      return faces[face_index].degenerate;
+    });
 
-  const vec3& position(const mesh& mesh, const vertex_format& format, const collapsable_vertex& vertex)
-  {
-    return cast<vec3>(mesh.vertex_buffer, vertex.mesh_vertex_indices[0] * format.size + format.position_offset);
+    accumulate(collapse_to_vertex.quadric, vertex.quadric);
+
+    vertex.collapse_to_index = collapse_to_index;
+    vertex.face_indices.clear();
+
+    return degenerate_face_count;
   }
 
-  std::function<bool(const collapsable_vertex& vertex)> contains_mesh_vertex(uint32_t mesh_vertex)
+  uint32_t collapsed_vertex_index(std::vector<collapsable_vertex>& vertices, uint32_t vertex_index)
   {
-    return [=] (const collapsable_vertex& vertex)
+    auto collapse_to_index = vertex_index;
+    while (vertices[collapse_to_index].collapse_to_index != std::numeric_limits<uint32_t>::max())
     {
-      return std::find(vertex.mesh_vertex_indices.begin(), vertex.mesh_vertex_indices.end(), mesh_vertex) != vertex.mesh_vertex_indices.end();
-    };
+      collapse_to_index = vertices[collapse_to_index].collapse_to_index;
+    }
+
+    // Shorten the chain for the vertices collapsed onto this one.
+    if (collapse_to_index != vertex_index)
+    {
+      vertices[vertex_index].collapse_to_index = collapse_to_index;
+    }
+
+    return collapse_to_index;
   }
 }
@@ -4,9 +4,37 @@
 
 #pragma once
 
+#include <limits>
+
 #include "../meshes.h"
 
 namespace ludo
 {
+  ///
+  /// Options for simplifying a mesh by collapsing its edges.
+  /// Collapsing stops as soon as any of the limits is reached.
+  struct collapse_options
+  {
+    uint32_t iterations = std::numeric_limits<uint32_t>::max(); ///< The maximum number of edges to collapse.
+    uint32_t target_face_count = 0; ///< The number of (non-degenerate) faces at which to stop collapsing.
+    float max_error = std::numeric_limits<float>::max(); ///< The error at which to stop collapsing. The error of a collapse is the mean squared distance of the resulting vertex from the planes of the faces it replaces, plus the attribute error.
+    float attribute_weight = 1.0f; ///< The weight of the difference in normals and colors between the vertices of an edge, relative to the squared length of the edge, in the attribute error.
+  };
+
+  ///
+  /// Simplifies a mesh by collapsing its edges, cheapest first according to their quadric error (see collapse_options).
+  /// Each edge is collapsed by moving one of its vertices (and any other vertices sharing its position) onto the other, so the indices are unchanged and
+  /// the faces that were collapsed become degenerate (these can be removed with clean). Normals are left as they are.
+  /// \param mesh The mesh to simplify.
+  /// \param format The vertex format of the mesh.
+  /// \param options The options used to simplify the mesh.
+  /// \return The number of (non-degenerate) faces remaining.
+  uint32_t collapse(mesh& mesh, const vertex_format& format, const collapse_options& options);
+
+  ///
+  /// Simplifies a mesh by collapsing a number of its edges (see collapse(mesh&, const vertex_format&, const collapse_options&)).
+  /// \param mesh The mesh to simplify.
+  /// \param format The vertex format of the mesh.
+  /// \param iterations The maximum number of edges to collapse.
   void collapse(mesh& mesh, const vertex_format& format, uint32_t iterations);
 }
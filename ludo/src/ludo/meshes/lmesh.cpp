@@ -0,0 +1,362 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <fstream>
+#include <iterator>
+
+#include "../files.h"
+#include "lmesh.h"
+#include "packing.h"
+
+namespace ludo
+{
+  // A ludo mesh file (version 2) consists of a header, followed by an entry for each mesh, followed by the index and vertex data of each mesh.
+  // Values are stored in the byte order of the machine that saved the file (little-endian on all supported platforms).
+  // The data of each mesh starts on a 16 byte boundary so that it can be copied (or read) straight out of the mapped file.
+  // Version 1 files (which predate the header) contain the index buffer size, the indices, the vertex size, the vertex buffer size and the vertices of a single mesh.
+
+  const auto lmesh_magic = std::array<char, 4> { 'L', 'M', 'S', 'H' };
+  const auto lmesh_version = uint32_t(2);
+  const auto lmesh_alignment = uint64_t(16);
+  const auto lmesh_max_components = uint32_t(8);
+
+  struct lmesh_header
+  {
+    std::array<char, 4> magic = lmesh_magic;
+    uint32_t version = lmesh_version;
+    uint32_t mesh_count = 0;
+    uint32_t key = 0; // User-defined e.g. a hash of the source of the meshes.
+    uint64_t checksum = 0; // Hash of everything following the header.
+  };
+
+  struct lmesh_entry
+  {
+    uint64_t index_offset = 0; // From the start of the file.
+    uint64_t vertex_offset = 0; // From the start of the file.
+    uint32_t index_count = 0;
+    uint32_t index_size = 0; // 2 or 4 bytes.
+    uint32_t vertex_count = 0;
+    uint32_t vertex_size = 0;
+    aabb3 bounds;
+    uint32_t component_count = 0;
+    uint32_t reserved = 0;
+    std::array<char, lmesh_max_components> component_types = {};
+    std::array<uint8_t, lmesh_max_components> component_counts = {};
+  };
+
+  static_assert(sizeof(lmesh_header) == 24 && "lmesh_header must not contain padding");
+  static_assert(sizeof(lmesh_entry) == 80 && "lmesh_entry must not contain padding");
+
+  std::vector<lmesh_entry> read_lmesh_entries(const buffer& data);
+  mesh read_lmesh_mesh(const buffer& data, const lmesh_entry& entry, heap& indices, heap& vertices);
+  buffer read_lmesh_stream(std::istream& stream);
+
+  mesh load(const std::string& file_name, heap& indices, heap& vertices, uint32_t mesh_index)
+  {
+    auto data = map_file(file_name);
+    assert(data.data && "failed to map file");
+
+    auto entries = read_lmesh_entries(data);
+    assert(mesh_index < entries.size() && "mesh index out of range");
+
+    auto mesh = read_lmesh_mesh(data, entries[mesh_index], indices, vertices);
+
+    unmap_file(data);
+
+    return mesh;
+  }
+
+  mesh load(std::istream& stream, heap& indices, heap& vertices, uint32_t mesh_index)
+  {
+    auto data = read_lmesh_stream(stream);
+
+    auto entries = read_lmesh_entries(data);
+    assert(mesh_index < entries.size() && "mesh index out of range");
+
+    auto mesh = read_lmesh_mesh(data, entries[mesh_index], indices, vertices);
+
+    deallocate(data);
+
+    return mesh;
+  }
+
+  std::vector<mesh> load_all(const std::string& file_name, heap& indices, heap& vertices)
+  {
+    auto data = map_file(file_name);
+    assert(data.data && "failed to map file");
+
+    auto meshes = std::vector<mesh>();
+    for (auto& entry : read_lmesh_entries(data))
+    {
+      meshes.emplace_back(read_lmesh_mesh(data, entry, indices, vertices));
+    }
+
+    unmap_file(data);
+
+    return meshes;
+  }
+
+  std::vector<mesh> load_all(std::istream& stream, heap& indices, heap& vertices)
+  {
+    auto data = read_lmesh_stream(stream);
+
+    auto meshes = std::vector<mesh>();
+    for (auto& entry : read_lmesh_entries(data))
+    {
+      meshes.emplace_back(read_lmesh_mesh(data, entry, indices, vertices));
+    }
+
+    deallocate(data);
+
+    return meshes;
+  }
+
+  void save(const mesh& mesh, const vertex_format& format, const std::string& file_name, bool compact_indices, uint32_t key)
+  {
+    save(std::vector<ludo::mesh> { mesh }, format, file_name, compact_indices, key);
+  }
+
+  void save(const mesh& mesh, const vertex_format& format, std::ostream& stream, bool compact_indices, uint32_t key)
+  {
+    save(std::vector<ludo::mesh> { mesh }, format, stream, compact_indices, key);
+  }
+
+  void save(const std::vector<mesh>& meshes, const vertex_format& format, const std::string& file_name, bool compact_indices, uint32_t key)
+  {
+    auto stream = std::ofstream(file_name, std::ios::binary);
+
+    save(meshes, format, stream, compact_indices, key);
+  }
+
+  void save(const std::vector<mesh>& meshes, const vertex_format& format, std::ostream& stream, bool compact_indices, uint32_t key)
+  {
+    assert(format.components.size() <= lmesh_max_components && "too many vertex format components");
+
+    auto header = lmesh_header { .mesh_count = static_cast<uint32_t>(meshes.size()), .key = key };
+
+    // Lay out the data of each mesh after the header and entries.
+    auto entries = std::vector<lmesh_entry>(meshes.size());
+    auto size = sizeof(lmesh_header) + entries.size() * sizeof(lmesh_entry);
+    for (auto mesh_index = uint32_t(0); mesh_index < meshes.size(); mesh_index++)
+    {
+      auto& mesh = meshes[mesh_index];
+      auto& entry = entries[mesh_index];
+
+      assert(mesh.vertex_size == format.size && "mesh does not match vertex format");
+
+      entry.index_count = index_count(mesh);
+      entry.vertex_count = static_cast<uint32_t>(mesh.vertex_buffer.size / format.size);
+      entry.index_size = compact_indices ? compact_index_size(entry.vertex_count) : sizeof(uint32_t);
+      entry.vertex_size = format.size;
+      entry.bounds = bounds(mesh, format);
+
+      entry.component_count = static_cast<uint32_t>(format.components.size());
+      for (auto component_index = uint32_t(0); component_index < entry.component_count; component_index++)
+      {
+        entry.component_types[component_index] = format.components[component_index].first;
+        entry.component_counts[component_index] = static_cast<uint8_t>(format.components[component_index].second);
+      }
+
+      entry.index_offset = (size + lmesh_alignment - 1) / lmesh_alignment * lmesh_alignment;
+      entry.vertex_offset = (entry.index_offset + entry.index_count * entry.index_size + lmesh_alignment - 1) / lmesh_alignment * lmesh_alignment;
+      size = entry.vertex_offset + entry.vertex_count * entry.vertex_size;
+    }
+
+    auto data = allocate(size);
+    std::memset(data.data, 0, data.size);
+
+    std::memcpy(data.data + sizeof(lmesh_header), entries.data(), entries.size() * sizeof(lmesh_entry));
+    for (auto mesh_index = uint32_t(0); mesh_index < meshes.size(); mesh_index++)
+    {
+      auto& mesh = meshes[mesh_index];
+      auto& entry = entries[mesh_index];
+
+      if (entry.index_size == mesh.index_size)
+      {
+        std::memcpy(data.data + entry.index_offset, mesh.index_buffer.data, mesh.index_buffer.size);
+      }
+      else if (entry.index_size == sizeof(uint16_t))
+      {
+        auto destination_indices = reinterpret_cast<uint16_t*>(data.data + entry.index_offset);
+        for (auto index_index = uint32_t(0); index_index < entry.index_count; index_index++)
+        {
+          destination_indices[index_index] = static_cast<uint16_t>(read_index(mesh, index_index));
+        }
+      }
+      else
+      {
+        auto destination_indices = reinterpret_cast<uint32_t*>(data.data + entry.index_offset);
+        for (auto index_index = uint32_t(0); index_index < entry.index_count; index_index++)
+        {
+          destination_indices[index_index] = read_index(mesh, index_index);
+        }
+      }
+
+      std::memcpy(data.data + entry.vertex_offset, mesh.vertex_buffer.data, mesh.vertex_buffer.size);
+    }
+
+    header.checksum = hash(data.data + sizeof(lmesh_header), data.size - sizeof(lmesh_header));
+    std::memcpy(data.data, &header, sizeof(lmesh_header));
+
+    stream.write(reinterpret_cast<const char*>(data.data), static_cast<int64_t>(data.size));
+
+    deallocate(data);
+  }
+
+  std::pair<uint32_t, uint32_t> mesh_counts(const std::string& file_name)
+  {
+    auto data = map_file(file_name);
+    assert(data.data && "failed to map file");
+
+    auto counts = std::pair<uint32_t, uint32_t>();
+    for (auto& entry : read_lmesh_entries(data))
+    {
+      counts.first += entry.index_count;
+      counts.second += entry.vertex_count;
+    }
+
+    unmap_file(data);
+
+    return counts;
+  }
+
+  std::pair<uint32_t, uint32_t> mesh_counts(std::istream& stream)
+  {
+    auto data = read_lmesh_stream(stream);
+
+    auto counts = std::pair<uint32_t, uint32_t>();
+    for (auto& entry : read_lmesh_entries(data))
+    {
+      counts.first += entry.index_count;
+      counts.second += entry.vertex_count;
+    }
+
+    deallocate(data);
+
+    return counts;
+  }
+
+  vertex_format mesh_format(const std::string& file_name, uint32_t mesh_index)
+  {
+    auto data = map_file(file_name);
+    assert(data.data && "failed to map file");
+
+    auto entries = read_lmesh_entries(data);
+    assert(mesh_index < entries.size() && "mesh index out of range");
+    auto& entry = entries[mesh_index];
+
+    unmap_file(data);
+
+    if (!entry.component_count)
+    {
+      return vertex_format { .size = entry.vertex_size };
+    }
+
+    auto components = std::vector<std::pair<char, uint32_t>>();
+    for (auto component_index = uint32_t(0); component_index < entry.component_count; component_index++)
+    {
+      components.emplace_back(entry.component_types[component_index], entry.component_counts[component_index]);
+    }
+
+    return format(components);
+  }
+
+  aabb3 mesh_bounds(const std::string& file_name, uint32_t mesh_index)
+  {
+    auto data = map_file(file_name);
+    assert(data.data && "failed to map file");
+
+    auto entries = read_lmesh_entries(data);
+    assert(mesh_index < entries.size() && "mesh index out of range");
+    assert(entries[mesh_index].component_count && "bounds not recorded (version 1 file)");
+
+    unmap_file(data);
+
+    return entries[mesh_index].bounds;
+  }
+
+  uint32_t mesh_key(const std::string& file_name)
+  {
+    auto data = map_file(file_name);
+    if (!data.data)
+    {
+      return 0;
+    }
+
+    if (data.size < sizeof(lmesh_header))
+    {
+      unmap_file(data);
+      return 0;
+    }
+
+    auto header = lmesh_header();
+    std::memcpy(&header, data.data, sizeof(lmesh_header));
+    unmap_file(data);
+
+    return header.magic == lmesh_magic ? header.key : 0;
+  }
+
+  std::vector<lmesh_entry> read_lmesh_entries(const buffer& data)
+  {
+    auto stream = ludo::stream(data);
+
+    if (data.size < sizeof(lmesh_header) || read<std::array<char, 4>>(stream) != lmesh_magic)
+    {
+      // Version 1
+      // The sizes aren't aligned within the file (they follow the indices), so they are copied out rather than read in place.
+      assert(data.size >= sizeof(uint64_t) && "truncated mesh data");
+
+      auto entry = lmesh_entry { .index_offset = sizeof(uint64_t), .index_size = sizeof(uint32_t) };
+      auto index_buffer_size = uint64_t(0);
+      std::memcpy(&index_buffer_size, data.data, sizeof(uint64_t));
+      entry.index_count = static_cast<uint32_t>(index_buffer_size / sizeof(uint32_t));
+
+      auto vertex_header_offset = entry.index_offset + index_buffer_size;
+      assert(vertex_header_offset + sizeof(uint32_t) + sizeof(uint64_t) <= data.size && "truncated mesh data");
+
+      auto vertex_buffer_size = uint64_t(0);
+      std::memcpy(&entry.vertex_size, data.data + vertex_header_offset, sizeof(uint32_t));
+      std::memcpy(&vertex_buffer_size, data.data + vertex_header_offset + sizeof(uint32_t), sizeof(uint64_t));
+      entry.vertex_offset = vertex_header_offset + sizeof(uint32_t) + sizeof(uint64_t);
+      entry.vertex_count = static_cast<uint32_t>(vertex_buffer_size / entry.vertex_size);
+      assert(entry.vertex_offset + vertex_buffer_size <= data.size && "truncated mesh data");
+
+      return { entry };
+    }
+
+    stream.position = 0;
+    auto header = read<lmesh_header>(stream);
+    assert(header.version == lmesh_version && "unsupported mesh file version");
+    assert(sizeof(lmesh_header) + header.mesh_count * sizeof(lmesh_entry) <= data.size && "truncated mesh data");
+    assert(hash(data.data + sizeof(lmesh_header), data.size - sizeof(lmesh_header)) == header.checksum && "corrupt mesh data");
+
+    auto entries = std::vector<lmesh_entry>(header.mesh_count);
+    std::memcpy(entries.data(), data.data + sizeof(lmesh_header), entries.size() * sizeof(lmesh_entry));
+
+    return entries;
+  }
+
+  mesh read_lmesh_mesh(const buffer& data, const lmesh_entry& entry, heap& indices, heap& vertices)
+  {
+    assert(entry.vertex_offset + entry.vertex_count * entry.vertex_size <= data.size && "truncated mesh data");
+
+    auto mesh = ludo::mesh();
+    init(mesh, indices, vertices, entry.index_count, entry.vertex_count, entry.vertex_size, entry.index_size);
+
+    std::memcpy(mesh.index_buffer.data, data.data + entry.index_offset, mesh.index_buffer.size);
+    std::memcpy(mesh.vertex_buffer.data, data.data + entry.vertex_offset, mesh.vertex_buffer.size);
+
+    return mesh;
+  }
+
+  buffer read_lmesh_stream(std::istream& stream)
+  {
+    auto contents = std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+
+    auto data = allocate(contents.size());
+    std::memcpy(data.data, contents.data(), contents.size());
+
+    return data;
+  }
+}
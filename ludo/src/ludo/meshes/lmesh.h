@@ -0,0 +1,119 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#pragma once
+
+#include <istream>
+#include <ostream>
+
+#include "../meshes.h"
+#include "../spatial/bounds.h"
+
+namespace ludo
+{
+  ///
+  /// Loads a mesh from a ludo mesh file.
+  /// The file is mapped into memory and its indices and vertices are copied straight into the heaps. The indices keep the size they were saved with.
+  /// \param file_name The name of the file containing the mesh data.
+  /// \param indices The indices to allocate from.
+  /// \param vertices The vertices to allocate from.
+  /// \param mesh_index The index of the mesh within the file.
+  /// \return The mesh.
+  mesh load(const std::string& file_name, heap& indices, heap& vertices, uint32_t mesh_index = 0);
+
+  ///
+  /// Loads a mesh from a stream.
+  /// \param stream The mesh data.
+  /// \param indices The indices to allocate from.
+  /// \param vertices The vertices to allocate from.
+  /// \param mesh_index The index of the mesh within the data.
+  /// \return The mesh.
+  mesh load(std::istream& stream, heap& indices, heap& vertices, uint32_t mesh_index = 0);
+
+  ///
+  /// Loads all of the meshes from a ludo mesh file.
+  /// The file is mapped into memory and its indices and vertices are copied straight into the heaps. The indices keep the size they were saved with.
+  /// \param file_name The name of the file containing the mesh data.
+  /// \param indices The indices to allocate from.
+  /// \param vertices The vertices to allocate from.
+  /// \return The meshes.
+  std::vector<mesh> load_all(const std::string& file_name, heap& indices, heap& vertices);
+
+  ///
+  /// Loads all of the meshes from a stream.
+  /// \param stream The mesh data.
+  /// \param indices The indices to allocate from.
+  /// \param vertices The vertices to allocate from.
+  /// \return The meshes.
+  std::vector<mesh> load_all(std::istream& stream, heap& indices, heap& vertices);
+
+  ///
+  /// Saves a mesh to a ludo mesh file.
+  /// \param mesh The mesh.
+  /// \param format The vertex format of the mesh.
+  /// \param file_name The name of the file to save to.
+  /// \param compact_indices Determines if the indices should be stored as uint16_t where there are few enough vertices (see compact_index_size), otherwise as uint32_t.
+  /// \param key A user-defined value to store with the meshes e.g. a hash of their source, used to detect when they need to be rebuilt (see mesh_key).
+  void save(const mesh& mesh, const vertex_format& format, const std::string& file_name, bool compact_indices = true, uint32_t key = 0);
+
+  ///
+  /// Saves a mesh to a stream.
+  /// \param mesh The mesh.
+  /// \param format The vertex format of the mesh.
+  /// \param stream The mesh data.
+  /// \param compact_indices Determines if the indices should be stored as uint16_t where there are few enough vertices (see compact_index_size), otherwise as uint32_t.
+  /// \param key A user-defined value to store with the meshes e.g. a hash of their source, used to detect when they need to be rebuilt (see mesh_key).
+  void save(const mesh& mesh, const vertex_format& format, std::ostream& stream, bool compact_indices = true, uint32_t key = 0);
+
+  ///
+  /// Saves meshes (e.g. the LODs of a mesh) to a single ludo mesh file.
+  /// \param meshes The meshes.
+  /// \param format The vertex format of the meshes.
+  /// \param file_name The name of the file to save to.
+  /// \param compact_indices Determines if the indices should be stored as uint16_t where there are few enough vertices (see compact_index_size), otherwise as uint32_t.
+  /// \param key A user-defined value to store with the meshes e.g. a hash of their source, used to detect when they need to be rebuilt (see mesh_key).
+  void save(const std::vector<mesh>& meshes, const vertex_format& format, const std::string& file_name, bool compact_indices = true, uint32_t key = 0);
+
+  ///
+  /// Saves meshes (e.g. the LODs of a mesh) to a stream.
+  /// \param meshes The meshes.
+  /// \param format The vertex format of the meshes.
+  /// \param stream The mesh data.
+  /// \param compact_indices Determines if the indices should be stored as uint16_t where there are few enough vertices (see compact_index_size), otherwise as uint32_t.
+  /// \param key A user-defined value to store with the meshes e.g. a hash of their source, used to detect when they need to be rebuilt (see mesh_key).
+  void save(const std::vector<mesh>& meshes, const vertex_format& format, std::ostream& stream, bool compact_indices = true, uint32_t key = 0);
+
+  ///
+  /// Reads the total counts of the meshes in a ludo mesh file.
+  /// \param file_name The name of the file containing the mesh data.
+  /// \return The index (first) and vertex (second) counts.
+  std::pair<uint32_t, uint32_t> mesh_counts(const std::string& file_name);
+
+  ///
+  /// Reads the total counts of the meshes in a stream.
+  /// \param stream The mesh data.
+  /// \return The index (first) and vertex (second) counts.
+  std::pair<uint32_t, uint32_t> mesh_counts(std::istream& stream);
+
+  ///
+  /// Reads the vertex format of a mesh in a ludo mesh file.
+  /// Files saved before the vertex format was recorded only provide its size.
+  /// \param file_name The name of the file containing the mesh data.
+  /// \param mesh_index The index of the mesh within the file.
+  /// \return The vertex format.
+  vertex_format mesh_format(const std::string& file_name, uint32_t mesh_index = 0);
+
+  ///
+  /// Reads the bounds of a mesh in a ludo mesh file without loading its vertices.
+  /// \param file_name The name of the file containing the mesh data.
+  /// \param mesh_index The index of the mesh within the file.
+  /// \return The bounds.
+  aabb3 mesh_bounds(const std::string& file_name, uint32_t mesh_index = 0);
+
+  ///
+  /// Reads the key a ludo mesh file was saved with (see save).
+  /// \param file_name The name of the file containing the mesh data.
+  /// \return The key, or 0 if the file doesn't exist or wasn't saved with a key.
+  uint32_t mesh_key(const std::string& file_name);
+}
@@ -0,0 +1,223 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+#include <limits>
+
+#include "../spatial/frustum.h"
+#include "meshlets.h"
+#include "packing.h"
+
+namespace ludo
+{
+  void compute_meshlet_bounds(meshlet& meshlet, const mesh& mesh, const vertex_format& format);
+  void add_meshlet_render_command(render_program& render_program, const render_mesh& render_mesh, const range& indices);
+
+  std::vector<meshlet> build_meshlets(const mesh& mesh, const vertex_format& format, uint32_t max_vertices, uint32_t max_triangles)
+  {
+    assert(max_vertices >= 3 && "meshlets must be able to hold a triangle");
+    assert(max_triangles >= 1 && "meshlets must be able to hold a triangle");
+
+    auto meshlets = std::vector<meshlet>();
+    auto current = meshlet();
+
+    // The meshlet each vertex was last added to, so that the unique vertices of a meshlet can be counted without searching.
+    auto vertex_meshlet_indices = std::vector<uint32_t>(mesh.vertex_buffer.size / format.size, std::numeric_limits<uint32_t>::max());
+
+    auto index_count = ludo::index_count(mesh);
+    for (auto index_index = uint32_t(0); index_index + 2 < index_count; index_index += 3)
+    {
+      auto triangle = std::array<uint32_t, 3> { read_index(mesh, index_index), read_index(mesh, index_index + 1), read_index(mesh, index_index + 2) };
+
+      auto new_vertex_count = uint32_t(0);
+      for (auto corner = uint32_t(0); corner < 3; corner++)
+      {
+        // Triangles may reference the same vertex more than once (when degenerate).
+        auto repeated = (corner > 0 && triangle[corner] == triangle[0]) || (corner > 1 && triangle[corner] == triangle[1]);
+        if (!repeated && vertex_meshlet_indices[triangle[corner]] != meshlets.size())
+        {
+          new_vertex_count++;
+        }
+      }
+
+      if (current.indices.count && (current.indices.count / 3 + 1 > max_triangles || current.vertex_count + new_vertex_count > max_vertices))
+      {
+        compute_meshlet_bounds(current, mesh, format);
+        meshlets.push_back(current);
+        current = meshlet { .indices = { .start = index_index } };
+
+        // Every vertex of the triangle is new to the next meshlet.
+        new_vertex_count = 1 + (triangle[1] != triangle[0]) + (triangle[2] != triangle[0] && triangle[2] != triangle[1]);
+      }
+
+      for (auto index : triangle)
+      {
+        vertex_meshlet_indices[index] = static_cast<uint32_t>(meshlets.size());
+      }
+
+      current.indices.count += 3;
+      current.vertex_count += new_vertex_count;
+    }
+
+    if (current.indices.count)
+    {
+      compute_meshlet_bounds(current, mesh, format);
+      meshlets.push_back(current);
+    }
+
+    return meshlets;
+  }
+
+  meshlet_culling_stats add_render_commands(render_program& render_program, const render_mesh& render_mesh, const std::vector<meshlet>& meshlets, const mat4& transform, const camera& camera)
+  {
+    auto stats = meshlet_culling_stats { .meshlet_count = static_cast<uint32_t>(meshlets.size()) };
+
+    auto planes = frustum_planes(camera);
+    auto camera_position = position(camera.view);
+    auto rotation = mat3(transform);
+    auto translation = position(transform);
+    auto scale = std::max(length(right(transform)), std::max(length(up(transform)), length(out(transform))));
+
+    // The indices of consecutive visible meshlets, which are drawn by a single render command.
+    auto visible_indices = range();
+
+    for (auto& meshlet : meshlets)
+    {
+      auto triangle_count = meshlet.indices.count / 3;
+      stats.triangle_count += triangle_count;
+
+      auto center = rotation * meshlet.center + translation;
+      auto radius = meshlet.radius * scale;
+
+      auto culled = false;
+      if (frustum_test(planes, center, radius) < 0)
+      {
+        stats.frustum_culled_count++;
+        culled = true;
+      }
+      else if (meshlet.cone_cutoff < 1.0f)
+      {
+        auto cone_axis = rotation * meshlet.cone_axis;
+        normalize(cone_axis);
+
+        // Every triangle faces away from every point of the bounding sphere when the direction to it lies within the (inverted) normal cone.
+        auto direction = center - camera_position;
+        if (dot(direction, cone_axis) >= meshlet.cone_cutoff * length(direction) + radius)
+        {
+          stats.cone_culled_count++;
+          culled = true;
+        }
+      }
+
+      if (culled)
+      {
+        stats.culled_triangle_count += triangle_count;
+        continue;
+      }
+
+      if (visible_indices.count && visible_indices.start + visible_indices.count == meshlet.indices.start)
+      {
+        visible_indices.count += meshlet.indices.count;
+        continue;
+      }
+
+      if (visible_indices.count)
+      {
+        add_meshlet_render_command(render_program, render_mesh, visible_indices);
+        stats.command_count++;
+      }
+
+      visible_indices = meshlet.indices;
+    }
+
+    if (visible_indices.count)
+    {
+      add_meshlet_render_command(render_program, render_mesh, visible_indices);
+      stats.command_count++;
+    }
+
+    return stats;
+  }
+
+  void compute_meshlet_bounds(meshlet& meshlet, const mesh& mesh, const vertex_format& format)
+  {
+    auto min = vec3 { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    auto max = vec3 { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    auto normal_sum = vec3_zero;
+
+    auto normals = std::vector<vec3>();
+    normals.reserve(meshlet.indices.count / 3);
+
+    for (auto index_index = meshlet.indices.start; index_index < meshlet.indices.start + meshlet.indices.count; index_index += 3)
+    {
+      auto positions = std::array<vec3, 3>
+      {
+        read_position(mesh, format, read_index(mesh, index_index)),
+        read_position(mesh, format, read_index(mesh, index_index + 1)),
+        read_position(mesh, format, read_index(mesh, index_index + 2))
+      };
+
+      for (auto& position : positions)
+      {
+        min = vec3 { std::min(min[0], position[0]), std::min(min[1], position[1]), std::min(min[2], position[2]) };
+        max = vec3 { std::max(max[0], position[0]), std::max(max[1], position[1]), std::max(max[2], position[2]) };
+      }
+
+      // Degenerate triangles are never drawn, so they don't widen the cone.
+      auto normal = cross(positions[1] - positions[0], positions[2] - positions[0]);
+      if (length2(normal) > 0.0f)
+      {
+        normalize(normal);
+        normals.push_back(normal);
+        normal_sum += normal;
+      }
+    }
+
+    meshlet.center = (min + max) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (auto index_index = meshlet.indices.start; index_index < meshlet.indices.start + meshlet.indices.count; index_index++)
+    {
+      meshlet.radius = std::max(meshlet.radius, length(read_position(mesh, format, read_index(mesh, index_index)) - meshlet.center));
+    }
+
+    meshlet.cone_axis = vec3_zero;
+    meshlet.cone_cutoff = 1.0f;
+    if (normals.empty() || length2(normal_sum) == 0.0f)
+    {
+      return;
+    }
+
+    meshlet.cone_axis = normal_sum;
+    normalize(meshlet.cone_axis);
+
+    auto min_dot = 1.0f;
+    for (auto& normal : normals)
+    {
+      min_dot = std::min(min_dot, dot(normal, meshlet.cone_axis));
+    }
+
+    // When the normals diverge by (close to) 90 degrees or more, some triangle always faces the camera.
+    if (min_dot <= 0.1f)
+    {
+      return;
+    }
+
+    meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+  }
+
+  void add_meshlet_render_command(render_program& render_program, const render_mesh& render_mesh, const range& indices)
+  {
+    auto position = (render_program.active_commands.start + render_program.active_commands.count++) * sizeof(render_command);
+    assert(position + sizeof(render_command) <= render_program.command_buffer.size && "command buffer full");
+
+    cast<render_command>(render_program.command_buffer, position) =
+      {
+        .index_count = indices.count,
+        .instance_count = render_mesh.instances.count,
+        .index_start = render_mesh.indices.start + indices.start,
+        .vertex_start = render_mesh.vertices.start,
+        .instance_start = render_mesh.instances.start
+      };
+  }
+}
@@ -0,0 +1,59 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#pragma once
+
+#include "../meshes.h"
+#include "../rendering.h"
+
+namespace ludo
+{
+  ///
+  /// A cluster of neighbouring triangles within a mesh, with bounds that allow it to be culled independently of the rest of the mesh.
+  struct meshlet
+  {
+    range indices; ///< The indices of the triangles (relative to the start of the mesh's indices).
+    uint32_t vertex_count = 0; ///< The number of unique vertices referenced by the triangles.
+
+    vec3 center = vec3_zero; ///< The center of the bounding sphere.
+    float radius = 0.0f; ///< The radius of the bounding sphere.
+
+    vec3 cone_axis = vec3_zero; ///< The average direction of the normals of the triangles.
+    float cone_cutoff = 1.0f; ///< The sine of the largest angle between the normals of the triangles and the cone axis. 1 if the normals are too divergent for the cluster to ever face away from the camera.
+  };
+
+  ///
+  /// Statistics of culling the meshlets of a render mesh.
+  struct meshlet_culling_stats
+  {
+    uint32_t meshlet_count = 0; ///< The number of meshlets tested.
+    uint32_t frustum_culled_count = 0; ///< The number of meshlets outside the view frustum.
+    uint32_t cone_culled_count = 0; ///< The number of (remaining) meshlets facing away from the camera.
+    uint32_t triangle_count = 0; ///< The number of triangles tested.
+    uint32_t culled_triangle_count = 0; ///< The number of triangles in culled meshlets.
+    uint32_t command_count = 0; ///< The number of render commands added.
+  };
+
+  ///
+  /// Splits the triangles of a mesh into meshlets. The triangles are not reordered, so each meshlet is a contiguous range of the mesh's indices.
+  /// Consecutive triangles are added to a meshlet until either limit would be exceeded, so this should follow optimize_vertex_cache (which places neighbouring triangles together).
+  /// \param mesh The mesh (assumes the primitive is a triangle list).
+  /// \param format The vertex format of the mesh.
+  /// \param max_vertices The maximum number of unique vertices referenced by a meshlet.
+  /// \param max_triangles The maximum number of triangles in a meshlet.
+  /// \return The meshlets.
+  std::vector<meshlet> build_meshlets(const mesh& mesh, const vertex_format& format, uint32_t max_vertices = 64, uint32_t max_triangles = 124);
+
+  ///
+  /// Culls the meshlets of a render mesh against the view frustum and by their normal cones, and adds a render command for each visible range of meshlets.
+  /// Visible meshlets that are adjacent in the mesh's indices are drawn by a single render command.
+  /// Assumes front faces are wound counter-clockwise and that back faces are culled by the render program.
+  /// \param render_program The render program to add the render commands to.
+  /// \param render_mesh The render mesh the meshlets were built from.
+  /// \param meshlets The meshlets (see build_meshlets).
+  /// \param transform The transform of the render mesh's instances. The same commands draw every instance, so culling is only valid when every instance shares this transform. Assumed to be free of non-uniform scaling.
+  /// \param camera The camera to cull against.
+  /// \return The culling statistics.
+  meshlet_culling_stats add_render_commands(render_program& render_program, const render_mesh& render_mesh, const std::vector<meshlet>& meshlets, const mat4& transform, const camera& camera);
+}
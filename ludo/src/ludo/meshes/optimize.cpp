@@ -0,0 +1,398 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "optimize.h"
+#include "packing.h"
+
+namespace ludo
+{
+  float vertex_cache_score(int32_t cache_position, uint32_t remaining_triangle_count, uint32_t cache_size);
+  bool degenerate_triangle(const std::array<uint32_t, 3>& triangle);
+  std::vector<std::array<uint32_t, 3>> read_triangles(const mesh& mesh);
+  void write_triangle(mesh& mesh, uint32_t& index_index, const std::array<uint32_t, 3>& triangle);
+
+  vertex_cache_statistics analyze_vertex_cache(const mesh& mesh, const vertex_format& format, uint32_t cache_size)
+  {
+    assert(cache_size > 0 && "cache size must be greater than 0");
+
+    auto index_count = ludo::index_count(mesh);
+    auto vertex_count = static_cast<uint32_t>(mesh.vertex_buffer.size / format.size);
+    if (index_count == 0)
+    {
+      return {};
+    }
+
+    // A vertex is in the cache if it was added within the last cache_size misses.
+    auto vertex_miss_times = std::vector<uint32_t>(vertex_count, std::numeric_limits<uint32_t>::max());
+    auto miss_count = uint32_t(0);
+    auto referenced_vertex_count = uint32_t(0);
+    for (auto index_index = uint32_t(0); index_index < index_count; index_index++)
+    {
+      auto& miss_time = vertex_miss_times[read_index(mesh, index_index)];
+      if (miss_time == std::numeric_limits<uint32_t>::max())
+      {
+        referenced_vertex_count++;
+      }
+      else if (miss_count - miss_time < cache_size)
+      {
+        continue;
+      }
+
+      miss_time = miss_count++;
+    }
+
+    return
+    {
+      .acmr = static_cast<float>(miss_count) / static_cast<float>(index_count / 3),
+      .atvr = static_cast<float>(miss_count) / static_cast<float>(referenced_vertex_count)
+    };
+  }
+
+  void optimize_vertex_cache(mesh& mesh, const vertex_format& format, uint32_t cache_size)
+  {
+    assert(cache_size > 3 && "cache size must be greater than 3");
+
+    auto triangle_count = index_count(mesh) / 3;
+    auto vertex_count = static_cast<uint32_t>(mesh.vertex_buffer.size / format.size);
+
+    auto triangles = read_triangles(mesh);
+
+    // The remaining triangles of each vertex are stored contiguously, the triangles are removed by swapping them with the last remaining.
+    auto remaining_triangle_counts = std::vector<uint32_t>(vertex_count);
+    for (auto& triangle : triangles)
+    {
+      if (!degenerate_triangle(triangle))
+      {
+        remaining_triangle_counts[triangle[0]]++;
+        remaining_triangle_counts[triangle[1]]++;
+        remaining_triangle_counts[triangle[2]]++;
+      }
+    }
+
+    auto vertex_triangle_offsets = std::vector<uint32_t>(vertex_count + 1);
+    std::partial_sum(remaining_triangle_counts.begin(), remaining_triangle_counts.end(), vertex_triangle_offsets.begin() + 1);
+
+    auto vertex_triangles = std::vector<uint32_t>(vertex_triangle_offsets[vertex_count]);
+    auto valid_triangle_count = uint32_t(0);
+    {
+      auto vertex_triangle_ends = vertex_triangle_offsets;
+      for (auto triangle_index = uint32_t(0); triangle_index < triangle_count; triangle_index++)
+      {
+        auto& triangle = triangles[triangle_index];
+        if (!degenerate_triangle(triangle))
+        {
+          vertex_triangles[vertex_triangle_ends[triangle[0]]++] = triangle_index;
+          vertex_triangles[vertex_triangle_ends[triangle[1]]++] = triangle_index;
+          vertex_triangles[vertex_triangle_ends[triangle[2]]++] = triangle_index;
+          valid_triangle_count++;
+        }
+      }
+    }
+
+    auto cache_positions = std::vector<int32_t>(vertex_count, -1);
+    auto vertex_scores = std::vector<float>(vertex_count);
+    for (auto vertex_index = uint32_t(0); vertex_index < vertex_count; vertex_index++)
+    {
+      vertex_scores[vertex_index] = vertex_cache_score(-1, remaining_triangle_counts[vertex_index], cache_size);
+    }
+
+    // Degenerate triangles are added at the end.
+    auto triangles_added = std::vector<bool>(triangle_count);
+    for (auto triangle_index = uint32_t(0); triangle_index < triangle_count; triangle_index++)
+    {
+      triangles_added[triangle_index] = degenerate_triangle(triangles[triangle_index]);
+    }
+
+    // The cache has room for a triangle's vertices beyond its size, the vertices pushed past its size are evicted after each triangle.
+    auto cache = std::vector<uint32_t>();
+    auto next_cache = std::vector<uint32_t>();
+    cache.reserve(cache_size + 3);
+    next_cache.reserve(cache_size + 3);
+
+    auto ordered_triangle_indices = std::vector<uint32_t>();
+    ordered_triangle_indices.reserve(triangle_count);
+
+    auto best_triangle_index = std::numeric_limits<uint32_t>::max();
+    auto next_unadded_triangle_index = uint32_t(0);
+    while (ordered_triangle_indices.size() < valid_triangle_count)
+    {
+      // When none of the triangles of the cached vertices remain, continue from the next triangle in the original order.
+      if (best_triangle_index == std::numeric_limits<uint32_t>::max())
+      {
+        while (triangles_added[next_unadded_triangle_index])
+        {
+          next_unadded_triangle_index++;
+        }
+
+        best_triangle_index = next_unadded_triangle_index;
+      }
+
+      auto& best_triangle = triangles[best_triangle_index];
+      triangles_added[best_triangle_index] = true;
+      ordered_triangle_indices.push_back(best_triangle_index);
+
+      for (auto vertex_index : best_triangle)
+      {
+        auto begin = vertex_triangles.begin() + vertex_triangle_offsets[vertex_index];
+        auto end = begin + remaining_triangle_counts[vertex_index];
+        std::iter_swap(std::find(begin, end, best_triangle_index), end - 1);
+        remaining_triangle_counts[vertex_index]--;
+      }
+
+      next_cache.assign(best_triangle.begin(), best_triangle.end());
+      for (auto vertex_index : cache)
+      {
+        if (std::find(best_triangle.begin(), best_triangle.end(), vertex_index) == best_triangle.end())
+        {
+          next_cache.push_back(vertex_index);
+        }
+      }
+
+      for (auto cache_index = uint32_t(0); cache_index < next_cache.size(); cache_index++)
+      {
+        auto vertex_index = next_cache[cache_index];
+        cache_positions[vertex_index] = cache_index < cache_size ? static_cast<int32_t>(cache_index) : -1;
+        vertex_scores[vertex_index] = vertex_cache_score(cache_positions[vertex_index], remaining_triangle_counts[vertex_index], cache_size);
+      }
+
+      // Only the triangles of the vertices whose scores changed need to be re-scored, and the best of the next triangles is among them.
+      auto best_triangle_score = 0.0f;
+      best_triangle_index = std::numeric_limits<uint32_t>::max();
+      for (auto vertex_index : next_cache)
+      {
+        auto begin = vertex_triangles.begin() + vertex_triangle_offsets[vertex_index];
+        auto end = begin + remaining_triangle_counts[vertex_index];
+        for (auto triangle_iter = begin; triangle_iter != end; triangle_iter++)
+        {
+          auto& triangle = triangles[*triangle_iter];
+          auto score = vertex_scores[triangle[0]] + vertex_scores[triangle[1]] + vertex_scores[triangle[2]];
+          if (score > best_triangle_score)
+          {
+            best_triangle_score = score;
+            best_triangle_index = *triangle_iter;
+          }
+        }
+      }
+
+      next_cache.resize(std::min(static_cast<uint32_t>(next_cache.size()), cache_size));
+      std::swap(cache, next_cache);
+    }
+
+    auto index_index = uint32_t(0);
+    for (auto triangle_index : ordered_triangle_indices)
+    {
+      write_triangle(mesh, index_index, triangles[triangle_index]);
+    }
+
+    for (auto& triangle : triangles)
+    {
+      if (degenerate_triangle(triangle))
+      {
+        write_triangle(mesh, index_index, triangle);
+      }
+    }
+  }
+
+  void optimize_overdraw(mesh& mesh, const vertex_format& format, uint32_t cache_size)
+  {
+    assert(cache_size > 0 && "cache size must be greater than 0");
+
+    struct cluster
+    {
+      uint32_t start = 0;
+      uint32_t count = 0;
+      float sort_key = 0.0f;
+    };
+
+    auto triangle_count = index_count(mesh) / 3;
+    auto vertex_count = static_cast<uint32_t>(mesh.vertex_buffer.size / format.size);
+
+    auto triangles = read_triangles(mesh);
+
+    // A new cluster is started by each triangle that shares no vertices with the (FIFO) cache, so reordering the clusters costs very few additional cache misses.
+    auto clusters = std::vector<cluster>();
+    auto vertex_miss_times = std::vector<uint32_t>(vertex_count, std::numeric_limits<uint32_t>::max());
+    auto miss_count = uint32_t(0);
+    for (auto triangle_index = uint32_t(0); triangle_index < triangle_count; triangle_index++)
+    {
+      auto triangle_miss_count = 0;
+      for (auto vertex_index : triangles[triangle_index])
+      {
+        auto& miss_time = vertex_miss_times[vertex_index];
+        if (miss_time == std::numeric_limits<uint32_t>::max() || miss_count - miss_time >= cache_size)
+        {
+          miss_time = miss_count++;
+          triangle_miss_count++;
+        }
+      }
+
+      if (clusters.empty() || triangle_miss_count == 3)
+      {
+        clusters.push_back({ .start = triangle_index });
+      }
+
+      clusters.back().count++;
+    }
+
+    // Clusters facing away from the center of the mesh are the most likely to occlude the others (and the least likely to be occluded themselves).
+    auto mesh_centroid = vec3_zero;
+    auto mesh_area = 0.0f;
+    auto cluster_centroids = std::vector<vec3>(clusters.size(), vec3_zero);
+    auto cluster_normals = std::vector<vec3>(clusters.size(), vec3_zero);
+    for (auto cluster_index = uint32_t(0); cluster_index < clusters.size(); cluster_index++)
+    {
+      auto& cluster = clusters[cluster_index];
+      auto cluster_area = 0.0f;
+      for (auto triangle_index = cluster.start; triangle_index < cluster.start + cluster.count; triangle_index++)
+      {
+        auto& triangle = triangles[triangle_index];
+        auto position_0 = read_position(mesh, format, triangle[0]);
+        auto position_1 = read_position(mesh, format, triangle[1]);
+        auto position_2 = read_position(mesh, format, triangle[2]);
+
+        auto normal = cross(position_1 - position_0, position_2 - position_0);
+        auto area = length(normal); // Twice the area, but only the relative areas matter.
+        auto centroid = (position_0 + position_1 + position_2) / 3.0f;
+
+        cluster_centroids[cluster_index] += centroid * area;
+        cluster_normals[cluster_index] += normal;
+        cluster_area += area;
+      }
+
+      mesh_centroid += cluster_centroids[cluster_index];
+      mesh_area += cluster_area;
+
+      if (cluster_area > 0.0f)
+      {
+        cluster_centroids[cluster_index] /= cluster_area;
+      }
+    }
+
+    if (mesh_area > 0.0f)
+    {
+      mesh_centroid /= mesh_area;
+    }
+
+    for (auto cluster_index = uint32_t(0); cluster_index < clusters.size(); cluster_index++)
+    {
+      auto& normal = cluster_normals[cluster_index];
+      if (length2(normal) > 0.0f)
+      {
+        normalize(normal);
+      }
+
+      clusters[cluster_index].sort_key = dot(cluster_centroids[cluster_index] - mesh_centroid, normal);
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const cluster& a, const cluster& b)
+    {
+      return a.sort_key > b.sort_key;
+    });
+
+    auto index_index = uint32_t(0);
+    for (auto& cluster : clusters)
+    {
+      for (auto triangle_index = cluster.start; triangle_index < cluster.start + cluster.count; triangle_index++)
+      {
+        write_triangle(mesh, index_index, triangles[triangle_index]);
+      }
+    }
+  }
+
+  void optimize_vertex_fetch(mesh& mesh, const vertex_format& format)
+  {
+    auto index_count = ludo::index_count(mesh);
+    auto vertex_count = static_cast<uint32_t>(mesh.vertex_buffer.size / format.size);
+
+    auto vertex_remap = std::vector<uint32_t>(vertex_count, std::numeric_limits<uint32_t>::max());
+    auto next_vertex_index = uint32_t(0);
+    for (auto index_index = uint32_t(0); index_index < index_count; index_index++)
+    {
+      auto index = read_index(mesh, index_index);
+      if (vertex_remap[index] == std::numeric_limits<uint32_t>::max())
+      {
+        vertex_remap[index] = next_vertex_index++;
+      }
+
+      write_index(mesh, index_index, vertex_remap[index]);
+    }
+
+    auto vertex_buffer = allocate(mesh.vertex_buffer.size);
+    for (auto vertex_index = uint32_t(0); vertex_index < vertex_count; vertex_index++)
+    {
+      if (vertex_remap[vertex_index] == std::numeric_limits<uint32_t>::max())
+      {
+        vertex_remap[vertex_index] = next_vertex_index++;
+      }
+
+      std::memcpy(vertex_buffer.data + vertex_remap[vertex_index] * format.size, mesh.vertex_buffer.data + vertex_index * format.size, format.size);
+    }
+
+    std::memcpy(mesh.vertex_buffer.data, vertex_buffer.data, vertex_buffer.size);
+    deallocate(vertex_buffer);
+  }
+
+  void optimize(mesh& mesh, const vertex_format& format, bool overdraw)
+  {
+    optimize_vertex_cache(mesh, format);
+
+    if (overdraw)
+    {
+      optimize_overdraw(mesh, format);
+    }
+
+    optimize_vertex_fetch(mesh, format);
+  }
+
+  float vertex_cache_score(int32_t cache_position, uint32_t remaining_triangle_count, uint32_t cache_size)
+  {
+    if (remaining_triangle_count == 0)
+    {
+      return -1.0f;
+    }
+
+    auto score = 0.0f;
+    if (cache_position >= 0)
+    {
+      // The vertices of the most recent triangle are scored equally (and slightly lower) so that the direction of the next triangle isn't biased.
+      score = cache_position < 3 ? 0.75f : std::pow(1.0f - static_cast<float>(cache_position - 3) / static_cast<float>(cache_size - 3), 1.5f);
+    }
+
+    // Vertices with few remaining triangles are preferred, so that they are finished with rather than left stranded.
+    return score + 2.0f / std::sqrt(static_cast<float>(remaining_triangle_count));
+  }
+
+  bool degenerate_triangle(const std::array<uint32_t, 3>& triangle)
+  {
+    return triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0];
+  }
+
+  std::vector<std::array<uint32_t, 3>> read_triangles(const mesh& mesh)
+  {
+    auto triangles = std::vector<std::array<uint32_t, 3>>(index_count(mesh) / 3);
+    if (mesh.index_size == sizeof(uint32_t))
+    {
+      std::memcpy(triangles.data(), mesh.index_buffer.data, triangles.size() * sizeof(std::array<uint32_t, 3>));
+      return triangles;
+    }
+
+    for (auto triangle_index = uint32_t(0); triangle_index < triangles.size(); triangle_index++)
+    {
+      triangles[triangle_index] = { read_index(mesh, triangle_index * 3), read_index(mesh, triangle_index * 3 + 1), read_index(mesh, triangle_index * 3 + 2) };
+    }
+
+    return triangles;
+  }
+
+  void write_triangle(mesh& mesh, uint32_t& index_index, const std::array<uint32_t, 3>& triangle)
+  {
+    write_index(mesh, index_index++, triangle[0]);
+    write_index(mesh, index_index++, triangle[1]);
+    write_index(mesh, index_index++, triangle[2]);
+  }
+}
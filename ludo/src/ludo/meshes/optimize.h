@@ -0,0 +1,58 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#pragma once
+
+#include "../meshes.h"
+
+namespace ludo
+{
+  ///
+  /// Statistics describing how well the indices of a mesh make use of the post-transform vertex cache.
+  struct vertex_cache_statistics
+  {
+    float acmr = 0.0f; ///< The average cache miss ratio i.e. the number of vertices transformed per triangle. Ranges from 0.5 (ideal) to 3.0.
+    float atvr = 0.0f; ///< The average transformed vertex ratio i.e. the number of vertices transformed per vertex referenced. Ranges from 1.0 (ideal) to 6.0.
+  };
+
+  ///
+  /// Determines how well the indices of a mesh make use of the post-transform vertex cache, simulated as a FIFO cache.
+  /// \param mesh The mesh (assumes the primitive is a triangle list).
+  /// \param format The vertex format of the mesh.
+  /// \param cache_size The number of vertices in the simulated cache.
+  /// \return The statistics.
+  vertex_cache_statistics analyze_vertex_cache(const mesh& mesh, const vertex_format& format, uint32_t cache_size = 16);
+
+  ///
+  /// Reorders the triangles of a mesh so that consecutive triangles share vertices that are still in the post-transform vertex cache.
+  /// Based on "Linear-Speed Vertex Cache Optimisation" (Forsyth), which isn't tuned to any particular cache size or replacement policy.
+  /// Degenerate triangles are moved to the end.
+  /// \param mesh The mesh (assumes the primitive is a triangle list).
+  /// \param format The vertex format of the mesh.
+  /// \param cache_size The number of vertices in the cache modelled while ordering the triangles.
+  void optimize_vertex_cache(mesh& mesh, const vertex_format& format, uint32_t cache_size = 32);
+
+  ///
+  /// Reorders clusters of triangles of a mesh so that those likely to occlude the others are drawn first.
+  /// The triangles are split into clusters wherever a triangle shares no vertices with the cache, so this should follow optimize_vertex_cache.
+  /// Based on "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Sander, Nehab & Barczak).
+  /// \param mesh The mesh (assumes the primitive is a triangle list).
+  /// \param format The vertex format of the mesh.
+  /// \param cache_size The number of vertices in the simulated (FIFO) cache used to find the clusters.
+  void optimize_overdraw(mesh& mesh, const vertex_format& format, uint32_t cache_size = 16);
+
+  ///
+  /// Reorders the vertices of a mesh into the order in which they are first referenced by its indices, so that vertex fetches are mostly sequential.
+  /// This should follow any reordering of the indices. Vertices that aren't referenced are moved to the end.
+  /// \param mesh The mesh.
+  /// \param format The vertex format of the mesh.
+  void optimize_vertex_fetch(mesh& mesh, const vertex_format& format);
+
+  ///
+  /// Optimizes a mesh for the vertex cache and vertex fetches (and optionally overdraw), in that order.
+  /// \param mesh The mesh (assumes the primitive is a triangle list).
+  /// \param format The vertex format of the mesh.
+  /// \param overdraw Determines if the mesh should be optimized for overdraw.
+  void optimize(mesh& mesh, const vertex_format& format, bool overdraw = false);
+}
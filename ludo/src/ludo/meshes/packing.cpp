@@ -0,0 +1,269 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <bit>
+#include <cmath>
+
+#include "packing.h"
+
+namespace ludo
+{
+  uint16_t pack_half(float value)
+  {
+    auto bits = std::bit_cast<uint32_t>(value);
+    auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    auto float_exponent = static_cast<int32_t>((bits >> 23) & 0xFF);
+    auto mantissa = bits & 0x7FFFFF;
+
+    // Infinity and NaN (keeping NaN a NaN).
+    if (float_exponent == 0xFF)
+    {
+      return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+    }
+
+    auto exponent = float_exponent - 127 + 15;
+    if (exponent >= 31)
+    {
+      return sign | 0x7C00;
+    }
+
+    // Values too small for the exponent become denormals (or zero), shifting the implicit leading bit into the mantissa.
+    if (exponent <= 0)
+    {
+      if (exponent < -10)
+      {
+        return sign;
+      }
+
+      mantissa |= 0x800000;
+      auto shift = static_cast<uint32_t>(14 - exponent);
+      auto half_mantissa = mantissa >> shift;
+      auto remainder = mantissa & ((1u << shift) - 1);
+      auto halfway = 1u << (shift - 1);
+      if (remainder > halfway || (remainder == halfway && (half_mantissa & 1)))
+      {
+        half_mantissa++;
+      }
+
+      return sign | static_cast<uint16_t>(half_mantissa);
+    }
+
+    // Round to the nearest (even). Rounding up may carry into the exponent, which is still correct (up to and including infinity).
+    auto half = static_cast<uint32_t>(exponent << 10) | (mantissa >> 13);
+    auto remainder = mantissa & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    {
+      half++;
+    }
+
+    return sign | static_cast<uint16_t>(half);
+  }
+
+  float unpack_half(uint16_t value)
+  {
+    auto sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    auto exponent = static_cast<uint32_t>(value >> 10) & 0x1F;
+    auto mantissa = static_cast<uint32_t>(value) & 0x3FF;
+
+    if (exponent == 0)
+    {
+      auto magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+      return sign ? -magnitude : magnitude;
+    }
+
+    if (exponent == 31)
+    {
+      return std::bit_cast<float>(sign | 0x7F800000 | (mantissa << 13));
+    }
+
+    return std::bit_cast<float>(sign | ((exponent + 127 - 15) << 23) | (mantissa << 13));
+  }
+
+  std::array<int16_t, 2> pack_octahedral(const vec3& normal)
+  {
+    auto l1_norm = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+    auto x = normal[0] / l1_norm;
+    auto y = normal[1] / l1_norm;
+
+    // The lower half of the octahedron is folded over the upper half's diagonals.
+    if (normal[2] < 0.0f)
+    {
+      auto folded_x = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+      auto folded_y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+      x = folded_x;
+      y = folded_y;
+    }
+
+    return
+    {
+      static_cast<int16_t>(std::round(std::clamp(x, -1.0f, 1.0f) * 32767.0f)),
+      static_cast<int16_t>(std::round(std::clamp(y, -1.0f, 1.0f) * 32767.0f))
+    };
+  }
+
+  vec3 unpack_octahedral(const std::array<int16_t, 2>& value)
+  {
+    // Matches the unpacking performed by the default vertex shader.
+    auto x = std::max(static_cast<float>(value[0]) / 32767.0f, -1.0f);
+    auto y = std::max(static_cast<float>(value[1]) / 32767.0f, -1.0f);
+    auto normal = vec3 { x, y, 1.0f - std::abs(x) - std::abs(y) };
+
+    auto fold = std::max(-normal[2], 0.0f);
+    normal[0] += normal[0] >= 0.0f ? -fold : fold;
+    normal[1] += normal[1] >= 0.0f ? -fold : fold;
+    normalize(normal);
+
+    return normal;
+  }
+
+  std::array<uint8_t, 4> pack_unorm8(const vec4& color)
+  {
+    return
+    {
+      static_cast<uint8_t>(std::round(std::clamp(color[0], 0.0f, 1.0f) * 255.0f)),
+      static_cast<uint8_t>(std::round(std::clamp(color[1], 0.0f, 1.0f) * 255.0f)),
+      static_cast<uint8_t>(std::round(std::clamp(color[2], 0.0f, 1.0f) * 255.0f)),
+      static_cast<uint8_t>(std::round(std::clamp(color[3], 0.0f, 1.0f) * 255.0f))
+    };
+  }
+
+  vec4 unpack_unorm8(const std::array<uint8_t, 4>& value)
+  {
+    return
+    {
+      static_cast<float>(value[0]) / 255.0f,
+      static_cast<float>(value[1]) / 255.0f,
+      static_cast<float>(value[2]) / 255.0f,
+      static_cast<float>(value[3]) / 255.0f
+    };
+  }
+
+  std::array<uint16_t, 2> pack_unorm16(const vec2& texture_coordinate)
+  {
+    return
+    {
+      static_cast<uint16_t>(std::round(std::clamp(texture_coordinate[0], 0.0f, 1.0f) * 65535.0f)),
+      static_cast<uint16_t>(std::round(std::clamp(texture_coordinate[1], 0.0f, 1.0f) * 65535.0f))
+    };
+  }
+
+  vec2 unpack_unorm16(const std::array<uint16_t, 2>& value)
+  {
+    return
+    {
+      static_cast<float>(value[0]) / 65535.0f,
+      static_cast<float>(value[1]) / 65535.0f
+    };
+  }
+
+  vec3 read_position(const mesh& mesh, const vertex_format& format, uint32_t vertex_index)
+  {
+    auto byte_index = vertex_index * format.size + format.position_offset;
+    if (!format.packed_position)
+    {
+      return cast<vec3>(mesh.vertex_buffer, byte_index);
+    }
+
+    auto& value = cast<std::array<uint16_t, 4>>(mesh.vertex_buffer, byte_index);
+    return { unpack_half(value[0]), unpack_half(value[1]), unpack_half(value[2]) };
+  }
+
+  vec3 read_normal(const mesh& mesh, const vertex_format& format, uint32_t vertex_index)
+  {
+    auto byte_index = vertex_index * format.size + format.normal_offset;
+    return format.packed_normal ? unpack_octahedral(cast<std::array<int16_t, 2>>(mesh.vertex_buffer, byte_index)) : cast<vec3>(mesh.vertex_buffer, byte_index);
+  }
+
+  vec4 read_color(const mesh& mesh, const vertex_format& format, uint32_t vertex_index)
+  {
+    auto byte_index = vertex_index * format.size + format.color_offset;
+    return format.packed_color ? unpack_unorm8(cast<std::array<uint8_t, 4>>(mesh.vertex_buffer, byte_index)) : cast<vec4>(mesh.vertex_buffer, byte_index);
+  }
+
+  vec2 read_texture_coordinate(const mesh& mesh, const vertex_format& format, uint32_t vertex_index)
+  {
+    auto byte_index = vertex_index * format.size + format.texture_coordinate_offset;
+    return format.packed_texture_coordinate ? unpack_unorm16(cast<std::array<uint16_t, 2>>(mesh.vertex_buffer, byte_index)) : cast<vec2>(mesh.vertex_buffer, byte_index);
+  }
+
+  void write_position(mesh& mesh, const vertex_format& format, uint32_t vertex_index, const vec3& position)
+  {
+    auto byte_index = vertex_index * format.size + format.position_offset;
+    if (!format.packed_position)
+    {
+      cast<vec3>(mesh.vertex_buffer, byte_index) = position;
+      return;
+    }
+
+    cast<std::array<uint16_t, 4>>(mesh.vertex_buffer, byte_index) = { pack_half(position[0]), pack_half(position[1]), pack_half(position[2]), 0 };
+  }
+
+  void write_normal(mesh& mesh, const vertex_format& format, uint32_t vertex_index, const vec3& normal)
+  {
+    auto byte_index = vertex_index * format.size + format.normal_offset;
+    if (!format.packed_normal)
+    {
+      cast<vec3>(mesh.vertex_buffer, byte_index) = normal;
+      return;
+    }
+
+    cast<std::array<int16_t, 2>>(mesh.vertex_buffer, byte_index) = pack_octahedral(normal);
+  }
+
+  void write_color(mesh& mesh, const vertex_format& format, uint32_t vertex_index, const vec4& color)
+  {
+    auto byte_index = vertex_index * format.size + format.color_offset;
+    if (!format.packed_color)
+    {
+      cast<vec4>(mesh.vertex_buffer, byte_index) = color;
+      return;
+    }
+
+    cast<std::array<uint8_t, 4>>(mesh.vertex_buffer, byte_index) = pack_unorm8(color);
+  }
+
+  void write_texture_coordinate(mesh& mesh, const vertex_format& format, uint32_t vertex_index, const vec2& texture_coordinate)
+  {
+    auto byte_index = vertex_index * format.size + format.texture_coordinate_offset;
+    if (!format.packed_texture_coordinate)
+    {
+      cast<vec2>(mesh.vertex_buffer, byte_index) = texture_coordinate;
+      return;
+    }
+
+    cast<std::array<uint16_t, 2>>(mesh.vertex_buffer, byte_index) = pack_unorm16(texture_coordinate);
+  }
+
+  void convert(mesh& destination, const mesh& source, const vertex_format& destination_format, const vertex_format& source_format)
+  {
+    auto vertex_count = static_cast<uint32_t>(source.vertex_buffer.size / source_format.size);
+
+    assert(destination.index_size == source.index_size && "index sizes must match");
+    assert(destination.index_buffer.size == source.index_buffer.size && "index counts must match");
+    assert(destination.vertex_buffer.size / destination_format.size == vertex_count && "vertex counts must match");
+
+    std::memcpy(destination.index_buffer.data, source.index_buffer.data, source.index_buffer.size);
+    std::memset(destination.vertex_buffer.data, 0, destination.vertex_buffer.size);
+
+    for (auto vertex_index = uint32_t(0); vertex_index < vertex_count; vertex_index++)
+    {
+      write_position(destination, destination_format, vertex_index, read_position(source, source_format, vertex_index));
+
+      if (destination_format.has_normal && source_format.has_normal)
+      {
+        write_normal(destination, destination_format, vertex_index, read_normal(source, source_format, vertex_index));
+      }
+
+      if (destination_format.has_color && source_format.has_color)
+      {
+        write_color(destination, destination_format, vertex_index, read_color(source, source_format, vertex_index));
+      }
+
+      if (destination_format.has_texture_coordinate && source_format.has_texture_coordinate)
+      {
+        write_texture_coordinate(destination, destination_format, vertex_index, read_texture_coordinate(source, source_format, vertex_index));
+      }
+    }
+  }
+}
@@ -0,0 +1,131 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#pragma once
+
+#include "../meshes.h"
+
+namespace ludo
+{
+  ///
+  /// Packs a float into a half float (rounding to the nearest).
+  /// \param value The float.
+  /// \return The half float.
+  uint16_t pack_half(float value);
+
+  ///
+  /// Unpacks a float from a half float.
+  /// \param value The half float.
+  /// \return The float.
+  float unpack_half(uint16_t value);
+
+  ///
+  /// Packs a unit vector into a pair of snorm values by mapping it onto an octahedron (and unfolding the octahedron into a square).
+  /// \param normal The unit vector.
+  /// \return The snorm values.
+  std::array<int16_t, 2> pack_octahedral(const vec3& normal);
+
+  ///
+  /// Unpacks a unit vector from a pair of snorm values mapped onto an octahedron (see pack_octahedral).
+  /// \param value The snorm values.
+  /// \return The unit vector.
+  vec3 unpack_octahedral(const std::array<int16_t, 2>& value);
+
+  ///
+  /// Packs a color into unorm values.
+  /// \param color The color. Its components are clamped to the range [0,1].
+  /// \return The unorm values.
+  std::array<uint8_t, 4> pack_unorm8(const vec4& color);
+
+  ///
+  /// Unpacks a color from unorm values.
+  /// \param value The unorm values.
+  /// \return The color.
+  vec4 unpack_unorm8(const std::array<uint8_t, 4>& value);
+
+  ///
+  /// Packs a texture coordinate into unorm values.
+  /// \param texture_coordinate The texture coordinate. Its components are clamped to the range [0,1].
+  /// \return The unorm values.
+  std::array<uint16_t, 2> pack_unorm16(const vec2& texture_coordinate);
+
+  ///
+  /// Unpacks a texture coordinate from unorm values.
+  /// \param value The unorm values.
+  /// \return The texture coordinate.
+  vec2 unpack_unorm16(const std::array<uint16_t, 2>& value);
+
+  ///
+  /// Reads the position of a vertex, unpacking it if necessary.
+  /// \param mesh The mesh containing the vertex.
+  /// \param format The vertex format of the mesh.
+  /// \param vertex_index The index of the vertex.
+  /// \return The position.
+  vec3 read_position(const mesh& mesh, const vertex_format& format, uint32_t vertex_index);
+
+  ///
+  /// Reads the normal of a vertex, unpacking it if necessary.
+  /// \param mesh The mesh containing the vertex.
+  /// \param format The vertex format of the mesh (must include a normal).
+  /// \param vertex_index The index of the vertex.
+  /// \return The normal.
+  vec3 read_normal(const mesh& mesh, const vertex_format& format, uint32_t vertex_index);
+
+  ///
+  /// Reads the color of a vertex, unpacking it if necessary.
+  /// \param mesh The mesh containing the vertex.
+  /// \param format The vertex format of the mesh (must include a color).
+  /// \param vertex_index The index of the vertex.
+  /// \return The color.
+  vec4 read_color(const mesh& mesh, const vertex_format& format, uint32_t vertex_index);
+
+  ///
+  /// Reads the texture coordinate of a vertex, unpacking it if necessary.
+  /// \param mesh The mesh containing the vertex.
+  /// \param format The vertex format of the mesh (must include a texture coordinate).
+  /// \param vertex_index The index of the vertex.
+  /// \return The texture coordinate.
+  vec2 read_texture_coordinate(const mesh& mesh, const vertex_format& format, uint32_t vertex_index);
+
+  ///
+  /// Writes the position of a vertex, packing it if necessary.
+  /// \param mesh The mesh containing the vertex.
+  /// \param format The vertex format of the mesh.
+  /// \param vertex_index The index of the vertex.
+  /// \param position The position.
+  void write_position(mesh& mesh, const vertex_format& format, uint32_t vertex_index, const vec3& position);
+
+  ///
+  /// Writes the normal of a vertex, packing it if necessary.
+  /// \param mesh The mesh containing the vertex.
+  /// \param format The vertex format of the mesh (must include a normal).
+  /// \param vertex_index The index of the vertex.
+  /// \param normal The normal.
+  void write_normal(mesh& mesh, const vertex_format& format, uint32_t vertex_index, const vec3& normal);
+
+  ///
+  /// Writes the color of a vertex, packing it if necessary.
+  /// \param mesh The mesh containing the vertex.
+  /// \param format The vertex format of the mesh (must include a color).
+  /// \param vertex_index The index of the vertex.
+  /// \param color The color.
+  void write_color(mesh& mesh, const vertex_format& format, uint32_t vertex_index, const vec4& color);
+
+  ///
+  /// Writes the texture coordinate of a vertex, packing it if necessary.
+  /// \param mesh The mesh containing the vertex.
+  /// \param format The vertex format of the mesh (must include a texture coordinate).
+  /// \param vertex_index The index of the vertex.
+  /// \param texture_coordinate The texture coordinate.
+  void write_texture_coordinate(mesh& mesh, const vertex_format& format, uint32_t vertex_index, const vec2& texture_coordinate);
+
+  ///
+  /// Copies the indices and vertices of a mesh to another mesh with a different vertex format e.g. to pack a mesh once it has been built.
+  /// The components present in the destination but not the source are zeroed. Bone weights are not copied.
+  /// \param destination The mesh to copy to. Must have the same number of indices and vertices as the source.
+  /// \param source The mesh to copy from.
+  /// \param destination_format The vertex format of the destination mesh.
+  /// \param source_format The vertex format of the source mesh.
+  void convert(mesh& destination, const mesh& source, const vertex_format& destination_format, const vertex_format& source_format);
+}
@@ -15,12 +15,14 @@ namespace ludo
 
     auto index_index = start_index;
     auto vertex_index = start_vertex;
+    auto welder = vertex_welder();
 
     if (options.outward_faces)
     {
       rectangle(
         mesh,
         format,
+        welder,
         index_index,
         vertex_index,
         options.center + vec3 { options.dimensions[0] * -0.5f, options.dimensions[1] * -0.5f, 0.0f },
@@ -40,6 +42,7 @@ namespace ludo
       rectangle(
         mesh,
         format,
+        welder,
         index_index,
         vertex_index,
         options.center + vec3 { options.dimensions[0] * 0.5f, options.dimensions[1] * -0.5f, 0.0f },
@@ -71,7 +74,7 @@ namespace ludo
     return { total, unique };
   }
 
-  void rectangle(mesh& mesh, const vertex_format& format, uint32_t& index_index, uint32_t& vertex_index, const vec3& position_bottom_left, const vec3& position_delta_right, const vec3& position_delta_top, const vec2& tex_coord_min, const vec2& tex_coord_delta, bool unique_only, bool no_normal_check, const vec4& color, uint32_t divisions)
+  void rectangle(mesh& mesh, const vertex_format& format, vertex_welder& welder, uint32_t& index_index, uint32_t& vertex_index, const vec3& position_bottom_left, const vec3& position_delta_right, const vec3& position_delta_top, const vec2& tex_coord_min, const vec2& tex_coord_delta, bool unique_only, bool no_normal_check, const vec4& color, uint32_t divisions)
   {
     auto cell_position_delta_right = position_delta_right / static_cast<float>(divisions);
     auto cell_position_delta_top = position_delta_top / static_cast<float>(divisions);
@@ -84,7 +87,7 @@ namespace ludo
 
       for (auto column = 0; column < divisions; column++)
       {
-        rectangle(mesh, format, index_index, vertex_index, cell_position_bottom_left, cell_position_delta_right, cell_position_delta_top, cell_tex_coord_min, cell_tex_coord_delta, unique_only, no_normal_check, color);
+        rectangle(mesh, format, welder, index_index, vertex_index, cell_position_bottom_left, cell_position_delta_right, cell_position_delta_top, cell_tex_coord_min, cell_tex_coord_delta, unique_only, no_normal_check, color);
 
         cell_position_bottom_left += cell_position_delta_right;
         cell_tex_coord_min += vec2 { cell_tex_coord_delta[0], 0.0f };
@@ -92,7 +95,7 @@ namespace ludo
     }
   }
 
-  void rectangle(mesh& mesh, const vertex_format& format, uint32_t& index_index, uint32_t& vertex_index, const vec3& position_bottom_left, const vec3& position_delta_right, const vec3& position_delta_top, const vec2& tex_coord_min, const vec2& tex_coord_delta, bool unique_only, bool no_normal_check, const vec4& color)
+  void rectangle(mesh& mesh, const vertex_format& format, vertex_welder& welder, uint32_t& index_index, uint32_t& vertex_index, const vec3& position_bottom_left, const vec3& position_delta_right, const vec3& position_delta_top, const vec2& tex_coord_min, const vec2& tex_coord_delta, bool unique_only, bool no_normal_check, const vec4& color)
   {
     auto normal = cross(position_delta_right, position_delta_top);
     normalize(normal);
@@ -101,12 +104,24 @@ namespace ludo
     auto tex_coord_top_left = tex_coord_min + vec2 { 0.0f, tex_coord_delta[1] };
     auto tex_coord_top_right = tex_coord_min + tex_coord_delta;
 
-    write_vertex(mesh, format, index_index, vertex_index, position_bottom_left, normal, color, tex_coord_min, unique_only, no_normal_check);
-    write_vertex(mesh, format, index_index, vertex_index, position_bottom_left + position_delta_right, normal, color, tex_coord_bottom_right, unique_only, no_normal_check);
-    write_vertex(mesh, format, index_index, vertex_index, position_bottom_left + position_delta_top, normal, color, tex_coord_top_left, unique_only, no_normal_check);
+    auto write = [&](const vec3& position, const vec2& texture_coordinate)
+    {
+      if (unique_only)
+      {
+        write_vertex(mesh, format, welder, index_index, vertex_index, position, normal, color, texture_coordinate, no_normal_check);
+      }
+      else
+      {
+        write_vertex(mesh, format, index_index, vertex_index, position, normal, color, texture_coordinate);
+      }
+    };
+
+    write(position_bottom_left, tex_coord_min);
+    write(position_bottom_left + position_delta_right, tex_coord_bottom_right);
+    write(position_bottom_left + position_delta_top, tex_coord_top_left);
 
-    write_vertex(mesh, format, index_index, vertex_index, position_bottom_left + position_delta_right, normal, color, tex_coord_bottom_right, unique_only, no_normal_check);
-    write_vertex(mesh, format, index_index, vertex_index, position_bottom_left + position_delta_right + position_delta_top, normal, color, tex_coord_top_right, unique_only, no_normal_check);
-    write_vertex(mesh, format, index_index, vertex_index, position_bottom_left + position_delta_top, normal, color, tex_coord_top_left, unique_only, no_normal_check);
+    write(position_bottom_left + position_delta_right, tex_coord_bottom_right);
+    write(position_bottom_left + position_delta_right + position_delta_top, tex_coord_top_right);
+    write(position_bottom_left + position_delta_top, tex_coord_top_left);
   }
 }
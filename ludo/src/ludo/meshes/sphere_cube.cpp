@@ -5,6 +5,7 @@
 #include <cmath>
 
 #include "box.h"
+#include "packing.h"
 #include "shapes.h"
 
 namespace ludo
@@ -16,8 +17,8 @@ namespace ludo
 
     auto index_index = start_index;
     auto vertex_index = start_vertex;
+    auto welder = vertex_welder();
 
-    auto [ vertex_count, index_count ] = sphere_cube_counts(format, options);
     auto radius = options.dimensions[0] / 2.0f;
 
     // I couldn't figure out how to adapt the 'spherifying' code to different cube sizes, so we're using the 2x2x2 cube and multiplying the result by the radius.
@@ -25,12 +26,12 @@ namespace ludo
     auto box_vertex_index = vertex_index;
     auto box_options = options;
     box_options.dimensions = vec3 { 2.0f, 2.0f, 2.0f };
-    box(mesh, format, box_index_index, box_vertex_index, box_options, options.smooth, options.smooth);
+    box(mesh, format, welder, box_index_index, box_vertex_index, box_options, options.smooth, options.smooth);
 
-    auto byte_index = vertex_index * format.size;
-    for (auto existing_vertex_index = vertex_index; existing_vertex_index < vertex_index + vertex_count; existing_vertex_index++)
+    // The components are read and written individually since they may be packed (see vertex_format).
+    for (auto existing_vertex_index = vertex_index; existing_vertex_index < box_vertex_index; existing_vertex_index++)
     {
-      auto position = cast<vec3>(mesh.vertex_buffer, byte_index + format.position_offset) - options.center;
+      auto position = read_position(mesh, format, existing_vertex_index) - options.center;
 
       if (spherified)
       {
@@ -47,43 +48,38 @@ namespace ludo
         normalize(position);
       }
 
-      cast<vec3>(mesh.vertex_buffer, byte_index + format.position_offset) = options.center + position * radius;
-      byte_index += format.size;
+      write_position(mesh, format, existing_vertex_index, options.center + position * radius);
     }
 
     if (format.has_normal)
     {
-      byte_index = vertex_index * format.size;
-
       if (options.smooth)
       {
-        for (auto existing_vertex_index = vertex_index; existing_vertex_index < vertex_index + vertex_count; existing_vertex_index++)
+        for (auto existing_vertex_index = vertex_index; existing_vertex_index < box_vertex_index; existing_vertex_index++)
         {
-          auto position = cast<vec3>(mesh.vertex_buffer, byte_index + format.position_offset);
-          auto normal = position - options.center;
+          auto normal = read_position(mesh, format, existing_vertex_index) - options.center;
           normalize(normal);
 
-          cast<vec3>(mesh.vertex_buffer, byte_index + format.normal_offset) = normal;
-          byte_index += format.size;
+          write_normal(mesh, format, existing_vertex_index, normal);
         }
       }
       else
       {
-        for (auto existing_index_index = index_index; existing_index_index < index_index + index_count; existing_index_index += 3)
+        for (auto existing_index_index = index_index; existing_index_index < box_index_index; existing_index_index += 3)
         {
-          auto index_0 = cast<uint32_t>(mesh.index_buffer, existing_index_index * sizeof(uint32_t));
-          auto index_1 = cast<uint32_t>(mesh.index_buffer, (existing_index_index + 1) * sizeof(uint32_t));
-          auto index_2 = cast<uint32_t>(mesh.index_buffer, (existing_index_index + 2) * sizeof(uint32_t));
+          auto index_0 = read_index(mesh, existing_index_index);
+          auto index_1 = read_index(mesh, existing_index_index + 1);
+          auto index_2 = read_index(mesh, existing_index_index + 2);
 
-          auto position_0 = cast<vec3>(mesh.vertex_buffer, index_0 * format.size + format.position_offset);
-          auto position_1 = cast<vec3>(mesh.vertex_buffer, index_1 * format.size + format.position_offset);
-          auto position_2 = cast<vec3>(mesh.vertex_buffer, index_2 * format.size + format.position_offset);
+          auto position_0 = read_position(mesh, format, index_0);
+          auto position_1 = read_position(mesh, format, index_1);
+          auto position_2 = read_position(mesh, format, index_2);
           auto normal = cross(position_1 - position_0, position_2 - position_0);
           normalize(normal);
 
-          cast<vec3>(mesh.vertex_buffer, index_0 * format.size + format.normal_offset) = normal;
-          cast<vec3>(mesh.vertex_buffer, index_1 * format.size + format.normal_offset) = normal;
-          cast<vec3>(mesh.vertex_buffer, index_2 * format.size + format.normal_offset) = normal;
+          write_normal(mesh, format, index_0, normal);
+          write_normal(mesh, format, index_1, normal);
+          write_normal(mesh, format, index_2, normal);
         }
       }
     }
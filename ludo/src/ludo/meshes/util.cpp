@@ -2,42 +2,92 @@
  * This file is part of ludo. See the LICENSE file for the full license governing this code.
  */
 
+#include <cmath>
+
+#include "packing.h"
 #include "util.h"
 
 namespace ludo
 {
-  void write_vertex(mesh& mesh, const vertex_format& format, uint32_t& index_index, uint32_t& vertex_index, const vec3& position, const vec3& normal, const vec4& color, const vec2& texture_coordinate, bool unique_only, bool no_normal_check)
+  void add(vertex_welder& welder, const vec3& position, uint32_t vertex_index)
   {
-    if (unique_only)
+    auto entry = static_cast<uint32_t>(welder.vertex_indices.size());
+    auto [ cell_iter, inserted ] = welder.cell_entries.try_emplace(cell_key(cell_coordinates(welder, position)), entry);
+
+    welder.vertex_indices.push_back(vertex_index);
+    welder.next_entries.push_back(inserted ? std::numeric_limits<uint32_t>::max() : cell_iter->second);
+
+    cell_iter->second = entry;
+  }
+
+  void write_vertex(mesh& mesh, const vertex_format& format, vertex_welder& welder, uint32_t& index_index, uint32_t& vertex_index, const vec3& position, const vec3& normal, const vec4& color, const vec2& texture_coordinate, bool no_normal_check)
+  {
+    // Packed components are compared as they would be stored, so that vertices that pack identically match.
+    auto stored_position = format.packed_position ? vec3 { unpack_half(pack_half(position[0])), unpack_half(pack_half(position[1])), unpack_half(pack_half(position[2])) } : position;
+    auto stored_normal = format.packed_normal ? unpack_octahedral(pack_octahedral(normal)) : normal;
+    auto stored_color = format.packed_color ? unpack_unorm8(pack_unorm8(color)) : color;
+    auto stored_texture_coordinate = format.packed_texture_coordinate ? unpack_unorm16(pack_unorm16(texture_coordinate)) : texture_coordinate;
+
+    auto existing_vertex_index = find(welder, position, [&](uint32_t existing_vertex_index)
     {
-      auto byte_index = uint32_t(0);
-      for (auto existing_vertex_index = uint32_t(0); existing_vertex_index < vertex_index; existing_vertex_index++)
-      {
-        if (near(cast<vec3>(mesh.vertex_buffer, byte_index + format.position_offset), position) &&
-            (no_normal_check || !format.has_normal || near(cast<vec3>(mesh.vertex_buffer, byte_index + format.normal_offset), normal)) &&
-            (!format.has_color || near(cast<vec4>(mesh.vertex_buffer, byte_index + format.color_offset), color)) &&
-            (!format.has_texture_coordinate || near(cast<vec2>(mesh.vertex_buffer, byte_index + format.texture_coordinate_offset), texture_coordinate)))
-        {
-          cast<uint32_t>(mesh.index_buffer, index_index * sizeof(uint32_t)) = existing_vertex_index;
-
-          index_index++;
-
-          return;
-        }
-
-        byte_index += format.size;
-      }
+      return near(read_position(mesh, format, existing_vertex_index), stored_position, welder.epsilon) &&
+        (no_normal_check || !format.has_normal || near(read_normal(mesh, format, existing_vertex_index), stored_normal)) &&
+        (!format.has_color || near(read_color(mesh, format, existing_vertex_index), stored_color)) &&
+        (!format.has_texture_coordinate || near(read_texture_coordinate(mesh, format, existing_vertex_index), stored_texture_coordinate));
+    });
+
+    if (existing_vertex_index != std::numeric_limits<uint32_t>::max())
+    {
+      write_index(mesh, index_index, existing_vertex_index);
+
+      index_index++;
+
+      return;
     }
 
-    auto byte_index = vertex_index * format.size;
-    cast<vec3>(mesh.vertex_buffer, byte_index + format.position_offset) = position;
-    if (format.has_normal) cast<vec3>(mesh.vertex_buffer, byte_index + format.normal_offset) = normal;
-    if (format.has_color) cast<vec4>(mesh.vertex_buffer, byte_index + format.color_offset) = color;
-    if (format.has_texture_coordinate) cast<vec2>(mesh.vertex_buffer, byte_index + format.texture_coordinate_offset) = texture_coordinate;
+    add(welder, position, vertex_index);
+    write_vertex(mesh, format, index_index, vertex_index, position, normal, color, texture_coordinate);
+  }
+
+  void write_vertex(mesh& mesh, const vertex_format& format, uint32_t& index_index, uint32_t& vertex_index, const vec3& position, const vec3& normal, const vec4& color, const vec2& texture_coordinate)
+  {
+    write_position(mesh, format, vertex_index, position);
+    if (format.has_normal) write_normal(mesh, format, vertex_index, normal);
+    if (format.has_color) write_color(mesh, format, vertex_index, color);
+    if (format.has_texture_coordinate) write_texture_coordinate(mesh, format, vertex_index, texture_coordinate);
 
-    cast<uint32_t>(mesh.index_buffer, index_index * sizeof(uint32_t)) = vertex_index;
+    write_index(mesh, index_index, vertex_index);
 
     vertex_index++;
     index_index++;
   }
+
+  std::array<int64_t, 3> cell_coordinates(const vertex_welder& welder, const vec3& position)
+  {
+    auto size = static_cast<double>(cell_size(welder));
+
+    return
+    {
+      static_cast<int64_t>(std::floor(position[0] / size)),
+      static_cast<int64_t>(std::floor(position[1] / size)),
+      static_cast<int64_t>(std::floor(position[2] / size))
+    };
+  }
+
+  uint64_t cell_key(const std::array<int64_t, 3>& cell_coordinates)
+  {
+    // Cells far enough apart can share a key, which only costs extra comparisons.
+    auto mask = (uint64_t(1) << 21) - 1;
+
+    return
+      (static_cast<uint64_t>(cell_coordinates[0]) & mask) << 42 |
+      (static_cast<uint64_t>(cell_coordinates[1]) & mask) << 21 |
+      (static_cast<uint64_t>(cell_coordinates[2]) & mask);
+  }
+
+  float cell_size(const vertex_welder& welder)
+  {
+    // Large enough that most positions aren't within the tolerance of a cell boundary, but small enough that cells rarely hold many vertices.
+    return 16.0f * welder.epsilon;
+  }
 }
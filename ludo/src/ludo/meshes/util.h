@@ -4,24 +4,86 @@
 
 #pragma once
 
+#include <unordered_map>
+
 #include "../meshes.h"
 
 namespace ludo
 {
+  ///
+  /// Finds matching vertices using a spatial hash of their positions, rather than by comparing each vertex against every other vertex.
+  /// Positions are quantized into cubic cells several times larger than the tolerance, so only cells within the tolerance of a position need to be searched.
+  struct vertex_welder
+  {
+    float epsilon = 0.0001f; ///< The tolerance within which each component of two vertices must be for them to be considered matching (see near).
+
+    std::unordered_map<uint64_t, uint32_t> cell_entries; ///< The most recently added entry within each cell.
+    std::vector<uint32_t> vertex_indices; ///< The vertex index of each entry.
+    std::vector<uint32_t> next_entries; ///< The next (earlier) entry within the same cell as each entry, or the maximum uint32_t value if there is none.
+  };
+
+  ///
+  /// Adds a vertex to a vertex welder.
+  /// \param welder The vertex welder.
+  /// \param position The position of the vertex.
+  /// \param vertex_index The index of the vertex.
+  void add(vertex_welder& welder, const vec3& position, uint32_t vertex_index);
+
+  ///
+  /// Finds the lowest index of the vertices within a vertex welder that match a vertex.
+  /// \param welder The vertex welder.
+  /// \param position The position of the vertex.
+  /// \param match A function called with the index of each candidate vertex (these are only likely to be near the position). Should return true if the vertex matches.
+  /// \return The index of the matching vertex, or the maximum uint32_t value if there is none.
+  template<typename F>
+  uint32_t find(const vertex_welder& welder, const vec3& position, F&& match);
+
   ///
   /// Writes an index and vertex at the given indices within the given mesh.
-  /// If it is writing unique vertices only it may only write an index and not a vertex (if the vertex already exists).
-  /// It will only search the vertices before the given vertex index for matching vertices.
+  /// Only unique vertices are written, so it may only write an index and not a vertex (if a matching vertex has already been written through the vertex welder).
   /// Vertex format information is passed individually (instead of being calculated in this function) to improve performance where this function is called many times.
   /// \param mesh The mesh to write the index and vertex to.
   /// \param format The vertex format of the mesh.
+  /// \param welder The vertex welder used to find matching vertices. Written vertices are added to it.
   /// \param index_index The index at which to write the index. NOTE: The value passed will be incremented if an index was written.
   /// \param vertex_index The index at which to write the vertex. NOTE: The value passed will be incremented if a vertex was written.
   /// \param position The position to write to the vertex.
   /// \param normal The normal to write to the vertex.
   /// \param color The color to write to the vertex.
   /// \param texture_coordinate The texture coordinate to write to the vertex.
-  /// \param unique_only Determines if only unique vertices should be written.
   /// \param no_normal_check Determines if normals should be taken into account when searching for matching vertices.
-  void write_vertex(mesh& mesh, const vertex_format& format, uint32_t& index_index, uint32_t& vertex_index, const vec3& position, const vec3& normal, const vec4& color, const vec2& texture_coordinate, bool unique_only = true, bool no_normal_check = false);
+  void write_vertex(mesh& mesh, const vertex_format& format, vertex_welder& welder, uint32_t& index_index, uint32_t& vertex_index, const vec3& position, const vec3& normal, const vec4& color, const vec2& texture_coordinate, bool no_normal_check = false);
+
+  ///
+  /// Writes an index and vertex at the given indices within the given mesh, without searching for a matching vertex.
+  /// \param mesh The mesh to write the index and vertex to.
+  /// \param format The vertex format of the mesh.
+  /// \param index_index The index at which to write the index. NOTE: The value passed will be incremented.
+  /// \param vertex_index The index at which to write the vertex. NOTE: The value passed will be incremented.
+  /// \param position The position to write to the vertex.
+  /// \param normal The normal to write to the vertex.
+  /// \param color The color to write to the vertex.
+  /// \param texture_coordinate The texture coordinate to write to the vertex.
+  void write_vertex(mesh& mesh, const vertex_format& format, uint32_t& index_index, uint32_t& vertex_index, const vec3& position, const vec3& normal, const vec4& color, const vec2& texture_coordinate);
+
+  ///
+  /// Determines the cell of a vertex welder that a position is within.
+  /// \param welder The vertex welder.
+  /// \param position The position.
+  /// \return The coordinates of the cell.
+  std::array<int64_t, 3> cell_coordinates(const vertex_welder& welder, const vec3& position);
+
+  ///
+  /// Determines the key of a cell of a vertex welder.
+  /// \param cell_coordinates The coordinates of the cell.
+  /// \return The key of the cell.
+  uint64_t cell_key(const std::array<int64_t, 3>& cell_coordinates);
+
+  ///
+  /// Determines the size of the cells of a vertex welder.
+  /// \param welder The vertex welder.
+  /// \return The size of the cells.
+  float cell_size(const vertex_welder& welder);
 }
+
+#include "util.hpp"
@@ -0,0 +1,55 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <limits>
+
+namespace ludo
+{
+  template<typename F>
+  uint32_t find(const vertex_welder& welder, const vec3& position, F&& match)
+  {
+    auto size = cell_size(welder);
+    auto coordinates = cell_coordinates(welder, position);
+
+    // Only search the neighbouring cells in the dimensions where the position is within the tolerance of the cell's boundary.
+    auto offset_ranges = std::array<std::pair<int64_t, int64_t>, 3>();
+    for (auto dimension = 0; dimension < 3; dimension++)
+    {
+      auto cell_position = static_cast<double>(position[dimension]) - static_cast<double>(coordinates[dimension]) * size;
+      offset_ranges[dimension] =
+      {
+        cell_position < welder.epsilon ? int64_t(-1) : int64_t(0),
+        cell_position > size - welder.epsilon ? int64_t(1) : int64_t(0)
+      };
+    }
+
+    auto found_vertex_index = std::numeric_limits<uint32_t>::max();
+    for (auto offset_x = offset_ranges[0].first; offset_x <= offset_ranges[0].second; offset_x++)
+    {
+      for (auto offset_y = offset_ranges[1].first; offset_y <= offset_ranges[1].second; offset_y++)
+      {
+        for (auto offset_z = offset_ranges[2].first; offset_z <= offset_ranges[2].second; offset_z++)
+        {
+          auto cell_iter = welder.cell_entries.find(cell_key({ coordinates[0] + offset_x, coordinates[1] + offset_y, coordinates[2] + offset_z }));
+          if (cell_iter == welder.cell_entries.end())
+          {
+            continue;
+          }
+
+          // Continue past the first match so that the result doesn't depend on the order in which the cells are searched.
+          for (auto entry = cell_iter->second; entry != std::numeric_limits<uint32_t>::max(); entry = welder.next_entries[entry])
+          {
+            auto vertex_index = welder.vertex_indices[entry];
+            if (vertex_index < found_vertex_index && match(vertex_index))
+            {
+              found_vertex_index = vertex_index;
+            }
+          }
+        }
+      }
+    }
+
+    return found_vertex_index;
+  }
+}
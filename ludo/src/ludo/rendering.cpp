@@ -2,11 +2,22 @@
  * This file is part of ludo. See the LICENSE file for the full license governing this code.
  */
 
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
 #include "animation.h"
 #include "rendering.h"
+#include "timer.h"
 
 namespace ludo
 {
+  void wait_for_frame(frame_ring& frame_ring, uint32_t frame_index);
+
+  uint64_t committed_instance_bytes = 0;
+  uint64_t render_state_call_count = 0;
+  float frame_stall_time = 0.0f;
+
   uint8_t pixel_depth(const texture& texture)
   {
     auto component_count = uint8_t(0);
@@ -47,6 +58,194 @@ namespace ludo
     return 3;
   }
 
+  // Based on http://www.cs.otago.ac.nz/postgrads/alexis/planeExtraction.pdf
+  std::array<vec4, 6> frustum_planes(const camera& camera)
+  {
+    auto view_inverse = camera.view;
+    invert(view_inverse);
+    auto view_projection = camera.projection * view_inverse;
+
+    auto rows = std::array<vec4, 4>
+    {
+      vec4 { view_projection[0], view_projection[4], view_projection[8], view_projection[12] },
+      vec4 { view_projection[1], view_projection[5], view_projection[9], view_projection[13] },
+      vec4 { view_projection[2], view_projection[6], view_projection[10], view_projection[14] },
+      vec4 { view_projection[3], view_projection[7], view_projection[11], view_projection[15] },
+    };
+
+    return std::array<vec4, 6>
+    {
+      rows[3] + rows[0], // Left
+      rows[3] - rows[0], // Right
+      rows[3] + rows[1], // Bottom
+      rows[3] - rows[1], // Top
+      rows[3] + rows[2], // Near
+      rows[3] - rows[2] // Far
+    };
+  }
+
+  void init(frame_ring& frame_ring, uint64_t frame_size)
+  {
+    assert(frame_ring.frame_count > 0 && "at-least one frame is required");
+
+    frame_ring.frame_size = frame_size;
+    if (frame_size)
+    {
+      frame_ring.buffer = allocate_vram(frame_ring.frame_count * frame_size);
+      std::memset(frame_ring.buffer.data, 0, frame_ring.buffer.size);
+    }
+
+    frame_ring.fences = std::vector<fence>(frame_ring.frame_count);
+
+    // The first call to next_frame moves on to the first slice.
+    frame_ring.frame_index = frame_ring.frame_count - 1;
+  }
+
+  void de_init(frame_ring& frame_ring)
+  {
+    for (auto& fence : frame_ring.fences)
+    {
+      if (fence.id)
+      {
+        de_init(fence);
+      }
+    }
+    frame_ring.fences.clear();
+
+    if (frame_ring.buffer.size)
+    {
+      deallocate_vram(frame_ring.buffer);
+    }
+  }
+
+  buffer next_frame(frame_ring& frame_ring)
+  {
+    frame_ring.frame_index = (frame_ring.frame_index + 1) % frame_ring.frame_count;
+    wait_for_frame(frame_ring, frame_ring.frame_index);
+
+    return
+    {
+      .id = frame_ring.buffer.id,
+      .data = frame_ring.buffer.data + frame_offset(frame_ring),
+      .size = frame_ring.frame_size
+    };
+  }
+
+  buffer previous_frame(frame_ring& frame_ring)
+  {
+    auto frame_index = (frame_ring.frame_index + frame_ring.frame_count - 1) % frame_ring.frame_count;
+    wait_for_frame(frame_ring, frame_index);
+
+    return
+    {
+      .id = frame_ring.buffer.id,
+      .data = frame_ring.buffer.data + frame_index * frame_ring.frame_size,
+      .size = frame_ring.frame_size
+    };
+  }
+
+  uint64_t frame_offset(const frame_ring& frame_ring)
+  {
+    return frame_ring.frame_index * frame_ring.frame_size;
+  }
+
+  void commit(frame_ring& frame_ring)
+  {
+    auto& fence = frame_ring.fences[frame_ring.frame_index];
+    if (fence.id)
+    {
+      de_init(fence);
+    }
+
+    init(fence);
+  }
+
+  void wait(frame_ring& frame_ring)
+  {
+    wait_for_frame(frame_ring, frame_ring.frame_index);
+  }
+
+  void wait_for_frame(frame_ring& frame_ring, uint32_t frame_index)
+  {
+    auto& fence = frame_ring.fences[frame_index];
+    if (!fence.id)
+    {
+      return;
+    }
+
+    // Only time the waits that actually block, so that the stall counters reflect the GPU falling behind.
+    if (signaled(fence))
+    {
+      wait(fence);
+      return;
+    }
+
+    auto timer = ludo::timer();
+    wait(fence);
+    auto stall_time = elapsed(timer);
+
+    frame_ring.stall_count++;
+    frame_ring.stall_time += stall_time;
+    frame_stall_time += stall_time;
+  }
+
+  render_command_stats merge_render_commands(render_program& render_program)
+  {
+    auto count = render_program.active_commands.count;
+    auto stats = render_command_stats { .command_count_before = count, .command_count_after = count };
+    if (count < 2)
+    {
+      return stats;
+    }
+
+    // Work on a copy since the command buffer may be mapped GPU memory that is slow to read from.
+    auto active_commands = reinterpret_cast<render_command*>(render_program.command_buffer.data) + render_program.active_commands.start;
+    auto render_commands = std::vector<render_command>(active_commands, active_commands + count);
+
+    std::sort(render_commands.begin(), render_commands.end(), [](const render_command& a, const render_command& b)
+    {
+      return std::tie(a.index_start, a.vertex_start, a.index_count, a.instance_start) < std::tie(b.index_start, b.vertex_start, b.index_count, b.instance_start);
+    });
+
+    auto merged_count = uint32_t(1);
+    for (auto index = uint32_t(1); index < count; index++)
+    {
+      auto& previous = render_commands[merged_count - 1];
+      auto& current = render_commands[index];
+
+      if (current.index_start == previous.index_start &&
+        current.vertex_start == previous.vertex_start &&
+        current.index_count == previous.index_count &&
+        current.instance_start == previous.instance_start + previous.instance_count)
+      {
+        previous.instance_count += current.instance_count;
+      }
+      else
+      {
+        render_commands[merged_count++] = current;
+      }
+    }
+
+    std::memcpy(active_commands, render_commands.data(), merged_count * sizeof(render_command));
+    render_program.active_commands.count = merged_count;
+    stats.command_count_after = merged_count;
+
+    return stats;
+  }
+
+  render_command_stats merge_render_commands(array<render_program>& render_programs)
+  {
+    auto stats = render_command_stats();
+    for (auto& render_program : render_programs)
+    {
+      auto render_program_stats = merge_render_commands(render_program);
+      stats.command_count_before += render_program_stats.command_count_before;
+      stats.command_count_after += render_program_stats.command_count_after;
+    }
+
+    return stats;
+  }
+
   void init(render_mesh& render_mesh)
   {
     render_mesh.id = next_id++;
@@ -54,6 +253,8 @@ namespace ludo
 
   void init(render_mesh& render_mesh, render_program& render_program, const mesh& mesh, const heap& indices, const heap& vertices, uint32_t instance_capacity)
   {
+    assert(mesh.index_size == render_program.index_size && "mesh does not match render program index size");
+
     render_mesh.id = next_id++;
     ludo::connect(render_mesh, render_program, instance_capacity);
     ludo::connect(render_mesh, mesh, indices, vertices);
@@ -70,6 +271,16 @@ namespace ludo
     render_mesh.render_program_id = render_program.id;
     render_mesh.instance_buffer = allocate(render_program.instance_buffer_back, render_program.instance_size * instance_capacity);
     render_mesh.instance_size = render_program.instance_size;
+
+    // The dirty bytes are laid out like the instances in the back buffer.
+    if (render_program.dirty_instances.data)
+    {
+      auto instance_offset = static_cast<uint64_t>(render_mesh.instance_buffer.data - render_program.instance_buffer_back.data);
+      assert(instance_offset % render_program.instance_size == 0 && "instance buffer not aligned to instances");
+
+      auto instance_start = instance_offset / render_program.instance_size;
+      render_mesh.dirty_instances = { .data = render_program.dirty_instances.data + instance_start, .size = instance_capacity };
+    }
   }
 
   void disconnect(render_mesh& render_mesh, render_program& render_program)
@@ -80,12 +291,13 @@ namespace ludo
       deallocate(render_program.instance_buffer_back, render_mesh.instance_buffer);
     }
     render_mesh.instance_size = 0;
+    render_mesh.dirty_instances = {};
   }
 
   void connect(render_mesh& render_mesh, const mesh& mesh, const heap& indices, const heap& vertices)
   {
-    render_mesh.indices.start = (mesh.index_buffer.data - indices.data) / sizeof(uint32_t);
-    render_mesh.indices.count = mesh.index_buffer.size / sizeof(uint32_t);
+    render_mesh.indices.start = (mesh.index_buffer.data - indices.data) / mesh.index_size;
+    render_mesh.indices.count = mesh.index_buffer.size / mesh.index_size;
 
     render_mesh.vertices.start = (mesh.vertex_buffer.data - vertices.data) / mesh.vertex_size;
     render_mesh.vertices.count = mesh.vertex_buffer.size / mesh.vertex_size;
@@ -95,7 +307,7 @@ namespace ludo
   {
     for (auto instance_index = uint32_t(0); instance_index < instance_count; instance_index++)
     {
-      instance_transform(render_mesh, instance_index) = mat4_identity;
+      set_instance_transform(render_mesh, mat4_identity, instance_index);
 
       if (mesh.texture_id)
       {
@@ -113,18 +325,20 @@ namespace ludo
     }
   }
 
-  mat4& instance_transform(render_mesh& render_mesh, uint32_t instance_index)
+  const mat4& instance_transform(const render_mesh& render_mesh, uint32_t instance_index)
   {
-    return cast<mat4>(render_mesh.instance_buffer, instance_index * render_mesh.instance_size);
+    return cast<const mat4>(render_mesh.instance_buffer, instance_index * render_mesh.instance_size);
   }
 
-  const mat4& instance_transform(const render_mesh& render_mesh, uint32_t instance_index)
+  void set_instance_transform(render_mesh& render_mesh, const mat4& transform, uint32_t instance_index)
   {
-    return cast<const mat4>(render_mesh.instance_buffer, instance_index * render_mesh.instance_size);
+    cast<mat4>(render_mesh.instance_buffer, instance_index * render_mesh.instance_size) = transform;
+    mark_instance_dirty(render_mesh, instance_index);
   }
 
   ludo::mat4* instance_bone_transforms(render_mesh& render_mesh, uint32_t instance_index)
   {
+    mark_instance_dirty(render_mesh, instance_index);
     return &cast<ludo::mat4>(render_mesh.instance_buffer, instance_index * render_mesh.instance_size + sizeof(ludo::mat4) + 16);
   }
 
@@ -132,4 +346,64 @@ namespace ludo
   {
     return &cast<const ludo::mat4>(render_mesh.instance_buffer, instance_index * render_mesh.instance_size + sizeof(ludo::mat4) + 16);
   }
+
+  void mark_instance_dirty(const render_mesh& render_mesh, uint32_t instance_index)
+  {
+    if (!render_mesh.dirty_instances.data)
+    {
+      return;
+    }
+
+    assert(instance_index < render_mesh.dirty_instances.size && "instance out of range");
+
+    // Every slice needs the instance's data, whenever it is next committed to.
+    render_mesh.dirty_instances.data[instance_index] = std::byte(0xFF);
+  }
+
+  std::vector<buffer> take_dirty_instance_data(render_program& render_program, uint32_t slice_index)
+  {
+    auto& dirty_instances = render_program.dirty_instances;
+    auto& instance_buffer = render_program.instance_buffer_back;
+    auto instance_size = static_cast<uint64_t>(render_program.instance_size);
+
+    // Instances are marked with every bit set, so the bits beyond the slices are cleared along with the slice's.
+    auto slice_bit = uint8_t(1 << slice_index);
+    auto slice_mask = static_cast<uint8_t>((1 << render_program.frames.frame_count) - 1);
+
+    auto taken = std::vector<buffer>();
+    for (auto instance_index = uint64_t(0); instance_index < dirty_instances.size;)
+    {
+      // Most instances are clean, so they are skipped a word at a time.
+      if (instance_index % sizeof(uint64_t) == 0 && instance_index + sizeof(uint64_t) <= dirty_instances.size)
+      {
+        auto word = uint64_t(0);
+        std::memcpy(&word, dirty_instances.data + instance_index, sizeof(uint64_t));
+        if (!word)
+        {
+          instance_index += sizeof(uint64_t);
+          continue;
+        }
+      }
+
+      auto dirty = static_cast<uint8_t>(dirty_instances.data[instance_index]);
+      if (dirty & slice_bit)
+      {
+        dirty_instances.data[instance_index] = static_cast<std::byte>(dirty & slice_mask & ~slice_bit);
+
+        auto data = instance_buffer.data + instance_index * instance_size;
+        if (!taken.empty() && taken.back().data + taken.back().size == data)
+        {
+          taken.back().size += instance_size;
+        }
+        else
+        {
+          taken.push_back({ .data = data, .size = instance_size });
+        }
+      }
+
+      instance_index++;
+    }
+
+    return taken;
+  }
 }
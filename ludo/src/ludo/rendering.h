@@ -15,6 +15,10 @@
 
 namespace ludo
 {
+  extern uint64_t committed_instance_bytes; ///< The number of bytes of instance data pushed to front buffers (see commit(render_program&)). Never reset by ludo, so it can be sampled e.g. per frame.
+  extern uint64_t render_state_call_count; ///< The number of graphics API state calls made when drawing (see use(render_program&) and commit_render_commands). Never reset by ludo, so it can be sampled e.g. per frame.
+  extern float frame_stall_time; ///< The time (in seconds) spent waiting for the GPU to finish with frames (see frame_ring). Never reset by ludo, so it can be sampled e.g. per frame.
+
   ///
   /// A fence.
   struct fence
@@ -22,15 +26,32 @@ namespace ludo
     uint64_t id = 0; ///< A unique identifier.
   };
 
+  ///
+  /// A ring of per-frame slices of a persistently mapped VRAM buffer.
+  /// Each slice has a fence, so the CPU only waits for the GPU when it is about to overwrite a slice that is still in use.
+  struct frame_ring
+  {
+    uint8_t frame_count = 3; ///< The number of frames that can be in flight.
+    uint64_t frame_size = 0; ///< The size (in bytes) of each slice. May be 0 if only the fences are needed.
+
+    ludo::buffer buffer; ///< The slices.
+    std::vector<fence> fences; ///< The fence of each slice (with an ID of 0 when the slice is not in flight).
+    uint32_t frame_index = 0; ///< The index of the current slice.
+
+    uint64_t stall_count = 0; ///< The number of times a slice was still in flight when it was needed.
+    float stall_time = 0.0f; ///< The time (in seconds) spent waiting for slices that were still in flight.
+  };
+
   ///
   /// A rendering context.
   struct rendering_context
   {
     uint64_t id = 0; ///< A unique identifier.
 
-    ludo::fence fence; ///< A fence used to determine when rendering is complete.
+    frame_ring frames = { .frame_count = 2 }; ///< Fences used to determine when rendering of each frame in flight is complete.
+    frame_ring compute_frames; ///< The context used to add render commands with compute programs, which is read back a frame later (see add_render_commands(rendering_context&, array<grid3>&, ...)).
 
-    double_buffer shader_buffer; ///< The data available to all render programs within the context.
+    double_buffer shader_buffer; ///< The data available to all render programs within the context. The front buffer has a slice for each of the frames.
   };
 
   ///
@@ -59,21 +80,48 @@ namespace ludo
     float range = 1000; ///< The distance that the light will reach.
   };
 
+  ///
+  /// A command to draw instances of a mesh (laid out as expected by indirect draw calls).
+  struct render_command
+  {
+    uint32_t index_count = 0; ///< The number of indices.
+    uint32_t instance_count = 1; ///< The number of instances.
+    uint32_t index_start = 0; ///< The first index.
+    uint32_t vertex_start = 0; ///< The offset added to each index.
+    uint32_t instance_start = 0; ///< The first instance.
+  };
+
+  ///
+  /// Statistics of merging render commands.
+  struct render_command_stats
+  {
+    uint32_t command_count_before = 0; ///< The number of active commands before merging.
+    uint32_t command_count_after = 0; ///< The number of active commands after merging.
+  };
+
   ///
   /// A program that executes a render pipeline.
   struct render_program
   {
     uint64_t id = 0; ///< A unique identifier.
+    uint64_t program_id = 0; ///< The ID of the compiled program (shared by render programs built from identical shader code).
 
     mesh_primitive primitive = mesh_primitive::TRIANGLE_LIST; ///< The primitive to render.
     vertex_format format; ///< The vertex format.
+    uint32_t index_size = sizeof(uint32_t); ///< The size in bytes of the indices of the meshes rendered (see mesh::index_size).
+    uint64_t vertex_array_id = 0; ///< The vertex array describing the vertex format (and the index and vertex buffers most recently drawn from).
+    uint64_t attached_index_buffer_id = 0; ///< The index buffer attached to the vertex array.
+    uint64_t attached_vertex_buffer_id = 0; ///< The vertex buffer attached to the vertex array.
 
-    buffer command_buffer; ///< The commands to be executed.
-    double_buffer shader_buffer; ///< The data available to this render program.
+    buffer command_buffer; ///< The commands to be executed, with a slice for each of the frames of the rendering context (see start_render_transaction).
+    double_buffer shader_buffer; ///< The data available to this render program. The front buffer is (re-)allocated with a slice for each of the frames when first committed.
 
-    buffer instance_buffer_front; ///< The committed instance data.
+    buffer instance_buffer_front; ///< The committed instance data, with a slice for each of the frames.
     heap instance_buffer_back; ///< The instance data.
     uint32_t instance_size = 0; ///< The size (in bytes) of the instance data per instance.
+    buffer dirty_instances; ///< A byte for each instance of the instance back buffer, with a bit for each slice of the instance front buffer that has yet to receive the instance's modified data (see mark_instance_dirty).
+
+    frame_ring frames = { .frame_count = 2 }; ///< Fences for the slices of the front buffers, which are committed to in turn so that a commit never overwrites data the GPU may still be reading. Must have at-least as many frames as the rendering context.
 
     range active_commands; ///< The active commands.
 
@@ -88,11 +136,12 @@ namespace ludo
     uint64_t render_program_id = 0; ///< The render program used to draw this mesh.
 
     range instances = { 0, 1 }; ///< The instances.
-    range indices; ///< The indices.
+    range indices; ///< The indices (in units of the index size of the mesh).
     range vertices; ///< The vertices.
 
     buffer instance_buffer; ///< The instance data.
     uint32_t instance_size = 0; ///< The size (in bytes) of the instance data per instance.
+    buffer dirty_instances; ///< The bytes of the render program's dirty_instances belonging to the instances of this render mesh.
   };
 
   ///
@@ -154,14 +203,16 @@ namespace ludo
   };
 
   ///
-  /// Starts a rendering transaction. Waits for the previous transaction to complete.
-  /// Must be called before any calls to commit_render_commands(...).
+  /// Starts a rendering transaction. Waits for the transaction the frame was last used by (see rendering_context::frames) to complete, if it is still in flight.
+  /// The active commands of each render program are moved to the slice of its command buffer for the frame.
+  /// Must be called before any render commands are added and before any calls to commit_render_commands(...).
   /// \param rendering_context The rendering context.
   /// \param render_programs The render programs that can be used in the transaction.
   void start_render_transaction(rendering_context& rendering_context, array<render_program>& render_programs);
 
   ///
   /// Commits render commands to the GPU.
+  /// Each render program is validated before it is drawn with, but only in debug builds.
   /// \param rendering_context The rendering context.
   /// \param render_programs The render programs to commit transactions for.
   /// \param render_commands The render commands to sample from.
@@ -174,6 +225,45 @@ namespace ludo
   /// \param rendering_context The rendering context.
   void commit_render_transaction(rendering_context& rendering_context);
 
+  ///
+  /// Initializes a frame ring. The slices are allocated in VRAM.
+  /// \param frame_ring The frame ring.
+  /// \param frame_size The size (in bytes) of each slice.
+  void init(frame_ring& frame_ring, uint64_t frame_size);
+
+  ///
+  /// De-initializes a frame ring.
+  /// \param frame_ring The frame ring.
+  void de_init(frame_ring& frame_ring);
+
+  ///
+  /// Moves on to the next slice of a frame ring, waiting for the GPU to finish with it if it is still in flight.
+  /// \param frame_ring The frame ring.
+  /// \return The slice (with the ID of the whole buffer, see frame_offset).
+  buffer next_frame(frame_ring& frame_ring);
+
+  ///
+  /// Waits for the GPU to finish with the slice of a frame ring before the current one e.g. to read back results written to it a frame ago (which rarely stalls).
+  /// \param frame_ring The frame ring.
+  /// \return The slice (with the ID of the whole buffer). Slices are zeroed when the frame ring is initialized.
+  buffer previous_frame(frame_ring& frame_ring);
+
+  ///
+  /// Determines the offset of the current slice within a frame ring's buffer e.g. for binding the slice.
+  /// \param frame_ring The frame ring.
+  /// \return The offset (in bytes).
+  uint64_t frame_offset(const frame_ring& frame_ring);
+
+  ///
+  /// Marks the current slice of a frame ring as in flight, until the GPU commands issued so far are complete.
+  /// \param frame_ring The frame ring.
+  void commit(frame_ring& frame_ring);
+
+  ///
+  /// Waits for the GPU to finish with the current slice of a frame ring e.g. to read back results written to it.
+  /// \param frame_ring The frame ring.
+  void wait(frame_ring& frame_ring);
+
   ///
   /// Initializes a fence.
   /// \param fence The fence.
@@ -189,6 +279,12 @@ namespace ludo
   /// \param fence The fence.
   void wait(fence& fence);
 
+  ///
+  /// Determines if a fence has been signaled i.e. if waiting for it would return immediately.
+  /// \param fence The fence.
+  /// \return True if the fence has been signaled, false otherwise.
+  bool signaled(const fence& fence);
+
   ///
   /// Initializes a rendering context.
   /// The shader buffer will be of the form <camera><light_count><light_0>...<light_n>
@@ -277,12 +373,13 @@ namespace ludo
   void de_init(render_program& render_program, heap& render_commands);
 
   ///
-  /// Commits the state of a render program to the front buffer.
+  /// Commits the state of a render program to the next slice of its front buffers, waiting for the GPU to finish with the slice if it is still in flight (see render_program::frames).
+  /// Only the instance data marked as dirty since the slice was last committed to is pushed (see mark_instance_dirty).
   /// \param render_program The render program.
   void commit(render_program& render_program);
 
   ///
-  /// Sets the current render program.
+  /// Sets the current render program, along with its vertex array.
   /// \param render_program The render program.
   void use(render_program& render_program);
 
@@ -292,6 +389,20 @@ namespace ludo
   /// \param render_mesh The render mesh.
   void add_render_command(render_program& render_program, const render_mesh& render_mesh);
 
+  ///
+  /// Sorts the active render commands of a render program by mesh (index start, then vertex start) and merges the commands of each mesh
+  /// with adjacent instance ranges (i.e. where one command's instances start immediately after the previous command's end) into a single command.
+  /// The commands are drawn in a different order afterwards, so this should not be used for render programs that depend on draw order (e.g. blending).
+  /// \param render_program The render program.
+  /// \return The number of active commands before and after merging.
+  render_command_stats merge_render_commands(render_program& render_program);
+
+  ///
+  /// Sorts and merges the active render commands of render programs. See merge_render_commands(render_program&).
+  /// \param render_programs The render programs.
+  /// \return The total number of active commands before and after merging.
+  render_command_stats merge_render_commands(array<render_program>& render_programs);
+
   ///
   /// Builds the default vertex shader code for a vertex format.
   /// \param format The vertex format.
@@ -359,11 +470,17 @@ namespace ludo
   /// \param render_mesh The transform to retrieve.
   /// \param instance_index The index of the instance to retrieve the transform for.
   /// \return The transform.
-  mat4& instance_transform(render_mesh& render_mesh, uint32_t instance_index = 0);
   const mat4& instance_transform(const render_mesh& render_mesh, uint32_t instance_index = 0);
 
   ///
-  /// Sets the texture of a render mesh.
+  /// Sets the transform of a render mesh. Marks the instance as dirty (see mark_instance_dirty).
+  /// \param render_mesh The render mesh.
+  /// \param transform The transform.
+  /// \param instance_index The index of the instance to set the transform for.
+  void set_instance_transform(render_mesh& render_mesh, const mat4& transform, uint32_t instance_index = 0);
+
+  ///
+  /// Sets the texture of a render mesh. Marks the instance as dirty (see mark_instance_dirty).
   /// \param render_mesh The render mesh.
   /// \param texture The texture.
   /// \param instance_index The index of the instance to set the texture for.
@@ -371,12 +488,29 @@ namespace ludo
 
   ///
   /// Retrieves the bone transforms from a render mesh.
+  /// Unless the render mesh is const, the bone transforms are expected to be written to, so the instance is marked as dirty (see mark_instance_dirty).
   /// \param render_mesh The render mesh.
   /// \param instance_index The index of the instance to retrieve the bone transforms for.
   /// \return The bone transforms.
   ludo::mat4* instance_bone_transforms(render_mesh& render_mesh, uint32_t instance_index = 0);
   const ludo::mat4* instance_bone_transforms(const render_mesh& render_mesh, uint32_t instance_index = 0);
 
+  ///
+  /// Marks an instance of a render mesh as dirty so that it is pushed to each slice of the front buffer at the next commits of its render program.
+  /// The instance setters mark instances themselves, so this is only needed when writing to the instance buffer directly.
+  /// Marking only sets the instance's byte of the render program's dirty_instances, so different instances can be marked from different threads.
+  /// \param render_mesh The render mesh.
+  /// \param instance_index The index of the instance.
+  void mark_instance_dirty(const render_mesh& render_mesh, uint32_t instance_index = 0);
+
+  ///
+  /// Removes the dirty instance data of a render program for a slice of its instance front buffer, merging adjacent instances.
+  /// The instances stay dirty for the other slices until they are taken for them as well.
+  /// \param render_program The render program.
+  /// \param slice_index The index of the slice.
+  /// \return The dirty instance data (within the render program's instance back buffer), in order.
+  std::vector<buffer> take_dirty_instance_data(render_program& render_program, uint32_t slice_index);
+
   ///
   /// Initializes a frame buffer.
   /// \param frame_buffer The frame buffer.
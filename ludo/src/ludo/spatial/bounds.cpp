@@ -4,6 +4,7 @@
 
 #include <limits>
 
+#include "../meshes/packing.h"
 #include "bounds.h"
 
 namespace ludo
@@ -17,9 +18,10 @@ namespace ludo
       .max = vec3(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest())
     };
 
-    for (auto vertex_position = 0; vertex_position < mesh.vertex_buffer.size; vertex_position += format.size)
+    auto vertex_count = static_cast<uint32_t>(mesh.vertex_buffer.size / format.size);
+    for (auto vertex_index = uint32_t(0); vertex_index < vertex_count; vertex_index++)
     {
-      auto position = cast<ludo::vec3>(mesh.vertex_buffer, vertex_position + format.position_offset);
+      auto position = read_position(mesh, format, vertex_index);
 
       bounds.min =
       {
@@ -95,4 +97,66 @@ namespace ludo
       std::abs(center_a[1] - center_b[1]) < (half_dimensions_a[1] + half_dimensions_b[1]) &&
       std::abs(center_a[2] - center_b[2]) < (half_dimensions_a[2] + half_dimensions_b[2]);
   }
+
+  bool intersect(const aabb3& bounds, const vec3& center, float radius)
+  {
+    return distance2(bounds, center) <= radius * radius;
+  }
+
+  // Based on https://tavianator.com/2011/ray_box.html
+  bool intersect(const aabb3& bounds, const vec3& origin, const vec3& direction, float& distance)
+  {
+    auto entry_distance = 0.0f;
+    auto exit_distance = std::numeric_limits<float>::max();
+
+    for (auto dimension = 0; dimension < 3; dimension++)
+    {
+      if (direction[dimension] == 0.0f)
+      {
+        // The ray is parallel to this slab so it must start within it.
+        if (origin[dimension] < bounds.min[dimension] || origin[dimension] > bounds.max[dimension])
+        {
+          return false;
+        }
+
+        continue;
+      }
+
+      auto inverse_direction = 1.0f / direction[dimension];
+      auto distance_min = (bounds.min[dimension] - origin[dimension]) * inverse_direction;
+      auto distance_max = (bounds.max[dimension] - origin[dimension]) * inverse_direction;
+
+      entry_distance = std::max(entry_distance, std::min(distance_min, distance_max));
+      exit_distance = std::min(exit_distance, std::max(distance_min, distance_max));
+
+      if (entry_distance > exit_distance)
+      {
+        return false;
+      }
+    }
+
+    distance = entry_distance;
+    return true;
+  }
+
+  float distance2(const aabb3& bounds, const vec3& position)
+  {
+    auto distance2 = 0.0f;
+
+    for (auto dimension = 0; dimension < 3; dimension++)
+    {
+      if (position[dimension] < bounds.min[dimension])
+      {
+        auto difference = bounds.min[dimension] - position[dimension];
+        distance2 += difference * difference;
+      }
+      else if (position[dimension] > bounds.max[dimension])
+      {
+        auto difference = position[dimension] - bounds.max[dimension];
+        distance2 += difference * difference;
+      }
+    }
+
+    return distance2;
+  }
 }
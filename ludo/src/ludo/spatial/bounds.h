@@ -54,4 +54,28 @@ namespace ludo
   /// \return True if the AABBs intersect, false otherwise.
   bool intersect(const aabb2& a, const aabb2& b);
   bool intersect(const aabb3& a, const aabb3& b);
+
+  ///
+  /// Determines whether a sphere intersects an AABB.
+  /// \param bounds The AABB.
+  /// \param center The center of the sphere.
+  /// \param radius The radius of the sphere.
+  /// \return True if the sphere and AABB intersect, false otherwise.
+  bool intersect(const aabb3& bounds, const vec3& center, float radius);
+
+  ///
+  /// Determines whether a ray intersects an AABB.
+  /// \param bounds The AABB.
+  /// \param origin The origin of the ray.
+  /// \param direction The direction of the ray (must be unit length).
+  /// \param distance The distance along the ray to the first intersection (0 if the origin is within the AABB).
+  /// \return True if the ray and AABB intersect, false otherwise.
+  bool intersect(const aabb3& bounds, const vec3& origin, const vec3& direction, float& distance);
+
+  ///
+  /// Calculates the squared distance from a position to the closest point within an AABB.
+  /// \param bounds The AABB.
+  /// \param position The position.
+  /// \return The squared distance (0 if the position is within the AABB).
+  float distance2(const aabb3& bounds, const vec3& position);
 }
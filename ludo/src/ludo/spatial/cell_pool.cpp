@@ -0,0 +1,275 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cstring>
+
+#include "../thread_pool.h"
+#include "cell_pool.h"
+
+namespace ludo
+{
+  uint32_t allocate_block(cell_pool& pool, buffer& buffer);
+  uint64_t block_offset(const cell_pool& pool, uint32_t block_index);
+  uint32_t& entry_count(buffer& buffer, uint64_t block_offset);
+  uint32_t& next_block(buffer& buffer, uint64_t block_offset);
+
+  buffer init(cell_pool& pool)
+  {
+    assert(pool.capacity > 0 && "capacity must be greater than 0");
+
+    pool.block_count = pool.cell_count;
+    pool.first_free_block = 0;
+
+    auto buffer = allocate(pool.cell_count * block_size(pool));
+    for (auto cell_index = uint32_t(0); cell_index < pool.cell_count; cell_index++)
+    {
+      entry_count(buffer, block_offset(pool, cell_index)) = 0;
+      next_block(buffer, block_offset(pool, cell_index)) = 0;
+    }
+
+    return buffer;
+  }
+
+  buffer init(cell_pool& pool, const std::vector<uint32_t>& cell_indices, const std::function<void(buffer& buffer, uint64_t offset, uint32_t entry_index)>& write)
+  {
+    assert(pool.capacity > 0 && "capacity must be greater than 0");
+
+    auto total_entry_count = static_cast<uint32_t>(cell_indices.size());
+
+    // Each batch counts its entries per cell separately so that the counting sort doesn't need any synchronization.
+    // The number of batches is limited so that the per-batch counts don't outweigh the entries themselves.
+    auto batch_count = std::max(uint32_t(1), std::min(thread_pool_size() + 1, total_entry_count / std::max(pool.cell_count, uint32_t(1024))));
+    auto batch_size = (total_entry_count + batch_count - 1) / batch_count;
+    auto batch_cell_offsets = std::vector<std::vector<uint32_t>>(batch_count, std::vector<uint32_t>(pool.cell_count));
+
+    thread_pool_parallel_for(batch_count, [&](uint32_t batch_index)
+    {
+      auto& cell_counts = batch_cell_offsets[batch_index];
+      for (auto entry_index = batch_index * batch_size; entry_index < std::min((batch_index + 1) * batch_size, total_entry_count); entry_index++)
+      {
+        assert(cell_indices[entry_index] < pool.cell_count && "cell index out of range");
+        cell_counts[cell_indices[entry_index]]++;
+      }
+    });
+
+    // Turn the counts into the offset of each batch's first entry of each cell (within the sorted entries).
+    auto cell_starts = std::vector<uint32_t>(pool.cell_count + 1);
+    auto start = uint32_t(0);
+    for (auto cell_index = uint32_t(0); cell_index < pool.cell_count; cell_index++)
+    {
+      cell_starts[cell_index] = start;
+      for (auto& cell_offsets : batch_cell_offsets)
+      {
+        auto cell_count = cell_offsets[cell_index];
+        cell_offsets[cell_index] = start;
+        start += cell_count;
+      }
+    }
+    cell_starts[pool.cell_count] = start;
+
+    auto sorted_entry_indices = std::vector<uint32_t>(total_entry_count);
+    thread_pool_parallel_for(batch_count, [&](uint32_t batch_index)
+    {
+      auto& cell_offsets = batch_cell_offsets[batch_index];
+      for (auto entry_index = batch_index * batch_size; entry_index < std::min((batch_index + 1) * batch_size, total_entry_count); entry_index++)
+      {
+        sorted_entry_indices[cell_offsets[cell_indices[entry_index]]++] = entry_index;
+      }
+    });
+
+    // The overflow blocks of each cell are contiguous, so the chain of a cell can be built without consulting the other cells.
+    pool.block_count = pool.cell_count;
+    pool.first_free_block = 0;
+
+    auto first_overflow_blocks = std::vector<uint32_t>(pool.cell_count);
+    for (auto cell_index = uint32_t(0); cell_index < pool.cell_count; cell_index++)
+    {
+      auto cell_entry_count = cell_starts[cell_index + 1] - cell_starts[cell_index];
+
+      first_overflow_blocks[cell_index] = pool.block_count;
+      if (cell_entry_count > pool.capacity)
+      {
+        pool.block_count += (cell_entry_count - 1) / pool.capacity;
+      }
+    }
+
+    auto buffer = allocate(used_size(pool));
+
+    auto cell_batch_count = std::max(uint32_t(1), std::min(thread_pool_size() + 1, pool.cell_count));
+    auto cell_batch_size = (pool.cell_count + cell_batch_count - 1) / cell_batch_count;
+    thread_pool_parallel_for(cell_batch_count, [&](uint32_t batch_index)
+    {
+      for (auto cell_index = batch_index * cell_batch_size; cell_index < std::min((batch_index + 1) * cell_batch_size, pool.cell_count); cell_index++)
+      {
+        auto sorted_index = cell_starts[cell_index];
+        auto remaining_entry_count = cell_starts[cell_index + 1] - sorted_index;
+
+        auto block_index = cell_index;
+        auto overflow_block_index = first_overflow_blocks[cell_index];
+        do
+        {
+          auto offset = block_offset(pool, block_index);
+          auto block_entry_count = std::min(remaining_entry_count, pool.capacity);
+          remaining_entry_count -= block_entry_count;
+
+          entry_count(buffer, offset) = block_entry_count;
+          next_block(buffer, offset) = remaining_entry_count > 0 ? overflow_block_index : 0;
+
+          for (auto entry_index = uint32_t(0); entry_index < block_entry_count; entry_index++)
+          {
+            write(buffer, offset + pool.header_size + entry_index * pool.entry_size, sorted_entry_indices[sorted_index++]);
+          }
+
+          block_index = overflow_block_index++;
+        }
+        while (remaining_entry_count > 0);
+      }
+    });
+
+    return buffer;
+  }
+
+  uint64_t add(cell_pool& pool, buffer& buffer, uint32_t cell_index)
+  {
+    assert(cell_index < pool.cell_count && "cell index out of range");
+
+    auto offset = block_offset(pool, cell_index);
+    while (next_block(buffer, offset) != 0)
+    {
+      offset = block_offset(pool, next_block(buffer, offset));
+    }
+
+    if (entry_count(buffer, offset) == pool.capacity)
+    {
+      // The buffer may be re-allocated, so only the offset of the last block can be relied upon.
+      auto overflow_block_index = allocate_block(pool, buffer);
+      next_block(buffer, offset) = overflow_block_index;
+      offset = block_offset(pool, overflow_block_index);
+    }
+
+    auto entry_index = entry_count(buffer, offset)++;
+
+    return offset + pool.header_size + entry_index * pool.entry_size;
+  }
+
+  bool remove(cell_pool& pool, buffer& buffer, uint32_t cell_index, uint32_t slot)
+  {
+    assert(cell_index < pool.cell_count && "cell index out of range");
+
+    // Find the last block (and the one before it so that the last block can be unlinked if it becomes empty).
+    auto previous_offset = uint64_t(0);
+    auto offset = block_offset(pool, cell_index);
+    while (next_block(buffer, offset) != 0)
+    {
+      previous_offset = offset;
+      offset = block_offset(pool, next_block(buffer, offset));
+    }
+
+    auto removed_offset = entry_offset(pool, buffer, cell_index, slot);
+    auto last_offset = offset + pool.header_size + (entry_count(buffer, offset) - 1) * pool.entry_size;
+
+    // The order of entries within a cell doesn't matter, so the gap is filled with the last entry instead of shifting the rest.
+    auto moved = removed_offset != last_offset;
+    if (moved)
+    {
+      std::memcpy(buffer.data + removed_offset, buffer.data + last_offset, pool.entry_size);
+    }
+
+    entry_count(buffer, offset)--;
+
+    if (entry_count(buffer, offset) == 0 && offset != block_offset(pool, cell_index))
+    {
+      auto block_index = next_block(buffer, previous_offset);
+      next_block(buffer, previous_offset) = 0;
+
+      next_block(buffer, offset) = pool.first_free_block;
+      pool.first_free_block = block_index;
+    }
+
+    return moved;
+  }
+
+  uint32_t count(const cell_pool& pool, const buffer& buffer, uint32_t cell_index)
+  {
+    auto count = uint32_t(0);
+
+    auto block_index = cell_index;
+    do
+    {
+      auto offset = block_offset(pool, block_index);
+      count += cast<uint32_t>(buffer, offset);
+      block_index = cast<uint32_t>(buffer, offset + sizeof(uint32_t));
+    }
+    while (block_index != 0);
+
+    return count;
+  }
+
+  uint64_t entry_offset(const cell_pool& pool, const buffer& buffer, uint32_t cell_index, uint32_t slot)
+  {
+    // Every block other than the last is full, so the block containing the slot can be found by skipping whole blocks.
+    auto offset = block_offset(pool, cell_index);
+    while (slot >= pool.capacity)
+    {
+      offset = block_offset(pool, cast<uint32_t>(buffer, offset + sizeof(uint32_t)));
+      slot -= pool.capacity;
+    }
+
+    assert(slot < cast<uint32_t>(buffer, offset) && "slot out of range");
+
+    return offset + pool.header_size + slot * pool.entry_size;
+  }
+
+  uint64_t used_size(const cell_pool& pool)
+  {
+    return pool.block_count * block_size(pool);
+  }
+
+  uint32_t allocate_block(cell_pool& pool, buffer& buffer)
+  {
+    auto block_index = pool.first_free_block;
+    if (block_index != 0)
+    {
+      pool.first_free_block = next_block(buffer, block_offset(pool, block_index));
+    }
+    else
+    {
+      block_index = pool.block_count++;
+
+      if (used_size(pool) > buffer.size)
+      {
+        // Grow geometrically so that the cost of copying is amortized.
+        auto new_buffer = allocate(std::max(used_size(pool), 2 * buffer.size));
+        std::memcpy(new_buffer.data, buffer.data, buffer.size);
+        deallocate(buffer);
+        buffer = new_buffer;
+      }
+    }
+
+    entry_count(buffer, block_offset(pool, block_index)) = 0;
+    next_block(buffer, block_offset(pool, block_index)) = 0;
+
+    return block_index;
+  }
+
+  uint64_t block_offset(const cell_pool& pool, uint32_t block_index)
+  {
+    return block_index * block_size(pool);
+  }
+
+  uint64_t block_size(const cell_pool& pool)
+  {
+    return pool.header_size + pool.capacity * pool.entry_size;
+  }
+
+  uint32_t& entry_count(buffer& buffer, uint64_t block_offset)
+  {
+    return cast<uint32_t>(buffer, block_offset);
+  }
+
+  uint32_t& next_block(buffer& buffer, uint64_t block_offset)
+  {
+    return cast<uint32_t>(buffer, block_offset + sizeof(uint32_t));
+  }
+}
@@ -0,0 +1,113 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "../data/buffers.h"
+
+namespace ludo
+{
+  ///
+  /// The layout of fixed-capacity cells within a buffer, where cells that are full spill into overflow blocks from a shared pool.
+  /// Each block (cell or overflow block) is a header of { uint32_t count, uint32_t next_block } followed by capacity entries.
+  /// The cells are the first blocks in the buffer and overflow blocks follow them, with the buffer growing as more are needed.
+  /// A next_block of 0 ends a chain (block 0 is always a cell, so it can never be an overflow block).
+  /// Only the last block of a chain can be partially filled.
+  struct cell_pool
+  {
+    uint32_t cell_count = 0; ///< The number of cells.
+    uint32_t capacity = 1; ///< The number of entries in each block.
+    uint32_t entry_size = 0; ///< The size of each entry (in bytes).
+    uint32_t header_size = 2 * sizeof(uint32_t); ///< The size of the header of each block (in bytes). Can be increased to align the entries.
+
+    uint32_t block_count = 0; ///< The number of blocks in use or available for re-use (including the cells).
+    uint32_t first_free_block = 0; ///< The first overflow block available for re-use (0 if there are none).
+  };
+
+  ///
+  /// Initializes a cell pool and allocates a buffer with enough space for its cells (and no overflow blocks).
+  /// \param pool The cell pool.
+  /// \return The buffer.
+  buffer init(cell_pool& pool);
+
+  ///
+  /// Initializes a cell pool and allocates a buffer containing a set of entries, grouped by cell.
+  /// The entries are counting sorted by cell in parallel (see thread_pool_parallel_for) and each cell is then written in a single pass,
+  /// with the overflow blocks of the cells following the cells in cell order. This is much cheaper than adding the entries one at a time.
+  /// \param pool The cell pool.
+  /// \param cell_indices The index of the cell of each entry.
+  /// \param write The function used to write an entry, given the buffer, the offset of the entry within the buffer and the index of the entry (within cell_indices). Called in parallel.
+  /// \return The buffer.
+  buffer init(cell_pool& pool, const std::vector<uint32_t>& cell_indices, const std::function<void(buffer& buffer, uint64_t offset, uint32_t entry_index)>& write);
+
+  ///
+  /// Adds an entry to the end of a cell, taking an overflow block from the pool (and growing the buffer if needed) if the cell is full.
+  /// \param pool The cell pool.
+  /// \param buffer The buffer containing the cells. May be re-allocated.
+  /// \param cell_index The index of the cell.
+  /// \return The offset of the entry within the buffer (the entry itself is not initialized).
+  uint64_t add(cell_pool& pool, buffer& buffer, uint32_t cell_index);
+
+  ///
+  /// Removes an entry from a cell. The gap is filled by moving the last entry of the cell into it and
+  /// overflow blocks that become empty are returned to the pool.
+  /// \param pool The cell pool.
+  /// \param buffer The buffer containing the cells.
+  /// \param cell_index The index of the cell.
+  /// \param slot The index of the entry within the cell.
+  /// \return True if the last entry of the cell was moved into the slot, false otherwise.
+  bool remove(cell_pool& pool, buffer& buffer, uint32_t cell_index, uint32_t slot);
+
+  ///
+  /// Counts the entries within a cell.
+  /// \param pool The cell pool.
+  /// \param buffer The buffer containing the cells.
+  /// \param cell_index The index of the cell.
+  /// \return The number of entries.
+  uint32_t count(const cell_pool& pool, const buffer& buffer, uint32_t cell_index);
+
+  ///
+  /// Determines the offset of an entry within a cell.
+  /// \param pool The cell pool.
+  /// \param buffer The buffer containing the cells.
+  /// \param cell_index The index of the cell.
+  /// \param slot The index of the entry within the cell.
+  /// \return The offset of the entry within the buffer.
+  uint64_t entry_offset(const cell_pool& pool, const buffer& buffer, uint32_t cell_index, uint32_t slot);
+
+  ///
+  /// Determines the size of the blocks that are in use or available for re-use i.e. the portion of the buffer that needs to be copied.
+  /// \param pool The cell pool.
+  /// \return The size (in bytes).
+  uint64_t used_size(const cell_pool& pool);
+
+  ///
+  /// Determines the size of each block (cell or overflow block), including its header.
+  /// \param pool The cell pool.
+  /// \return The size (in bytes).
+  uint64_t block_size(const cell_pool& pool);
+
+  ///
+  /// Calls a function for each block (the cell and its overflow blocks) of a cell.
+  /// \param pool The cell pool.
+  /// \param buffer The buffer containing the cells.
+  /// \param cell_index The index of the cell.
+  /// \param function The function to call with the index of each block.
+  template<typename F>
+  void for_each_block(const cell_pool& pool, const buffer& buffer, uint32_t cell_index, F&& function);
+
+  ///
+  /// Calls a function for each entry within a cell.
+  /// \param pool The cell pool.
+  /// \param buffer The buffer containing the cells.
+  /// \param cell_index The index of the cell.
+  /// \param function The function to call with the offset of each entry within the buffer.
+  template<typename F>
+  void for_each_entry(const cell_pool& pool, const buffer& buffer, uint32_t cell_index, F&& function);
+}
+
+#include "cell_pool.hpp"
@@ -0,0 +1,41 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+namespace ludo
+{
+  template<typename F>
+  void for_each_entry(const cell_pool& pool, const buffer& buffer, uint32_t cell_index, F&& function)
+  {
+    auto block_size = pool.header_size + pool.capacity * pool.entry_size;
+
+    auto block_index = cell_index;
+    do
+    {
+      auto block_offset = uint64_t(block_index) * block_size;
+      auto entry_count = cast<uint32_t>(buffer, block_offset);
+
+      for (auto entry_index = uint32_t(0); entry_index < entry_count; entry_index++)
+      {
+        function(block_offset + pool.header_size + entry_index * pool.entry_size);
+      }
+
+      block_index = cast<uint32_t>(buffer, block_offset + sizeof(uint32_t));
+    }
+    while (block_index != 0);
+  }
+
+  template<typename F>
+  void for_each_block(const cell_pool& pool, const buffer& buffer, uint32_t cell_index, F&& function)
+  {
+    auto block_size = pool.header_size + pool.capacity * pool.entry_size;
+
+    auto block_index = cell_index;
+    do
+    {
+      function(block_index);
+      block_index = cast<uint32_t>(buffer, uint64_t(block_index) * block_size + sizeof(uint32_t));
+    }
+    while (block_index != 0);
+  }
+}
@@ -0,0 +1,296 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "frustum.h"
+
+namespace ludo
+{
+#if defined(__AVX__)
+  // A batch of 8 floats.
+  struct frustum_batch
+  {
+    static const auto width = uint32_t(8);
+    static const auto all = 0xff;
+
+    __m256 value;
+
+    static frustum_batch load(const float* values) { return { _mm256_loadu_ps(values) }; }
+    static frustum_batch set(float value) { return { _mm256_set1_ps(value) }; }
+    static frustum_batch zero() { return { _mm256_setzero_ps() }; }
+    static int32_t mask(const frustum_batch& batch) { return _mm256_movemask_ps(batch.value); }
+  };
+
+  inline frustum_batch operator+(const frustum_batch& lhs, const frustum_batch& rhs) { return { _mm256_add_ps(lhs.value, rhs.value) }; }
+  inline frustum_batch operator*(const frustum_batch& lhs, const frustum_batch& rhs) { return { _mm256_mul_ps(lhs.value, rhs.value) }; }
+  inline frustum_batch operator|(const frustum_batch& lhs, const frustum_batch& rhs) { return { _mm256_or_ps(lhs.value, rhs.value) }; }
+  inline frustum_batch operator<(const frustum_batch& lhs, const frustum_batch& rhs) { return { _mm256_cmp_ps(lhs.value, rhs.value, _CMP_LT_OQ) }; }
+#elif defined(__SSE2__) || defined(_M_X64)
+  // A batch of 4 floats.
+  struct frustum_batch
+  {
+    static const auto width = uint32_t(4);
+    static const auto all = 0xf;
+
+    __m128 value;
+
+    static frustum_batch load(const float* values) { return { _mm_loadu_ps(values) }; }
+    static frustum_batch set(float value) { return { _mm_set1_ps(value) }; }
+    static frustum_batch zero() { return { _mm_setzero_ps() }; }
+    static int32_t mask(const frustum_batch& batch) { return _mm_movemask_ps(batch.value); }
+  };
+
+  inline frustum_batch operator+(const frustum_batch& lhs, const frustum_batch& rhs) { return { _mm_add_ps(lhs.value, rhs.value) }; }
+  inline frustum_batch operator*(const frustum_batch& lhs, const frustum_batch& rhs) { return { _mm_mul_ps(lhs.value, rhs.value) }; }
+  inline frustum_batch operator|(const frustum_batch& lhs, const frustum_batch& rhs) { return { _mm_or_ps(lhs.value, rhs.value) }; }
+  inline frustum_batch operator<(const frustum_batch& lhs, const frustum_batch& rhs) { return { _mm_cmplt_ps(lhs.value, rhs.value) }; }
+#endif
+
+  std::vector<int8_t> frustum_test(const std::array<vec4, 6>& planes, const aabb3_soa& bounds, std::vector<uint8_t>* plane_hints);
+  std::array<vec4, 6> normalized(const std::array<vec4, 6>& planes);
+
+  // Based on https://old.cescg.org/CESCG-2002/DSykoraJJelinek/index.html
+  int32_t frustum_test(const std::array<vec4, 6>& planes, const aabb3& bounds)
+  {
+    auto result = 1;
+
+    for (auto& plane : planes)
+    {
+      // This is the vertex that would be closest to the plane if the AABB is fully within the negative halfspace (the p-vertex).
+      // If this vertex is indeed in the negative halfspace, all other vertices of the AABB must also be in the negative halfspace.
+      auto closest_negative = vec4
+      {
+        plane[0] > 0.0f ? bounds.max[0] : bounds.min[0],
+        plane[1] > 0.0f ? bounds.max[1] : bounds.min[1],
+        plane[2] > 0.0f ? bounds.max[2] : bounds.min[2],
+        1.0f
+      };
+
+      if (dot(plane, closest_negative) < 0.0f)
+      {
+        return -1;
+      }
+
+      // This is the vertex that would be closest to the plane if the AABB is fully within the positive halfspace (the n-vertex).
+      // If this vertex is actually in the negative halfspace, the AABB intersects the plane.
+      // Unlike the GLSL version, the remaining planes must still be checked since they could reject the AABB entirely.
+      auto closest_positive = vec4
+      {
+        plane[0] > 0.0f ? bounds.min[0] : bounds.max[0],
+        plane[1] > 0.0f ? bounds.min[1] : bounds.max[1],
+        plane[2] > 0.0f ? bounds.min[2] : bounds.max[2],
+        1.0f
+      };
+
+      if (dot(plane, closest_positive) < 0.0f)
+      {
+        result = 0;
+      }
+    }
+
+    return result;
+  }
+
+  int32_t frustum_test(const std::array<vec4, 6>& planes, const vec3& center, float radius)
+  {
+    auto result = 1;
+
+    // The planes must be normalized for the distances to be comparable to the radius.
+    for (auto& plane : normalized(planes))
+    {
+      auto distance = dot(plane, vec4 { center[0], center[1], center[2], 1.0f });
+      if (distance < -radius)
+      {
+        return -1;
+      }
+
+      if (distance < radius)
+      {
+        result = 0;
+      }
+    }
+
+    return result;
+  }
+
+  std::vector<int8_t> frustum_test(const std::array<vec4, 6>& planes, const aabb3_soa& bounds)
+  {
+    return frustum_test(planes, bounds, nullptr);
+  }
+
+  std::vector<int8_t> frustum_test(const std::array<vec4, 6>& planes, const aabb3_soa& bounds, std::vector<uint8_t>& plane_hints)
+  {
+    plane_hints.resize(bounds.min_x.size());
+
+    return frustum_test(planes, bounds, &plane_hints);
+  }
+
+  std::vector<int8_t> frustum_test(const std::array<vec4, 6>& planes, const aabb3_soa& bounds, std::vector<uint8_t>* plane_hints)
+  {
+    auto count = static_cast<uint32_t>(bounds.min_x.size());
+    auto results = std::vector<int8_t>(count);
+
+    // The octant of each plane's normal determines which of the min/max coordinates form its p-vertex and n-vertex (see frustum_test(planes, aabb3)).
+    // Since this is the same for every AABB, it is resolved to arrays once rather than per AABB.
+    auto p_vertices = std::array<std::array<const float*, 3>, 6>();
+    auto n_vertices = std::array<std::array<const float*, 3>, 6>();
+    for (auto plane_index = uint32_t(0); plane_index < 6; plane_index++)
+    {
+      auto& plane = planes[plane_index];
+      p_vertices[plane_index] = { plane[0] > 0.0f ? bounds.max_x.data() : bounds.min_x.data(), plane[1] > 0.0f ? bounds.max_y.data() : bounds.min_y.data(), plane[2] > 0.0f ? bounds.max_z.data() : bounds.min_z.data() };
+      n_vertices[plane_index] = { plane[0] > 0.0f ? bounds.min_x.data() : bounds.max_x.data(), plane[1] > 0.0f ? bounds.min_y.data() : bounds.max_y.data(), plane[2] > 0.0f ? bounds.min_z.data() : bounds.max_z.data() };
+    }
+
+    auto index = uint32_t(0);
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+    for (; index + frustum_batch::width <= count; index += frustum_batch::width)
+    {
+      auto outside = frustum_batch::zero();
+      auto intersecting = frustum_batch::zero();
+
+      auto first_plane_index = plane_hints ? uint32_t((*plane_hints)[index]) : uint32_t(0);
+      for (auto plane_offset = uint32_t(0); plane_offset < 6; plane_offset++)
+      {
+        auto plane_index = (first_plane_index + plane_offset) % 6;
+        auto& plane = planes[plane_index];
+        auto& p_vertex = p_vertices[plane_index];
+        auto& n_vertex = n_vertices[plane_index];
+
+        // Same order of operations as dot(plane, vertex) so that the results match the single AABB test exactly.
+        auto p_distance = frustum_batch::set(plane[0]) * frustum_batch::load(p_vertex[0] + index) + frustum_batch::set(plane[1]) * frustum_batch::load(p_vertex[1] + index) + frustum_batch::set(plane[2]) * frustum_batch::load(p_vertex[2] + index) + frustum_batch::set(plane[3]);
+        auto n_distance = frustum_batch::set(plane[0]) * frustum_batch::load(n_vertex[0] + index) + frustum_batch::set(plane[1]) * frustum_batch::load(n_vertex[1] + index) + frustum_batch::set(plane[2]) * frustum_batch::load(n_vertex[2] + index) + frustum_batch::set(plane[3]);
+
+        auto previous_outside_mask = frustum_batch::mask(outside);
+        outside = outside | (p_distance < frustum_batch::zero());
+        intersecting = intersecting | (n_distance < frustum_batch::zero());
+
+        auto outside_mask = frustum_batch::mask(outside);
+        if (plane_hints && outside_mask != previous_outside_mask)
+        {
+          for (auto lane = uint32_t(0); lane < frustum_batch::width; lane++)
+          {
+            if ((outside_mask & ~previous_outside_mask) & (1 << lane))
+            {
+              (*plane_hints)[index + lane] = static_cast<uint8_t>(plane_index);
+            }
+          }
+        }
+
+        if (outside_mask == frustum_batch::all)
+        {
+          break;
+        }
+      }
+
+      auto outside_mask = frustum_batch::mask(outside);
+      auto intersecting_mask = frustum_batch::mask(intersecting);
+      for (auto lane = uint32_t(0); lane < frustum_batch::width; lane++)
+      {
+        results[index + lane] = (outside_mask & (1 << lane)) ? -1 : (intersecting_mask & (1 << lane)) ? 0 : 1;
+      }
+    }
+#endif
+
+    for (; index < count; index++)
+    {
+      auto result = int8_t(1);
+
+      auto first_plane_index = plane_hints ? uint32_t((*plane_hints)[index]) : uint32_t(0);
+      for (auto plane_offset = uint32_t(0); plane_offset < 6; plane_offset++)
+      {
+        auto plane_index = (first_plane_index + plane_offset) % 6;
+        auto& plane = planes[plane_index];
+        auto& p_vertex = p_vertices[plane_index];
+        auto& n_vertex = n_vertices[plane_index];
+
+        if (dot(plane, vec4 { p_vertex[0][index], p_vertex[1][index], p_vertex[2][index], 1.0f }) < 0.0f)
+        {
+          result = -1;
+          if (plane_hints)
+          {
+            (*plane_hints)[index] = static_cast<uint8_t>(plane_index);
+          }
+
+          break;
+        }
+
+        if (dot(plane, vec4 { n_vertex[0][index], n_vertex[1][index], n_vertex[2][index], 1.0f }) < 0.0f)
+        {
+          result = 0;
+        }
+      }
+
+      results[index] = result;
+    }
+
+    return results;
+  }
+
+  std::vector<int8_t> frustum_test(const std::array<vec4, 6>& planes, const sphere_soa& spheres)
+  {
+    auto count = static_cast<uint32_t>(spheres.center_x.size());
+    auto results = std::vector<int8_t>(count);
+
+    auto normalized_planes = normalized(planes);
+
+    auto index = uint32_t(0);
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+    for (; index + frustum_batch::width <= count; index += frustum_batch::width)
+    {
+      auto center_x = frustum_batch::load(spheres.center_x.data() + index);
+      auto center_y = frustum_batch::load(spheres.center_y.data() + index);
+      auto center_z = frustum_batch::load(spheres.center_z.data() + index);
+      auto radius = frustum_batch::load(spheres.radius.data() + index);
+      auto negative_radius = frustum_batch::set(-1.0f) * radius;
+
+      auto outside = frustum_batch::zero();
+      auto intersecting = frustum_batch::zero();
+      for (auto& plane : normalized_planes)
+      {
+        auto distance = frustum_batch::set(plane[0]) * center_x + frustum_batch::set(plane[1]) * center_y + frustum_batch::set(plane[2]) * center_z + frustum_batch::set(plane[3]);
+
+        outside = outside | (distance < negative_radius);
+        intersecting = intersecting | (distance < radius);
+
+        if (frustum_batch::mask(outside) == frustum_batch::all)
+        {
+          break;
+        }
+      }
+
+      auto outside_mask = frustum_batch::mask(outside);
+      auto intersecting_mask = frustum_batch::mask(intersecting);
+      for (auto lane = uint32_t(0); lane < frustum_batch::width; lane++)
+      {
+        results[index + lane] = (outside_mask & (1 << lane)) ? -1 : (intersecting_mask & (1 << lane)) ? 0 : 1;
+      }
+    }
+#endif
+
+    for (; index < count; index++)
+    {
+      results[index] = static_cast<int8_t>(frustum_test(planes, { spheres.center_x[index], spheres.center_y[index], spheres.center_z[index] }, spheres.radius[index]));
+    }
+
+    return results;
+  }
+
+  std::array<vec4, 6> normalized(const std::array<vec4, 6>& planes)
+  {
+    auto normalized_planes = planes;
+    for (auto& plane : normalized_planes)
+    {
+      plane = plane / length(vec3 { plane[0], plane[1], plane[2] });
+    }
+
+    return normalized_planes;
+  }
+}
@@ -0,0 +1,75 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "bounds.h"
+
+namespace ludo
+{
+  ///
+  /// A set of AABBs laid out as a structure of arrays, for testing in batches.
+  struct aabb3_soa
+  {
+    std::vector<float> min_x; ///< The minimum x coordinate of each AABB.
+    std::vector<float> min_y; ///< The minimum y coordinate of each AABB.
+    std::vector<float> min_z; ///< The minimum z coordinate of each AABB.
+    std::vector<float> max_x; ///< The maximum x coordinate of each AABB.
+    std::vector<float> max_y; ///< The maximum y coordinate of each AABB.
+    std::vector<float> max_z; ///< The maximum z coordinate of each AABB.
+  };
+
+  ///
+  /// A set of spheres laid out as a structure of arrays, for testing in batches.
+  struct sphere_soa
+  {
+    std::vector<float> center_x; ///< The x coordinate of the center of each sphere.
+    std::vector<float> center_y; ///< The y coordinate of the center of each sphere.
+    std::vector<float> center_z; ///< The z coordinate of the center of each sphere.
+    std::vector<float> radius; ///< The radius of each sphere.
+  };
+
+  ///
+  /// Tests an AABB against the planes of a view frustum.
+  /// \param planes The planes of the view frustum (with normals pointing into the view frustum, see frustum_planes).
+  /// \param bounds The AABB to test.
+  /// \return -1 if the AABB is outside the view frustum, 0 if it intersects the view frustum or 1 if it is inside the view frustum.
+  int32_t frustum_test(const std::array<vec4, 6>& planes, const aabb3& bounds);
+
+  ///
+  /// Tests a sphere against the planes of a view frustum.
+  /// \param planes The planes of the view frustum (with normals pointing into the view frustum, see frustum_planes).
+  /// \param center The center of the sphere.
+  /// \param radius The radius of the sphere.
+  /// \return -1 if the sphere is outside the view frustum, 0 if it intersects the view frustum or 1 if it is inside the view frustum.
+  int32_t frustum_test(const std::array<vec4, 6>& planes, const vec3& center, float radius);
+
+  ///
+  /// Tests AABBs against the planes of a view frustum in batches (of 8 with AVX or 4 with SSE, depending on what is enabled at compile time).
+  /// The corners of the AABBs closest to and furthest from each plane are chosen once per plane (by the octant its normal points into) rather than per AABB.
+  /// The results are identical to testing each AABB individually.
+  /// \param planes The planes of the view frustum (with normals pointing into the view frustum, see frustum_planes).
+  /// \param bounds The AABBs to test.
+  /// \return The result of each AABB: -1 if it is outside the view frustum, 0 if it intersects the view frustum or 1 if it is inside the view frustum.
+  std::vector<int8_t> frustum_test(const std::array<vec4, 6>& planes, const aabb3_soa& bounds);
+
+  ///
+  /// Tests AABBs against the planes of a view frustum in batches, exploiting the coherency between frames.
+  /// Each batch starts with the plane that last rejected its first AABB and stops as soon as every AABB of the batch is rejected,
+  /// so AABBs that remain outside the view frustum (and are stored near each other) usually only need to be tested against a single plane.
+  /// \param planes The planes of the view frustum (with normals pointing into the view frustum, see frustum_planes).
+  /// \param bounds The AABBs to test.
+  /// \param plane_hints The index of the plane that last rejected each AABB. Resized to the number of AABBs (with new entries set to 0) and updated.
+  /// \return The result of each AABB: -1 if it is outside the view frustum, 0 if it intersects the view frustum or 1 if it is inside the view frustum.
+  std::vector<int8_t> frustum_test(const std::array<vec4, 6>& planes, const aabb3_soa& bounds, std::vector<uint8_t>& plane_hints);
+
+  ///
+  /// Tests spheres against the planes of a view frustum in batches (of 8 with AVX or 4 with SSE, depending on what is enabled at compile time).
+  /// \param planes The planes of the view frustum (with normals pointing into the view frustum, see frustum_planes).
+  /// \param spheres The spheres to test.
+  /// \return The result of each sphere: -1 if it is outside the view frustum, 0 if it intersects the view frustum or 1 if it is inside the view frustum.
+  std::vector<int8_t> frustum_test(const std::array<vec4, 6>& planes, const sphere_soa& spheres);
+}
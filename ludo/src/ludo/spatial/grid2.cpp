@@ -3,24 +3,23 @@
  */
 
 #include <cmath>
+#include <limits>
 
 #include "grid2.h"
 
 namespace ludo
 {
+  void find(const grid2& grid, const std::function<int32_t(const aabb2& bounds)>& test, const std::array<uint32_t, 2>& min, const std::array<uint32_t, 2>& max, const vec2& cell_dimensions, std::vector<uint64_t>& results);
+  void append_cell_render_mesh_ids(const grid2& grid, uint32_t cell_index, std::vector<uint64_t>& render_mesh_ids);
   vec2 cell_dimensions(const grid2& grid);
   std::vector<uint64_t> cell_render_mesh_ids(const grid2& grid, uint32_t cell_index);
   uint32_t cell_render_mesh_index(const grid2& grid, uint32_t cell_index, uint64_t render_mesh_id);
-  uint64_t cell_offset(const grid2& grid, uint32_t cell_index);
   uint32_t to_index(const grid2& grid, const std::array<uint32_t, 2>& cell_coordinates);
   std::array<uint32_t, 2> to_cell_coordinates(const grid2& grid, const vec2& position);
 
   // 3 * vec2
   const auto front_buffer_header_size = 3 * sizeof(vec2);
 
-  // The render mesh count, padded to 8 bytes
-  const auto cell_header_size = sizeof(uint32_t) + 4;
-
   // 2 IDs and 6 start/count values
   const auto render_mesh_size = 2 * sizeof(uint64_t) + 6 * sizeof(uint32_t);
 
@@ -28,19 +27,15 @@ namespace ludo
   {
     grid.id = next_id++;
 
-    auto cell_count = static_cast<uint32_t>(std::pow(grid.cell_count_1d, 2));
-    auto cell_size = cell_header_size + grid.cell_capacity * render_mesh_size;
-
-    auto data_size = cell_count * cell_size;
-    grid.buffer.front = allocate_vram(front_buffer_header_size + data_size);
-    grid.buffer.back = allocate(data_size);
-
-    auto offset = uint32_t(0);
-    for (auto cell_index = uint32_t(0); cell_index < cell_count; cell_index++)
+    grid.pool =
     {
-      cast<uint32_t>(grid.buffer.back, offset) = 0;
-      offset += cell_size;
-    }
+      .cell_count = static_cast<uint32_t>(std::pow(grid.cell_count_1d, 2)),
+      .capacity = grid.cell_capacity,
+      .entry_size = render_mesh_size
+    };
+
+    grid.buffer.back = init(grid.pool);
+    grid.buffer.front = allocate_vram(front_buffer_header_size + grid.buffer.back.size);
   }
 
   void de_init(grid2& grid)
@@ -52,9 +47,16 @@ namespace ludo
 
   void commit(grid2& grid)
   {
+    // The back buffer grows as overflow blocks are added, so the front buffer may need to catch up.
+    if (grid.buffer.front.size < front_buffer_header_size + used_size(grid.pool))
+    {
+      deallocate_vram(grid.buffer.front);
+      grid.buffer.front = allocate_vram(front_buffer_header_size + grid.buffer.back.size);
+    }
+
     commit_header(grid);
 
-    std::memcpy(grid.buffer.front.data + front_buffer_header_size, grid.buffer.back.data, grid.buffer.back.size);
+    std::memcpy(grid.buffer.front.data + front_buffer_header_size, grid.buffer.back.data, used_size(grid.pool));
   }
 
   void commit_header(grid2& grid)
@@ -68,16 +70,8 @@ namespace ludo
   void add(grid2& grid, const render_mesh& render_mesh, const vec2& position)
   {
     auto index = to_index(grid, to_cell_coordinates(grid, position));
-    auto offset = cell_offset(grid, index);
-    auto stream = ludo::stream(grid.buffer.back, offset);
-
-    auto render_mesh_count = peek<uint32_t>(stream);
 
-    assert(render_mesh_count < grid.cell_capacity && "cell is full");
-
-    write(stream, render_mesh_count + 1);
-    stream.position += 4; // align 8
-    stream.position += render_mesh_count * render_mesh_size;
+    auto stream = ludo::stream(grid.buffer.back, add(grid.pool, grid.buffer.back, index));
     write(stream, render_mesh.id);
     write(stream, render_mesh.render_program_id);
     write(stream, render_mesh.instances.start);
@@ -94,7 +88,7 @@ namespace ludo
     auto cell_index = to_index(grid, cell_coordinates);
     auto render_mesh_index = cell_render_mesh_index(grid, cell_index, render_mesh.id);
 
-    if (render_mesh_index == grid.cell_capacity)
+    if (render_mesh_index == std::numeric_limits<uint32_t>::max())
     {
       // Search adjacent cells in case of floating point precision errors
       auto offsets = std::array<int32_t, 3> { -1, 0, 1 };
@@ -120,64 +114,92 @@ namespace ludo
 
           cell_index = to_index(grid, adjacent_cell_coordinates);
           render_mesh_index = cell_render_mesh_index(grid, cell_index, render_mesh.id);
-          if (render_mesh_index < grid.cell_capacity)
+          if (render_mesh_index != std::numeric_limits<uint32_t>::max())
           {
             break;
           }
         }
 
-        if (render_mesh_index < grid.cell_capacity)
+        if (render_mesh_index != std::numeric_limits<uint32_t>::max())
         {
           break;
         }
       }
     }
 
-    assert(render_mesh_index < grid.cell_capacity && "render mesh not found");
-
-    auto offset = cell_offset(grid, cell_index);
-    auto stream = ludo::stream(grid.buffer.back, offset);
+    assert(render_mesh_index != std::numeric_limits<uint32_t>::max() && "render mesh not found");
 
-    auto render_mesh_count = peek<uint32_t>(stream) - 1;
-    write(stream, render_mesh_count);
-    stream.position += 4; // align 8
-    stream.position += render_mesh_index * render_mesh_size;
-    std::memmove(
-      grid.buffer.back.data + stream.position,
-      grid.buffer.back.data + stream.position + render_mesh_size,
-      (render_mesh_count - render_mesh_index) * render_mesh_size
-    );
+    remove(grid.pool, grid.buffer.back, cell_index, render_mesh_index);
   }
 
   std::vector<uint64_t> find(const grid2& grid, const std::function<int32_t(const aabb2& bounds)>& test)
   {
     auto render_mesh_ids = std::vector<uint64_t>();
-    auto cell_count = static_cast<uint32_t>(std::pow(grid.cell_count_1d, 2));
-    auto cell_dimensions = ludo::cell_dimensions(grid);
+    auto cell_count_1d = static_cast<uint32_t>(grid.cell_count_1d);
+
+    find(grid, test, { 0, 0 }, { cell_count_1d, cell_count_1d }, ludo::cell_dimensions(grid), render_mesh_ids);
+
+    return render_mesh_ids;
+  }
 
-    for (auto index = uint32_t(0); index < cell_count; index++)
+  void find(const grid2& grid, const std::function<int32_t(const aabb2& bounds)>& test, const std::array<uint32_t, 2>& min, const std::array<uint32_t, 2>& max, const vec2& cell_dimensions, std::vector<uint64_t>& results)
+  {
+    // The cells are treated as the leaves of a virtual quadtree, each node covering a block of cells [min, max).
+    auto bounds = aabb2
     {
-      auto x = index / (grid.cell_count_1d * grid.cell_count_1d);
-      auto y = (index / grid.cell_count_1d) % grid.cell_count_1d;
-      auto z = index % grid.cell_count_1d;
+      .min = grid.bounds.min + vec2 { static_cast<float>(min[0]), static_cast<float>(min[1]) } * cell_dimensions,
+      .max = grid.bounds.min + vec2 { static_cast<float>(max[0]), static_cast<float>(max[1]) } * cell_dimensions
+    };
 
-      auto xy = vec2 { static_cast<float>(x), static_cast<float>(y) };
-      auto min = grid.bounds.min + xy * cell_dimensions;
+    auto test_result = test(bounds);
+    if (test_result == -1)
+    {
+      return;
+    }
 
-      auto bounds = aabb2
+    auto is_cell = max[0] - min[0] == 1 && max[1] - min[1] == 1;
+    if (test_result == 1 || is_cell)
+    {
+      // The whole block is accepted, so the cells within it do not need to be tested individually.
+      for (auto x = min[0]; x < max[0]; x++)
       {
-        .min = min,
-        .max = min + cell_dimensions
-      };
+        for (auto y = min[1]; y < max[1]; y++)
+        {
+          append_cell_render_mesh_ids(grid, to_index(grid, { x, y }), results);
+        }
+      }
+
+      return;
+    }
 
-      if (test(bounds) != -1)
+    // Dimensions that are a single cell wide are not split (one half of them will be empty and skipped).
+    auto center = std::array<uint32_t, 2> { (min[0] + max[0]) / 2, (min[1] + max[1]) / 2 };
+    for (auto quadrant_index = uint32_t(0); quadrant_index < 4; quadrant_index++)
+    {
+      auto quadrant_min = std::array<uint32_t, 2>();
+      auto quadrant_max = std::array<uint32_t, 2>();
+      for (auto dimension = uint32_t(0); dimension < 2; dimension++)
       {
-        auto ids = cell_render_mesh_ids(grid, index);
-        render_mesh_ids.insert(render_mesh_ids.end(), ids.begin(), ids.end());
+        auto upper = quadrant_index & (1 << dimension);
+        quadrant_min[dimension] = upper ? center[dimension] : min[dimension];
+        quadrant_max[dimension] = upper ? max[dimension] : center[dimension];
       }
+
+      if (quadrant_min[0] == quadrant_max[0] || quadrant_min[1] == quadrant_max[1])
+      {
+        continue;
+      }
+
+      find(grid, test, quadrant_min, quadrant_max, cell_dimensions, results);
     }
+  }
 
-    return render_mesh_ids;
+  void append_cell_render_mesh_ids(const grid2& grid, uint32_t cell_index, std::vector<uint64_t>& render_mesh_ids)
+  {
+    for_each_entry(grid.pool, grid.buffer.back, cell_index, [&](uint64_t offset)
+    {
+      render_mesh_ids.push_back(cast<uint64_t>(grid.buffer.back, offset));
+    });
   }
 
   vec2 cell_dimensions(const grid2& grid)
@@ -189,45 +211,27 @@ namespace ludo
   std::vector<uint64_t> cell_render_mesh_ids(const grid2& grid, uint32_t cell_index)
   {
     auto cell_render_mesh_ids = std::vector<uint64_t>();
-    auto offset = cell_offset(grid, cell_index);
-
-    auto render_mesh_count = cast<uint32_t>(grid.buffer.back, offset);
-    offset += 4;
-    offset += 4; // align 8
-
-    for (auto render_mesh_index = uint32_t(0); render_mesh_index < render_mesh_count; render_mesh_index++)
-    {
-      cell_render_mesh_ids.push_back(cast<uint64_t>(grid.buffer.back, offset));
-      offset += render_mesh_size;
-    }
+    append_cell_render_mesh_ids(grid, cell_index, cell_render_mesh_ids);
 
     return cell_render_mesh_ids;
   }
 
   uint32_t cell_render_mesh_index(const grid2& grid, uint32_t cell_index, uint64_t render_mesh_id)
   {
-    auto offset = cell_offset(grid, cell_index);
+    auto render_mesh_index = uint32_t(0);
+    auto found_render_mesh_index = std::numeric_limits<uint32_t>::max();
 
-    auto render_mesh_count = cast<uint32_t>(grid.buffer.back, offset);
-    offset += 4;
-    offset += 4; // align 8
-
-    for (auto render_mesh_index = uint32_t(0); render_mesh_index < render_mesh_count; render_mesh_index++)
+    for_each_entry(grid.pool, grid.buffer.back, cell_index, [&](uint64_t offset)
     {
       if (cast<uint64_t>(grid.buffer.back, offset) == render_mesh_id)
       {
-        return render_mesh_index;
+        found_render_mesh_index = render_mesh_index;
       }
 
-      offset += render_mesh_size;
-    }
+      render_mesh_index++;
+    });
 
-    return grid.cell_capacity;
-  }
-
-  uint64_t cell_offset(const grid2& grid, uint32_t cell_index)
-  {
-    return cell_index * (cell_header_size + grid.cell_capacity * render_mesh_size);
+    return found_render_mesh_index;
   }
 
   uint32_t to_index(const grid2& grid, const std::array<uint32_t, 2>& cell_coordinates)
@@ -8,6 +8,7 @@
 #include "../compute.h"
 #include "../rendering.h"
 #include "bounds.h"
+#include "cell_pool.h"
 
 namespace ludo
 {
@@ -19,8 +20,9 @@ namespace ludo
 
     aabb2 bounds; ///< The outer bounds.
     uint8_t cell_count_1d = 1; ///< The number of cells in each dimension.
-    uint32_t cell_capacity = 16; ///< The maximum number of render meshes that can be added to a cell.
+    uint32_t cell_capacity = 16; ///< The number of render meshes stored within each cell before it spills into overflow blocks.
 
+    cell_pool pool; ///< The layout of the cells (and their overflow blocks) within the buffers.
     double_buffer buffer; ///< The cell data (the front buffer also contains a header).
   };
 
@@ -61,8 +63,10 @@ namespace ludo
 
   ///
   /// Finds render meshes within a grid.
+  /// The cells are searched hierarchically: blocks of cells are tested first and their cells are only tested individually
+  /// if the block intersects (0). Blocks that are outside (-1) are skipped and blocks that are inside (1) are accepted whole.
   /// \param grid The grid to search.
-  /// \param test The test to perform against the bounds of the cells.
+  /// \param test The test to perform against the bounds of the cells (returning -1 for outside, 0 for intersecting and 1 for inside).
   /// \return The matching render mesh IDs.
   std::vector<uint64_t> find(const grid2& grid, const std::function<int32_t(const aabb2& bounds)>& test);
 }
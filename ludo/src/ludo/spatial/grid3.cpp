@@ -2,25 +2,34 @@
  * This file is part of ludo. See the LICENSE file for the full license governing this code.
  */
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "../thread_pool.h"
 #include "grid3.h"
 
 namespace ludo
 {
+  void find(const grid3& grid, const std::function<int32_t(const aabb3& bounds)>& test, const std::array<uint32_t, 3>& min, const std::array<uint32_t, 3>& max, const vec3& cell_dimensions, std::vector<uint64_t>& results);
+  void append_cell_render_mesh_ids(const grid3& grid, uint32_t cell_index, std::vector<uint64_t>& render_mesh_ids);
   vec3 cell_dimensions(const grid3& grid);
   std::vector<uint64_t> cell_render_mesh_ids(const grid3& grid, uint32_t cell_index);
   uint32_t cell_render_mesh_index(const grid3& grid, uint32_t cell_index, uint64_t render_mesh_id);
-  uint64_t cell_offset(const grid3& grid, uint32_t cell_index);
+  void remove_at(grid3& grid, uint32_t cell_index, uint32_t render_mesh_index);
+  void mark_dirty(grid3& grid, uint32_t cell_index);
+  void add_render_commands(const grid3& grid, array<render_program>& render_programs, const camera& camera, const occlusion_buffer* occlusion_buffer);
+  void frustum_test_row(const grid3& grid, const std::array<vec4, 6>& planes, const vec3& cell_dimensions, uint32_t x, uint32_t y, std::vector<uint8_t>& visible);
   uint32_t to_index(const grid3& grid, const std::array<uint32_t, 3>& cell_coordinates);
   std::array<uint32_t, 3> to_cell_coordinates(const grid3& grid, const vec3& position);
 
   // 3 * vec3, padded to 16 bytes
   const auto front_buffer_header_size = sizeof(vec3) + 4 + sizeof(vec3) + 4 + sizeof(vec3) + 4;
 
-  // The render mesh count, padded to 8 bytes
-  const auto cell_header_size = sizeof(uint32_t) + 4;
-
   // 2 IDs and 6 start/count values
   const auto render_mesh_size = 2 * sizeof(uint64_t) + 6 * sizeof(uint32_t);
 
@@ -28,37 +37,109 @@ namespace ludo
   {
     grid.id = next_id++;
 
-    auto cell_count = static_cast<uint32_t>(std::pow(grid.cell_count_1d, 3));
-    auto cell_size = cell_header_size + grid.cell_capacity * render_mesh_size;
+    grid.pool =
+    {
+      .cell_count = static_cast<uint32_t>(std::pow(grid.cell_count_1d, 3)),
+      .capacity = grid.cell_capacity,
+      .entry_size = render_mesh_size
+    };
 
-    auto data_size = cell_count * cell_size;
-    grid.buffer.front = allocate_vram(front_buffer_header_size + data_size);
-    grid.buffer.back = allocate(data_size);
+    grid.buffer.back = init(grid.pool);
+
+    // Grids that are only read on the CPU have no front buffers.
+    if (!grid.front_buffer_count)
+    {
+      return;
+    }
 
-    auto offset = uint32_t(0);
-    for (auto cell_index = uint32_t(0); cell_index < cell_count; cell_index++)
+    grid.front_buffers = std::vector<grid3_front_buffer>(grid.front_buffer_count);
+    for (auto& front_buffer : grid.front_buffers)
     {
-      cast<uint32_t>(grid.buffer.back, offset) = 0;
-      offset += cell_size;
+      front_buffer.buffer = allocate_vram(front_buffer_header_size + grid.buffer.back.size);
     }
+
+    // The first commit is to the first front buffer.
+    grid.front_buffer_index = grid.front_buffer_count - 1;
+    grid.buffer.front = grid.front_buffers[grid.front_buffer_index].buffer;
   }
 
   void de_init(grid3& grid)
   {
     grid.id = 0;
 
-    deallocate_dual(grid.buffer);
+    deallocate(grid.buffer.back);
+    for (auto& front_buffer : grid.front_buffers)
+    {
+      deallocate_vram(front_buffer.buffer);
+    }
+
+    grid.buffer.front = {};
+    grid.front_buffers.clear();
+    grid.dirty_blocks.clear();
+    grid.locations.clear();
   }
 
   void commit(grid3& grid)
   {
+    assert(!grid.front_buffers.empty() && "grid has no front buffers");
+
+    // Every front buffer needs the blocks modified since the last commit, whenever it is next committed to.
+    for (auto& front_buffer : grid.front_buffers)
+    {
+      front_buffer.dirty_blocks.insert(front_buffer.dirty_blocks.end(), grid.dirty_blocks.begin(), grid.dirty_blocks.end());
+    }
+    grid.dirty_blocks.clear();
+
+    grid.front_buffer_index = (grid.front_buffer_index + 1) % static_cast<uint32_t>(grid.front_buffers.size());
+    auto& front_buffer = grid.front_buffers[grid.front_buffer_index];
+
+    // The back buffer grows as overflow blocks are added, so the front buffer may need to catch up.
+    if (front_buffer.buffer.size < front_buffer_header_size + used_size(grid.pool))
+    {
+      deallocate_vram(front_buffer.buffer);
+      front_buffer.buffer = allocate_vram(front_buffer_header_size + grid.buffer.back.size);
+      front_buffer.stale = true;
+    }
+
+    grid.buffer.front = front_buffer.buffer;
     commit_header(grid);
 
-    std::memcpy(grid.buffer.front.data + front_buffer_header_size, grid.buffer.back.data, grid.buffer.back.size);
+    if (front_buffer.stale)
+    {
+      std::memcpy(grid.buffer.front.data + front_buffer_header_size, grid.buffer.back.data, used_size(grid.pool));
+
+      front_buffer.dirty_blocks.clear();
+      front_buffer.stale = false;
+      return;
+    }
+
+    auto& dirty_blocks = front_buffer.dirty_blocks;
+    std::sort(dirty_blocks.begin(), dirty_blocks.end());
+    dirty_blocks.erase(std::unique(dirty_blocks.begin(), dirty_blocks.end()), dirty_blocks.end());
+
+    // Copy runs of consecutive blocks at once.
+    auto block_size = ludo::block_size(grid.pool);
+    for (auto run_start = std::size_t(0); run_start < dirty_blocks.size();)
+    {
+      auto run_end = run_start + 1;
+      while (run_end < dirty_blocks.size() && dirty_blocks[run_end] == dirty_blocks[run_end - 1] + 1)
+      {
+        run_end++;
+      }
+
+      auto offset = dirty_blocks[run_start] * block_size;
+      std::memcpy(grid.buffer.front.data + front_buffer_header_size + offset, grid.buffer.back.data + offset, (run_end - run_start) * block_size);
+
+      run_start = run_end;
+    }
+
+    dirty_blocks.clear();
   }
 
   void commit_header(grid3& grid)
   {
+    assert(!grid.front_buffers.empty() && "grid has no front buffers");
+
     auto stream = ludo::stream(grid.buffer.front);
     write(stream, grid.bounds.min);
     stream.position += 4; // align 16
@@ -70,16 +151,14 @@ namespace ludo
   void add(grid3& grid, const render_mesh& render_mesh, const vec3& position)
   {
     auto index = to_index(grid, to_cell_coordinates(grid, position));
-    auto offset = cell_offset(grid, index);
-    auto stream = ludo::stream(grid.buffer.back, offset);
-
-    auto render_mesh_count = peek<uint32_t>(stream);
 
-    assert(render_mesh_count < grid.cell_capacity && "cell is full");
+    if (grid.track_locations)
+    {
+      assert(!grid.locations.contains(render_mesh.id) && "render mesh already added");
+      grid.locations[render_mesh.id] = { .cell_index = index, .slot = count(grid.pool, grid.buffer.back, index) };
+    }
 
-    write(stream, render_mesh_count + 1);
-    stream.position += 4; // align 8
-    stream.position += render_mesh_count * render_mesh_size;
+    auto stream = ludo::stream(grid.buffer.back, add(grid.pool, grid.buffer.back, index));
     write(stream, render_mesh.id);
     write(stream, render_mesh.render_program_id);
     write(stream, render_mesh.instances.start);
@@ -88,15 +167,26 @@ namespace ludo
     write(stream, render_mesh.indices.count);
     write(stream, render_mesh.vertices.start);
     write(stream, render_mesh.vertices.count);
+
+    mark_dirty(grid, index);
   }
 
   void remove(grid3& grid, const render_mesh& render_mesh, const vec3& position)
   {
+    if (grid.track_locations)
+    {
+      auto location_iter = grid.locations.find(render_mesh.id);
+      assert(location_iter != grid.locations.end() && "render mesh not found");
+
+      remove_at(grid, location_iter->second.cell_index, location_iter->second.slot);
+      return;
+    }
+
     auto cell_coordinates = to_cell_coordinates(grid, position);
     auto cell_index = to_index(grid, cell_coordinates);
     auto render_mesh_index = cell_render_mesh_index(grid, cell_index, render_mesh.id);
 
-    if (render_mesh_index == grid.cell_capacity)
+    if (render_mesh_index == std::numeric_limits<uint32_t>::max())
     {
       // Search adjacent cells in case of floating point precision errors
       auto offsets = std::array<int32_t, 3> { -1, 0, 1 };
@@ -129,70 +219,292 @@ namespace ludo
 
             cell_index = to_index(grid, adjacent_cell_coordinates);
             render_mesh_index = cell_render_mesh_index(grid, cell_index, render_mesh.id);
-            if (render_mesh_index < grid.cell_capacity)
+            if (render_mesh_index != std::numeric_limits<uint32_t>::max())
             {
               break;
             }
           }
 
-          if (render_mesh_index < grid.cell_capacity)
+          if (render_mesh_index != std::numeric_limits<uint32_t>::max())
           {
             break;
           }
         }
 
-        if (render_mesh_index < grid.cell_capacity)
+        if (render_mesh_index != std::numeric_limits<uint32_t>::max())
         {
           break;
         }
       }
     }
 
-    assert(render_mesh_index < grid.cell_capacity && "render mesh not found");
+    assert(render_mesh_index != std::numeric_limits<uint32_t>::max() && "render mesh not found");
 
-    auto offset = cell_offset(grid, cell_index);
-    auto stream = ludo::stream(grid.buffer.back, offset);
+    remove_at(grid, cell_index, render_mesh_index);
+  }
+
+  void move(grid3& grid, const render_mesh& render_mesh, const vec3& old_position, const vec3& new_position)
+  {
+    auto old_cell_index = grid.track_locations ? grid.locations.at(render_mesh.id).cell_index : to_index(grid, to_cell_coordinates(grid, old_position));
+    auto new_cell_index = to_index(grid, to_cell_coordinates(grid, new_position));
+
+    if (old_cell_index == new_cell_index)
+    {
+      return;
+    }
 
-    auto render_mesh_count = peek<uint32_t>(stream) - 1;
-    write(stream, render_mesh_count);
-    stream.position += 4; // align 8
-    stream.position += render_mesh_index * render_mesh_size;
-    std::memmove(
-      grid.buffer.back.data + stream.position,
-      grid.buffer.back.data + stream.position + render_mesh_size,
-      (render_mesh_count - render_mesh_index) * render_mesh_size
-    );
+    remove(grid, render_mesh, old_position);
+    add(grid, render_mesh, new_position);
   }
 
   std::vector<uint64_t> find(const grid3& grid, const std::function<int32_t(const aabb3& bounds)>& test)
   {
     auto render_mesh_ids = std::vector<uint64_t>();
-    auto cell_count = static_cast<uint32_t>(std::pow(grid.cell_count_1d, 3));
+    auto cell_count_1d = static_cast<uint32_t>(grid.cell_count_1d);
+
+    find(grid, test, { 0, 0, 0 }, { cell_count_1d, cell_count_1d, cell_count_1d }, ludo::cell_dimensions(grid), render_mesh_ids);
+
+    return render_mesh_ids;
+  }
+
+  void find(const grid3& grid, const std::function<int32_t(const aabb3& bounds)>& test, const std::array<uint32_t, 3>& min, const std::array<uint32_t, 3>& max, const vec3& cell_dimensions, std::vector<uint64_t>& results)
+  {
+    // The cells are treated as the leaves of a virtual octree, each node covering a block of cells [min, max).
+    auto bounds = aabb3
+    {
+      .min = grid.bounds.min + vec3 { static_cast<float>(min[0]), static_cast<float>(min[1]), static_cast<float>(min[2]) } * cell_dimensions,
+      .max = grid.bounds.min + vec3 { static_cast<float>(max[0]), static_cast<float>(max[1]), static_cast<float>(max[2]) } * cell_dimensions
+    };
+
+    auto test_result = test(bounds);
+    if (test_result == -1)
+    {
+      return;
+    }
+
+    auto is_cell = max[0] - min[0] == 1 && max[1] - min[1] == 1 && max[2] - min[2] == 1;
+    if (test_result == 1 || is_cell)
+    {
+      // The whole block is accepted, so the cells within it do not need to be tested individually.
+      for (auto x = min[0]; x < max[0]; x++)
+      {
+        for (auto y = min[1]; y < max[1]; y++)
+        {
+          for (auto z = min[2]; z < max[2]; z++)
+          {
+            append_cell_render_mesh_ids(grid, to_index(grid, { x, y, z }), results);
+          }
+        }
+      }
+
+      return;
+    }
+
+    // Dimensions that are a single cell wide are not split (one half of them will be empty and skipped).
+    auto center = std::array<uint32_t, 3> { (min[0] + max[0]) / 2, (min[1] + max[1]) / 2, (min[2] + max[2]) / 2 };
+    for (auto octant_index = uint32_t(0); octant_index < 8; octant_index++)
+    {
+      auto octant_min = std::array<uint32_t, 3>();
+      auto octant_max = std::array<uint32_t, 3>();
+      for (auto dimension = uint32_t(0); dimension < 3; dimension++)
+      {
+        auto upper = octant_index & (1 << dimension);
+        octant_min[dimension] = upper ? center[dimension] : min[dimension];
+        octant_max[dimension] = upper ? max[dimension] : center[dimension];
+      }
+
+      if (octant_min[0] == octant_max[0] || octant_min[1] == octant_max[1] || octant_min[2] == octant_max[2])
+      {
+        continue;
+      }
+
+      find(grid, test, octant_min, octant_max, cell_dimensions, results);
+    }
+  }
+
+  void add_render_commands(const grid3& grid, array<render_program>& render_programs, const camera& camera)
+  {
+    add_render_commands(grid, render_programs, camera, nullptr);
+  }
+
+  void add_render_commands(const grid3& grid, array<render_program>& render_programs, const camera& camera, const occlusion_buffer& occlusion_buffer)
+  {
+    add_render_commands(grid, render_programs, camera, &occlusion_buffer);
+  }
+
+  void add_render_commands(const grid3& grid, array<render_program>& render_programs, const camera& camera, const occlusion_buffer* occlusion_buffer)
+  {
+    auto planes = frustum_planes(camera);
     auto cell_dimensions = ludo::cell_dimensions(grid);
+    auto cell_count_1d = static_cast<uint32_t>(grid.cell_count_1d);
 
-    for (auto index = uint32_t(0); index < cell_count; index++)
+    // Resolve render programs by ID once, rather than searching for them for every render mesh.
+    auto render_program_indices = std::unordered_map<uint64_t, uint32_t>();
+    for (auto render_program_index = uint32_t(0); render_program_index < render_programs.length; render_program_index++)
     {
-      auto x = index / (grid.cell_count_1d * grid.cell_count_1d);
-      auto y = (index / grid.cell_count_1d) % grid.cell_count_1d;
-      auto z = index % grid.cell_count_1d;
+      render_program_indices[render_programs[render_program_index].id] = render_program_index;
+    }
 
-      auto xyz = vec3 { static_cast<float>(x), static_cast<float>(y), static_cast<float>(z) };
-      auto min = grid.bounds.min + xyz * cell_dimensions;
+    // Each slab (of x coordinates) collects its render commands per render program so that the slabs don't contend over the command buffers.
+    auto batch_count = std::max(uint32_t(1), std::min(thread_pool_size() + 1, cell_count_1d));
+    auto batch_size = (cell_count_1d + batch_count - 1) / batch_count;
+    auto batch_render_commands = std::vector<std::vector<std::vector<render_command>>>(batch_count, std::vector<std::vector<render_command>>(render_programs.length));
 
-      auto bounds = aabb3
+    thread_pool_parallel_for(batch_count, [&](uint32_t batch_index)
+    {
+      auto& render_commands = batch_render_commands[batch_index];
+      auto visible = std::vector<uint8_t>(cell_count_1d);
+
+      for (auto x = batch_index * batch_size; x < std::min((batch_index + 1) * batch_size, cell_count_1d); x++)
       {
-        .min = min,
-        .max = min + cell_dimensions
-      };
+        for (auto y = uint32_t(0); y < cell_count_1d; y++)
+        {
+          frustum_test_row(grid, planes, cell_dimensions, x, y, visible);
 
-      if (test(bounds) != -1)
+          for (auto z = uint32_t(0); z < cell_count_1d; z++)
+          {
+            if (!visible[z])
+            {
+              continue;
+            }
+
+            // Test the same (expanded) bounds as the frustum test, since render meshes can overlap from the neighbouring cells.
+            if (occlusion_buffer)
+            {
+              auto cell_min = grid.bounds.min + vec3 { static_cast<float>(x), static_cast<float>(y), static_cast<float>(z) } * cell_dimensions;
+              if (occluded(*occlusion_buffer, { .min = cell_min - cell_dimensions, .max = cell_min + cell_dimensions * 2.0f }))
+              {
+                continue;
+              }
+            }
+
+            for_each_entry(grid.pool, grid.buffer.back, to_index(grid, { x, y, z }), [&](uint64_t offset)
+            {
+              auto render_program_iter = render_program_indices.find(cast<uint64_t>(grid.buffer.back, offset + sizeof(uint64_t)));
+              if (render_program_iter == render_program_indices.end())
+              {
+                return;
+              }
+
+              // See add(grid3&, ...) for the layout.
+              auto values = reinterpret_cast<const uint32_t*>(grid.buffer.back.data + offset + 2 * sizeof(uint64_t));
+              render_commands[render_program_iter->second].push_back(
+              {
+                .index_count = values[3],
+                .instance_count = values[1],
+                .index_start = values[2],
+                .vertex_start = values[4],
+                .instance_start = values[0]
+              });
+            });
+          }
+        }
+      }
+    });
+
+    // Determine where each slab's render commands go (after the active commands and those of the previous slabs).
+    auto batch_render_command_starts = std::vector<std::vector<uint32_t>>(batch_count, std::vector<uint32_t>(render_programs.length));
+    for (auto render_program_index = uint32_t(0); render_program_index < render_programs.length; render_program_index++)
+    {
+      auto& render_program = render_programs[render_program_index];
+
+      auto start = render_program.active_commands.start + render_program.active_commands.count;
+      for (auto batch_index = uint32_t(0); batch_index < batch_count; batch_index++)
       {
-        auto ids = cell_render_mesh_ids(grid, index);
-        render_mesh_ids.insert(render_mesh_ids.end(), ids.begin(), ids.end());
+        batch_render_command_starts[batch_index][render_program_index] = start;
+        start += static_cast<uint32_t>(batch_render_commands[batch_index][render_program_index].size());
       }
+
+      assert(start * sizeof(render_command) <= render_program.command_buffer.size && "command buffer full");
+      render_program.active_commands.count = start - render_program.active_commands.start;
     }
 
-    return render_mesh_ids;
+    thread_pool_parallel_for(batch_count, [&](uint32_t batch_index)
+    {
+      for (auto render_program_index = uint32_t(0); render_program_index < render_programs.length; render_program_index++)
+      {
+        auto& render_commands = batch_render_commands[batch_index][render_program_index];
+        if (!render_commands.empty())
+        {
+          std::memcpy(
+            render_programs[render_program_index].command_buffer.data + batch_render_command_starts[batch_index][render_program_index] * sizeof(render_command),
+            render_commands.data(),
+            render_commands.size() * sizeof(render_command)
+          );
+        }
+      }
+    });
+  }
+
+  void frustum_test_row(const grid3& grid, const std::array<vec4, 6>& planes, const vec3& cell_dimensions, uint32_t x, uint32_t y, std::vector<uint8_t>& visible)
+  {
+    // A cell is visible unless the bounds of it and its neighbours are fully outside any plane (see frustum_test).
+    // Along a row only z varies, so the x and y terms of each plane are shared by every cell of the row.
+    auto cell_min_x = grid.bounds.min[0] + static_cast<float>(x) * cell_dimensions[0];
+    auto cell_min_y = grid.bounds.min[1] + static_cast<float>(y) * cell_dimensions[1];
+
+    auto xy_terms = std::array<float, 6>();
+    auto z_offsets = std::array<float, 6>();
+    for (auto plane_index = uint32_t(0); plane_index < 6; plane_index++)
+    {
+      auto& plane = planes[plane_index];
+
+      // The p-vertex i.e. the corner furthest along the normal.
+      auto p_x = plane[0] > 0.0f ? cell_min_x + cell_dimensions[0] * 2.0f : cell_min_x - cell_dimensions[0];
+      auto p_y = plane[1] > 0.0f ? cell_min_y + cell_dimensions[1] * 2.0f : cell_min_y - cell_dimensions[1];
+
+      xy_terms[plane_index] = plane[0] * p_x + plane[1] * p_y;
+      z_offsets[plane_index] = plane[2] > 0.0f ? cell_dimensions[2] * 2.0f : -cell_dimensions[2];
+    }
+
+    auto cell_count_1d = static_cast<uint32_t>(grid.cell_count_1d);
+    auto z = uint32_t(0);
+
+#if defined(__SSE2__) || defined(_M_X64)
+    for (; z + 4 <= cell_count_1d; z += 4)
+    {
+      auto z_coordinates = _mm_set_ps(static_cast<float>(z + 3), static_cast<float>(z + 2), static_cast<float>(z + 1), static_cast<float>(z));
+      auto cell_min_z = _mm_add_ps(_mm_set1_ps(grid.bounds.min[2]), _mm_mul_ps(z_coordinates, _mm_set1_ps(cell_dimensions[2])));
+
+      auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      for (auto plane_index = uint32_t(0); plane_index < 6; plane_index++)
+      {
+        auto p_z = _mm_add_ps(cell_min_z, _mm_set1_ps(z_offsets[plane_index]));
+        auto distance = _mm_add_ps(_mm_add_ps(_mm_set1_ps(xy_terms[plane_index]), _mm_mul_ps(_mm_set1_ps(planes[plane_index][2]), p_z)), _mm_set1_ps(planes[plane_index][3]));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+      }
+
+      auto mask = _mm_movemask_ps(inside);
+      visible[z] = mask & 1;
+      visible[z + 1] = (mask >> 1) & 1;
+      visible[z + 2] = (mask >> 2) & 1;
+      visible[z + 3] = (mask >> 3) & 1;
+    }
+#endif
+
+    for (; z < cell_count_1d; z++)
+    {
+      auto cell_min_z = grid.bounds.min[2] + static_cast<float>(z) * cell_dimensions[2];
+
+      visible[z] = 1;
+      for (auto plane_index = uint32_t(0); plane_index < 6; plane_index++)
+      {
+        auto p_z = cell_min_z + z_offsets[plane_index];
+        if (xy_terms[plane_index] + planes[plane_index][2] * p_z + planes[plane_index][3] < 0.0f)
+        {
+          visible[z] = 0;
+          break;
+        }
+      }
+    }
+  }
+
+  void append_cell_render_mesh_ids(const grid3& grid, uint32_t cell_index, std::vector<uint64_t>& render_mesh_ids)
+  {
+    for_each_entry(grid.pool, grid.buffer.back, cell_index, [&](uint64_t offset)
+    {
+      render_mesh_ids.push_back(cast<uint64_t>(grid.buffer.back, offset));
+    });
   }
 
   vec3 cell_dimensions(const grid3& grid)
@@ -204,45 +516,58 @@ namespace ludo
   std::vector<uint64_t> cell_render_mesh_ids(const grid3& grid, uint32_t cell_index)
   {
     auto cell_render_mesh_ids = std::vector<uint64_t>();
-    auto offset = cell_offset(grid, cell_index);
-
-    auto render_mesh_count = cast<uint32_t>(grid.buffer.back, offset);
-    offset += 4;
-    offset += 4; // align 8
-
-    for (auto render_mesh_index = uint32_t(0); render_mesh_index < render_mesh_count; render_mesh_index++)
-    {
-      cell_render_mesh_ids.push_back(cast<uint64_t>(grid.buffer.back, offset));
-      offset += render_mesh_size;
-    }
+    append_cell_render_mesh_ids(grid, cell_index, cell_render_mesh_ids);
 
     return cell_render_mesh_ids;
   }
 
   uint32_t cell_render_mesh_index(const grid3& grid, uint32_t cell_index, uint64_t render_mesh_id)
   {
-    auto offset = cell_offset(grid, cell_index);
-
-    auto render_mesh_count = cast<uint32_t>(grid.buffer.back, offset);
-    offset += 4;
-    offset += 4; // align 8
+    auto render_mesh_index = uint32_t(0);
+    auto found_render_mesh_index = std::numeric_limits<uint32_t>::max();
 
-    for (auto render_mesh_index = uint32_t(0); render_mesh_index < render_mesh_count; render_mesh_index++)
+    for_each_entry(grid.pool, grid.buffer.back, cell_index, [&](uint64_t offset)
     {
       if (cast<uint64_t>(grid.buffer.back, offset) == render_mesh_id)
       {
-        return render_mesh_index;
+        found_render_mesh_index = render_mesh_index;
       }
 
-      offset += render_mesh_size;
+      render_mesh_index++;
+    });
+
+    return found_render_mesh_index;
+  }
+
+  void remove_at(grid3& grid, uint32_t cell_index, uint32_t render_mesh_index)
+  {
+    if (grid.track_locations)
+    {
+      grid.locations.erase(cast<uint64_t>(grid.buffer.back, entry_offset(grid.pool, grid.buffer.back, cell_index, render_mesh_index)));
+    }
+
+    // The last render mesh of the cell may be moved into the gap.
+    if (remove(grid.pool, grid.buffer.back, cell_index, render_mesh_index) && grid.track_locations)
+    {
+      grid.locations[cast<uint64_t>(grid.buffer.back, entry_offset(grid.pool, grid.buffer.back, cell_index, render_mesh_index))].slot = render_mesh_index;
     }
 
-    return grid.cell_capacity;
+    mark_dirty(grid, cell_index);
   }
 
-  uint64_t cell_offset(const grid3& grid, uint32_t cell_index)
+  void mark_dirty(grid3& grid, uint32_t cell_index)
   {
-    return cell_index * (cell_header_size + grid.cell_capacity * render_mesh_size);
+    // Without front buffers, there is nothing to commit the blocks to.
+    if (grid.front_buffers.empty())
+    {
+      return;
+    }
+
+    // Blocks that were taken out of the chain don't need to be marked, since they are no longer read from.
+    for_each_block(grid.pool, grid.buffer.back, cell_index, [&](uint32_t block_index)
+    {
+      grid.dirty_blocks.push_back(block_index);
+    });
   }
 
   uint32_t to_index(const grid3& grid, const std::array<uint32_t, 3>& cell_coordinates)
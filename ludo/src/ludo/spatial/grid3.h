@@ -8,9 +8,28 @@
 #include "../compute.h"
 #include "../rendering.h"
 #include "bounds.h"
+#include "cell_pool.h"
+#include "occlusion.h"
 
 namespace ludo
 {
+  ///
+  /// The location of a render mesh within a grid.
+  struct grid3_location
+  {
+    uint32_t cell_index = 0; ///< The index of the cell containing the render mesh.
+    uint32_t slot = 0; ///< The index of the render mesh within the cell.
+  };
+
+  ///
+  /// One of the front buffers of a grid.
+  struct grid3_front_buffer
+  {
+    ludo::buffer buffer; ///< The header and cell data.
+    std::vector<uint32_t> dirty_blocks; ///< The blocks (see cell_pool) modified since this front buffer was last committed to (may contain duplicates).
+    bool stale = true; ///< Determines if all of the blocks need to be committed e.g. when this front buffer has just been (re-)allocated.
+  };
+
   ///
   /// A grid with uniformly-sized cubic cells.
   struct grid3
@@ -20,9 +39,18 @@ namespace ludo
 
     aabb3 bounds; ///< The outer bounds.
     uint8_t cell_count_1d = 1; ///< The number of cells in each dimension.
-    uint32_t cell_capacity = 16; ///< The maximum number of render meshes that can be added to a cell.
+    uint32_t cell_capacity = 16; ///< The number of render meshes stored within each cell before it spills into overflow blocks.
+
+    bool track_locations = false; ///< Determines if the location of each render mesh is tracked so that it can be removed without searching (render mesh IDs must be unique within the grid).
 
-    double_buffer buffer; ///< The cell data (the front buffer also contains a header).
+    uint8_t front_buffer_count = 2; ///< The number of front buffers. They are committed to in turn, so the front buffer committed to is never the one most recently read from. Grids only read on the CPU (see add_render_commands) can have none, in which case they are never committed.
+
+    cell_pool pool; ///< The layout of the cells (and their overflow blocks) within the buffers.
+    double_buffer buffer; ///< The cell data (the front buffer also contains a header). The front buffer is the most recently committed of the front buffers.
+    std::vector<grid3_front_buffer> front_buffers; ///< The front buffers.
+    uint32_t front_buffer_index = 0; ///< The index of the most recently committed front buffer.
+    std::vector<uint32_t> dirty_blocks; ///< The blocks (see cell_pool) modified since the last commit (may contain duplicates).
+    std::unordered_map<uint64_t, grid3_location> locations; ///< The location of each render mesh (if track_locations is set).
   };
 
   ///
@@ -36,13 +64,14 @@ namespace ludo
   void de_init(grid3& grid);
 
   ///
-  /// Commits to the front buffer.
+  /// Commits to the next of the front buffers, which then becomes the front buffer.
+  /// Only the blocks modified since the front buffer was last committed to are copied, coalesced into contiguous ranges.
+  /// This should be called at most once per frame, at a point where the front buffer about to be committed to is not being read from.
   /// \param grid The grid.
-  /// \param header_only Determines if only the header state should be pushed (i.e. not the cell data).
   void commit(grid3& grid);
 
   ///
-  /// Commits the header state to the front buffer (i.e. not the cell data).
+  /// Commits the header state to the front buffer (i.e. not the cell data). The header is also committed by commit(grid3&).
   /// \param grid The grid.
   void commit_header(grid3& grid);
 
@@ -57,13 +86,23 @@ namespace ludo
   /// Removes a render mesh from a grid.
   /// \param grid The grid to remove the render mesh from.
   /// \param render_mesh The render mesh to remove.
-  /// \param position The position of the render mesh.
+  /// \param position The position of the render mesh. Unused if track_locations is set.
   void remove(grid3& grid3, const render_mesh& render_mesh, const vec3& position);
 
+  ///
+  /// Moves a render mesh within a grid. This does nothing if the render mesh remains within the same cell.
+  /// \param grid The grid containing the render mesh.
+  /// \param render_mesh The render mesh to move.
+  /// \param old_position The position the render mesh was added with. Unused if track_locations is set.
+  /// \param new_position The new position of the render mesh.
+  void move(grid3& grid, const render_mesh& render_mesh, const vec3& old_position, const vec3& new_position);
+
   ///
   /// Finds render meshes within a grid.
+  /// The cells are searched hierarchically: blocks of cells are tested first and their cells are only tested individually
+  /// if the block intersects (0). Blocks that are outside (-1) are skipped and blocks that are inside (1) are accepted whole.
   /// \param grid The grid to search.
-  /// \param test The test to perform against the bounds of the cells.
+  /// \param test The test to perform against the bounds of the cells (returning -1 for outside, 0 for intersecting and 1 for inside).
   /// \return The matching render mesh IDs.
   std::vector<uint64_t> find(const grid3& grid, const std::function<int32_t(const aabb3& bounds)>& test);
 
@@ -74,13 +113,36 @@ namespace ludo
   compute_program build_compute_program(const grid3& grid);
 
   ///
-  /// Adds render commands to the render programs' command buffers and updates the active command count.
-  /// \param grids The render program.
+  /// Adds render commands to the render programs' command buffers with compute programs.
+  /// So that the CPU doesn't wait for the compute programs, the command counts are read back a frame later: the active commands of each render program
+  /// that the grids added to are replaced with those added by the previous call (culled with the previous camera), which the GPU has usually finished with.
+  /// Must be called once per frame, after start_render_transaction.
+  /// \param rendering_context The rendering context (holding the frames of the context, see rendering_context::compute_frames).
+  /// \param grids The grids.
   /// \param compute_programs The compute programs to execute.
   /// \param render_programs The render programs that can have render commands added.
   /// \param render_commands The render commands to sample from.
   /// \param camera The camera the render meshes are being viewed through.
-  void add_render_commands(array<grid3>& grids, array<compute_program>& compute_programs, array<render_program>& render_programs, const heap& render_commands, const camera& camera);
+  void add_render_commands(rendering_context& rendering_context, array<grid3>& grids, array<compute_program>& compute_programs, array<render_program>& render_programs, const heap& render_commands, const camera& camera);
+
+  ///
+  /// Adds render commands to the render programs' command buffers and updates the active command count, on the CPU rather than with a compute program.
+  /// The cells are frustum tested a row at a time (using SIMD where available) in parallel slabs (see thread_pool_parallel_for). Each slab collects its own
+  /// render commands which are then merged into the command buffers in slab order, so the render commands are in cell order regardless of the number of threads.
+  /// As with the compute program, each cell is tested with its neighbouring cells included and render meshes of unknown render programs are skipped.
+  /// \param grid The grid.
+  /// \param render_programs The render programs that can have render commands added.
+  /// \param camera The camera the render meshes are being viewed through.
+  void add_render_commands(const grid3& grid, array<render_program>& render_programs, const camera& camera);
+
+  ///
+  /// Adds render commands to the render programs' command buffers and updates the active command count, on the CPU rather than with a compute program.
+  /// As above, but cells that are visible to the camera are also skipped if they are hidden behind the occluders of an occlusion buffer.
+  /// \param grid The grid.
+  /// \param render_programs The render programs that can have render commands added.
+  /// \param camera The camera the render meshes are being viewed through.
+  /// \param occlusion_buffer The occlusion buffer (committed, and cleared with the same camera).
+  void add_render_commands(const grid3& grid, array<render_program>& render_programs, const camera& camera, const occlusion_buffer& occlusion_buffer);
 }
 
 #endif // LUDO_SPATIAL_GRID3_H
@@ -0,0 +1,190 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+#include <limits>
+
+#include "hash_grid3.h"
+
+namespace ludo
+{
+  void append_cell(const hash_grid3& grid, const std::array<int32_t, 3>& cell_coordinates, const std::vector<uint64_t>& render_mesh_ids, const std::function<int32_t(const aabb3& bounds)>& test, std::vector<uint64_t>& results);
+  aabb3 cell_bounds(const hash_grid3& grid, const std::array<int32_t, 3>& cell_coordinates);
+  std::array<int32_t, 3> to_cell_coordinates(const hash_grid3& grid, const vec3& position);
+
+  // Based on "Optimized Spatial Hashing for Collision Detection of Deformable Objects" (Teschner et al.)
+  std::size_t hash_grid3_cell_hash::operator()(const std::array<int32_t, 3>& cell_coordinates) const
+  {
+    return
+      (static_cast<std::size_t>(cell_coordinates[0]) * 73856093) ^
+      (static_cast<std::size_t>(cell_coordinates[1]) * 19349663) ^
+      (static_cast<std::size_t>(cell_coordinates[2]) * 83492791);
+  }
+
+  void init(hash_grid3& grid)
+  {
+    assert(grid.cell_size > 0.0f && "cell size must be positive");
+
+    grid.id = next_id++;
+  }
+
+  void de_init(hash_grid3& grid)
+  {
+    grid.id = 0;
+
+    grid.cells.clear();
+    grid.locations.clear();
+  }
+
+  void add(hash_grid3& grid, const render_mesh& render_mesh, const vec3& position)
+  {
+    assert(!grid.locations.contains(render_mesh.id) && "render mesh already added");
+
+    auto cell_coordinates = to_cell_coordinates(grid, position);
+    auto& render_mesh_ids = grid.cells[cell_coordinates];
+
+    grid.locations[render_mesh.id] = { .cell_coordinates = cell_coordinates, .slot = static_cast<uint32_t>(render_mesh_ids.size()) };
+    render_mesh_ids.push_back(render_mesh.id);
+  }
+
+  void remove(hash_grid3& grid, const render_mesh& render_mesh, const vec3& position)
+  {
+    auto location_iter = grid.locations.find(render_mesh.id);
+    assert(location_iter != grid.locations.end() && "render mesh not found");
+
+    auto cell_iter = grid.cells.find(location_iter->second.cell_coordinates);
+    auto& render_mesh_ids = cell_iter->second;
+
+    // Swap with the last render mesh of the cell so that removal doesn't need to shift the remaining render meshes.
+    auto slot = location_iter->second.slot;
+    if (slot != render_mesh_ids.size() - 1)
+    {
+      render_mesh_ids[slot] = render_mesh_ids.back();
+      grid.locations[render_mesh_ids[slot]].slot = slot;
+    }
+
+    render_mesh_ids.pop_back();
+    grid.locations.erase(location_iter);
+
+    // Only occupied cells are kept so that searches don't visit empty cells.
+    if (render_mesh_ids.empty())
+    {
+      grid.cells.erase(cell_iter);
+    }
+  }
+
+  void move(hash_grid3& grid, const render_mesh& render_mesh, const vec3& old_position, const vec3& new_position)
+  {
+    auto location_iter = grid.locations.find(render_mesh.id);
+    assert(location_iter != grid.locations.end() && "render mesh not found");
+
+    if (location_iter->second.cell_coordinates == to_cell_coordinates(grid, new_position))
+    {
+      return;
+    }
+
+    remove(grid, render_mesh, old_position);
+    add(grid, render_mesh, new_position);
+  }
+
+  std::vector<uint64_t> find(const hash_grid3& grid, const std::function<int32_t(const aabb3& bounds)>& test)
+  {
+    auto results = std::vector<uint64_t>();
+    for (auto& [ cell_coordinates, render_mesh_ids ] : grid.cells)
+    {
+      append_cell(grid, cell_coordinates, render_mesh_ids, test, results);
+    }
+
+    return results;
+  }
+
+  std::vector<uint64_t> find(const hash_grid3& grid, const aabb3& bounds, const std::function<int32_t(const aabb3& bounds)>& test)
+  {
+    auto results = std::vector<uint64_t>();
+
+    auto min = to_cell_coordinates(grid, bounds.min);
+    auto max = to_cell_coordinates(grid, bounds.max);
+
+    // Computed in floating point since the region can span the entire range of cell coordinates.
+    auto region_cell_count =
+      static_cast<double>(static_cast<int64_t>(max[0]) - min[0] + 1) *
+      static_cast<double>(static_cast<int64_t>(max[1]) - min[1] + 1) *
+      static_cast<double>(static_cast<int64_t>(max[2]) - min[2] + 1);
+
+    if (region_cell_count > static_cast<double>(grid.cells.size()))
+    {
+      for (auto& [ cell_coordinates, render_mesh_ids ] : grid.cells)
+      {
+        if (cell_coordinates[0] >= min[0] && cell_coordinates[0] <= max[0] &&
+          cell_coordinates[1] >= min[1] && cell_coordinates[1] <= max[1] &&
+          cell_coordinates[2] >= min[2] && cell_coordinates[2] <= max[2])
+        {
+          append_cell(grid, cell_coordinates, render_mesh_ids, test, results);
+        }
+      }
+
+      return results;
+    }
+
+    for (auto x = int64_t(min[0]); x <= max[0]; x++)
+    {
+      for (auto y = int64_t(min[1]); y <= max[1]; y++)
+      {
+        for (auto z = int64_t(min[2]); z <= max[2]; z++)
+        {
+          auto cell_coordinates = std::array<int32_t, 3> { static_cast<int32_t>(x), static_cast<int32_t>(y), static_cast<int32_t>(z) };
+
+          auto cell_iter = grid.cells.find(cell_coordinates);
+          if (cell_iter != grid.cells.end())
+          {
+            append_cell(grid, cell_coordinates, cell_iter->second, test, results);
+          }
+        }
+      }
+    }
+
+    return results;
+  }
+
+  std::vector<uint64_t> find(const hash_grid3& grid, const aabb3& bounds)
+  {
+    return find(grid, bounds, [](const aabb3& bounds)
+    {
+      return 0;
+    });
+  }
+
+  void append_cell(const hash_grid3& grid, const std::array<int32_t, 3>& cell_coordinates, const std::vector<uint64_t>& render_mesh_ids, const std::function<int32_t(const aabb3& bounds)>& test, std::vector<uint64_t>& results)
+  {
+    if (test(cell_bounds(grid, cell_coordinates)) == -1)
+    {
+      return;
+    }
+
+    results.insert(results.end(), render_mesh_ids.begin(), render_mesh_ids.end());
+  }
+
+  aabb3 cell_bounds(const hash_grid3& grid, const std::array<int32_t, 3>& cell_coordinates)
+  {
+    auto min = vec3 { static_cast<float>(cell_coordinates[0]), static_cast<float>(cell_coordinates[1]), static_cast<float>(cell_coordinates[2]) } * grid.cell_size;
+
+    return
+    {
+      .min = min,
+      .max = min + vec3 { grid.cell_size, grid.cell_size, grid.cell_size }
+    };
+  }
+
+  std::array<int32_t, 3> to_cell_coordinates(const hash_grid3& grid, const vec3& position)
+  {
+    // Clamped to the range of the cell coordinates, since converting a value outside it is undefined.
+    auto to_cell_coordinate = [&](float coordinate)
+    {
+      auto cell_coordinate = std::floor(static_cast<double>(coordinate) / grid.cell_size);
+      return static_cast<int32_t>(std::clamp(cell_coordinate, static_cast<double>(std::numeric_limits<int32_t>::min()), static_cast<double>(std::numeric_limits<int32_t>::max())));
+    };
+
+    return { to_cell_coordinate(position[0]), to_cell_coordinate(position[1]), to_cell_coordinate(position[2]) };
+  }
+}
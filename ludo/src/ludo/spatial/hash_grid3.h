@@ -0,0 +1,101 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#ifndef LUDO_SPATIAL_HASH_GRID3_H
+#define LUDO_SPATIAL_HASH_GRID3_H
+
+#include <functional>
+#include <unordered_map>
+
+#include "../rendering.h"
+#include "bounds.h"
+
+namespace ludo
+{
+  ///
+  /// Computes the hash of the integer coordinates of a cell.
+  struct hash_grid3_cell_hash
+  {
+    std::size_t operator()(const std::array<int32_t, 3>& cell_coordinates) const;
+  };
+
+  ///
+  /// The location of a render mesh within a hash grid.
+  struct hash_grid3_location
+  {
+    std::array<int32_t, 3> cell_coordinates = { 0, 0, 0 }; ///< The coordinates of the cell containing the render mesh.
+    uint32_t slot = 0; ///< The index of the render mesh within the cell.
+  };
+
+  ///
+  /// A sparse grid with uniformly-sized cubic cells and no outer bounds.
+  /// Only occupied cells are stored, keyed by their integer coordinates (the cell containing the origin has coordinates 0, 0, 0).
+  /// Unlike grid3 this is a CPU-only structure, so there is nothing to commit.
+  struct hash_grid3
+  {
+    uint64_t id = 0; ///< A unique identifier.
+
+    float cell_size = 1.0f; ///< The width of each cell in all dimensions.
+
+    std::unordered_map<std::array<int32_t, 3>, std::vector<uint64_t>, hash_grid3_cell_hash> cells; ///< The render mesh IDs of the occupied cells.
+    std::unordered_map<uint64_t, hash_grid3_location> locations; ///< The location of each render mesh.
+  };
+
+  ///
+  /// Initializes a hash grid.
+  /// \param grid The hash grid.
+  void init(hash_grid3& grid);
+
+  ///
+  /// De-initializes a hash grid.
+  /// \param grid The hash grid.
+  void de_init(hash_grid3& grid);
+
+  ///
+  /// Adds a render mesh to a hash grid.
+  /// \param grid The hash grid to add the render mesh to.
+  /// \param render_mesh The render mesh to add.
+  /// \param position The position of the render mesh.
+  void add(hash_grid3& grid, const render_mesh& render_mesh, const vec3& position);
+
+  ///
+  /// Removes a render mesh from a hash grid.
+  /// \param grid The hash grid to remove the render mesh from.
+  /// \param render_mesh The render mesh to remove.
+  /// \param position The position of the render mesh. Unused since the location of each render mesh is tracked, but accepted for parity with grid3.
+  void remove(hash_grid3& grid, const render_mesh& render_mesh, const vec3& position);
+
+  ///
+  /// Moves a render mesh within a hash grid. This does nothing if the render mesh remains within the same cell.
+  /// \param grid The hash grid containing the render mesh.
+  /// \param render_mesh The render mesh to move.
+  /// \param old_position The position the render mesh was added with. Unused since the location of each render mesh is tracked, but accepted for parity with grid3.
+  /// \param new_position The new position of the render mesh.
+  void move(hash_grid3& grid, const render_mesh& render_mesh, const vec3& old_position, const vec3& new_position);
+
+  ///
+  /// Finds render meshes within a hash grid. Every occupied cell is tested.
+  /// \param grid The hash grid to search.
+  /// \param test The test to perform against the bounds of the cells (returning -1 for outside, 0 for intersecting and 1 for inside).
+  /// \return The matching render mesh IDs.
+  std::vector<uint64_t> find(const hash_grid3& grid, const std::function<int32_t(const aabb3& bounds)>& test);
+
+  ///
+  /// Finds render meshes within a region of a hash grid.
+  /// Only the cells intersecting the region are considered, which are either looked up individually or filtered from the occupied cells (whichever is fewer).
+  /// \param grid The hash grid to search.
+  /// \param bounds The bounds of the region to search (such as the bounds of a view frustum).
+  /// \param test The test to perform against the bounds of the cells within the region (returning -1 for outside, 0 for intersecting and 1 for inside).
+  /// \return The matching render mesh IDs.
+  std::vector<uint64_t> find(const hash_grid3& grid, const aabb3& bounds, const std::function<int32_t(const aabb3& bounds)>& test);
+
+  ///
+  /// Finds render meshes within the cells intersecting a region of a hash grid.
+  /// \param grid The hash grid to search.
+  /// \param bounds The bounds of the region to search.
+  /// \return The matching render mesh IDs.
+  std::vector<uint64_t> find(const hash_grid3& grid, const aabb3& bounds);
+}
+
+#endif // LUDO_SPATIAL_HASH_GRID3_H
@@ -0,0 +1,451 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+#include <limits>
+#include <queue>
+
+#include "loose_octree.h"
+
+namespace ludo
+{
+  void find(const loose_octree& octree, const std::function<int32_t(const aabb3& bounds)>& test, uint32_t layer, const std::array<uint32_t, 3>& coordinates, bool inside, std::vector<uint32_t>& results);
+  void raycast(const loose_octree& octree, const vec3& origin, const vec3& direction, uint32_t layer, const std::array<uint32_t, 3>& coordinates, loose_octree_hit& closest_hit);
+  void raycast_all(const loose_octree& octree, const vec3& origin, const vec3& direction, float max_distance, uint32_t layer, const std::array<uint32_t, 3>& coordinates, std::vector<loose_octree_hit>& hits);
+  std::array<uint32_t, 3> child_coordinates(const std::array<uint32_t, 3>& coordinates, uint32_t octant_index);
+  aabb3 loose_bounds(const loose_octree& octree, uint32_t layer, const std::array<uint32_t, 3>& coordinates);
+  uint32_t node_index(uint32_t layer, const std::array<uint32_t, 3>& coordinates);
+  std::pair<uint32_t, std::array<uint32_t, 3>> to_location(const loose_octree& octree, const aabb3& bounds);
+  uint32_t unlink(loose_octree& octree, uint32_t node_index, uint32_t element);
+  void update_counts(loose_octree& octree, uint32_t layer, std::array<uint32_t, 3> coordinates, int32_t change);
+
+  const auto no_slot = std::numeric_limits<uint32_t>::max();
+
+  void init(loose_octree& octree)
+  {
+    assert(octree.looseness > 1.0f && "looseness must be greater than 1");
+    assert(octree.divisions < 10 && "node indices of 10 or more divisions would overflow");
+
+    octree.id = next_id++;
+
+    // The sum of 8^layer for all layers
+    auto node_count = ((uint32_t(1) << (3 * (octree.divisions + 1))) - 1) / 7;
+    octree.nodes = std::vector<loose_octree_node>(node_count, { .first_slot = no_slot, .count = 0 });
+    octree.slots.clear();
+    octree.first_free_slot = no_slot;
+  }
+
+  void de_init(loose_octree& octree)
+  {
+    octree.id = 0;
+
+    octree.nodes.clear();
+    octree.slots.clear();
+    octree.first_free_slot = no_slot;
+  }
+
+  void add(loose_octree& octree, uint32_t element, const aabb3& bounds)
+  {
+    auto [ layer, coordinates ] = to_location(octree, bounds);
+    auto& node = octree.nodes[node_index(layer, coordinates)];
+
+    auto slot_index = octree.first_free_slot;
+    if (slot_index == no_slot)
+    {
+      slot_index = static_cast<uint32_t>(octree.slots.size());
+      octree.slots.emplace_back();
+    }
+    else
+    {
+      octree.first_free_slot = octree.slots[slot_index].next_slot;
+    }
+
+    octree.slots[slot_index] = { .element = element, .bounds = bounds, .next_slot = node.first_slot };
+    node.first_slot = slot_index;
+
+    update_counts(octree, layer, coordinates, 1);
+  }
+
+  void remove(loose_octree& octree, uint32_t element, const aabb3& bounds)
+  {
+    auto [ layer, coordinates ] = to_location(octree, bounds);
+
+    auto slot_index = unlink(octree, node_index(layer, coordinates), element);
+    octree.slots[slot_index].next_slot = octree.first_free_slot;
+    octree.first_free_slot = slot_index;
+
+    update_counts(octree, layer, coordinates, -1);
+  }
+
+  void move(loose_octree& octree, uint32_t element, const aabb3& old_bounds, const aabb3& new_bounds)
+  {
+    auto old_location = to_location(octree, old_bounds);
+    auto new_location = to_location(octree, new_bounds);
+
+    if (old_location != new_location)
+    {
+      remove(octree, element, old_bounds);
+      add(octree, element, new_bounds);
+
+      return;
+    }
+
+    auto& node = octree.nodes[node_index(old_location.first, old_location.second)];
+    for (auto slot_index = node.first_slot; slot_index != no_slot; slot_index = octree.slots[slot_index].next_slot)
+    {
+      if (octree.slots[slot_index].element == element)
+      {
+        octree.slots[slot_index].bounds = new_bounds;
+        return;
+      }
+    }
+
+    assert(false && "element not found");
+  }
+
+  std::vector<uint32_t> find(const loose_octree& octree, const std::function<int32_t(const aabb3& bounds)>& test)
+  {
+    auto results = std::vector<uint32_t>();
+    find(octree, test, 0, { 0, 0, 0 }, false, results);
+
+    return results;
+  }
+
+  std::vector<uint32_t> find(const loose_octree& octree, const vec3& center, float radius)
+  {
+    return find(octree, [&](const aabb3& bounds)
+    {
+      return intersect(bounds, center, radius) ? 0 : -1;
+    });
+  }
+
+  loose_octree_hit raycast(const loose_octree& octree, const vec3& origin, const vec3& direction, float max_distance)
+  {
+    auto closest_hit = loose_octree_hit { .element = std::numeric_limits<uint32_t>::max(), .distance = max_distance };
+    raycast(octree, origin, direction, 0, { 0, 0, 0 }, closest_hit);
+
+    return closest_hit;
+  }
+
+  std::vector<loose_octree_hit> raycast_all(const loose_octree& octree, const vec3& origin, const vec3& direction, float max_distance)
+  {
+    auto hits = std::vector<loose_octree_hit>();
+    raycast_all(octree, origin, direction, max_distance, 0, { 0, 0, 0 }, hits);
+
+    std::sort(hits.begin(), hits.end(), [](const loose_octree_hit& a, const loose_octree_hit& b)
+    {
+      return a.distance < b.distance;
+    });
+
+    return hits;
+  }
+
+  std::vector<loose_octree_hit> nearest(const loose_octree& octree, const vec3& position, uint32_t count)
+  {
+    struct node_candidate
+    {
+      float distance2;
+      uint32_t layer;
+      std::array<uint32_t, 3> coordinates;
+    };
+
+    auto compare_nodes = [](const node_candidate& a, const node_candidate& b)
+    {
+      return a.distance2 > b.distance2;
+    };
+
+    auto compare_hits = [](const loose_octree_hit& a, const loose_octree_hit& b)
+    {
+      return a.distance < b.distance;
+    };
+
+    // Nodes are visited closest first, the hits are a max-heap (of squared distances) so the furthest can be replaced.
+    auto nodes = std::priority_queue<node_candidate, std::vector<node_candidate>, decltype(compare_nodes)>(compare_nodes);
+    auto hits = std::priority_queue<loose_octree_hit, std::vector<loose_octree_hit>, decltype(compare_hits)>(compare_hits);
+
+    if (count && octree.nodes[0].count)
+    {
+      nodes.push({ .distance2 = distance2(loose_bounds(octree, 0, { 0, 0, 0 }), position), .layer = 0, .coordinates = { 0, 0, 0 } });
+    }
+
+    while (!nodes.empty())
+    {
+      auto candidate = nodes.top();
+      nodes.pop();
+
+      if (hits.size() == count && candidate.distance2 > hits.top().distance)
+      {
+        break;
+      }
+
+      auto& node = octree.nodes[node_index(candidate.layer, candidate.coordinates)];
+      for (auto slot_index = node.first_slot; slot_index != no_slot; slot_index = octree.slots[slot_index].next_slot)
+      {
+        auto& slot = octree.slots[slot_index];
+        auto slot_distance2 = distance2(slot.bounds, position);
+
+        if (hits.size() < count)
+        {
+          hits.push({ .element = slot.element, .distance = slot_distance2 });
+        }
+        else if (slot_distance2 < hits.top().distance)
+        {
+          hits.pop();
+          hits.push({ .element = slot.element, .distance = slot_distance2 });
+        }
+      }
+
+      if (candidate.layer == octree.divisions)
+      {
+        continue;
+      }
+
+      for (auto octant_index = uint32_t(0); octant_index < 8; octant_index++)
+      {
+        auto coordinates = child_coordinates(candidate.coordinates, octant_index);
+        if (!octree.nodes[node_index(candidate.layer + 1, coordinates)].count)
+        {
+          continue;
+        }
+
+        nodes.push({ .distance2 = distance2(loose_bounds(octree, candidate.layer + 1, coordinates), position), .layer = candidate.layer + 1, .coordinates = coordinates });
+      }
+    }
+
+    auto results = std::vector<loose_octree_hit>(hits.size());
+    for (auto index = results.size(); index > 0; index--)
+    {
+      results[index - 1] = { .element = hits.top().element, .distance = std::sqrt(hits.top().distance) };
+      hits.pop();
+    }
+
+    return results;
+  }
+
+  void find(const loose_octree& octree, const std::function<int32_t(const aabb3& bounds)>& test, uint32_t layer, const std::array<uint32_t, 3>& coordinates, bool inside, std::vector<uint32_t>& results)
+  {
+    auto& node = octree.nodes[node_index(layer, coordinates)];
+    if (!node.count)
+    {
+      return;
+    }
+
+    if (!inside)
+    {
+      auto test_result = test(loose_bounds(octree, layer, coordinates));
+      if (test_result == -1)
+      {
+        return;
+      }
+
+      // Everything below a node that is inside must also be inside.
+      inside = test_result == 1;
+    }
+
+    for (auto slot_index = node.first_slot; slot_index != no_slot; slot_index = octree.slots[slot_index].next_slot)
+    {
+      auto& slot = octree.slots[slot_index];
+      if (inside || test(slot.bounds) != -1)
+      {
+        results.push_back(slot.element);
+      }
+    }
+
+    if (layer == octree.divisions)
+    {
+      return;
+    }
+
+    for (auto octant_index = uint32_t(0); octant_index < 8; octant_index++)
+    {
+      find(octree, test, layer + 1, child_coordinates(coordinates, octant_index), inside, results);
+    }
+  }
+
+  void raycast(const loose_octree& octree, const vec3& origin, const vec3& direction, uint32_t layer, const std::array<uint32_t, 3>& coordinates, loose_octree_hit& closest_hit)
+  {
+    auto& node = octree.nodes[node_index(layer, coordinates)];
+    if (!node.count)
+    {
+      return;
+    }
+
+    auto node_distance = 0.0f;
+    if (!intersect(loose_bounds(octree, layer, coordinates), origin, direction, node_distance) || node_distance > closest_hit.distance)
+    {
+      return;
+    }
+
+    for (auto slot_index = node.first_slot; slot_index != no_slot; slot_index = octree.slots[slot_index].next_slot)
+    {
+      auto& slot = octree.slots[slot_index];
+
+      auto slot_distance = 0.0f;
+      if (intersect(slot.bounds, origin, direction, slot_distance) && slot_distance < closest_hit.distance)
+      {
+        closest_hit = { .element = slot.element, .distance = slot_distance };
+      }
+    }
+
+    if (layer == octree.divisions)
+    {
+      return;
+    }
+
+    // Visit the octants front-to-back relative to the ray so that closer hits prune further octants sooner.
+    auto octant_mask = (direction[0] < 0.0f ? 1 : 0) | (direction[1] < 0.0f ? 2 : 0) | (direction[2] < 0.0f ? 4 : 0);
+    for (auto octant_index = uint32_t(0); octant_index < 8; octant_index++)
+    {
+      raycast(octree, origin, direction, layer + 1, child_coordinates(coordinates, octant_index ^ octant_mask), closest_hit);
+    }
+  }
+
+  void raycast_all(const loose_octree& octree, const vec3& origin, const vec3& direction, float max_distance, uint32_t layer, const std::array<uint32_t, 3>& coordinates, std::vector<loose_octree_hit>& hits)
+  {
+    auto& node = octree.nodes[node_index(layer, coordinates)];
+    if (!node.count)
+    {
+      return;
+    }
+
+    auto node_distance = 0.0f;
+    if (!intersect(loose_bounds(octree, layer, coordinates), origin, direction, node_distance) || node_distance > max_distance)
+    {
+      return;
+    }
+
+    for (auto slot_index = node.first_slot; slot_index != no_slot; slot_index = octree.slots[slot_index].next_slot)
+    {
+      auto& slot = octree.slots[slot_index];
+
+      auto slot_distance = 0.0f;
+      if (intersect(slot.bounds, origin, direction, slot_distance) && slot_distance <= max_distance)
+      {
+        hits.push_back({ .element = slot.element, .distance = slot_distance });
+      }
+    }
+
+    if (layer == octree.divisions)
+    {
+      return;
+    }
+
+    for (auto octant_index = uint32_t(0); octant_index < 8; octant_index++)
+    {
+      raycast_all(octree, origin, direction, max_distance, layer + 1, child_coordinates(coordinates, octant_index), hits);
+    }
+  }
+
+  std::array<uint32_t, 3> child_coordinates(const std::array<uint32_t, 3>& coordinates, uint32_t octant_index)
+  {
+    // Matches the octant ordering of octree i.e. bit 0 is x, bit 1 is y and bit 2 is z.
+    return
+    {
+      coordinates[0] * 2 + (octant_index & 1),
+      coordinates[1] * 2 + ((octant_index >> 1) & 1),
+      coordinates[2] * 2 + ((octant_index >> 2) & 1)
+    };
+  }
+
+  aabb3 loose_bounds(const loose_octree& octree, uint32_t layer, const std::array<uint32_t, 3>& coordinates)
+  {
+    auto cell_dimensions = (octree.bounds.max - octree.bounds.min) / static_cast<float>(uint32_t(1) << layer);
+    auto min = octree.bounds.min + vec3 { static_cast<float>(coordinates[0]), static_cast<float>(coordinates[1]), static_cast<float>(coordinates[2]) } * cell_dimensions;
+    auto expansion = cell_dimensions * ((octree.looseness - 1.0f) / 2.0f);
+
+    return
+    {
+      .min = min - expansion,
+      .max = min + cell_dimensions + expansion
+    };
+  }
+
+  uint32_t node_index(uint32_t layer, const std::array<uint32_t, 3>& coordinates)
+  {
+    auto cell_count_1d = uint32_t(1) << layer;
+    auto layer_offset = ((uint32_t(1) << (3 * layer)) - 1) / 7;
+
+    return layer_offset + coordinates[0] * cell_count_1d * cell_count_1d + coordinates[1] * cell_count_1d + coordinates[2];
+  }
+
+  std::pair<uint32_t, std::array<uint32_t, 3>> to_location(const loose_octree& octree, const aabb3& bounds)
+  {
+    auto center = (bounds.min + bounds.max) / 2.0f;
+    auto extent = bounds.max - bounds.min;
+    auto size = octree.bounds.max - octree.bounds.min;
+
+    assert(contains(octree.bounds, center) && "position out of bounds");
+
+    // An element fits within a node if it is no larger than the expansion of the node's bounds (since its center is within the node's bounds).
+    auto layer = octree.divisions;
+    auto cell_dimensions = size / static_cast<float>(uint32_t(1) << layer);
+    while (layer > 0 && (
+      extent[0] > cell_dimensions[0] * (octree.looseness - 1.0f) ||
+      extent[1] > cell_dimensions[1] * (octree.looseness - 1.0f) ||
+      extent[2] > cell_dimensions[2] * (octree.looseness - 1.0f)))
+    {
+      layer--;
+      cell_dimensions = size / static_cast<float>(uint32_t(1) << layer);
+    }
+
+    assert((layer > 0 || contains(loose_bounds(octree, 0, { 0, 0, 0 }), bounds)) && "element too large");
+
+    auto max_coordinate = (uint32_t(1) << layer) - 1;
+    auto cell_coordinates = (center - octree.bounds.min) / cell_dimensions;
+
+    return
+    {
+      layer,
+      {
+        std::min(static_cast<uint32_t>(std::floor(cell_coordinates[0])), max_coordinate),
+        std::min(static_cast<uint32_t>(std::floor(cell_coordinates[1])), max_coordinate),
+        std::min(static_cast<uint32_t>(std::floor(cell_coordinates[2])), max_coordinate)
+      }
+    };
+  }
+
+  uint32_t unlink(loose_octree& octree, uint32_t node_index, uint32_t element)
+  {
+    auto& node = octree.nodes[node_index];
+
+    auto previous_slot_index = no_slot;
+    for (auto slot_index = node.first_slot; slot_index != no_slot; slot_index = octree.slots[slot_index].next_slot)
+    {
+      if (octree.slots[slot_index].element == element)
+      {
+        if (previous_slot_index == no_slot)
+        {
+          node.first_slot = octree.slots[slot_index].next_slot;
+        }
+        else
+        {
+          octree.slots[previous_slot_index].next_slot = octree.slots[slot_index].next_slot;
+        }
+
+        return slot_index;
+      }
+
+      previous_slot_index = slot_index;
+    }
+
+    assert(false && "element not found");
+    return no_slot;
+  }
+
+  void update_counts(loose_octree& octree, uint32_t layer, std::array<uint32_t, 3> coordinates, int32_t change)
+  {
+    while (true)
+    {
+      octree.nodes[node_index(layer, coordinates)].count += change;
+
+      if (layer == 0)
+      {
+        break;
+      }
+
+      layer--;
+      coordinates = { coordinates[0] / 2, coordinates[1] / 2, coordinates[2] / 2 };
+    }
+  }
+}
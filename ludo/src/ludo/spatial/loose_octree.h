@@ -0,0 +1,125 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#pragma once
+
+#include "bounds.h"
+
+namespace ludo
+{
+  ///
+  /// A node of a loose octree.
+  struct loose_octree_node
+  {
+    uint32_t first_slot = 0; ///< The first slot of the elements within the node.
+    uint32_t count = 0; ///< The number of elements within the node and all of its descendants.
+  };
+
+  ///
+  /// A slot containing an element of a loose octree.
+  struct loose_octree_slot
+  {
+    uint32_t element = 0; ///< The element.
+    aabb3 bounds; ///< The bounds of the element.
+    uint32_t next_slot = 0; ///< The next slot within the same node (or in the free list).
+  };
+
+  ///
+  /// A linear loose octree.
+  /// Unlike octree, elements have bounds and are added to the deepest node (of any layer) that can contain them.
+  /// The bounds of each node are expanded by the looseness factor so that elements only need to be contained by the node their center is in.
+  struct loose_octree
+  {
+    uint64_t id = 0; ///< A unique identifier.
+
+    aabb3 bounds; ///< The outer bounds.
+    uint32_t divisions = 1; ///< The number of divisions (layers). Must be less than 10.
+    float looseness = 2.0f; ///< The factor the bounds of each node are expanded by (must be greater than 1).
+
+    std::vector<loose_octree_node> nodes; ///< The nodes of all layers, ordered by layer.
+    std::vector<loose_octree_slot> slots; ///< The element slots.
+    uint32_t first_free_slot = 0; ///< The first slot available for re-use.
+  };
+
+  ///
+  /// An element found by a query and its distance from the origin of the query.
+  struct loose_octree_hit
+  {
+    uint32_t element = 0; ///< The element.
+    float distance = 0.0f; ///< The distance from the origin of the query.
+  };
+
+  ///
+  /// Initializes a loose octree.
+  /// \param octree The loose octree.
+  void init(loose_octree& octree);
+
+  ///
+  /// De-initializes a loose octree.
+  /// \param octree The loose octree.
+  void de_init(loose_octree& octree);
+
+  ///
+  /// Adds an element to a loose octree.
+  /// \param octree The loose octree to add the element to.
+  /// \param element The element to add to the loose octree.
+  /// \param bounds The bounds of the element. The center must be within the bounds of the loose octree.
+  void add(loose_octree& octree, uint32_t element, const aabb3& bounds);
+
+  ///
+  /// Removes an element from a loose octree.
+  /// \param octree The loose octree to remove the element from.
+  /// \param element The element to remove from the loose octree.
+  /// \param bounds The bounds the element was added with.
+  void remove(loose_octree& octree, uint32_t element, const aabb3& bounds);
+
+  ///
+  /// Moves an element within a loose octree. This is cheaper than removing and re-adding the element if it stays within the same node.
+  /// \param octree The loose octree containing the element.
+  /// \param element The element to move.
+  /// \param old_bounds The bounds the element was added with.
+  /// \param new_bounds The new bounds of the element.
+  void move(loose_octree& octree, uint32_t element, const aabb3& old_bounds, const aabb3& new_bounds);
+
+  ///
+  /// Finds elements within a loose octree.
+  /// \param octree The loose octree to search.
+  /// \param test The test to perform against the bounds of the nodes and elements (returning -1 for outside, 0 for intersecting and 1 for inside).
+  /// \return The matching elements.
+  std::vector<uint32_t> find(const loose_octree& octree, const std::function<int32_t(const aabb3& bounds)>& test);
+
+  ///
+  /// Finds elements within a loose octree that intersect a sphere.
+  /// \param octree The loose octree to search.
+  /// \param center The center of the sphere.
+  /// \param radius The radius of the sphere.
+  /// \return The matching elements.
+  std::vector<uint32_t> find(const loose_octree& octree, const vec3& center, float radius);
+
+  ///
+  /// Finds the first element within a loose octree that is hit by a ray.
+  /// \param octree The loose octree to search.
+  /// \param origin The origin of the ray.
+  /// \param direction The direction of the ray (must be unit length).
+  /// \param max_distance The maximum distance along the ray.
+  /// \return The closest hit. The element will be std::numeric_limits<uint32_t>::max() if nothing was hit.
+  loose_octree_hit raycast(const loose_octree& octree, const vec3& origin, const vec3& direction, float max_distance);
+
+  ///
+  /// Finds all the elements within a loose octree that are hit by a ray.
+  /// \param octree The loose octree to search.
+  /// \param origin The origin of the ray.
+  /// \param direction The direction of the ray (must be unit length).
+  /// \param max_distance The maximum distance along the ray.
+  /// \return The hits, closest first.
+  std::vector<loose_octree_hit> raycast_all(const loose_octree& octree, const vec3& origin, const vec3& direction, float max_distance);
+
+  ///
+  /// Finds the elements within a loose octree that are nearest to a position.
+  /// \param octree The loose octree to search.
+  /// \param position The position.
+  /// \param count The maximum number of elements to find.
+  /// \return The nearest elements (measured to the closest point of their bounds), closest first.
+  std::vector<loose_octree_hit> nearest(const loose_octree& octree, const vec3& position, uint32_t count);
+}
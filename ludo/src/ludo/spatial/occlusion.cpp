@@ -0,0 +1,376 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "../thread_pool.h"
+#include "occlusion.h"
+
+namespace ludo
+{
+  ///
+  /// A triangle projected into an occlusion buffer, as edge functions and a depth plane (each of the form a * x + b * y + c).
+  struct occlusion_triangle
+  {
+    std::array<vec3, 3> edges; ///< The edge functions (positive within the triangle).
+    vec3 depth; ///< The depth plane.
+    std::array<int32_t, 4> pixel_bounds; ///< The minimum x, minimum y, maximum x and maximum y pixels (inclusive) whose centers could be within the triangle.
+    bool valid = false; ///< Determines if the triangle covers any pixels.
+  };
+
+  occlusion_triangle project(const occlusion_buffer& occlusion_buffer, const std::array<vec3, 3>& positions);
+  void rasterize(occlusion_buffer& occlusion_buffer, const occlusion_triangle& triangle, const std::array<int32_t, 4>& tile_bounds);
+
+  void init(occlusion_buffer& occlusion_buffer)
+  {
+    assert((occlusion_buffer.width & (occlusion_buffer.width - 1)) == 0 && (occlusion_buffer.height & (occlusion_buffer.height - 1)) == 0 && "dimensions must be powers of 2");
+    assert(occlusion_buffer.tile_size % 4 == 0 && occlusion_buffer.width % occlusion_buffer.tile_size == 0 && occlusion_buffer.height % occlusion_buffer.tile_size == 0 && "tile size must be a multiple of 4 and divide the dimensions");
+
+    occlusion_buffer.levels.clear();
+
+    auto width = occlusion_buffer.width;
+    auto height = occlusion_buffer.height;
+    while (true)
+    {
+      occlusion_buffer.levels.emplace_back(width * height, 1.0f);
+      if (width == 1 && height == 1)
+      {
+        break;
+      }
+
+      width = std::max(width / 2, uint32_t(1));
+      height = std::max(height / 2, uint32_t(1));
+    }
+  }
+
+  void clear(occlusion_buffer& occlusion_buffer, const camera& camera)
+  {
+    auto view_inverse = camera.view;
+    invert(view_inverse);
+    occlusion_buffer.view_projection = camera.projection * view_inverse;
+
+    std::fill(occlusion_buffer.levels[0].begin(), occlusion_buffer.levels[0].end(), 1.0f);
+  }
+
+  void add_occluders(occlusion_buffer& occlusion_buffer, const std::vector<vec3>& positions, const std::vector<uint32_t>& indices)
+  {
+    auto triangle_count = static_cast<uint32_t>(indices.size() / 3);
+    auto triangles = std::vector<occlusion_triangle>(triangle_count);
+
+    auto batch_count = std::max(uint32_t(1), std::min(thread_pool_size() + 1, triangle_count / 256));
+    auto batch_size = (triangle_count + batch_count - 1) / batch_count;
+    thread_pool_parallel_for(batch_count, [&](uint32_t batch_index)
+    {
+      for (auto triangle_index = batch_index * batch_size; triangle_index < std::min((batch_index + 1) * batch_size, triangle_count); triangle_index++)
+      {
+        triangles[triangle_index] = project(occlusion_buffer, { positions[indices[triangle_index * 3]], positions[indices[triangle_index * 3 + 1]], positions[indices[triangle_index * 3 + 2]] });
+      }
+    });
+
+    // Each tile only writes its own pixels, so the tiles can be rasterized without synchronization.
+    auto tile_count_x = occlusion_buffer.width / occlusion_buffer.tile_size;
+    auto tile_count_y = occlusion_buffer.height / occlusion_buffer.tile_size;
+    thread_pool_parallel_for(tile_count_x * tile_count_y, [&](uint32_t tile_index)
+    {
+      auto tile_bounds = std::array<int32_t, 4>
+      {
+        static_cast<int32_t>((tile_index % tile_count_x) * occlusion_buffer.tile_size),
+        static_cast<int32_t>((tile_index / tile_count_x) * occlusion_buffer.tile_size),
+        static_cast<int32_t>((tile_index % tile_count_x + 1) * occlusion_buffer.tile_size - 1),
+        static_cast<int32_t>((tile_index / tile_count_x + 1) * occlusion_buffer.tile_size - 1)
+      };
+
+      for (auto& triangle : triangles)
+      {
+        if (triangle.valid &&
+          triangle.pixel_bounds[0] <= tile_bounds[2] && triangle.pixel_bounds[2] >= tile_bounds[0] &&
+          triangle.pixel_bounds[1] <= tile_bounds[3] && triangle.pixel_bounds[3] >= tile_bounds[1])
+        {
+          rasterize(occlusion_buffer, triangle, tile_bounds);
+        }
+      }
+    });
+  }
+
+  void commit(occlusion_buffer& occlusion_buffer)
+  {
+    for (auto level_index = uint32_t(1); level_index < occlusion_buffer.levels.size(); level_index++)
+    {
+      auto previous_width = std::max(occlusion_buffer.width >> (level_index - 1), uint32_t(1));
+      auto previous_height = std::max(occlusion_buffer.height >> (level_index - 1), uint32_t(1));
+      auto width = std::max(occlusion_buffer.width >> level_index, uint32_t(1));
+      auto height = std::max(occlusion_buffer.height >> level_index, uint32_t(1));
+
+      auto& previous_level = occlusion_buffer.levels[level_index - 1];
+      auto& level = occlusion_buffer.levels[level_index];
+
+      auto batch_count = std::max(uint32_t(1), std::min(thread_pool_size() + 1, height / 16));
+      auto batch_size = (height + batch_count - 1) / batch_count;
+      thread_pool_parallel_for(batch_count, [&](uint32_t batch_index)
+      {
+        for (auto y = batch_index * batch_size; y < std::min((batch_index + 1) * batch_size, height); y++)
+        {
+          // Dimensions that have already been reduced to 1 are not halved any further.
+          auto y0 = std::min(y * 2, previous_height - 1);
+          auto y1 = std::min(y * 2 + 1, previous_height - 1);
+
+          for (auto x = uint32_t(0); x < width; x++)
+          {
+            auto x0 = std::min(x * 2, previous_width - 1);
+            auto x1 = std::min(x * 2 + 1, previous_width - 1);
+
+            level[y * width + x] = std::max(
+              std::max(previous_level[y0 * previous_width + x0], previous_level[y0 * previous_width + x1]),
+              std::max(previous_level[y1 * previous_width + x0], previous_level[y1 * previous_width + x1])
+            );
+          }
+        }
+      });
+    }
+  }
+
+  bool occluded(const occlusion_buffer& occlusion_buffer, const aabb3& bounds)
+  {
+    auto min = vec2 { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    auto max = vec2 { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    auto nearest_depth = std::numeric_limits<float>::max();
+
+    for (auto corner_index = uint32_t(0); corner_index < 8; corner_index++)
+    {
+      auto corner = vec4
+      {
+        (corner_index & 1) ? bounds.max[0] : bounds.min[0],
+        (corner_index & 2) ? bounds.max[1] : bounds.min[1],
+        (corner_index & 4) ? bounds.max[2] : bounds.min[2],
+        1.0f
+      };
+
+      auto clip = occlusion_buffer.view_projection * corner;
+      if (clip[2] < -clip[3] || clip[3] <= 0.0f)
+      {
+        // The AABB crosses the near plane, so its projection is unbounded.
+        return false;
+      }
+
+      auto x = (clip[0] / clip[3] * 0.5f + 0.5f) * static_cast<float>(occlusion_buffer.width);
+      auto y = (clip[1] / clip[3] * 0.5f + 0.5f) * static_cast<float>(occlusion_buffer.height);
+
+      min = { std::min(min[0], x), std::min(min[1], y) };
+      max = { std::max(max[0], x), std::max(max[1], y) };
+      nearest_depth = std::min(nearest_depth, clip[2] / clip[3] * 0.5f + 0.5f);
+    }
+
+    if (max[0] < 0.0f || max[1] < 0.0f || min[0] >= static_cast<float>(occlusion_buffer.width) || min[1] >= static_cast<float>(occlusion_buffer.height))
+    {
+      return false;
+    }
+
+    auto x0 = static_cast<uint32_t>(std::max(min[0], 0.0f));
+    auto y0 = static_cast<uint32_t>(std::max(min[1], 0.0f));
+    auto x1 = std::min(static_cast<uint32_t>(max[0]), occlusion_buffer.width - 1);
+    auto y1 = std::min(static_cast<uint32_t>(max[1]), occlusion_buffer.height - 1);
+
+    // Find the level where the rectangle covers at most 2x2 texels.
+    auto level_index = uint32_t(0);
+    while (level_index + 1 < occlusion_buffer.levels.size() && ((x1 >> level_index) - (x0 >> level_index) > 1 || (y1 >> level_index) - (y0 >> level_index) > 1))
+    {
+      level_index++;
+    }
+
+    auto& level = occlusion_buffer.levels[level_index];
+    auto width = std::max(occlusion_buffer.width >> level_index, uint32_t(1));
+    for (auto y = y0 >> level_index; y <= y1 >> level_index; y++)
+    {
+      for (auto x = x0 >> level_index; x <= x1 >> level_index; x++)
+      {
+        if (nearest_depth <= level[y * width + x])
+        {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  std::vector<uint8_t> occluded(const occlusion_buffer& occlusion_buffer, const aabb3_soa& bounds)
+  {
+    auto count = static_cast<uint32_t>(bounds.min_x.size());
+    auto results = std::vector<uint8_t>(count);
+
+    auto batch_count = std::max(uint32_t(1), std::min(thread_pool_size() + 1, count / 1024));
+    auto batch_size = (count + batch_count - 1) / batch_count;
+    thread_pool_parallel_for(batch_count, [&](uint32_t batch_index)
+    {
+      for (auto index = batch_index * batch_size; index < std::min((batch_index + 1) * batch_size, count); index++)
+      {
+        results[index] = occluded(occlusion_buffer,
+        {
+          .min = { bounds.min_x[index], bounds.min_y[index], bounds.min_z[index] },
+          .max = { bounds.max_x[index], bounds.max_y[index], bounds.max_z[index] }
+        });
+      }
+    });
+
+    return results;
+  }
+
+  occlusion_triangle project(const occlusion_buffer& occlusion_buffer, const std::array<vec3, 3>& positions)
+  {
+    auto triangle = occlusion_triangle();
+
+    auto vertices = std::array<vec3, 3>();
+    for (auto vertex_index = uint32_t(0); vertex_index < 3; vertex_index++)
+    {
+      auto clip = occlusion_buffer.view_projection * vec4 { positions[vertex_index][0], positions[vertex_index][1], positions[vertex_index][2], 1.0f };
+      if (clip[2] < -clip[3] || clip[3] <= 0.0f)
+      {
+        // Skipping the triangle rather than clipping it only loses occlusion.
+        return triangle;
+      }
+
+      vertices[vertex_index] =
+      {
+        (clip[0] / clip[3] * 0.5f + 0.5f) * static_cast<float>(occlusion_buffer.width),
+        (clip[1] / clip[3] * 0.5f + 0.5f) * static_cast<float>(occlusion_buffer.height),
+        clip[2] / clip[3] * 0.5f + 0.5f
+      };
+    }
+
+    auto area = (vertices[1][0] - vertices[0][0]) * (vertices[2][1] - vertices[0][1]) - (vertices[1][1] - vertices[0][1]) * (vertices[2][0] - vertices[0][0]);
+    if (area == 0.0f)
+    {
+      return triangle;
+    }
+
+    // Both sides of an occluder occlude, so clockwise triangles are made counter-clockwise instead of being culled.
+    if (area < 0.0f)
+    {
+      std::swap(vertices[1], vertices[2]);
+      area = -area;
+    }
+
+    // Pixel centers are at +0.5, so these are the pixels with centers within the bounds of the triangle.
+    auto min_x = std::min({ vertices[0][0], vertices[1][0], vertices[2][0] });
+    auto min_y = std::min({ vertices[0][1], vertices[1][1], vertices[2][1] });
+    auto max_x = std::max({ vertices[0][0], vertices[1][0], vertices[2][0] });
+    auto max_y = std::max({ vertices[0][1], vertices[1][1], vertices[2][1] });
+    triangle.pixel_bounds =
+    {
+      std::max(static_cast<int32_t>(std::ceil(min_x - 0.5f)), 0),
+      std::max(static_cast<int32_t>(std::ceil(min_y - 0.5f)), 0),
+      std::min(static_cast<int32_t>(std::floor(max_x - 0.5f)), static_cast<int32_t>(occlusion_buffer.width) - 1),
+      std::min(static_cast<int32_t>(std::floor(max_y - 0.5f)), static_cast<int32_t>(occlusion_buffer.height) - 1)
+    };
+
+    if (triangle.pixel_bounds[0] > triangle.pixel_bounds[2] || triangle.pixel_bounds[1] > triangle.pixel_bounds[3])
+    {
+      return triangle;
+    }
+
+    // The edge from vertex i to vertex i + 1 (the edge function is 0 on the edge and positive towards the remaining vertex).
+    for (auto edge_index = uint32_t(0); edge_index < 3; edge_index++)
+    {
+      auto& from = vertices[edge_index];
+      auto& to = vertices[(edge_index + 1) % 3];
+
+      auto a = from[1] - to[1];
+      auto b = to[0] - from[0];
+      triangle.edges[edge_index] = { a, b, -(a * from[0] + b * from[1]) };
+    }
+
+    // The depth is interpolated with the barycentric coordinates of vertex 1 (edge 2's function) and vertex 2 (edge 0's function).
+    auto depth_1 = (vertices[1][2] - vertices[0][2]) / area;
+    auto depth_2 = (vertices[2][2] - vertices[0][2]) / area;
+    triangle.depth =
+    {
+      triangle.edges[2][0] * depth_1 + triangle.edges[0][0] * depth_2,
+      triangle.edges[2][1] * depth_1 + triangle.edges[0][1] * depth_2,
+      vertices[0][2] + triangle.edges[2][2] * depth_1 + triangle.edges[0][2] * depth_2
+    };
+
+    // Offset the plane so that it gives the farthest depth over a pixel rather than the depth at its center, so that the slope of a triangle can't hide anything that is in front of it elsewhere within the pixel.
+    triangle.depth[2] += 0.5f * (std::abs(triangle.depth[0]) + std::abs(triangle.depth[1]));
+
+    triangle.valid = true;
+
+    return triangle;
+  }
+
+  void rasterize(occlusion_buffer& occlusion_buffer, const occlusion_triangle& triangle, const std::array<int32_t, 4>& tile_bounds)
+  {
+    auto& depths = occlusion_buffer.levels[0];
+
+    auto min_y = std::max(triangle.pixel_bounds[1], tile_bounds[1]);
+    auto max_y = std::min(triangle.pixel_bounds[3], tile_bounds[3]);
+
+    // Rows are processed in groups of 4 pixels aligned to the tile (which is a multiple of 4 wide), so they never stray into another tile.
+    // Pixels outside the triangle's bounds are also outside of its edges, so they are masked out.
+    auto min_x = std::max(triangle.pixel_bounds[0], tile_bounds[0]) & ~3;
+    auto max_x = std::min(triangle.pixel_bounds[2], tile_bounds[2]);
+
+    for (auto y = min_y; y <= max_y; y++)
+    {
+      auto center_y = static_cast<float>(y) + 0.5f;
+      auto row = depths.data() + y * occlusion_buffer.width;
+
+      auto x = min_x;
+
+#if defined(__SSE2__) || defined(_M_X64)
+      // Plain arrays, since the alignment attributes of __m128 are ignored as a template argument.
+      __m128 edge_rows[3];
+      __m128 edge_steps[3];
+      for (auto edge_index = uint32_t(0); edge_index < 3; edge_index++)
+      {
+        auto& edge = triangle.edges[edge_index];
+        edge_rows[edge_index] = _mm_set1_ps(edge[1] * center_y + edge[2]);
+        edge_steps[edge_index] = _mm_set1_ps(edge[0]);
+      }
+
+      auto depth_row = _mm_set1_ps(triangle.depth[1] * center_y + triangle.depth[2]);
+      auto depth_step = _mm_set1_ps(triangle.depth[0]);
+
+      for (; x <= max_x; x += 4)
+      {
+        auto center_x = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f));
+
+        auto inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edge_steps[0], center_x), edge_rows[0]), _mm_setzero_ps());
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edge_steps[1], center_x), edge_rows[1]), _mm_setzero_ps()));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edge_steps[2], center_x), edge_rows[2]), _mm_setzero_ps()));
+
+        if (_mm_movemask_ps(inside) == 0)
+        {
+          continue;
+        }
+
+        auto depth = _mm_add_ps(_mm_mul_ps(depth_step, center_x), depth_row);
+        auto existing_depth = _mm_loadu_ps(row + x);
+        auto nearest_depth = _mm_min_ps(existing_depth, depth);
+
+        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest_depth), _mm_andnot_ps(inside, existing_depth)));
+      }
+#endif
+
+      for (; x <= max_x; x++)
+      {
+        auto center_x = static_cast<float>(x) + 0.5f;
+
+        auto inside = true;
+        for (auto& edge : triangle.edges)
+        {
+          inside = inside && edge[0] * center_x + edge[1] * center_y + edge[2] >= 0.0f;
+        }
+
+        if (inside)
+        {
+          row[x] = std::min(row[x], triangle.depth[0] * center_x + triangle.depth[1] * center_y + triangle.depth[2]);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,69 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "../rendering.h"
+#include "bounds.h"
+#include "frustum.h"
+
+namespace ludo
+{
+  ///
+  /// A low resolution depth buffer that occluders are rasterized into on the CPU, so that bounds hidden behind them can be culled.
+  /// The depths are normalized device depths mapped to [0, 1] (with 1 being the far plane).
+  struct occlusion_buffer
+  {
+    uint32_t width = 256; ///< The width (in pixels). Must be a power of 2 and a multiple of tile_size.
+    uint32_t height = 128; ///< The height (in pixels). Must be a power of 2 and a multiple of tile_size.
+    uint32_t tile_size = 32; ///< The size of the square tiles that are rasterized in parallel (in pixels). Must be a multiple of 4.
+
+    mat4 view_projection; ///< The view projection of the camera the occluders and bounds are projected with.
+    std::vector<std::vector<float>> levels; ///< The nearest occluder depth of each pixel (level 0) followed by the levels of a pyramid, each holding the maximum depth of 2x2 texels of the previous level.
+  };
+
+  ///
+  /// Initializes an occlusion buffer.
+  /// \param occlusion_buffer The occlusion buffer.
+  void init(occlusion_buffer& occlusion_buffer);
+
+  ///
+  /// Removes all occluders from an occlusion buffer and sets the camera they are viewed through.
+  /// \param occlusion_buffer The occlusion buffer.
+  /// \param camera The camera.
+  void clear(occlusion_buffer& occlusion_buffer, const camera& camera);
+
+  ///
+  /// Rasterizes occluders into an occlusion buffer. The triangles are projected and then rasterized a tile at a time, in parallel (see thread_pool_parallel_for).
+  /// Pixels are covered when their centers are within a triangle (as on the GPU), so bounds that are hidden except for less than a pixel may be considered occluded.
+  /// The depth written to a covered pixel is the farthest depth of the triangle's plane over the whole pixel. Triangles that cross the near plane are skipped.
+  /// Occluders should be simple (e.g. low detail meshes) and solid, since anything behind them is treated as hidden.
+  /// \param occlusion_buffer The occlusion buffer.
+  /// \param positions The positions of the vertices of the occluders (in world space).
+  /// \param indices The indices of the triangles of the occluders (a triangle list).
+  void add_occluders(occlusion_buffer& occlusion_buffer, const std::vector<vec3>& positions, const std::vector<uint32_t>& indices);
+
+  ///
+  /// Builds the pyramid of an occlusion buffer. Must be called after the occluders are added and before testing for occlusion.
+  /// \param occlusion_buffer The occlusion buffer.
+  void commit(occlusion_buffer& occlusion_buffer);
+
+  ///
+  /// Determines if an AABB is hidden behind the occluders of an occlusion buffer.
+  /// The screen rectangle and nearest depth of the AABB are compared with the level of the pyramid where the rectangle covers at most 2x2 texels.
+  /// AABBs that cross the near plane or are off screen are never considered occluded.
+  /// \param occlusion_buffer The occlusion buffer.
+  /// \param bounds The AABB.
+  /// \return True if the AABB is occluded, false otherwise.
+  bool occluded(const occlusion_buffer& occlusion_buffer, const aabb3& bounds);
+
+  ///
+  /// Determines if AABBs are hidden behind the occluders of an occlusion buffer, in parallel (see thread_pool_parallel_for).
+  /// \param occlusion_buffer The occlusion buffer.
+  /// \param bounds The AABBs.
+  /// \return For each AABB, 1 if it is occluded or 0 otherwise.
+  std::vector<uint8_t> occluded(const occlusion_buffer& occlusion_buffer, const aabb3_soa& bounds);
+}
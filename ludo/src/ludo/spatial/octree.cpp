@@ -3,7 +3,9 @@
  */
 
 #include <cmath>
+#include <limits>
 
+#include "../thread_pool.h"
 #include "octree.h"
 
 namespace ludo
@@ -12,59 +14,105 @@ namespace ludo
   vec3 cell_dimensions(const octree& octree);
   uint32_t cell_element_index(const octree& octree, uint32_t cell_index, uint32_t element);
   std::vector<uint32_t> cell_elements(const octree& octree, uint32_t cell_index);
-  uint64_t cell_offset(const octree& octree, uint32_t cell_index);
   std::array<aabb3, 8> octant_bounds(const aabb3& bounds);
+  uint32_t spread_bits_3d(uint32_t value);
+  void remove_at(octree& octree, uint32_t cell_index, uint32_t element_index);
   uint32_t to_index(const octree& octree, const std::array<uint32_t, 3>& cell_coordinates);
   std::array<uint32_t, 3> to_cell_coordinates(const octree& octree, const vec3& position);
 
   void init(octree& octree)
   {
-    octree.id = next_id++;
-
-    auto cell_count = static_cast<uint32_t>(std::pow(8, octree.divisions));
-    auto cell_size = sizeof(uint32_t) + octree.cell_capacity * sizeof(uint32_t);
+    assert(octree.divisions <= 10 && "too many divisions");
 
-    auto data_size = cell_count * cell_size;
-    octree.buffer = allocate(data_size);
+    octree.id = next_id++;
 
-    auto offset = uint32_t(0);
-    for (auto cell_index = uint32_t(0); cell_index < cell_count; cell_index++)
+    octree.pool =
     {
-      cast<uint32_t>(octree.buffer, offset) = 0;
-      offset += cell_size;
-    }
+      .cell_count = uint32_t(1) << (3 * octree.divisions),
+      .capacity = octree.cell_capacity,
+      .entry_size = sizeof(uint32_t)
+    };
+
+    octree.buffer = init(octree.pool);
   }
 
   void de_init(octree& octree)
   {
     deallocate(octree.buffer);
+    octree.locations.clear();
   }
 
   void add(octree& octree, uint32_t element, const ludo::vec3& position)
   {
     auto index = to_index(octree, to_cell_coordinates(octree, position));
-    auto offset = cell_offset(octree, index);
-    auto stream = ludo::stream(octree.buffer, offset);
 
-    auto element_count = peek<uint32_t>(stream);
+    if (octree.track_locations)
+    {
+      assert(!octree.locations.contains(element) && "element already added");
+      octree.locations[element] = { .cell_index = index, .slot = count(octree.pool, octree.buffer, index) };
+    }
+
+    cast<uint32_t>(octree.buffer, add(octree.pool, octree.buffer, index)) = element;
+  }
+
+  void build(octree& octree, const std::vector<uint32_t>& elements, const std::vector<vec3>& positions)
+  {
+    assert(elements.size() == positions.size() && "elements and positions must be the same size");
+
+    auto element_count = static_cast<uint32_t>(elements.size());
+    auto cell_indices = std::vector<uint32_t>(element_count);
 
-    assert(element_count < octree.cell_capacity && "cell is full");
+    auto batch_count = std::max(uint32_t(1), std::min(thread_pool_size() + 1, element_count / 1024));
+    auto batch_size = (element_count + batch_count - 1) / batch_count;
+    thread_pool_parallel_for(batch_count, [&](uint32_t batch_index)
+    {
+      for (auto element_index = batch_index * batch_size; element_index < std::min((batch_index + 1) * batch_size, element_count); element_index++)
+      {
+        cell_indices[element_index] = to_index(octree, to_cell_coordinates(octree, positions[element_index]));
+      }
+    });
+
+    deallocate(octree.buffer);
+    octree.buffer = init(octree.pool, cell_indices, [&](buffer& buffer, uint64_t offset, uint32_t element_index)
+    {
+      cast<uint32_t>(buffer, offset) = elements[element_index];
+    });
 
-    write(stream, element_count + 1);
-    stream.position += element_count * sizeof(uint32_t);
-    write(stream, element);
+    octree.locations.clear();
+    if (octree.track_locations)
+    {
+      for (auto cell_index = uint32_t(0); cell_index < octree.pool.cell_count; cell_index++)
+      {
+        auto slot = uint32_t(0);
+        for_each_entry(octree.pool, octree.buffer, cell_index, [&](uint64_t offset)
+        {
+          auto element = cast<uint32_t>(octree.buffer, offset);
+          assert(!octree.locations.contains(element) && "element already added");
+          octree.locations[element] = { .cell_index = cell_index, .slot = slot++ };
+        });
+      }
+    }
   }
 
   void remove(octree& octree, uint32_t element, const ludo::vec3& position)
   {
+    if (octree.track_locations)
+    {
+      auto location_iter = octree.locations.find(element);
+      assert(location_iter != octree.locations.end() && "element not found");
+
+      remove_at(octree, location_iter->second.cell_index, location_iter->second.slot);
+      return;
+    }
+
     auto cell_coordinates = to_cell_coordinates(octree, position);
     auto cell_index = to_index(octree, cell_coordinates);
     auto element_index = cell_element_index(octree, cell_index, element);
 
-    if (element_index == octree.cell_capacity)
+    if (element_index == std::numeric_limits<uint32_t>::max())
     {
       // Search adjacent cells in case of floating point precision errors
-      auto cell_count_1d = uint32_t(std::pow(2, octree.divisions));
+      auto cell_count_1d = uint32_t(1) << octree.divisions;
       auto offsets = std::array<int32_t, 3> { -1, 0, 1 };
       for (auto offset_x : offsets)
       {
@@ -95,38 +143,42 @@ namespace ludo
 
             cell_index = to_index(octree, adjacent_cell_coordinates);
             element_index = cell_element_index(octree, cell_index, element);
-            if (element_index < octree.cell_capacity)
+            if (element_index != std::numeric_limits<uint32_t>::max())
             {
               break;
             }
           }
 
-          if (element_index < octree.cell_capacity)
+          if (element_index != std::numeric_limits<uint32_t>::max())
           {
             break;
           }
         }
 
-        if (element_index < octree.cell_capacity)
+        if (element_index != std::numeric_limits<uint32_t>::max())
         {
           break;
         }
       }
     }
 
-    assert(element_index < octree.cell_capacity && "element not found");
+    assert(element_index != std::numeric_limits<uint32_t>::max() && "element not found");
+
+    remove_at(octree, cell_index, element_index);
+  }
+
+  void move(octree& octree, uint32_t element, const ludo::vec3& old_position, const ludo::vec3& new_position)
+  {
+    auto old_cell_index = octree.track_locations ? octree.locations.at(element).cell_index : to_index(octree, to_cell_coordinates(octree, old_position));
+    auto new_cell_index = to_index(octree, to_cell_coordinates(octree, new_position));
 
-    auto offset = cell_offset(octree, cell_index);
-    auto stream = ludo::stream(octree.buffer, offset);
+    if (old_cell_index == new_cell_index)
+    {
+      return;
+    }
 
-    auto element_count = peek<uint32_t>(stream) - 1;
-    write(stream, element_count);
-    stream.position += element_index * sizeof(uint32_t);
-    std::memmove(
-      octree.buffer.data + stream.position,
-      octree.buffer.data + stream.position + sizeof(uint32_t),
-      (element_count - element_index) * sizeof(uint32_t)
-    );
+    remove(octree, element, old_position);
+    add(octree, element, new_position);
   }
 
   std::vector<uint32_t> find(const octree& octree, const std::function<int32_t(const aabb3& bounds)>& test)
@@ -162,46 +214,51 @@ namespace ludo
 
   vec3 cell_dimensions(const octree& octree)
   {
-    auto cell_count_1d = uint32_t(std::pow(2, octree.divisions));
     auto bounds_size = octree.bounds.max - octree.bounds.min;
-    return bounds_size / static_cast<float>(cell_count_1d);
+    return bounds_size / static_cast<float>(uint32_t(1) << octree.divisions);
   }
 
   uint32_t cell_element_index(const octree& octree, uint32_t cell_index, uint32_t element)
   {
-    auto offset = cell_offset(octree, cell_index);
-    auto stream = ludo::stream(octree.buffer, offset);
+    auto element_index = uint32_t(0);
+    auto found_element_index = std::numeric_limits<uint32_t>::max();
 
-    auto element_count = read<uint32_t>(stream);
-    for (auto element_index = uint32_t(0); element_index < element_count; element_index++)
+    for_each_entry(octree.pool, octree.buffer, cell_index, [&](uint64_t offset)
     {
-      if (read<uint32_t>(stream) == element)
+      if (cast<uint32_t>(octree.buffer, offset) == element)
       {
-        return element_index;
+        found_element_index = element_index;
       }
-    }
 
-    return octree.cell_capacity;
+      element_index++;
+    });
+
+    return found_element_index;
   }
 
   std::vector<uint32_t> cell_elements(const octree& octree, uint32_t cell_index)
   {
     auto elements = std::vector<uint32_t>();
-    auto offset = cell_offset(octree, cell_index);
-    auto stream = ludo::stream(octree.buffer, offset);
-
-    auto element_count = read<uint32_t>(stream);
-    for (auto element_index = uint32_t(0); element_index < element_count; element_index++)
+    for_each_entry(octree.pool, octree.buffer, cell_index, [&](uint64_t offset)
     {
-      elements.push_back(read<uint32_t>(stream));
-    }
+      elements.push_back(cast<uint32_t>(octree.buffer, offset));
+    });
 
     return elements;
   }
 
-  uint64_t cell_offset(const octree& octree, uint32_t cell_index)
+  void remove_at(octree& octree, uint32_t cell_index, uint32_t element_index)
   {
-    return cell_index * (sizeof(uint32_t) + octree.cell_capacity * sizeof(uint32_t));
+    if (octree.track_locations)
+    {
+      octree.locations.erase(cast<uint32_t>(octree.buffer, entry_offset(octree.pool, octree.buffer, cell_index, element_index)));
+    }
+
+    // The last element of the cell may be moved into the gap.
+    if (remove(octree.pool, octree.buffer, cell_index, element_index) && octree.track_locations)
+    {
+      octree.locations[cast<uint32_t>(octree.buffer, entry_offset(octree.pool, octree.buffer, cell_index, element_index))].slot = element_index;
+    }
   }
 
   std::array<aabb3, 8> octant_bounds(const aabb3& bounds)
@@ -236,10 +293,22 @@ namespace ludo
     }};
   }
 
+  uint32_t spread_bits_3d(uint32_t value)
+  {
+    // Moves each of the lower 10 bits to every third bit.
+    value &= 0x000003ff;
+    value = (value | (value << 16)) & 0x030000ff;
+    value = (value | (value << 8)) & 0x0300f00f;
+    value = (value | (value << 4)) & 0x030c30c3;
+    value = (value | (value << 2)) & 0x09249249;
+
+    return value;
+  }
+
   uint32_t to_index(const octree& octree, const std::array<uint32_t, 3>& cell_coordinates)
   {
-    auto cell_count_1d = uint32_t(std::pow(2, octree.divisions));
-    return cell_coordinates[0] * cell_count_1d * cell_count_1d + cell_coordinates[1] * cell_count_1d + cell_coordinates[2];
+    // The cells are in Morton order, which matches the order find visits the octants in (x is the lowest bit of each octant index).
+    return spread_bits_3d(cell_coordinates[0]) | (spread_bits_3d(cell_coordinates[1]) << 1) | (spread_bits_3d(cell_coordinates[2]) << 2);
   }
 
   std::array<uint32_t, 3> to_cell_coordinates(const octree& octree, const vec3& position)
@@ -6,20 +6,33 @@
 
 #include "../data/buffers.h"
 #include "bounds.h"
+#include "cell_pool.h"
 
 namespace ludo
 {
   ///
-  /// A linear octree.
+  /// The location of an element within an octree.
+  struct octree_location
+  {
+    uint32_t cell_index = 0; ///< The index of the cell containing the element.
+    uint32_t slot = 0; ///< The index of the element within the cell.
+  };
+
+  ///
+  /// A linear octree. The cells (the leaves) are stored in Morton order so that the cells of each node are contiguous.
   struct octree
   {
     uint64_t id = 0; ///< A unique identifier.
 
     aabb3 bounds; ///< The outer bounds.
     uint32_t divisions = 1; ///< The number of divisions (layers).
-    uint32_t cell_capacity = 16; ///< The maximum number of elements that can be added to a cell.
+    uint32_t cell_capacity = 16; ///< The number of elements stored within each cell before it spills into overflow blocks.
+
+    bool track_locations = false; ///< Determines if the location of each element is tracked so that it can be removed without searching (elements must be unique within the octree).
 
+    cell_pool pool; ///< The layout of the cells (and their overflow blocks) within the buffer.
     ludo::buffer buffer; ///< The cell data.
+    std::unordered_map<uint32_t, octree_location> locations; ///< The location of each element (if track_locations is set).
   };
 
   ///
@@ -39,13 +52,30 @@ namespace ludo
   /// \param position The position of the element.
   void add(octree& octree, uint32_t element, const ludo::vec3& position);
 
+  ///
+  /// Builds an octree from a set of elements, replacing its current contents.
+  /// The cells of the elements are determined in parallel and the elements are sorted into their cells (in Morton order) in a single pass.
+  /// This is much cheaper than adding the elements one at a time.
+  /// \param octree The octree to build.
+  /// \param elements The elements to add to the octree.
+  /// \param positions The position of each element.
+  void build(octree& octree, const std::vector<uint32_t>& elements, const std::vector<vec3>& positions);
+
   ///
   /// Removes an element from an octree.
   /// \param octree The octree to remove the element from.
   /// \param element The element to remove from the octree.
-  /// \param position The position of the element.
+  /// \param position The position of the element. Unused if track_locations is set.
   void remove(octree& octree, uint32_t element, const ludo::vec3& position);
 
+  ///
+  /// Moves an element within an octree. This does nothing if the element remains within the same cell.
+  /// \param octree The octree containing the element.
+  /// \param element The element to move.
+  /// \param old_position The position the element was added with. Unused if track_locations is set.
+  /// \param new_position The new position of the element.
+  void move(octree& octree, uint32_t element, const ludo::vec3& old_position, const ludo::vec3& new_position);
+
   ///
   /// Finds elements within an octree.
   /// \param octree The octree to search.
@@ -3,7 +3,9 @@
  */
 
 #include <cmath>
+#include <limits>
 
+#include "../thread_pool.h"
 #include "quadtree.h"
 
 namespace ludo
@@ -12,27 +14,25 @@ namespace ludo
   vec2 cell_dimensions(const quadtree& quadtree);
   uint32_t cell_element_index(const quadtree& quadtree, uint32_t cell_index, uint32_t element);
   std::vector<uint32_t> cell_elements(const quadtree& quadtree, uint32_t cell_index);
-  uint64_t cell_offset(const quadtree& quadtree, uint32_t cell_index);
   std::array<aabb2, 4> quadrant_bounds(const aabb2& bounds);
+  uint32_t spread_bits_2d(uint32_t value);
   uint32_t to_index(const quadtree& quadtree, const std::array<uint32_t, 2>& cell_coordinates);
   std::array<uint32_t, 2> to_cell_coordinates(const quadtree& quadtree, const vec2& position);
 
   void init(quadtree& quadtree)
   {
-    quadtree.id = next_id++;
-
-    auto cell_count = static_cast<uint32_t>(std::pow(4, quadtree.divisions));
-    auto cell_size = sizeof(uint32_t) + quadtree.cell_capacity * sizeof(uint32_t);
+    assert(quadtree.divisions <= 15 && "too many divisions");
 
-    auto data_size = cell_count * cell_size;
-    quadtree.buffer = allocate(data_size);
+    quadtree.id = next_id++;
 
-    auto offset = uint32_t(0);
-    for (auto cell_index = uint32_t(0); cell_index < cell_count; cell_index++)
+    quadtree.pool =
     {
-      cast<uint32_t>(quadtree.buffer, offset) = 0;
-      offset += cell_size;
-    }
+      .cell_count = uint32_t(1) << (2 * quadtree.divisions),
+      .capacity = quadtree.cell_capacity,
+      .entry_size = sizeof(uint32_t)
+    };
+
+    quadtree.buffer = init(quadtree.pool);
   }
 
   void de_init(quadtree& quadtree)
@@ -43,16 +43,32 @@ namespace ludo
   void add(quadtree& quadtree, uint32_t element, const ludo::vec2& position)
   {
     auto index = to_index(quadtree, to_cell_coordinates(quadtree, position));
-    auto offset = cell_offset(quadtree, index);
-    auto stream = ludo::stream(quadtree.buffer, offset);
 
-    auto element_count = peek<uint32_t>(stream);
+    cast<uint32_t>(quadtree.buffer, add(quadtree.pool, quadtree.buffer, index)) = element;
+  }
 
-    assert(element_count < quadtree.cell_capacity && "cell is full");
+  void build(quadtree& quadtree, const std::vector<uint32_t>& elements, const std::vector<vec2>& positions)
+  {
+    assert(elements.size() == positions.size() && "elements and positions must be the same size");
 
-    write(stream, element_count + 1);
-    stream.position += element_count * sizeof(uint32_t);
-    write(stream, element);
+    auto element_count = static_cast<uint32_t>(elements.size());
+    auto cell_indices = std::vector<uint32_t>(element_count);
+
+    auto batch_count = std::max(uint32_t(1), std::min(thread_pool_size() + 1, element_count / 1024));
+    auto batch_size = (element_count + batch_count - 1) / batch_count;
+    thread_pool_parallel_for(batch_count, [&](uint32_t batch_index)
+    {
+      for (auto element_index = batch_index * batch_size; element_index < std::min((batch_index + 1) * batch_size, element_count); element_index++)
+      {
+        cell_indices[element_index] = to_index(quadtree, to_cell_coordinates(quadtree, positions[element_index]));
+      }
+    });
+
+    deallocate(quadtree.buffer);
+    quadtree.buffer = init(quadtree.pool, cell_indices, [&](buffer& buffer, uint64_t offset, uint32_t element_index)
+    {
+      cast<uint32_t>(buffer, offset) = elements[element_index];
+    });
   }
 
   void remove(quadtree& quadtree, uint32_t element, const ludo::vec2& position)
@@ -61,10 +77,10 @@ namespace ludo
     auto cell_index = to_index(quadtree, cell_coordinates);
     auto element_index = cell_element_index(quadtree, cell_index, element);
 
-    if (element_index == quadtree.cell_capacity)
+    if (element_index == std::numeric_limits<uint32_t>::max())
     {
       // Search adjacent cells in case of floating point precision errors
-      auto cell_count_1d = uint32_t(std::pow(2, quadtree.divisions));
+      auto cell_count_1d = uint32_t(1) << quadtree.divisions;
       auto offsets = std::array<int32_t, 3> { -1, 0, 1 };
       for (auto offset_x : offsets)
       {
@@ -88,32 +104,22 @@ namespace ludo
 
           cell_index = to_index(quadtree, adjacent_cell_coordinates);
           element_index = cell_element_index(quadtree, cell_index, element);
-          if (element_index < quadtree.cell_capacity)
+          if (element_index != std::numeric_limits<uint32_t>::max())
           {
             break;
           }
         }
 
-        if (element_index < quadtree.cell_capacity)
+        if (element_index != std::numeric_limits<uint32_t>::max())
         {
           break;
         }
       }
     }
 
-    assert(element_index < quadtree.cell_capacity && "element not found");
-
-    auto offset = cell_offset(quadtree, cell_index);
-    auto stream = ludo::stream(quadtree.buffer, offset);
+    assert(element_index != std::numeric_limits<uint32_t>::max() && "element not found");
 
-    auto element_count = peek<uint32_t>(stream) - 1;
-    write(stream, element_count);
-    stream.position += element_index * sizeof(uint32_t);
-    std::memmove(
-      quadtree.buffer.data + stream.position,
-      quadtree.buffer.data + stream.position + sizeof(uint32_t),
-      (element_count - element_index) * sizeof(uint32_t)
-    );
+    remove(quadtree.pool, quadtree.buffer, cell_index, element_index);
   }
 
   std::vector<uint32_t> find(const quadtree& quadtree, const std::function<int32_t(const aabb2& bounds)>& test)
@@ -149,48 +155,39 @@ namespace ludo
 
   vec2 cell_dimensions(const quadtree& quadtree)
   {
-    auto cell_count_1d = uint32_t(std::pow(2, quadtree.divisions));
     auto bounds_size = quadtree.bounds.max - quadtree.bounds.min;
-    return bounds_size / static_cast<float>(cell_count_1d);
+    return bounds_size / static_cast<float>(uint32_t(1) << quadtree.divisions);
   }
 
   uint32_t cell_element_index(const quadtree& quadtree, uint32_t cell_index, uint32_t element)
   {
-    auto offset = cell_offset(quadtree, cell_index);
-    auto stream = ludo::stream(quadtree.buffer, offset);
+    auto element_index = uint32_t(0);
+    auto found_element_index = std::numeric_limits<uint32_t>::max();
 
-    auto element_count = read<uint32_t>(stream);
-    for (auto element_index = uint32_t(0); element_index < element_count; element_index++)
+    for_each_entry(quadtree.pool, quadtree.buffer, cell_index, [&](uint64_t offset)
     {
-      if (read<uint32_t>(stream) == element)
+      if (cast<uint32_t>(quadtree.buffer, offset) == element)
       {
-        return element_index;
+        found_element_index = element_index;
       }
-    }
 
-    return quadtree.cell_capacity;
+      element_index++;
+    });
+
+    return found_element_index;
   }
 
   std::vector<uint32_t> cell_elements(const quadtree& quadtree, uint32_t cell_index)
   {
     auto elements = std::vector<uint32_t>();
-    auto offset = cell_offset(quadtree, cell_index);
-    auto stream = ludo::stream(quadtree.buffer, offset);
-
-    auto element_count = read<uint32_t>(stream);
-    for (auto element_index = uint32_t(0); element_index < element_count; element_index++)
+    for_each_entry(quadtree.pool, quadtree.buffer, cell_index, [&](uint64_t offset)
     {
-      elements.push_back(read<uint32_t>(stream));
-    }
+      elements.push_back(cast<uint32_t>(quadtree.buffer, offset));
+    });
 
     return elements;
   }
 
-  uint64_t cell_offset(const quadtree& quadtree, uint32_t cell_index)
-  {
-    return cell_index * (sizeof(uint32_t) + quadtree.cell_capacity * sizeof(uint32_t));
-  }
-
   std::array<aabb2, 4> quadrant_bounds(const aabb2& bounds)
   {
     auto center = (bounds.min + bounds.max) / 2.0f;
@@ -214,10 +211,22 @@ namespace ludo
     }};
   }
 
+  uint32_t spread_bits_2d(uint32_t value)
+  {
+    // Moves each of the lower 16 bits to every second bit.
+    value &= 0x0000ffff;
+    value = (value | (value << 8)) & 0x00ff00ff;
+    value = (value | (value << 4)) & 0x0f0f0f0f;
+    value = (value | (value << 2)) & 0x33333333;
+    value = (value | (value << 1)) & 0x55555555;
+
+    return value;
+  }
+
   uint32_t to_index(const quadtree& quadtree, const std::array<uint32_t, 2>& cell_coordinates)
   {
-    auto cell_count_1d = uint32_t(std::pow(2, quadtree.divisions));
-    return cell_coordinates[0] * cell_count_1d + cell_coordinates[1];
+    // The cells are in Morton order, which matches the order find visits the quadrants in (x is the lowest bit of each quadrant index).
+    return spread_bits_2d(cell_coordinates[0]) | (spread_bits_2d(cell_coordinates[1]) << 1);
   }
 
   std::array<uint32_t, 2> to_cell_coordinates(const quadtree& quadtree, const vec2& position)
@@ -6,19 +6,21 @@
 
 #include "../data/buffers.h"
 #include "bounds.h"
+#include "cell_pool.h"
 
 namespace ludo
 {
   ///
-  /// A linear quadtree.
+  /// A linear quadtree. The cells (the leaves) are stored in Morton order so that the cells of each node are contiguous.
   struct quadtree
   {
     uint64_t id = 0; ///< A unique identifier.
 
     aabb2 bounds; ///< The outer bounds.
     uint32_t divisions = 1; ///< The number of divisions (layers).
-    uint32_t cell_capacity = 16; ///< The maximum number of elements that can be added to a cell.
+    uint32_t cell_capacity = 16; ///< The number of elements stored within each cell before it spills into overflow blocks.
 
+    cell_pool pool; ///< The layout of the cells (and their overflow blocks) within the buffer.
     ludo::buffer buffer; ///< The cell data.
   };
 
@@ -39,6 +41,15 @@ namespace ludo
   /// \param position The position of the element.
   void add(quadtree& quadtree, uint32_t element, const ludo::vec2& position);
 
+  ///
+  /// Builds a quadtree from a set of elements, replacing its current contents.
+  /// The cells of the elements are determined in parallel and the elements are sorted into their cells (in Morton order) in a single pass.
+  /// This is much cheaper than adding the elements one at a time.
+  /// \param quadtree The quadtree to build.
+  /// \param elements The elements to add to the quadtree.
+  /// \param positions The position of each element.
+  void build(quadtree& quadtree, const std::vector<uint32_t>& elements, const std::vector<vec2>& positions);
+
   ///
   /// Removes an element from an quadtree.
   /// \param quadtree The quadtree to remove the element from.
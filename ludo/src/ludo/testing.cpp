@@ -2,9 +2,11 @@
  * This file is part of ludo. See the LICENSE file for the full license governing this code.
  */
 
+#include <iomanip>
 #include <iostream>
 
 #include "testing.h"
+#include "timer.h"
 
 namespace ludo
 {
@@ -32,4 +34,16 @@ namespace ludo
 
     return test_failed_logs.empty() ? 0 : 1;
   }
+
+  void benchmark(const std::string& name, uint32_t iterations, const std::function<void()>& function)
+  {
+    auto timer = ludo::timer();
+    for (auto iteration = uint32_t(0); iteration < iterations; iteration++)
+    {
+      function();
+    }
+
+    auto milliseconds = elapsed(timer) * 1000.0f / static_cast<float>(iterations);
+    std::cout << std::fixed << std::setprecision(4) << name << ": " << milliseconds << "ms (" << iterations << " iterations)" << std::endl;
+  }
 }
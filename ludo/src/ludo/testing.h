@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -26,6 +27,8 @@ namespace ludo
   void test_near(const std::string& name, T actual, T expected);
 
   int32_t test_finalize();
+
+  void benchmark(const std::string& name, uint32_t iterations, const std::function<void()>& function);
 }
 
 #include "testing.hpp"
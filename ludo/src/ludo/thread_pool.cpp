@@ -2,6 +2,8 @@
  * This file is part of ludo. See the LICENSE file for the full license governing this code.
  */
 
+#include <atomic>
+#include <memory>
 #include <queue>
 #include <thread>
 
@@ -12,13 +14,14 @@ namespace ludo
   static auto queue = std::queue<std::function<void()>>();
   static auto mutex = std::mutex();
   static auto semaphore = std::counting_semaphore(0);
+  static auto thread_count = std::atomic<uint32_t>(0);
 
   void thread_pool_start()
   {
-    static auto threads = std::vector<std::thread>();
-    while (threads.size() < std::thread::hardware_concurrency())
+    while (thread_count < std::thread::hardware_concurrency())
     {
-      threads.emplace_back([]()
+      // The threads run for the lifetime of the process, so they are detached rather than joined.
+      std::thread([]()
       {
         while (true)
         {
@@ -31,10 +34,17 @@ namespace ludo
 
           task();
         }
-      });
+      }).detach();
+
+      thread_count++;
     }
   }
 
+  uint32_t thread_pool_size()
+  {
+    return thread_count;
+  }
+
   void thread_pool_enqueue(const std::function<void()>& task)
   {
     mutex.lock();
@@ -43,4 +53,42 @@ namespace ludo
 
     semaphore.release();
   }
+
+  void thread_pool_parallel_for(uint32_t batch_count, const std::function<void(uint32_t batch_index)>& function)
+  {
+    struct parallel_for_state
+    {
+      std::function<void(uint32_t batch_index)> function;
+      uint32_t batch_count = 0;
+      std::atomic<uint32_t> next_batch_index = 0;
+      std::atomic<uint32_t> completed_batch_count = 0;
+    };
+
+    // The state is shared since helper tasks may only get to run after every batch has been completed (and this function has returned).
+    auto state = std::make_shared<parallel_for_state>();
+    state->function = function;
+    state->batch_count = batch_count;
+
+    auto execute_batches = [state]()
+    {
+      for (auto batch_index = state->next_batch_index++; batch_index < state->batch_count; batch_index = state->next_batch_index++)
+      {
+        state->function(batch_index);
+        state->completed_batch_count++;
+      }
+    };
+
+    auto helper_count = std::min(thread_pool_size(), batch_count > 0 ? batch_count - 1 : 0);
+    for (auto helper_index = uint32_t(0); helper_index < helper_count; helper_index++)
+    {
+      thread_pool_enqueue(execute_batches);
+    }
+
+    execute_batches();
+
+    while (state->completed_batch_count < batch_count)
+    {
+      std::this_thread::yield();
+    }
+  }
 }
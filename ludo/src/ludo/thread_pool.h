@@ -4,14 +4,27 @@
 
 #pragma once
 
+#include <cstdint>
 #include <functional>
 
 namespace ludo
 {
   void thread_pool_start();
 
+  ///
+  /// Determines the number of threads in the thread pool.
+  /// \return The number of threads (0 if the thread pool hasn't been started).
+  uint32_t thread_pool_size();
+
   ///
   /// Executes a task in the thread pool.
   /// \param task The task to execute.
   void thread_pool_enqueue(const std::function<void()>& task);
+
+  ///
+  /// Executes a function for a number of batches in parallel and waits for all of them to complete.
+  /// The calling thread executes batches too, so this still completes (serially) if the thread pool hasn't been started.
+  /// \param batch_count The number of batches.
+  /// \param function The function to execute for each batch (given the index of the batch).
+  void thread_pool_parallel_for(uint32_t batch_count, const std::function<void(uint32_t batch_index)>& function);
 }
@@ -2,6 +2,8 @@
  * This file is part of ludo. See the LICENSE file for the full license governing this code.
  */
 
+#include <string>
+
 #include <ludo/data/buffers.h>
 #include <ludo/testing.h>
 
@@ -20,5 +22,11 @@ namespace ludo
     deallocate(buffer);
     test_equal<void*>("buffer: deallocate (data)", buffer.data, nullptr);
     test_equal("buffer: deallocate (size)", buffer.size, 0ul);
+
+    auto bytes = std::string("foobar");
+    auto data = reinterpret_cast<const std::byte*>(bytes.data());
+    test_equal("buffer: hash (empty)", hash(data, 0), uint64_t(0xcbf29ce484222325u));
+    test_equal("buffer: hash", hash(data, 6), uint64_t(0x85944171f73967e8u));
+    test_equal("buffer: hash (seed)", hash(data + 3, 3, hash(data, 3)), hash(data, 6));
   }
 }
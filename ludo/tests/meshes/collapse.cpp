@@ -0,0 +1,187 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+
+#include <ludo/meshes/clean.h>
+#include <ludo/meshes/collapse.h>
+#include <ludo/meshes/packing.h>
+#include <ludo/meshes/shapes.h>
+#include <ludo/testing.h>
+
+#include "collapse.h"
+
+namespace ludo
+{
+  mesh collapse_test_grid(heap& indices, heap& vertices, uint32_t divisions);
+  mesh collapse_test_triangles(heap& indices, heap& vertices);
+  vec3 collapse_test_normal(const mesh& mesh, const vertex_format& format, uint32_t face_index);
+
+  void test_meshes_collapse()
+  {
+    test_group("meshes collapse");
+
+    auto indices = allocate_heap(4 * 1024 * 1024);
+    auto vertices = allocate_heap(4 * 1024 * 1024);
+
+    auto sphere_counts = sphere_ico_counts(vertex_format_p, { .divisions = 4 });
+    auto sphere_face_count = sphere_counts.first / 3;
+
+    // Each collapse makes one or two faces degenerate, so collapsing can stop just short of the target face count.
+    auto sphere_1 = mesh();
+    init(sphere_1, indices, vertices, sphere_counts.first, sphere_counts.second, vertex_format_p.size);
+    sphere_ico(sphere_1, vertex_format_p, 0, 0, { .divisions = 4 });
+
+    auto sphere_1_face_count = collapse(sphere_1, vertex_format_p, { .target_face_count = 100 });
+    test_equal("collapse: target face count", sphere_1_face_count <= 100 && sphere_1_face_count >= 99, true);
+    test_equal("collapse: target face count (clean)", clean(sphere_1, sphere_1, vertex_format_p, vertex_format_p, true).first / 3, sphere_1_face_count);
+
+    // A closed surface loses two faces per collapse.
+    auto sphere_2 = mesh();
+    init(sphere_2, indices, vertices, sphere_counts.first, sphere_counts.second, vertex_format_p.size);
+    sphere_ico(sphere_2, vertex_format_p, 0, 0, { .divisions = 4 });
+
+    auto sphere_2_face_count = collapse(sphere_2, vertex_format_p, { .iterations = 10 });
+    test_equal("collapse: iterations", sphere_2_face_count, sphere_face_count - 20);
+    test_equal("collapse: iterations (clean)", clean(sphere_2, sphere_2, vertex_format_p, vertex_format_p, true).first / 3, sphere_2_face_count);
+
+    // Every collapse of a curved surface has an error, so nothing should be collapsed with a max error of zero.
+    auto sphere_3 = mesh();
+    init(sphere_3, indices, vertices, sphere_counts.first, sphere_counts.second, vertex_format_p.size);
+    sphere_ico(sphere_3, vertex_format_p, 0, 0, { .divisions = 4 });
+
+    test_equal("collapse: max error (curved)", collapse(sphere_3, vertex_format_p, { .max_error = 0.0f }), sphere_face_count);
+
+    // A flat grid collapses without error.
+    auto grid_1 = collapse_test_grid(indices, vertices, 8);
+    auto grid_1_face_count = collapse(grid_1, vertex_format_p, { .max_error = 0.0f });
+    test_equal("collapse: max error (flat)", grid_1_face_count < 8 * 8 * 2 / 4, true);
+    test_equal("collapse: max error (flat) (clean)", clean(grid_1, grid_1, vertex_format_p, vertex_format_p, true).first / 3, grid_1_face_count);
+
+    // The flat grid must not have flipped any faces, and must have kept its boundary (so the area it covers is unchanged).
+    auto flipped = false;
+    auto area = 0.0f;
+    auto min = vec3 { 1.0f, 1.0f, 1.0f };
+    auto max = vec3 { -1.0f, -1.0f, -1.0f };
+    for (auto face_index = uint32_t(0); face_index < index_count(grid_1) / 3; face_index++)
+    {
+      auto normal = collapse_test_normal(grid_1, vertex_format_p, face_index);
+      if (length2(normal) == 0.0f)
+      {
+        continue;
+      }
+
+      flipped = flipped || normal[2] < 0.0f;
+      area += normal[2] / 2.0f;
+
+      for (auto corner = uint32_t(0); corner < 3; corner++)
+      {
+        auto position = read_position(grid_1, vertex_format_p, read_index(grid_1, face_index * 3 + corner));
+        min = vec3 { std::min(min[0], position[0]), std::min(min[1], position[1]), std::min(min[2], position[2]) };
+        max = vec3 { std::max(max[0], position[0]), std::max(max[1], position[1]), std::max(max[2], position[2]) };
+      }
+    }
+
+    test_equal("collapse: open grid (no flipped faces)", flipped, false);
+    test_near("collapse: open grid boundary (area)", area, 1.0f);
+    test_near("collapse: open grid boundary (min)", min, vec3 { -0.5f, -0.5f, 0.0f });
+    test_near("collapse: open grid boundary (max)", max, vec3 { 0.5f, 0.5f, 0.0f });
+
+    // A flat chevron around an inner vertex. Its cheapest collapse (onto the right-hand tip, which shares its color) would flip the face opposite it, so it should be collapsed onto its next cheapest neighbour instead.
+    auto chevron = mesh();
+    init(chevron, indices, vertices, 12, 5, vertex_format_pc.size);
+    auto chevron_positions = std::array<vec3, 5>
+    {
+      vec3 { 0.0f, -0.2f, 0.0f },
+      vec3 { 0.0f, -1.0f, 0.0f },
+      vec3 { 1.0f, 1.0f, 0.0f },
+      vec3 { 0.0f, 0.2f, 0.0f },
+      vec3 { -1.0f, 1.0f, 0.0f }
+    };
+    auto chevron_colors = std::array<vec4, 5>
+    {
+      vec4 { 1.0f, 1.0f, 1.0f, 1.0f },
+      vec4 { 0.0f, 0.0f, 0.0f, 1.0f },
+      vec4 { 1.0f, 1.0f, 1.0f, 1.0f },
+      vec4 { 0.9f, 1.0f, 1.0f, 1.0f },
+      vec4 { 0.0f, 0.0f, 0.0f, 1.0f }
+    };
+    for (auto vertex_index = uint32_t(0); vertex_index < chevron_positions.size(); vertex_index++)
+    {
+      write_position(chevron, vertex_format_pc, vertex_index, chevron_positions[vertex_index]);
+      write_color(chevron, vertex_format_pc, vertex_index, chevron_colors[vertex_index]);
+    }
+    auto chevron_indices = std::array<uint32_t, 12> { 0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 4, 1 };
+    for (auto index_index = uint32_t(0); index_index < chevron_indices.size(); index_index++)
+    {
+      write_index(chevron, index_index, chevron_indices[index_index]);
+    }
+
+    auto chevron_face_count = collapse(chevron, vertex_format_pc, { .iterations = 1 });
+
+    auto chevron_flipped = false;
+    for (auto face_index = uint32_t(0); face_index < 4; face_index++)
+    {
+      chevron_flipped = chevron_flipped || collapse_test_normal(chevron, vertex_format_pc, face_index)[2] < 0.0f;
+    }
+
+    test_equal("collapse: flip rejected (face count)", chevron_face_count, uint32_t(2));
+    test_equal("collapse: flip rejected", chevron_flipped, false);
+    test_near("collapse: flip rejected (next cheapest)", read_position(chevron, vertex_format_pc, 0), chevron_positions[3]);
+
+    // Collapsing an edge of a lone triangle leaves its other vertices without faces, so they must not be collapsed (onto each other) afterwards.
+    auto triangles_1 = collapse_test_triangles(indices, vertices);
+    test_equal("collapse: isolated faces (iterations)", collapse(triangles_1, vertex_format_p, { .iterations = 2 }), uint32_t(0));
+
+    auto triangles_2 = collapse_test_triangles(indices, vertices);
+    test_equal("collapse: isolated faces", collapse(triangles_2, vertex_format_p, collapse_options()), uint32_t(0));
+    test_equal("collapse: isolated faces (clean)", clean(triangles_2, triangles_2, vertex_format_p, vertex_format_p, true).first, uint32_t(0));
+
+    deallocate(indices);
+    deallocate(vertices);
+  }
+
+  mesh collapse_test_grid(heap& indices, heap& vertices, uint32_t divisions)
+  {
+    auto counts = rectangle_counts(vertex_format_p, { .divisions = divisions });
+
+    auto grid = mesh();
+    init(grid, indices, vertices, counts.first, counts.second, vertex_format_p.size);
+    rectangle(grid, vertex_format_p, 0, 0, { .divisions = divisions });
+
+    return grid;
+  }
+
+  mesh collapse_test_triangles(heap& indices, heap& vertices)
+  {
+    auto triangles = mesh();
+    init(triangles, indices, vertices, 6, 6, vertex_format_p.size);
+
+    auto positions = std::array<vec3, 6>
+    {
+      vec3 { 0.0f, 0.0f, 0.0f },
+      vec3 { 2.0f, 0.0f, 0.0f },
+      vec3 { 0.0f, 1.0f, 0.0f },
+      vec3 { 4.0f, 0.0f, 0.0f },
+      vec3 { 5.0f, 0.0f, 0.0f },
+      vec3 { 4.0f, 3.0f, 0.0f }
+    };
+    for (auto vertex_index = uint32_t(0); vertex_index < positions.size(); vertex_index++)
+    {
+      write_index(triangles, vertex_index, vertex_index);
+      write_position(triangles, vertex_format_p, vertex_index, positions[vertex_index]);
+    }
+
+    return triangles;
+  }
+
+  vec3 collapse_test_normal(const mesh& mesh, const vertex_format& format, uint32_t face_index)
+  {
+    auto position_0 = read_position(mesh, format, read_index(mesh, face_index * 3));
+    auto position_1 = read_position(mesh, format, read_index(mesh, face_index * 3 + 1));
+    auto position_2 = read_position(mesh, format, read_index(mesh, face_index * 3 + 2));
+
+    return cross(position_1 - position_0, position_2 - position_0);
+  }
+}
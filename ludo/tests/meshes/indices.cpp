@@ -0,0 +1,102 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <ludo/meshes/clean.h>
+#include <ludo/meshes/optimize.h>
+#include <ludo/meshes/shapes.h>
+#include <ludo/rendering.h>
+#include <ludo/testing.h>
+
+#include "indices.h"
+
+namespace ludo
+{
+  bool indices_equal(const mesh& a, const mesh& b);
+
+  void test_meshes_indices()
+  {
+    test_group("meshes indices");
+
+    test_equal("compact_index_size small", uint32_t(compact_index_size(65536)), uint32_t(sizeof(uint16_t)));
+    test_equal("compact_index_size large", uint32_t(compact_index_size(65537)), uint32_t(sizeof(uint32_t)));
+
+    auto indices = allocate_heap(1024 * 1024);
+    auto vertices = allocate_heap(1024 * 1024);
+
+    auto box_counts = ludo::box_counts(vertex_format_pnc);
+    auto box_mesh = mesh();
+    init(box_mesh, indices, vertices, box_counts.first, box_counts.second, vertex_format_pnc.size);
+    ludo::box(box_mesh, vertex_format_pnc, 0, 0);
+
+    auto short_box_mesh = mesh();
+    init(short_box_mesh, indices, vertices, box_counts.first, box_counts.second, vertex_format_pnc.size, sizeof(uint16_t));
+    ludo::box(short_box_mesh, vertex_format_pnc, 0, 0);
+
+    test_equal("init index_size", short_box_mesh.index_size, uint32_t(sizeof(uint16_t)));
+    test_equal("init index_buffer size", short_box_mesh.index_buffer.size, uint64_t(box_counts.first * sizeof(uint16_t)));
+    test_equal("index_count", index_count(short_box_mesh), box_counts.first);
+    test_equal("box", indices_equal(short_box_mesh, box_mesh), true);
+    test_equal("box vertices", std::memcmp(short_box_mesh.vertex_buffer.data, box_mesh.vertex_buffer.data, box_mesh.vertex_buffer.size) == 0, true);
+
+    write_index(short_box_mesh, 1, 65535);
+    test_equal("write_index", read_index(short_box_mesh, 1), uint32_t(65535));
+    test_equal("write_index neighbours", read_index(short_box_mesh, 0) == read_index(box_mesh, 0) && read_index(short_box_mesh, 2) == read_index(box_mesh, 2), true);
+    write_index(short_box_mesh, 1, read_index(box_mesh, 1));
+
+    // Indices allocated after a 16-bit mesh are still aligned to their own size.
+    auto odd_mesh = mesh();
+    init(odd_mesh, indices, vertices, 3, 3, vertex_format_pnc.size, sizeof(uint16_t));
+    auto wide_mesh = mesh();
+    init(wide_mesh, indices, vertices, 3, 3, vertex_format_pnc.size);
+    test_equal("mixed alignment", (wide_mesh.index_buffer.data - indices.data) % sizeof(uint32_t) == 0, true);
+
+    auto render_mesh = ludo::render_mesh();
+    connect(render_mesh, short_box_mesh, indices, vertices);
+    test_equal("render_mesh indices start", render_mesh.indices.start, uint32_t((short_box_mesh.index_buffer.data - indices.data) / sizeof(uint16_t)));
+    test_equal("render_mesh indices count", render_mesh.indices.count, box_counts.first);
+
+    auto sphere_counts = sphere_ico_counts(vertex_format_pnc, { .divisions = 3 });
+    auto sphere = mesh();
+    init(sphere, indices, vertices, sphere_counts.first, sphere_counts.second, vertex_format_pnc.size);
+    sphere_ico(sphere, vertex_format_pnc, 0, 0, { .divisions = 3 });
+    auto short_sphere = mesh();
+    init(short_sphere, indices, vertices, sphere_counts.first, sphere_counts.second, vertex_format_pnc.size, sizeof(uint16_t));
+    sphere_ico(short_sphere, vertex_format_pnc, 0, 0, { .divisions = 3 });
+
+    auto clean_counts = clean(sphere, sphere, vertex_format_pnc, vertex_format_pnc, true);
+    auto clean_sphere = mesh();
+    init(clean_sphere, indices, vertices, clean_counts.first, clean_counts.second, vertex_format_pnc.size);
+    clean(clean_sphere, sphere, vertex_format_pnc, vertex_format_pnc);
+    auto short_clean_sphere = mesh();
+    init(short_clean_sphere, indices, vertices, clean_counts.first, clean_counts.second, vertex_format_pnc.size, sizeof(uint16_t));
+    clean(short_clean_sphere, short_sphere, vertex_format_pnc, vertex_format_pnc);
+    test_equal("clean", indices_equal(short_clean_sphere, clean_sphere), true);
+
+    optimize(clean_sphere, vertex_format_pnc, true);
+    optimize(short_clean_sphere, vertex_format_pnc, true);
+    test_equal("optimize", indices_equal(short_clean_sphere, clean_sphere), true);
+    test_equal("optimize vertices", std::memcmp(short_clean_sphere.vertex_buffer.data, clean_sphere.vertex_buffer.data, clean_sphere.vertex_buffer.size) == 0, true);
+
+    deallocate(indices);
+    deallocate(vertices);
+  }
+
+  bool indices_equal(const mesh& a, const mesh& b)
+  {
+    if (index_count(a) != index_count(b))
+    {
+      return false;
+    }
+
+    for (auto index_index = uint32_t(0); index_index < index_count(a); index_index++)
+    {
+      if (read_index(a, index_index) != read_index(b, index_index))
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+}
@@ -0,0 +1,126 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <filesystem>
+#include <sstream>
+
+#include <ludo/meshes/lmesh.h>
+#include <ludo/meshes/shapes.h>
+#include <ludo/testing.h>
+
+#include "lmesh.h"
+
+namespace ludo
+{
+  bool lmesh_equal(const mesh& a, const mesh& b);
+  bool lmesh_indices_equal(const mesh& a, const mesh& b);
+
+  void test_meshes_lmesh()
+  {
+    test_group("meshes lmesh");
+
+    auto indices = allocate_heap(1024 * 1024);
+    auto vertices = allocate_heap(1024 * 1024);
+
+    auto box_counts = ludo::box_counts(vertex_format_pnc);
+    auto box_mesh = mesh();
+    init(box_mesh, indices, vertices, box_counts.first, box_counts.second, vertex_format_pnc.size);
+    ludo::box(box_mesh, vertex_format_pnc, 0, 0);
+
+    auto sphere_counts = sphere_ico_counts(vertex_format_pnc, { .divisions = 3 });
+    auto sphere = mesh();
+    init(sphere, indices, vertices, sphere_counts.first, sphere_counts.second, vertex_format_pnc.size);
+    sphere_ico(sphere, vertex_format_pnc, 0, 0, { .center = { 1.0f, 2.0f, 3.0f }, .divisions = 3 });
+
+    auto stream = std::stringstream();
+    save(std::vector<mesh> { box_mesh, sphere }, vertex_format_pnc, stream);
+
+    auto loaded = load_all(stream, indices, vertices);
+    test_equal("load_all count", loaded.size(), size_t(2));
+    test_equal("load_all first", lmesh_equal(loaded[0], box_mesh), true);
+    test_equal("load_all second", lmesh_equal(loaded[1], sphere), true);
+    test_equal("load_all index_size", loaded[1].index_size, uint32_t(sizeof(uint16_t)));
+    test_not_equal("load_all ids", loaded[0].id, loaded[1].id);
+
+    stream.seekg(0);
+    auto second = load(stream, indices, vertices, 1);
+    test_equal("load index", lmesh_equal(second, sphere), true);
+
+    stream.seekg(0);
+    auto counts = mesh_counts(stream);
+    test_equal("mesh_counts", counts.first == box_counts.first + sphere_counts.first && counts.second == box_counts.second + sphere_counts.second, true);
+
+    auto compact_stream = std::stringstream();
+    save(sphere, vertex_format_pnc, compact_stream);
+    auto wide_stream = std::stringstream();
+    save(sphere, vertex_format_pnc, wide_stream, false);
+    test_equal("compact indices", wide_stream.str().size() - compact_stream.str().size() > sphere_counts.first, true);
+
+    auto wide_sphere = load(wide_stream, indices, vertices);
+    test_equal("wide indices", lmesh_equal(wide_sphere, sphere), true);
+    test_equal("wide index_size", wide_sphere.index_size, uint32_t(sizeof(uint32_t)));
+
+    // Version 1 files are still readable.
+    auto legacy_stream = std::stringstream();
+    legacy_stream.write(reinterpret_cast<const char*>(&box_mesh.index_buffer.size), sizeof(uint64_t));
+    legacy_stream.write(reinterpret_cast<const char*>(box_mesh.index_buffer.data), static_cast<int64_t>(box_mesh.index_buffer.size));
+    legacy_stream.write(reinterpret_cast<const char*>(&box_mesh.vertex_size), sizeof(uint32_t));
+    legacy_stream.write(reinterpret_cast<const char*>(&box_mesh.vertex_buffer.size), sizeof(uint64_t));
+    legacy_stream.write(reinterpret_cast<const char*>(box_mesh.vertex_buffer.data), static_cast<int64_t>(box_mesh.vertex_buffer.size));
+    auto legacy_box = load(legacy_stream, indices, vertices);
+    test_equal("version 1", lmesh_equal(legacy_box, box_mesh), true);
+    test_equal("version 1 index_size", legacy_box.index_size, uint32_t(sizeof(uint32_t)));
+
+    auto file_name = (std::filesystem::temp_directory_path() / "ludo-test.lmesh").string();
+    save(std::vector<mesh> { box_mesh, sphere }, vertex_format_pnc, file_name);
+
+    test_equal("mesh_key none", mesh_key(file_name), uint32_t(0));
+    save(std::vector<mesh> { box_mesh, sphere }, vertex_format_pnc, file_name, true, 42);
+    test_equal("mesh_key", mesh_key(file_name), uint32_t(42));
+
+    auto mapped = load_all(file_name, indices, vertices);
+    test_equal("load_all file", mapped.size() == 2 && lmesh_equal(mapped[0], box_mesh) && lmesh_equal(mapped[1], sphere), true);
+    auto file_counts = mesh_counts(file_name);
+    test_equal("mesh_counts file", file_counts.first == box_counts.first + sphere_counts.first && file_counts.second == box_counts.second + sphere_counts.second, true);
+
+    auto format = mesh_format(file_name, 1);
+    test_equal("mesh_format components", format.components == vertex_format_pnc.components, true);
+    test_equal("mesh_format size", format.size, vertex_format_pnc.size);
+    test_equal("mesh_format normal offset", format.normal_offset, vertex_format_pnc.normal_offset);
+    test_equal("mesh_format color offset", format.color_offset, vertex_format_pnc.color_offset);
+
+    auto sphere_bounds = bounds(sphere, vertex_format_pnc);
+    auto file_bounds = mesh_bounds(file_name, 1);
+    test_equal("mesh_bounds", file_bounds.min == sphere_bounds.min && file_bounds.max == sphere_bounds.max, true);
+
+    std::filesystem::remove(file_name);
+    test_equal("mesh_key missing file", mesh_key(file_name), uint32_t(0));
+
+    deallocate(indices);
+    deallocate(vertices);
+  }
+
+  bool lmesh_equal(const mesh& a, const mesh& b)
+  {
+    return
+      a.vertex_size == b.vertex_size &&
+      index_count(a) == index_count(b) &&
+      a.vertex_buffer.size == b.vertex_buffer.size &&
+      lmesh_indices_equal(a, b) &&
+      std::memcmp(a.vertex_buffer.data, b.vertex_buffer.data, a.vertex_buffer.size) == 0;
+  }
+
+  bool lmesh_indices_equal(const mesh& a, const mesh& b)
+  {
+    for (auto index_index = uint32_t(0); index_index < index_count(a); index_index++)
+    {
+      if (read_index(a, index_index) != read_index(b, index_index))
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+}
@@ -0,0 +1,149 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+#include <set>
+
+#include <ludo/meshes/clean.h>
+#include <ludo/meshes/meshlets.h>
+#include <ludo/meshes/optimize.h>
+#include <ludo/meshes/shapes.h>
+#include <ludo/testing.h>
+
+#include "meshlets.h"
+
+namespace ludo
+{
+  vec3 meshlet_test_position(const mesh& mesh, uint32_t index_index);
+
+  void test_meshes_meshlets()
+  {
+    test_group("meshes meshlets");
+
+    auto indices = allocate_heap(4 * 1024 * 1024);
+    auto vertices = allocate_heap(4 * 1024 * 1024);
+
+    auto sphere_counts = sphere_ico_counts(vertex_format_p, { .divisions = 6 });
+    auto sphere = mesh();
+    init(sphere, indices, vertices, sphere_counts.first, sphere_counts.second, vertex_format_p.size);
+    sphere_ico(sphere, vertex_format_p, 0, 0, { .divisions = 6 });
+
+    // Weld the vertices of the sphere so that its triangles share them.
+    auto clean_counts = clean(sphere, sphere, vertex_format_p, vertex_format_p, true);
+    auto welded_sphere = mesh();
+    init(welded_sphere, indices, vertices, clean_counts.first, clean_counts.second, vertex_format_p.size);
+    clean(welded_sphere, sphere, vertex_format_p, vertex_format_p);
+    optimize(welded_sphere, vertex_format_p);
+
+    auto meshlets = build_meshlets(welded_sphere, vertex_format_p);
+    test_equal("build_meshlets count", meshlets.size() > 1 && meshlets.size() < clean_counts.first / 3, true);
+
+    auto contiguous = true;
+    auto within_limits = true;
+    auto vertex_counts_match = true;
+    auto within_bounds = true;
+    auto within_cones = true;
+    auto cone_count = uint32_t(0);
+    auto next_index_index = uint32_t(0);
+    for (auto& meshlet : meshlets)
+    {
+      contiguous = contiguous && meshlet.indices.start == next_index_index && meshlet.indices.count % 3 == 0;
+      next_index_index = meshlet.indices.start + meshlet.indices.count;
+
+      auto unique_indices = std::set<uint32_t>();
+      for (auto index_index = meshlet.indices.start; index_index < meshlet.indices.start + meshlet.indices.count; index_index++)
+      {
+        unique_indices.insert(read_index(welded_sphere, index_index));
+        within_bounds = within_bounds && length(meshlet_test_position(welded_sphere, index_index) - meshlet.center) <= meshlet.radius + 0.0001f;
+      }
+
+      within_limits = within_limits && meshlet.vertex_count <= 64 && meshlet.indices.count / 3 <= 124;
+      vertex_counts_match = vertex_counts_match && meshlet.vertex_count == unique_indices.size();
+
+      if (meshlet.cone_cutoff == 1.0f)
+      {
+        continue;
+      }
+
+      cone_count++;
+      for (auto index_index = meshlet.indices.start; index_index < meshlet.indices.start + meshlet.indices.count; index_index += 3)
+      {
+        auto position_0 = meshlet_test_position(welded_sphere, index_index);
+        auto normal = cross(meshlet_test_position(welded_sphere, index_index + 1) - position_0, meshlet_test_position(welded_sphere, index_index + 2) - position_0);
+        normalize(normal);
+        within_cones = within_cones && dot(normal, meshlet.cone_axis) >= std::sqrt(1.0f - meshlet.cone_cutoff * meshlet.cone_cutoff) - 0.0001f;
+      }
+    }
+
+    test_equal("build_meshlets contiguous", contiguous && next_index_index == clean_counts.first, true);
+    test_equal("build_meshlets limits", within_limits, true);
+    test_equal("build_meshlets vertex counts", vertex_counts_match, true);
+    test_equal("build_meshlets bounds", within_bounds, true);
+    test_equal("build_meshlets cones", within_cones, true);
+    test_equal("build_meshlets cone count", cone_count > meshlets.size() / 2, true); // A sphere is smooth enough for most meshlets to have a cone.
+
+    auto single_triangle_meshlets = build_meshlets(welded_sphere, vertex_format_p, 3, 1);
+    test_equal("build_meshlets single triangles", single_triangle_meshlets.size(), size_t(clean_counts.first / 3));
+
+    auto camera = ludo::camera
+    {
+      .view = mat4_identity,
+      .projection = perspective(60.0f, 1.0f, 0.1f, 100.0f)
+    };
+    auto render_program = ludo::render_program { .command_buffer = allocate(meshlets.size() * sizeof(render_command)) };
+    auto render_mesh = ludo::render_mesh { .instances = { .start = 3, .count = 2 }, .indices = { .start = 100, .count = clean_counts.first }, .vertices = { .start = 10, .count = clean_counts.second } };
+
+    auto transform = mat4_identity;
+    position(transform, vec3 { 0.0f, 0.0f, -5.0f });
+    auto stats = add_render_commands(render_program, render_mesh, meshlets, transform, camera);
+    test_equal("add_render_commands meshlet count", stats.meshlet_count, uint32_t(meshlets.size()));
+    test_equal("add_render_commands triangle count", stats.triangle_count, clean_counts.first / 3);
+    test_equal("add_render_commands frustum culled", stats.frustum_culled_count, uint32_t(0));
+    test_equal("add_render_commands cone culled", stats.cone_culled_count > 0, true);
+    test_equal("add_render_commands triangles culled", stats.culled_triangle_count > 0 && stats.culled_triangle_count < stats.triangle_count, true);
+    test_equal("add_render_commands command count", stats.command_count, render_program.active_commands.count);
+
+    // Every triangle facing the camera must still be drawn.
+    auto drawn = std::vector<bool>(clean_counts.first / 3);
+    auto commands_valid = true;
+    for (auto command_index = uint32_t(0); command_index < render_program.active_commands.count; command_index++)
+    {
+      auto& render_command = cast<ludo::render_command>(render_program.command_buffer, command_index * sizeof(ludo::render_command));
+      commands_valid = commands_valid && render_command.instance_start == 3 && render_command.instance_count == 2 && render_command.vertex_start == 10;
+      for (auto index_index = render_command.index_start - 100; index_index < render_command.index_start - 100 + render_command.index_count; index_index += 3)
+      {
+        drawn[index_index / 3] = true;
+      }
+    }
+
+    auto conservative = true;
+    auto drawn_count = uint32_t(0);
+    for (auto triangle_index = uint32_t(0); triangle_index < drawn.size(); triangle_index++)
+    {
+      auto position_0 = meshlet_test_position(welded_sphere, triangle_index * 3) + position(transform);
+      auto normal = cross(meshlet_test_position(welded_sphere, triangle_index * 3 + 1) - meshlet_test_position(welded_sphere, triangle_index * 3), meshlet_test_position(welded_sphere, triangle_index * 3 + 2) - meshlet_test_position(welded_sphere, triangle_index * 3));
+      conservative = conservative && (drawn[triangle_index] || dot(normal, position_0) >= 0.0f);
+      drawn_count += drawn[triangle_index];
+    }
+
+    test_equal("add_render_commands commands", commands_valid, true);
+    test_equal("add_render_commands drawn triangles", drawn_count, stats.triangle_count - stats.culled_triangle_count);
+    test_equal("add_render_commands conservative", conservative, true);
+
+    position(transform, vec3 { 0.0f, 0.0f, 5.0f });
+    render_program.active_commands = {};
+    auto behind_stats = add_render_commands(render_program, render_mesh, meshlets, transform, camera);
+    test_equal("add_render_commands behind", behind_stats.frustum_culled_count == meshlets.size() && behind_stats.culled_triangle_count == behind_stats.triangle_count, true);
+    test_equal("add_render_commands behind commands", render_program.active_commands.count, uint32_t(0));
+
+    deallocate(render_program.command_buffer);
+    deallocate(indices);
+    deallocate(vertices);
+  }
+
+  vec3 meshlet_test_position(const mesh& mesh, uint32_t index_index)
+  {
+    return cast<vec3>(mesh.vertex_buffer, read_index(mesh, index_index) * vertex_format_p.size + vertex_format_p.position_offset);
+  }
+}
@@ -0,0 +1,168 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <numeric>
+
+#include <ludo/meshes/clean.h>
+#include <ludo/meshes/optimize.h>
+#include <ludo/meshes/packing.h>
+#include <ludo/meshes/shapes.h>
+#include <ludo/testing.h>
+
+#include "optimize.h"
+
+namespace ludo
+{
+  mesh optimize_test_mesh(heap& indices, heap& vertices, uint32_t degenerate_count);
+  std::vector<std::array<uint32_t, 3>> optimize_test_triangles(const mesh& mesh);
+
+  void test_meshes_optimize()
+  {
+    test_group("meshes optimize");
+
+    auto indices = allocate_heap(4 * 1024 * 1024);
+    auto vertices = allocate_heap(4 * 1024 * 1024);
+
+    // Vertex cache.
+    auto mesh_1 = optimize_test_mesh(indices, vertices, 0);
+    auto mesh_1_triangles = optimize_test_triangles(mesh_1);
+    auto shuffled_statistics = analyze_vertex_cache(mesh_1, vertex_format_p);
+
+    optimize_vertex_cache(mesh_1, vertex_format_p);
+    auto optimized_statistics = analyze_vertex_cache(mesh_1, vertex_format_p);
+
+    test_equal("optimize_vertex_cache: triangles", optimize_test_triangles(mesh_1) == mesh_1_triangles, true);
+    test_equal("optimize_vertex_cache: acmr", optimized_statistics.acmr < shuffled_statistics.acmr * 0.5f, true);
+    test_equal("optimize_vertex_cache: atvr", optimized_statistics.atvr < shuffled_statistics.atvr, true);
+
+    // Overdraw.
+    optimize_overdraw(mesh_1, vertex_format_p);
+    test_equal("optimize_overdraw: triangles", optimize_test_triangles(mesh_1) == mesh_1_triangles, true);
+    test_equal("optimize_overdraw: acmr", analyze_vertex_cache(mesh_1, vertex_format_p).acmr < shuffled_statistics.acmr * 0.5f, true);
+
+    // Degenerate triangles.
+    auto mesh_2 = optimize_test_mesh(indices, vertices, 5);
+    auto mesh_2_triangles = optimize_test_triangles(mesh_2);
+    optimize_vertex_cache(mesh_2, vertex_format_p);
+
+    auto degenerate_at_end = true;
+    auto triangle_count = index_count(mesh_2) / 3;
+    for (auto triangle_index = uint32_t(0); triangle_index < triangle_count; triangle_index++)
+    {
+      auto triangle = std::array<uint32_t, 3> { read_index(mesh_2, triangle_index * 3), read_index(mesh_2, triangle_index * 3 + 1), read_index(mesh_2, triangle_index * 3 + 2) };
+      auto degenerate = triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0];
+      degenerate_at_end = degenerate_at_end && degenerate == (triangle_index >= triangle_count - 5);
+    }
+
+    test_equal("optimize_vertex_cache: degenerate triangles at end", degenerate_at_end, true);
+    test_equal("optimize_vertex_cache: degenerate triangles kept", optimize_test_triangles(mesh_2) == mesh_2_triangles, true);
+
+    // Vertex fetch.
+    auto mesh_3 = optimize_test_mesh(indices, vertices, 0);
+    auto vertex_count = static_cast<uint32_t>(mesh_3.vertex_buffer.size / vertex_format_p.size);
+
+    auto corner_positions = std::vector<vec3>();
+    for (auto index_index = uint32_t(0); index_index < index_count(mesh_3); index_index++)
+    {
+      corner_positions.push_back(read_position(mesh_3, vertex_format_p, read_index(mesh_3, index_index)));
+    }
+
+    auto vertex_positions = std::vector<std::array<float, 3>>();
+    for (auto vertex_index = uint32_t(0); vertex_index < vertex_count; vertex_index++)
+    {
+      vertex_positions.push_back(read_position(mesh_3, vertex_format_p, vertex_index));
+    }
+
+    optimize_vertex_fetch(mesh_3, vertex_format_p);
+
+    auto corners_kept = true;
+    auto sequential = true;
+    auto next_vertex_index = uint32_t(0);
+    for (auto index_index = uint32_t(0); index_index < index_count(mesh_3); index_index++)
+    {
+      auto index = read_index(mesh_3, index_index);
+      corners_kept = corners_kept && read_position(mesh_3, vertex_format_p, index) == corner_positions[index_index];
+
+      // Each vertex is either one that has already been referenced or the next.
+      sequential = sequential && index <= next_vertex_index;
+      if (index == next_vertex_index)
+      {
+        next_vertex_index++;
+      }
+    }
+
+    auto optimized_vertex_positions = std::vector<std::array<float, 3>>();
+    for (auto vertex_index = uint32_t(0); vertex_index < vertex_count; vertex_index++)
+    {
+      optimized_vertex_positions.push_back(read_position(mesh_3, vertex_format_p, vertex_index));
+    }
+
+    std::sort(vertex_positions.begin(), vertex_positions.end());
+    std::sort(optimized_vertex_positions.begin(), optimized_vertex_positions.end());
+
+    test_equal("optimize_vertex_fetch: triangle positions", corners_kept, true);
+    test_equal("optimize_vertex_fetch: sequential", sequential && next_vertex_index == vertex_count, true);
+    test_equal("optimize_vertex_fetch: permutation", optimized_vertex_positions == vertex_positions, true);
+
+    deallocate(indices);
+    deallocate(vertices);
+  }
+
+  // A welded sphere with its triangles shuffled, and the given number of them replaced with degenerate triangles.
+  mesh optimize_test_mesh(heap& indices, heap& vertices, uint32_t degenerate_count)
+  {
+    auto sphere_counts = sphere_ico_counts(vertex_format_p, { .divisions = 4 });
+    auto sphere = mesh();
+    init(sphere, indices, vertices, sphere_counts.first, sphere_counts.second, vertex_format_p.size);
+    sphere_ico(sphere, vertex_format_p, 0, 0, { .divisions = 4 });
+
+    auto clean_counts = clean(sphere, sphere, vertex_format_p, vertex_format_p, true);
+    auto welded_sphere = mesh();
+    init(welded_sphere, indices, vertices, clean_counts.first, clean_counts.second, vertex_format_p.size);
+    clean(welded_sphere, sphere, vertex_format_p, vertex_format_p);
+    de_init(sphere, indices, vertices);
+
+    auto triangles = optimize_test_triangles(welded_sphere);
+    auto triangle_count = static_cast<uint32_t>(triangles.size());
+
+    // Stepping through the triangles with a stride that shares no factors with their count visits each of them once, and scatters neighbours.
+    auto stride = triangle_count / 3 + 1;
+    while (std::gcd(stride, triangle_count) != 1)
+    {
+      stride++;
+    }
+
+    // The degenerate triangles are spread out, starting with the first.
+    auto degenerate_spacing = triangle_count / (degenerate_count + 1);
+    for (auto triangle_index = uint32_t(0); triangle_index < triangle_count; triangle_index++)
+    {
+      auto triangle = triangles[triangle_index * stride % triangle_count];
+      if (triangle_index % degenerate_spacing == 0 && triangle_index / degenerate_spacing < degenerate_count)
+      {
+        triangle[2] = triangle[0];
+      }
+
+      for (auto corner = uint32_t(0); corner < 3; corner++)
+      {
+        write_index(welded_sphere, triangle_index * 3 + corner, triangle[corner]);
+      }
+    }
+
+    return welded_sphere;
+  }
+
+  // The triangles of a mesh, sorted so that they can be compared regardless of order.
+  std::vector<std::array<uint32_t, 3>> optimize_test_triangles(const mesh& mesh)
+  {
+    auto triangles = std::vector<std::array<uint32_t, 3>>(index_count(mesh) / 3);
+    for (auto triangle_index = uint32_t(0); triangle_index < triangles.size(); triangle_index++)
+    {
+      triangles[triangle_index] = { read_index(mesh, triangle_index * 3), read_index(mesh, triangle_index * 3 + 1), read_index(mesh, triangle_index * 3 + 2) };
+    }
+
+    std::sort(triangles.begin(), triangles.end());
+
+    return triangles;
+  }
+}
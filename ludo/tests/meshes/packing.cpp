@@ -0,0 +1,209 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#include <ludo/meshes/packing.h>
+#include <ludo/meshes/shapes.h>
+#include <ludo/meshes/util.h>
+#include <ludo/testing.h>
+
+#include "packing.h"
+
+namespace ludo
+{
+  bool packing_test_shape(const std::pair<uint32_t, uint32_t>& counts, const std::function<void(mesh&, const vertex_format&)>& shape);
+
+  void test_meshes_packing()
+  {
+    test_group("meshes packing");
+
+    test_equal("half zero", unpack_half(pack_half(0.0f)), 0.0f);
+    test_equal("half one", unpack_half(pack_half(1.0f)), 1.0f);
+    test_equal("half negative", unpack_half(pack_half(-2.5f)), -2.5f);
+    test_equal("half max", unpack_half(pack_half(65504.0f)), 65504.0f);
+    test_equal("half overflow", unpack_half(pack_half(100000.0f)), std::numeric_limits<float>::infinity());
+    test_equal("half infinity", unpack_half(pack_half(-std::numeric_limits<float>::infinity())), -std::numeric_limits<float>::infinity());
+    test_equal("half nan", std::isnan(unpack_half(pack_half(std::numeric_limits<float>::quiet_NaN()))), true);
+    test_equal("half denormal", unpack_half(pack_half(std::ldexp(3.0f, -24))), std::ldexp(3.0f, -24));
+    test_equal("half round to nearest even", unpack_half(pack_half(1.0f + std::ldexp(1.0f, -11))), 1.0f);
+    test_equal("half round to nearest", unpack_half(pack_half(1.0f + std::ldexp(3.0f, -12))), 1.0f + std::ldexp(1.0f, -10));
+
+    // Half floats have 11 significant bits, so the relative error of a normal value is at most 2^-11.
+    auto half_relative_error = 0.0f;
+    for (auto value = -512.0f; value < 512.0f; value += 0.0137f)
+    {
+      if (value != 0.0f)
+      {
+        half_relative_error = std::max(half_relative_error, std::abs(unpack_half(pack_half(value)) - value) / std::abs(value));
+      }
+    }
+    test_equal("half precision", half_relative_error <= std::ldexp(1.0f, -11), true);
+
+    test_near("octahedral x", unpack_octahedral(pack_octahedral(vec3_unit_x)), vec3_unit_x);
+    test_near("octahedral negative y", unpack_octahedral(pack_octahedral(vec3 { 0.0f, -1.0f, 0.0f })), vec3 { 0.0f, -1.0f, 0.0f });
+    test_near("octahedral negative z", unpack_octahedral(pack_octahedral(vec3 { 0.0f, 0.0f, -1.0f })), vec3 { 0.0f, 0.0f, -1.0f });
+
+    // Covers the sphere (including the folded lower hemisphere) with a fibonacci lattice.
+    auto octahedral_max_error = 0.0f;
+    auto octahedral_max_length_error = 0.0f;
+    auto sample_count = 10000;
+    for (auto sample_index = 0; sample_index < sample_count; sample_index++)
+    {
+      auto z = 1.0f - 2.0f * (static_cast<float>(sample_index) + 0.5f) / static_cast<float>(sample_count);
+      auto radius = std::sqrt(1.0f - z * z);
+      auto angle = static_cast<float>(sample_index) * 2.39996323f;
+      auto normal = vec3 { radius * std::cos(angle), radius * std::sin(angle), z };
+
+      auto unpacked = unpack_octahedral(pack_octahedral(normal));
+      octahedral_max_error = std::max(octahedral_max_error, length(unpacked - normal));
+      octahedral_max_length_error = std::max(octahedral_max_length_error, std::abs(length(unpacked) - 1.0f));
+    }
+    test_equal("octahedral precision", octahedral_max_error < 0.0001f, true);
+    test_equal("octahedral unit length", octahedral_max_length_error < 0.00001f, true);
+
+    test_equal("unorm8 clamp", unpack_unorm8(pack_unorm8(vec4 { -1.0f, 0.0f, 1.0f, 2.0f })), vec4 { 0.0f, 0.0f, 1.0f, 1.0f });
+    test_equal("unorm16 clamp", unpack_unorm16(pack_unorm16(vec2 { -1.0f, 2.0f })), vec2 { 0.0f, 1.0f });
+
+    // Rounding to the nearest step gives errors of at most half a step.
+    auto unorm8_max_error = 0.0f;
+    auto unorm16_max_error = 0.0f;
+    for (auto value = 0.0f; value <= 1.0f; value += 0.0001f)
+    {
+      unorm8_max_error = std::max(unorm8_max_error, std::abs(unpack_unorm8(pack_unorm8(vec4 { value, value, value, value }))[0] - value));
+      unorm16_max_error = std::max(unorm16_max_error, std::abs(unpack_unorm16(pack_unorm16(vec2 { value, value }))[0] - value));
+    }
+    test_equal("unorm8 precision", unorm8_max_error <= 0.5f / 255.0f + 0.000001f, true);
+    test_equal("unorm16 precision", unorm16_max_error <= 0.5f / 65535.0f + 0.000001f, true);
+
+    test_equal("format packed", format(true, true, false, false, true).size, vertex_format_pnc_packed.size);
+    test_equal("format packed texture coordinate", format(false, false, true, false, true).size, uint32_t(12));
+
+    auto mesh = ludo::mesh();
+    mesh.index_buffer = allocate(3 * sizeof(uint32_t));
+    mesh.vertex_buffer = allocate(3 * vertex_format_pnc_packed.size);
+
+    auto welder = vertex_welder();
+    auto index_index = uint32_t(0);
+    auto vertex_index = uint32_t(0);
+    auto normal = vec3 { 1.0f, -2.0f, -3.0f };
+    normalize(normal);
+    write_vertex(mesh, vertex_format_pnc_packed, welder, index_index, vertex_index, vec3 { 1.0f, 2.0f, 3.0f }, normal, vec4 { 0.25f, 0.5f, 0.75f, 1.0f }, vec2_zero);
+    write_vertex(mesh, vertex_format_pnc_packed, welder, index_index, vertex_index, vec3 { 1.0f, 2.0f, 3.0f }, normal, vec4 { 0.25f, 0.5f, 0.75f, 1.0f }, vec2_zero);
+    write_vertex(mesh, vertex_format_pnc_packed, welder, index_index, vertex_index, vec3 { -4.0f, 5.5f, 0.125f }, normal * -1.0f, vec4 { 1.0f, 0.0f, 0.0f, 0.6f }, vec2_zero);
+
+    test_equal("write_vertex packed welds", vertex_index, uint32_t(2));
+    test_equal("write_vertex packed position", read_position(mesh, vertex_format_pnc_packed, 1), vec3 { -4.0f, 5.5f, 0.125f });
+    test_near("write_vertex packed normal", read_normal(mesh, vertex_format_pnc_packed, 0), normal);
+    test_near("write_vertex packed color", read_color(mesh, vertex_format_pnc_packed, 1), vec4 { 1.0f, 0.0f, 0.0f, 0.6f });
+
+    auto unpacked_mesh = ludo::mesh();
+    unpacked_mesh.index_buffer = allocate(3 * sizeof(uint32_t));
+    unpacked_mesh.vertex_buffer = allocate(3 * vertex_format_pnc.size);
+    convert(unpacked_mesh, mesh, vertex_format_pnc, vertex_format_pnc_packed);
+
+    test_equal("convert indices", cast<uint32_t>(unpacked_mesh.index_buffer, 2 * sizeof(uint32_t)), uint32_t(1));
+    test_equal("convert position", cast<vec3>(unpacked_mesh.vertex_buffer, vertex_format_pnc.size + vertex_format_pnc.position_offset), vec3 { -4.0f, 5.5f, 0.125f });
+    test_near("convert normal", cast<vec3>(unpacked_mesh.vertex_buffer, vertex_format_pnc.normal_offset), normal);
+
+    deallocate(mesh.index_buffer);
+    deallocate(mesh.vertex_buffer);
+    deallocate(unpacked_mesh.index_buffer);
+    deallocate(unpacked_mesh.vertex_buffer);
+
+    // Every shape should be built the same in a packed format, without writing beyond its vertices.
+    for (auto smooth : { false, true })
+    {
+      auto options = shape_options { .divisions = 4, .smooth = smooth, .color = vec4 { 0.2f, 0.4f, 0.6f, 1.0f } };
+      auto suffix = std::string(smooth ? " (smooth)" : "");
+
+      test_equal("packed box" + suffix, packing_test_shape(box_counts(vertex_format_pnc_packed, options), [&](ludo::mesh& mesh, const vertex_format& format)
+      {
+        box(mesh, format, 0, 0, options);
+      }), true);
+      test_equal("packed circle" + suffix, packing_test_shape(circle_counts(vertex_format_pnc_packed, options), [&](ludo::mesh& mesh, const vertex_format& format)
+      {
+        circle(mesh, format, 0, 0, options);
+      }), true);
+      test_equal("packed cylinder" + suffix, packing_test_shape(cylinder_counts(vertex_format_pnc_packed, options), [&](ludo::mesh& mesh, const vertex_format& format)
+      {
+        cylinder(mesh, format, 0, 0, options);
+      }), true);
+      test_equal("packed rectangle" + suffix, packing_test_shape(rectangle_counts(vertex_format_pnc_packed, options), [&](ludo::mesh& mesh, const vertex_format& format)
+      {
+        rectangle(mesh, format, 0, 0, options);
+      }), true);
+      test_equal("packed sphere_cube" + suffix, packing_test_shape(sphere_cube_counts(vertex_format_pnc_packed, options), [&](ludo::mesh& mesh, const vertex_format& format)
+      {
+        sphere_cube(mesh, format, 0, 0, options);
+      }), true);
+      test_equal("packed sphere_cube (normalized)" + suffix, packing_test_shape(sphere_cube_counts(vertex_format_pnc_packed, options), [&](ludo::mesh& mesh, const vertex_format& format)
+      {
+        sphere_cube(mesh, format, 0, 0, options, false);
+      }), true);
+      test_equal("packed sphere_ico" + suffix, packing_test_shape(sphere_ico_counts(vertex_format_pnc_packed, options), [&](ludo::mesh& mesh, const vertex_format& format)
+      {
+        sphere_ico(mesh, format, 0, 0, options);
+      }), true);
+      test_equal("packed sphere_uv" + suffix, packing_test_shape(sphere_uv_counts(vertex_format_pnc_packed, options), [&](ludo::mesh& mesh, const vertex_format& format)
+      {
+        sphere_uv(mesh, format, 0, 0, options);
+      }), true);
+    }
+  }
+
+  bool packing_test_shape(const std::pair<uint32_t, uint32_t>& counts, const std::function<void(mesh&, const vertex_format&)>& shape)
+  {
+    // Each index may reference a different vertex (the unique counts of some shapes are estimates).
+    auto vertex_count = counts.first;
+    auto guard_size = uint32_t(64);
+
+    auto unpacked_mesh = mesh();
+    unpacked_mesh.index_buffer = allocate(counts.first * sizeof(uint32_t));
+    unpacked_mesh.vertex_buffer = allocate(vertex_count * vertex_format_pnc.size);
+    std::memset(unpacked_mesh.index_buffer.data, 0, unpacked_mesh.index_buffer.size);
+
+    // The packed vertices are followed by a guard, which should be left untouched.
+    auto packed_vertex_buffer = allocate(vertex_count * vertex_format_pnc_packed.size + guard_size);
+    std::memset(packed_vertex_buffer.data, 0xAB, packed_vertex_buffer.size);
+
+    auto packed_mesh = mesh();
+    packed_mesh.index_buffer = allocate(counts.first * sizeof(uint32_t));
+    packed_mesh.vertex_buffer = { .data = packed_vertex_buffer.data, .size = vertex_count * vertex_format_pnc_packed.size };
+    std::memset(packed_mesh.index_buffer.data, 0, packed_mesh.index_buffer.size);
+
+    shape(unpacked_mesh, vertex_format_pnc);
+    shape(packed_mesh, vertex_format_pnc_packed);
+
+    // Positions are within the precision of half floats (for a unit sized shape), but normals may be computed from the packed positions.
+    auto matches = true;
+    for (auto index_index = uint32_t(0); index_index < counts.first; index_index++)
+    {
+      auto index = read_index(unpacked_mesh, index_index);
+      auto unpacked_color = read_color(unpacked_mesh, vertex_format_pnc, index);
+      auto packed_color = read_color(packed_mesh, vertex_format_pnc_packed, index);
+
+      matches = matches &&
+        read_index(packed_mesh, index_index) == index &&
+        near(read_position(packed_mesh, vertex_format_pnc_packed, index), read_position(unpacked_mesh, vertex_format_pnc, index), 0.001f) &&
+        near(read_normal(packed_mesh, vertex_format_pnc_packed, index), read_normal(unpacked_mesh, vertex_format_pnc, index), 0.02f) &&
+        near(packed_color[0], unpacked_color[0], 0.01f) && near(packed_color[1], unpacked_color[1], 0.01f) && near(packed_color[2], unpacked_color[2], 0.01f) && near(packed_color[3], unpacked_color[3], 0.01f);
+    }
+
+    for (auto byte_index = packed_mesh.vertex_buffer.size; byte_index < packed_vertex_buffer.size; byte_index++)
+    {
+      matches = matches && packed_vertex_buffer.data[byte_index] == std::byte(0xAB);
+    }
+
+    deallocate(unpacked_mesh.index_buffer);
+    deallocate(unpacked_mesh.vertex_buffer);
+    deallocate(packed_mesh.index_buffer);
+    deallocate(packed_vertex_buffer);
+
+    return matches;
+  }
+}
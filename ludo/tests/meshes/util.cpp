@@ -0,0 +1,82 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+#include <limits>
+
+#include <ludo/meshes/util.h>
+#include <ludo/testing.h>
+
+#include "util.h"
+
+namespace ludo
+{
+  uint32_t find_near(const vertex_welder& welder, const std::vector<vec3>& positions, const vec3& position);
+
+  void test_meshes_util()
+  {
+    test_group("meshes util");
+
+    auto welder = vertex_welder { .epsilon = 0.0001f };
+    auto size = cell_size(welder);
+    auto none = std::numeric_limits<uint32_t>::max();
+
+    // Positions within the tolerance of each other, on either side of a cell boundary (in each dimension, and at the origin where the coordinates change sign).
+    auto positions = std::vector<vec3>
+    {
+      { size - 0.00004f, 1.0f, 1.0f },
+      { 1.0f, size - 0.00004f, 1.0f },
+      { 1.0f, 1.0f, size - 0.00004f },
+      { -0.00004f, -0.00004f, -0.00004f }
+    };
+    for (auto index = uint32_t(0); index < positions.size(); index++)
+    {
+      add(welder, positions[index], index);
+    }
+
+    test_equal("vertex_welder: cells differ (x)", cell_coordinates(welder, positions[0])[0] != cell_coordinates(welder, { size + 0.00004f, 1.0f, 1.0f })[0], true);
+    test_equal("vertex_welder: within epsilon across boundary (x)", find_near(welder, positions, { size + 0.00004f, 1.0f, 1.0f }), uint32_t(0));
+    test_equal("vertex_welder: within epsilon across boundary (y)", find_near(welder, positions, { 1.0f, size + 0.00004f, 1.0f }), uint32_t(1));
+    test_equal("vertex_welder: within epsilon across boundary (z)", find_near(welder, positions, { 1.0f, 1.0f, size + 0.00004f }), uint32_t(2));
+    test_equal("vertex_welder: within epsilon across origin", find_near(welder, positions, { 0.00004f, 0.00004f, 0.00004f }), uint32_t(3));
+    test_equal("vertex_welder: within epsilon across corner", find_near(welder, positions, { 0.00004f, -0.00004f, 0.00004f }), uint32_t(3));
+
+    // Just beyond the tolerance, on either side of the boundary.
+    test_equal("vertex_welder: beyond epsilon across boundary", find_near(welder, positions, { size + 0.00007f, 1.0f, 1.0f }), none);
+    test_equal("vertex_welder: beyond epsilon within cell", find_near(welder, positions, { size - 0.00015f, 1.0f, 1.0f }), none);
+    test_equal("vertex_welder: beyond epsilon across origin", find_near(welder, positions, { 0.00007f, 0.0f, 0.0f }), none);
+
+    // The lowest matching index wins, regardless of the order the vertices were added in or the cells they are in.
+    auto lowest_welder = vertex_welder { .epsilon = 0.0001f };
+    auto lowest_positions = std::vector<vec3>
+    {
+      { 5.0f, 5.0f, 5.0f },
+      { 1.0f, 1.0f, 1.0f },
+      { size - 0.00001f, 0.0f, 0.0f },
+      { size + 0.00002f, 0.0f, 0.0f },
+      { size, 0.0f, 0.0f }
+    };
+    for (auto index = uint32_t(lowest_positions.size()); index > 0; index--)
+    {
+      add(lowest_welder, lowest_positions[index - 1], index - 1);
+    }
+    test_equal("vertex_welder: lowest index (across cells)", find_near(lowest_welder, lowest_positions, { size + 0.00001f, 0.0f, 0.0f }), uint32_t(2));
+    test_equal("vertex_welder: lowest index (same cell)", find_near(lowest_welder, lowest_positions, { size + 0.000095f, 0.0f, 0.0f }), uint32_t(3));
+
+    auto rejected = find(lowest_welder, lowest_positions[2], [](uint32_t vertex_index) { return vertex_index != 2; });
+    test_equal("vertex_welder: lowest index (rejected)", rejected, uint32_t(3));
+  }
+
+  uint32_t find_near(const vertex_welder& welder, const std::vector<vec3>& positions, const vec3& position)
+  {
+    return find(welder, position, [&](uint32_t vertex_index)
+    {
+      auto& candidate = positions[vertex_index];
+      return
+        std::abs(candidate[0] - position[0]) <= welder.epsilon &&
+        std::abs(candidate[1] - position[1]) <= welder.epsilon &&
+        std::abs(candidate[2] - position[2]) <= welder.epsilon;
+    });
+  }
+}
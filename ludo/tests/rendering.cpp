@@ -0,0 +1,183 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <ludo/rendering.h>
+#include <ludo/testing.h>
+
+#include "rendering.h"
+
+namespace ludo
+{
+  extern bool stub_fences_signaled;
+
+  void test_rendering()
+  {
+    test_group("rendering");
+
+    auto render_program = ludo::render_program { .command_buffer = allocate(16 * sizeof(render_command)), .active_commands = { .start = 2, .count = 0 } };
+    cast<render_command>(render_program.command_buffer, 0) = { .index_count = 99 };
+
+    auto add_command = [&](uint32_t mesh_index, uint32_t instance_start, uint32_t instance_count)
+    {
+      auto& active_commands = render_program.active_commands;
+      cast<render_command>(render_program.command_buffer, (active_commands.start + active_commands.count++) * sizeof(render_command)) =
+      {
+        .index_count = 6,
+        .instance_count = instance_count,
+        .index_start = mesh_index * 6,
+        .vertex_start = mesh_index * 4,
+        .instance_start = instance_start
+      };
+    };
+
+    // Mesh 1 has a gap in its instances, mesh 0 is contiguous (out of order) and mesh 2 is on its own.
+    add_command(1, 10, 1);
+    add_command(0, 2, 2);
+    add_command(2, 7, 1);
+    add_command(1, 11, 2);
+    add_command(0, 0, 2);
+    add_command(1, 14, 1);
+    add_command(0, 4, 1);
+
+    auto stats = merge_render_commands(render_program);
+
+    test_equal("rendering: merge_render_commands (count before)", stats.command_count_before, uint32_t(7));
+    test_equal("rendering: merge_render_commands (count after)", stats.command_count_after, uint32_t(4));
+    test_equal("rendering: merge_render_commands (active count)", render_program.active_commands.count, uint32_t(4));
+
+    auto expected = std::vector<std::array<uint32_t, 3>> { { 0, 0, 5 }, { 1, 10, 3 }, { 1, 14, 1 }, { 2, 7, 1 } };
+    auto actual = std::vector<std::array<uint32_t, 3>>();
+    for (auto index = uint32_t(0); index < render_program.active_commands.count; index++)
+    {
+      auto& render_command = cast<ludo::render_command>(render_program.command_buffer, (render_program.active_commands.start + index) * sizeof(ludo::render_command));
+      actual.push_back({ render_command.index_start / 6, render_command.instance_start, render_command.instance_count });
+    }
+
+    test_equal("rendering: merge_render_commands (commands)", actual == expected, true);
+    test_equal("rendering: merge_render_commands (inactive commands)", cast<render_command>(render_program.command_buffer, 0).index_count, uint32_t(99));
+
+    auto render_programs = allocate_array<ludo::render_program>(2);
+    add(render_programs, render_program);
+    add(render_programs, ludo::render_program());
+
+    stats = merge_render_commands(render_programs);
+    test_equal("rendering: merge_render_commands (array, count before)", stats.command_count_before, uint32_t(4));
+    test_equal("rendering: merge_render_commands (array, count after)", stats.command_count_after, uint32_t(4));
+
+    deallocate(render_programs);
+    deallocate(render_program.command_buffer);
+
+    auto instance_render_program = ludo::render_program { .instance_buffer_back = allocate_heap(16 * sizeof(mat4)), .instance_size = sizeof(mat4), .dirty_instances = allocate(16) };
+    auto other_render_program = ludo::render_program { .instance_buffer_back = allocate_heap(16 * sizeof(mat4)), .instance_size = sizeof(mat4), .dirty_instances = allocate(16) };
+    std::memset(instance_render_program.dirty_instances.data, 0, 16);
+    std::memset(other_render_program.dirty_instances.data, 0, 16);
+
+    auto render_mesh_0 = ludo::render_mesh();
+    auto render_mesh_1 = ludo::render_mesh();
+    auto other_render_mesh = ludo::render_mesh();
+    connect(render_mesh_0, instance_render_program, 4);
+    connect(render_mesh_1, instance_render_program, 4);
+    connect(other_render_mesh, other_render_program, 4);
+
+    test_equal("rendering: take_dirty_instance_data (none)", take_dirty_instance_data(instance_render_program, 0).empty(), true);
+
+    // Out of order and repeated writes should be merged, but not across the gap in render mesh 0 or into another render program.
+    set_instance_transform(render_mesh_1, mat4_identity, 0);
+    set_instance_transform(render_mesh_0, mat4_identity, 2);
+    set_instance_transform(render_mesh_0, mat4_identity, 0);
+    mark_instance_dirty(render_mesh_0, 3);
+    set_instance_transform(render_mesh_0, mat4_identity, 2);
+    set_instance_transform(other_render_mesh, mat4_identity, 1);
+
+    // Reading doesn't mark the instance.
+    instance_transform(render_mesh_1, 3);
+
+    auto dirty_ranges = [&](uint32_t slice_index)
+    {
+      auto ranges = std::vector<std::pair<uint64_t, uint64_t>>();
+      for (auto& dirty_data : take_dirty_instance_data(instance_render_program, slice_index))
+      {
+        ranges.emplace_back(dirty_data.data - instance_render_program.instance_buffer_back.data, dirty_data.size);
+      }
+
+      return ranges;
+    };
+
+    auto expected_dirty_ranges = std::vector<std::pair<uint64_t, uint64_t>> { { 0, sizeof(mat4) }, { 2 * sizeof(mat4), 3 * sizeof(mat4) } };
+    test_equal("rendering: take_dirty_instance_data", dirty_ranges(0) == expected_dirty_ranges, true);
+    test_equal("rendering: take_dirty_instance_data (taken)", dirty_ranges(0).empty(), true);
+    test_equal("rendering: take_dirty_instance_data (other slice)", dirty_ranges(1) == expected_dirty_ranges, true);
+    test_equal("rendering: take_dirty_instance_data (other slice, taken)", dirty_ranges(1).empty(), true);
+    test_equal("rendering: take_dirty_instance_data (all taken)", std::all_of(instance_render_program.dirty_instances.data, instance_render_program.dirty_instances.data + 16, [](std::byte dirty) { return dirty == std::byte(0); }), true);
+
+    auto other_dirty = take_dirty_instance_data(other_render_program, 0);
+    test_equal("rendering: take_dirty_instance_data (other render program)", other_dirty.size() == 1 && other_dirty[0].data == other_render_mesh.instance_buffer.data + sizeof(mat4), true);
+
+    // Instances beyond the first word of dirty bytes should be found as well.
+    set_instance_transform(other_render_mesh, mat4_identity, 0);
+    disconnect(other_render_mesh, other_render_program);
+    connect(other_render_mesh, other_render_program, 12);
+    set_instance_transform(other_render_mesh, mat4_identity, 11);
+
+    auto other_instance_start = (other_render_mesh.instance_buffer.data - other_render_program.instance_buffer_back.data) / sizeof(mat4);
+    other_dirty = take_dirty_instance_data(other_render_program, 0);
+    test_equal("rendering: take_dirty_instance_data (later word)", other_dirty.size() == 2 && other_dirty[1].data == other_render_program.instance_buffer_back.data + (other_instance_start + 11) * sizeof(mat4), true);
+
+    deallocate(instance_render_program.instance_buffer_back);
+    deallocate(other_render_program.instance_buffer_back);
+    deallocate(instance_render_program.dirty_instances);
+    deallocate(other_render_program.dirty_instances);
+
+    auto frame_ring = ludo::frame_ring { .frame_count = 3 };
+    init(frame_ring, 64);
+
+    // Each frame gets its own slice, without waiting until a slice comes around again.
+    auto frame_datas = std::vector<std::byte*>();
+    for (auto frame_index = 0; frame_index < 3; frame_index++)
+    {
+      auto frame = next_frame(frame_ring);
+      frame_datas.push_back(frame.data);
+
+      test_equal("rendering: next_frame (offset)", frame_offset(frame_ring), uint64_t(frame_index * 64));
+      test_equal("rendering: next_frame (slice)", frame.data == frame_ring.buffer.data + frame_index * 64 && frame.size == 64, true);
+
+      commit(frame_ring);
+    }
+    test_equal("rendering: next_frame (no stalls)", frame_ring.stall_count, uint64_t(0));
+
+    // Coming around again only counts as a stall if the GPU hasn't finished with the slice.
+    test_equal("rendering: next_frame (wrapped)", next_frame(frame_ring).data, frame_datas[0]);
+    test_equal("rendering: next_frame (signaled)", frame_ring.stall_count, uint64_t(0));
+    test_equal("rendering: next_frame (fence consumed)", frame_ring.fences[0].id, uint64_t(0));
+
+    stub_fences_signaled = false;
+    next_frame(frame_ring);
+    test_equal("rendering: next_frame (stalled)", frame_ring.stall_count, uint64_t(1));
+
+    next_frame(frame_ring);
+    commit(frame_ring);
+    wait(frame_ring);
+    test_equal("rendering: wait (stalled)", frame_ring.stall_count, uint64_t(3));
+    test_equal("rendering: wait (fence consumed)", frame_ring.fences[2].id, uint64_t(0));
+
+    // Slices that haven't been committed since they were last waited for are not in flight.
+    next_frame(frame_ring);
+    test_equal("rendering: next_frame (not in flight)", frame_ring.stall_count, uint64_t(3));
+    stub_fences_signaled = true;
+
+    // The previous slice is the one committed a frame ago, which is waited for if it is still in flight.
+    commit(frame_ring);
+    auto current_frame = next_frame(frame_ring);
+    auto frame = previous_frame(frame_ring);
+    test_equal("rendering: previous_frame (slice)", frame.data == frame_datas[0] && frame.size == 64, true);
+    test_equal("rendering: previous_frame (current)", current_frame.data, frame_datas[1]);
+    test_equal("rendering: previous_frame (fence consumed)", frame_ring.fences[0].id, uint64_t(0));
+    test_equal("rendering: previous_frame (zeroed)", std::all_of(frame_datas[2], frame_datas[2] + 64, [](std::byte byte) { return byte == std::byte(0); }), true);
+
+    de_init(frame_ring);
+  }
+}
@@ -0,0 +1,64 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <ludo/spatial/cell_pool.h>
+#include <ludo/testing.h>
+
+#include "cell_pool.h"
+
+namespace ludo
+{
+  std::vector<uint32_t> cell_pool_entries(const cell_pool& pool, const buffer& buffer, uint32_t cell_index)
+  {
+    auto entries = std::vector<uint32_t>();
+    for_each_entry(pool, buffer, cell_index, [&](uint64_t offset)
+    {
+      entries.push_back(cast<uint32_t>(buffer, offset));
+    });
+
+    return entries;
+  }
+
+  void test_spatial_cell_pool()
+  {
+    test_group("cell_pool");
+
+    auto pool = cell_pool { .cell_count = 4, .capacity = 2, .entry_size = sizeof(uint32_t) };
+    auto buffer = init(pool);
+    test_equal("cell_pool: init (size)", buffer.size, uint64_t(4 * (8 + 2 * sizeof(uint32_t))));
+
+    for (auto entry = uint32_t(1); entry <= 5; entry++)
+    {
+      cast<uint32_t>(buffer, add(pool, buffer, 1)) = entry;
+    }
+    cast<uint32_t>(buffer, add(pool, buffer, 2)) = 6;
+
+    test_equal("cell_pool: add (count)", count(pool, buffer, 1), uint32_t(5));
+    test_equal("cell_pool: add (entries)", cell_pool_entries(pool, buffer, 1) == std::vector<uint32_t> { 1, 2, 3, 4, 5 }, true);
+    test_equal("cell_pool: add (block count)", pool.block_count, uint32_t(6));
+    test_equal("cell_pool: add (other cell)", cell_pool_entries(pool, buffer, 2) == std::vector<uint32_t> { 6 }, true);
+    test_equal("cell_pool: add (empty cell)", count(pool, buffer, 0), uint32_t(0));
+    test_equal("cell_pool: entry offset", cast<uint32_t>(buffer, entry_offset(pool, buffer, 1, 4)), uint32_t(5));
+
+    // Removing from the first block moves the last entry (in the last overflow block) into the gap and frees that block.
+    test_equal("cell_pool: remove (moved)", remove(pool, buffer, 1, 0), true);
+    test_equal("cell_pool: remove (entries)", cell_pool_entries(pool, buffer, 1) == std::vector<uint32_t> { 5, 2, 3, 4 }, true);
+    test_not_equal("cell_pool: remove (free block)", pool.first_free_block, uint32_t(0));
+
+    test_equal("cell_pool: remove last (moved)", remove(pool, buffer, 1, 3), false);
+    test_equal("cell_pool: remove last (entries)", cell_pool_entries(pool, buffer, 1) == std::vector<uint32_t> { 5, 2, 3 }, true);
+
+    // Freed blocks are re-used before the buffer grows.
+    auto buffer_size = buffer.size;
+    cast<uint32_t>(buffer, add(pool, buffer, 3)) = 7;
+    cast<uint32_t>(buffer, add(pool, buffer, 3)) = 8;
+    cast<uint32_t>(buffer, add(pool, buffer, 3)) = 9;
+    test_equal("cell_pool: re-use (entries)", cell_pool_entries(pool, buffer, 3) == std::vector<uint32_t> { 7, 8, 9 }, true);
+    test_equal("cell_pool: re-use (block count)", pool.block_count, uint32_t(6));
+    test_equal("cell_pool: re-use (buffer size)", buffer.size, buffer_size);
+    test_equal("cell_pool: re-use (other cells)", cell_pool_entries(pool, buffer, 1) == std::vector<uint32_t> { 5, 2, 3 }, true);
+
+    deallocate(buffer);
+  }
+}
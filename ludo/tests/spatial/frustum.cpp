@@ -0,0 +1,103 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <ludo/rendering.h>
+#include <ludo/spatial/frustum.h>
+#include <ludo/testing.h>
+
+#include "frustum.h"
+
+namespace ludo
+{
+  void test_spatial_frustum()
+  {
+    test_group("frustum");
+
+    auto camera = ludo::camera
+    {
+      .view = mat4_identity,
+      .projection = perspective(60.0f, 1.0f, 0.1f, 100.0f)
+    };
+    auto planes = frustum_planes(camera);
+
+    test_equal("frustum_test inside", frustum_test(planes, { .min = { -0.5f, -0.5f, -5.5f }, .max = { 0.5f, 0.5f, -4.5f } }), 1);
+    test_equal("frustum_test behind", frustum_test(planes, { .min = { -0.5f, -0.5f, 4.5f }, .max = { 0.5f, 0.5f, 5.5f } }), -1);
+    test_equal("frustum_test beyond far", frustum_test(planes, { .min = { -0.5f, -0.5f, -201.0f }, .max = { 0.5f, 0.5f, -200.0f } }), -1);
+    test_equal("frustum_test beside", frustum_test(planes, { .min = { 50.0f, -0.5f, -5.5f }, .max = { 51.0f, 0.5f, -4.5f } }), -1);
+    test_equal("frustum_test intersecting near", frustum_test(planes, { .min = { -0.5f, -0.5f, -0.5f }, .max = { 0.5f, 0.5f, 0.5f } }), 0);
+    test_equal("frustum_test intersecting side", frustum_test(planes, { .min = { 2.5f, -0.5f, -5.5f }, .max = { 3.5f, 0.5f, -4.5f } }), 0);
+
+    test_equal("frustum_test sphere inside", frustum_test(planes, { 0.0f, 0.0f, -5.0f }, 0.5f), 1);
+    test_equal("frustum_test sphere behind", frustum_test(planes, { 0.0f, 0.0f, 5.0f }, 0.5f), -1);
+    test_equal("frustum_test sphere intersecting near", frustum_test(planes, { 0.0f, 0.0f, 0.0f }, 0.5f), 0);
+    test_equal("frustum_test sphere beside", frustum_test(planes, { 50.0f, 0.0f, -5.0f }, 0.5f), -1);
+
+    // The batch tests should match the individual tests exactly (including the remainder that doesn't fill a batch).
+    auto bounds = aabb3_soa();
+    auto spheres = sphere_soa();
+    for (auto index = uint32_t(0); index < 1003; index++)
+    {
+      auto center = vec3
+      {
+        static_cast<float>((index * 37) % 101) - 50.0f,
+        static_cast<float>((index * 53) % 97) - 48.0f,
+        static_cast<float>((index * 71) % 89) * -1.5f + 20.0f
+      };
+      auto half_extent = 0.5f + static_cast<float>(index % 7);
+
+      bounds.min_x.push_back(center[0] - half_extent);
+      bounds.min_y.push_back(center[1] - half_extent);
+      bounds.min_z.push_back(center[2] - half_extent);
+      bounds.max_x.push_back(center[0] + half_extent);
+      bounds.max_y.push_back(center[1] + half_extent);
+      bounds.max_z.push_back(center[2] + half_extent);
+
+      spheres.center_x.push_back(center[0]);
+      spheres.center_y.push_back(center[1]);
+      spheres.center_z.push_back(center[2]);
+      spheres.radius.push_back(half_extent);
+    }
+
+    auto expected_results = std::vector<int8_t>();
+    auto expected_sphere_results = std::vector<int8_t>();
+    auto result_counts = std::array<uint32_t, 3>();
+    for (auto index = uint32_t(0); index < 1003; index++)
+    {
+      auto result = frustum_test(planes, { .min = { bounds.min_x[index], bounds.min_y[index], bounds.min_z[index] }, .max = { bounds.max_x[index], bounds.max_y[index], bounds.max_z[index] } });
+      expected_results.push_back(static_cast<int8_t>(result));
+      result_counts[result + 1]++;
+
+      expected_sphere_results.push_back(static_cast<int8_t>(frustum_test(planes, { spheres.center_x[index], spheres.center_y[index], spheres.center_z[index] }, spheres.radius[index])));
+    }
+
+    test_equal("frustum_test batch (all results occur)", result_counts[0] > 0 && result_counts[1] > 0 && result_counts[2] > 0, true);
+    test_equal("frustum_test batch", frustum_test(planes, bounds) == expected_results, true);
+    test_equal("frustum_test batch spheres", frustum_test(planes, spheres) == expected_sphere_results, true);
+
+    // The plane hints change the order the planes are tested in, but not the results.
+    auto plane_hints = std::vector<uint8_t>();
+    test_equal("frustum_test batch coherent", frustum_test(planes, bounds, plane_hints) == expected_results, true);
+    test_equal("frustum_test batch coherent (hints)", plane_hints.size(), std::size_t(1003));
+
+    // The hint of each AABB outside the view frustum should be a plane that rejects it.
+    auto plane_hints_valid = true;
+    for (auto index = uint32_t(0); index < 1003; index++)
+    {
+      if (expected_results[index] == -1)
+      {
+        auto& plane = planes[plane_hints[index]];
+        auto closest_negative = vec4
+        {
+          plane[0] > 0.0f ? bounds.max_x[index] : bounds.min_x[index],
+          plane[1] > 0.0f ? bounds.max_y[index] : bounds.min_y[index],
+          plane[2] > 0.0f ? bounds.max_z[index] : bounds.min_z[index],
+          1.0f
+        };
+        plane_hints_valid = plane_hints_valid && dot(plane, closest_negative) < 0.0f;
+      }
+    }
+    test_equal("frustum_test batch coherent (hints valid)", plane_hints_valid, true);
+    test_equal("frustum_test batch coherent 2", frustum_test(planes, bounds, plane_hints) == expected_results, true);
+  }
+}
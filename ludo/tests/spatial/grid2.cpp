@@ -68,5 +68,41 @@ namespace ludo
       return intersect(bounds_3, bounds) ? 0 : -1;
     });
     test_equal("grid2: find 2", meshes_4.size(), std::size_t(0));
+
+    auto test_call_count_5 = 0;
+    auto meshes_5 = find(grid_1, [&](const aabb2& bounds)
+    {
+      test_call_count_5++;
+      return 1;
+    });
+    test_equal("grid2: find inside", meshes_5.size(), std::size_t(1));
+    test_equal("grid2: find inside (test count)", test_call_count_5, 1);
+
+    auto grid_2 = grid2 { .bounds = { .min = { 0.0f, 0.0f }, .max = { 16.0f, 16.0f } }, .cell_count_1d = 16 };
+    init(grid_2);
+
+    auto render_mesh_id = uint64_t(1);
+    for (auto x = 0.5f; x < 16.0f; x += 1.0f)
+    {
+      for (auto y = 0.5f; y < 16.0f; y += 1.0f)
+      {
+        add(grid_2, render_mesh { .id = render_mesh_id++ }, { x, y });
+      }
+    }
+
+    auto bounds_6 = aabb2 { .min = { 2.5f, 2.5f }, .max = { 5.5f, 9.5f } };
+    auto meshes_6 = find(grid_2, [&](const aabb2& bounds)
+    {
+      if (contains(bounds_6, bounds))
+      {
+        return 1;
+      }
+
+      return intersect(bounds_6, bounds) ? 0 : -1;
+    });
+    test_equal("grid2: find region", meshes_6.size(), std::size_t(4 * 8));
+
+    de_init(grid_1);
+    de_init(grid_2);
   }
 }
@@ -2,7 +2,10 @@
  * This file is part of ludo. See the LICENSE file for the full license governing this code.
  */
 
+#include <cstring>
+
 #include <ludo/rendering.h>
+#include <ludo/spatial/frustum.h>
 #include <ludo/spatial/grid3.h>
 #include <ludo/testing.h>
 
@@ -69,5 +72,244 @@ namespace ludo
       return intersect(bounds_3, bounds) ? 0 : -1;
     });
     test_equal("grid3: find 2", meshes_4.size(), std::size_t(0));
+
+    auto test_call_count_5 = 0;
+    auto meshes_5 = find(grid_1, [&](const aabb3& bounds)
+    {
+      test_call_count_5++;
+      return 1;
+    });
+    test_equal("grid3: find inside", meshes_5.size(), std::size_t(1));
+    test_equal("grid3: find inside (test count)", test_call_count_5, 1);
+
+    auto grid_2 = grid3 { .bounds = { .min = { -8.0f, -8.0f, -8.0f }, .max = { 8.0f, 8.0f, 8.0f } }, .cell_count_1d = 16 };
+    init(grid_2);
+
+    auto render_mesh_id = uint64_t(1);
+    for (auto x = -7.5f; x < 8.0f; x += 1.0f)
+    {
+      for (auto y = -7.5f; y < 8.0f; y += 1.0f)
+      {
+        for (auto z = -7.5f; z < 8.0f; z += 1.0f)
+        {
+          add(grid_2, render_mesh { .id = render_mesh_id++ }, { x, y, z });
+        }
+      }
+    }
+
+    auto camera = ludo::camera
+    {
+      .view = mat4({ 0.0f, 0.0f, 0.0f }, mat3(vec3_unit_y, pi / 4.0f)),
+      .projection = perspective(60.0f, 16.0f / 9.0f, 0.1f, 10.0f)
+    };
+    auto planes = frustum_planes(camera);
+
+    auto expected_ids = std::vector<uint64_t>();
+    for (auto cell_index = uint32_t(0); cell_index < 16 * 16 * 16; cell_index++)
+    {
+      auto x = cell_index / (16 * 16);
+      auto y = (cell_index / 16) % 16;
+      auto z = cell_index % 16;
+      auto min = vec3 { -8.0f + static_cast<float>(x), -8.0f + static_cast<float>(y), -8.0f + static_cast<float>(z) };
+
+      if (frustum_test(planes, { .min = min, .max = min + vec3_one }) != -1)
+      {
+        auto ids = cell_render_mesh_ids(grid_2, cell_index);
+        expected_ids.insert(expected_ids.end(), ids.begin(), ids.end());
+      }
+    }
+
+    auto test_call_count_6 = 0;
+    auto meshes_6 = find(grid_2, [&](const aabb3& bounds)
+    {
+      test_call_count_6++;
+      return frustum_test(planes, bounds);
+    });
+    std::sort(meshes_6.begin(), meshes_6.end());
+    std::sort(expected_ids.begin(), expected_ids.end());
+    test_equal("grid3: find frustum", meshes_6 == expected_ids, true);
+    test_equal("grid3: find frustum (pruned)", test_call_count_6 < 16 * 16 * 16, true);
+
+    de_init(grid_1);
+    de_init(grid_2);
+
+    auto grid_3 = grid3 { .bounds = bounds_1, .cell_count_1d = 2, .track_locations = true };
+    init(grid_3);
+
+    add(grid_3, render_mesh { .id = 1 }, position_1);
+    add(grid_3, render_mesh { .id = 2 }, position_1);
+    add(grid_3, render_mesh { .id = 3 }, position_1);
+
+    // Moving within a cell should not change anything.
+    move(grid_3, render_mesh { .id = 1 }, position_1, { -0.75f, -0.75f, -0.75f });
+    test_equal("grid3: move within cell", cell_render_mesh_ids(grid_3, 0) == std::vector<uint64_t> { 1, 2, 3 }, true);
+
+    // The last render mesh of the cell fills the gap left by the moved render mesh.
+    auto position_2 = vec3 { 0.25f, 0.25f, 0.25f };
+    move(grid_3, render_mesh { .id = 1 }, { -0.75f, -0.75f, -0.75f }, position_2);
+    test_equal("grid3: move across cells (old cell)", cell_render_mesh_ids(grid_3, 0) == std::vector<uint64_t> { 3, 2 }, true);
+    test_equal("grid3: move across cells (new cell)", cell_render_mesh_ids(grid_3, 7) == std::vector<uint64_t> { 1 }, true);
+    test_equal("grid3: move across cells (location)", grid_3.locations[3].slot, uint32_t(0));
+
+    // Tracked render meshes are removed from where they are, regardless of the position given.
+    remove(grid_3, render_mesh { .id = 3 }, position_2);
+    test_equal("grid3: remove tracked", cell_render_mesh_ids(grid_3, 0) == std::vector<uint64_t> { 2 }, true);
+    test_equal("grid3: remove tracked (location count)", grid_3.locations.size(), std::size_t(2));
+
+    de_init(grid_3);
+
+    // Cells that are full spill into overflow blocks rather than failing.
+    auto grid_4 = grid3 { .bounds = bounds_1, .cell_count_1d = 2, .cell_capacity = 2 };
+    init(grid_4);
+
+    auto front_size = grid_4.buffer.front.size;
+    for (auto render_mesh_id = uint64_t(1); render_mesh_id <= 5; render_mesh_id++)
+    {
+      add(grid_4, render_mesh { .id = render_mesh_id }, position_1);
+    }
+    commit(grid_4);
+
+    test_equal("grid3: overflow (cell)", cell_render_mesh_ids(grid_4, 0) == std::vector<uint64_t> { 1, 2, 3, 4, 5 }, true);
+    test_equal("grid3: overflow (find)", find(grid_4, [](const aabb3& bounds) { return 1; }).size(), std::size_t(5));
+    test_equal("grid3: overflow (front buffer grown)", grid_4.buffer.front.size > front_size, true);
+
+    remove(grid_4, render_mesh { .id = 1 }, position_1);
+    test_equal("grid3: overflow remove", cell_render_mesh_ids(grid_4, 0) == std::vector<uint64_t> { 5, 2, 3, 4 }, true);
+
+    de_init(grid_4);
+
+    // Front buffers are committed to in turn and only receive the blocks modified since they were last committed to.
+    auto grid_6 = grid3 { .bounds = bounds_1, .cell_count_1d = 2, .cell_capacity = 2, .front_buffer_count = 3 };
+    init(grid_6);
+
+    auto front_data_matches = [&](const grid3& grid)
+    {
+      auto header_size = 3 * (sizeof(vec3) + 4); // The bounds and cell dimensions, each aligned to 16 bytes.
+      return std::memcmp(grid.buffer.front.data + header_size, grid.buffer.back.data, used_size(grid.pool)) == 0;
+    };
+
+    auto front_buffer_datas = std::vector<std::byte*>();
+    for (auto commit_index = 0; commit_index < 6; commit_index++)
+    {
+      add(grid_6, render_mesh { .id = uint64_t(commit_index + 1) }, commit_index % 2 ? position_1 : position_2);
+      if (commit_index == 4)
+      {
+        remove(grid_6, render_mesh { .id = 1 }, position_2);
+      }
+
+      commit(grid_6);
+      front_buffer_datas.push_back(grid_6.buffer.front.data);
+
+      test_equal("grid3: commit (front buffer index)", grid_6.front_buffer_index, uint32_t(commit_index % 3));
+      test_equal("grid3: commit (dirty blocks)", grid_6.dirty_blocks.empty(), true);
+      test_equal("grid3: commit (front buffer matches)", front_data_matches(grid_6), true);
+    }
+
+    test_equal("grid3: commit (front buffers alternate)", front_buffer_datas[0] != front_buffer_datas[1] && front_buffer_datas[1] != front_buffer_datas[2], true);
+    test_equal("grid3: commit (front buffers reused)", front_buffer_datas[0] == front_buffer_datas[3], true);
+    test_equal("grid3: commit (cell)", cell_render_mesh_ids(grid_6, 7) == std::vector<uint64_t> { 5, 3 }, true);
+    test_equal("grid3: commit (overflow cell)", cell_render_mesh_ids(grid_6, 0) == std::vector<uint64_t> { 2, 4, 6 }, true);
+
+    de_init(grid_6);
+
+    // Grids without front buffers are only read on the CPU, so nothing is tracked for committing.
+    auto grid_7 = grid3 { .bounds = bounds_1, .cell_count_1d = 2, .front_buffer_count = 0 };
+    init(grid_7);
+
+    add(grid_7, render_mesh { .id = 1 }, position_1);
+    add(grid_7, render_mesh { .id = 2 }, position_2);
+    remove(grid_7, render_mesh { .id = 1 }, position_1);
+
+    test_equal("grid3: no front buffers (front buffer)", grid_7.buffer.front.data == nullptr, true);
+    test_equal("grid3: no front buffers (dirty blocks)", grid_7.dirty_blocks.empty(), true);
+    test_equal("grid3: no front buffers (find)", find(grid_7, [](const aabb3& bounds) { return 1; }) == std::vector<uint64_t> { 2 }, true);
+
+    de_init(grid_7);
+
+    // Render commands built on the CPU should match those of the visible cells (with their neighbours), in cell order.
+    auto grid_5 = grid3 { .bounds = { .min = { -8.0f, -8.0f, -8.0f }, .max = { 8.0f, 8.0f, 8.0f } }, .cell_count_1d = 16, .cell_capacity = 4 };
+    init(grid_5);
+
+    auto render_mesh_index = uint32_t(0);
+    for (auto x = -7.5f; x < 8.0f; x += 1.0f)
+    {
+      for (auto y = -7.5f; y < 8.0f; y += 1.0f)
+      {
+        for (auto z = -7.5f; z < 8.0f; z += 1.0f)
+        {
+          // Some cells overflow and some render meshes belong to a render program that isn't given.
+          for (auto copy_index = uint32_t(0); copy_index < 1 + render_mesh_index % 6; copy_index++)
+          {
+            add(grid_5, render_mesh
+            {
+              .id = render_mesh_index * 8 + copy_index,
+              .render_program_id = 100 + render_mesh_index % 3,
+              .instances = { .start = render_mesh_index, .count = 1 + copy_index },
+              .indices = { .start = copy_index * 6, .count = 6 },
+              .vertices = { .start = render_mesh_index * 4, .count = 4 }
+            }, { x, y, z });
+          }
+
+          render_mesh_index++;
+        }
+      }
+    }
+
+    auto render_programs = allocate_array<render_program>(2);
+    add(render_programs, render_program { .id = 101, .command_buffer = allocate(16 * 16 * 16 * 6 * sizeof(render_command)), .active_commands = { .start = 0, .count = 1 } });
+    add(render_programs, render_program { .id = 100, .command_buffer = allocate(16 * 16 * 16 * 6 * sizeof(render_command)) });
+
+    auto expected_render_commands = std::array<std::vector<render_command>, 2>();
+    expected_render_commands[0].push_back(cast<render_command>(render_programs[0].command_buffer, 0)); // The existing active command is kept.
+    for (auto cell_index = uint32_t(0); cell_index < 16 * 16 * 16; cell_index++)
+    {
+      auto x = cell_index / (16 * 16);
+      auto y = (cell_index / 16) % 16;
+      auto z = cell_index % 16;
+      auto min = vec3 { -8.0f + static_cast<float>(x), -8.0f + static_cast<float>(y), -8.0f + static_cast<float>(z) };
+
+      if (frustum_test(planes, { .min = min - vec3_one, .max = min + vec3_one * 2.0f }) == -1)
+      {
+        continue;
+      }
+
+      for (auto id : cell_render_mesh_ids(grid_5, cell_index))
+      {
+        auto index = static_cast<uint32_t>(id / 8);
+        auto copy_index = static_cast<uint32_t>(id % 8);
+        if (index % 3 == 2)
+        {
+          continue;
+        }
+
+        expected_render_commands[index % 3 == 1 ? 0 : 1].push_back(
+        {
+          .index_count = 6,
+          .instance_count = 1 + copy_index,
+          .index_start = copy_index * 6,
+          .vertex_start = index * 4,
+          .instance_start = index
+        });
+      }
+    }
+
+    add_render_commands(grid_5, render_programs, camera);
+
+    for (auto render_program_index = uint32_t(0); render_program_index < 2; render_program_index++)
+    {
+      auto& render_program = render_programs[render_program_index];
+      auto& expected = expected_render_commands[render_program_index];
+
+      test_equal("grid3: add render commands (some culled)", expected.size() > 1 && expected.size() < 16 * 16 * 16, true);
+      test_equal("grid3: add render commands (count)", render_program.active_commands.count, static_cast<uint32_t>(expected.size()));
+      test_equal("grid3: add render commands", std::memcmp(render_program.command_buffer.data, expected.data(), expected.size() * sizeof(render_command)), 0);
+    }
+
+    for (auto& render_program : render_programs)
+    {
+      deallocate(render_program.command_buffer);
+    }
+    deallocate(render_programs);
+    de_init(grid_5);
   }
 }
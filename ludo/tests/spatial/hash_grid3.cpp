@@ -0,0 +1,126 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+#include <limits>
+
+#include <ludo/rendering.h>
+#include <ludo/spatial/frustum.h>
+#include <ludo/spatial/hash_grid3.h>
+#include <ludo/testing.h>
+
+#include "hash_grid3.h"
+
+namespace ludo
+{
+  void test_spatial_hash_grid3()
+  {
+    test_group("hash_grid3");
+
+    auto grid_1 = hash_grid3 { .cell_size = 10.0f };
+    init(grid_1);
+
+    auto render_mesh_1 = render_mesh { .id = 1 };
+    auto render_mesh_2 = render_mesh { .id = 2 };
+    auto render_mesh_3 = render_mesh { .id = 3 };
+
+    auto position_1 = vec3 { 5.0f, 5.0f, 5.0f };
+    auto position_2 = vec3 { -5.0f, 5.0f, 5.0f };
+    auto position_3 = vec3 { 3.0e9f, -2.0e9f, 1.0e9f }; // Far outside the bounds any grid3 would have.
+
+    add(grid_1, render_mesh_1, position_1);
+    add(grid_1, render_mesh_2, position_2);
+    add(grid_1, render_mesh_3, position_3);
+    test_equal("hash_grid3: add (cell count)", grid_1.cells.size(), std::size_t(3));
+
+    auto render_mesh_ids_1 = find(grid_1, aabb3 { .min = { 1.0f, 1.0f, 1.0f }, .max = { 2.0f, 2.0f, 2.0f } });
+    test_equal("hash_grid3: find region (count)", render_mesh_ids_1.size(), std::size_t(1));
+    test_equal("hash_grid3: find region (ID)", render_mesh_ids_1[0], uint64_t(1));
+
+    auto render_mesh_ids_2 = find(grid_1, aabb3 { .min = { -1.0f, 1.0f, 1.0f }, .max = { 1.0f, 2.0f, 2.0f } });
+    test_equal("hash_grid3: find region negative", render_mesh_ids_2.size(), std::size_t(2));
+
+    auto render_mesh_ids_3 = find(grid_1, aabb3 { .min = { 2.9e9f, -2.1e9f, 0.9e9f }, .max = { 3.1e9f, -1.9e9f, 1.1e9f } });
+    test_equal("hash_grid3: find region far (count)", render_mesh_ids_3.size(), std::size_t(1));
+    test_equal("hash_grid3: find region far (ID)", render_mesh_ids_3[0], uint64_t(3));
+
+    auto render_mesh_ids_4 = find(grid_1, [](const aabb3& bounds)
+    {
+      return bounds.min[0] >= 0.0f ? 1 : -1;
+    });
+    test_equal("hash_grid3: find test", render_mesh_ids_4.size(), std::size_t(2));
+
+    // Moving within a cell should not change anything.
+    move(grid_1, render_mesh_1, position_1, { 6.0f, 6.0f, 6.0f });
+    test_equal("hash_grid3: move within cell (cell count)", grid_1.cells.size(), std::size_t(3));
+    test_equal("hash_grid3: move within cell (slot)", grid_1.locations[1].slot, uint32_t(0));
+
+    add(grid_1, render_mesh { .id = 4 }, position_1);
+    move(grid_1, render_mesh_1, { 6.0f, 6.0f, 6.0f }, position_2);
+    test_equal("hash_grid3: move across cells (old cell)", grid_1.cells[{ 0, 0, 0 }].size(), std::size_t(1));
+    test_equal("hash_grid3: move across cells (swapped slot)", grid_1.locations[4].slot, uint32_t(0));
+    test_equal("hash_grid3: move across cells (new cell)", grid_1.cells[{ -1, 0, 0 }].size(), std::size_t(2));
+
+    remove(grid_1, render_mesh { .id = 4 }, position_1);
+    test_equal("hash_grid3: remove (cell count)", grid_1.cells.size(), std::size_t(2));
+    test_equal("hash_grid3: remove (location count)", grid_1.locations.size(), std::size_t(3));
+
+    de_init(grid_1);
+
+    // Compare a frustum query over a region against a brute force search.
+    auto grid_2 = hash_grid3 { .cell_size = 100.0f };
+    init(grid_2);
+
+    auto positions = std::vector<vec3>();
+    auto render_mesh_id = uint64_t(1);
+    for (auto x = -750.0f; x < 800.0f; x += 100.0f)
+    {
+      for (auto y = -750.0f; y < 800.0f; y += 100.0f)
+      {
+        for (auto z = -750.0f; z < 800.0f; z += 100.0f)
+        {
+          positions.push_back({ x, y, z });
+          add(grid_2, render_mesh { .id = render_mesh_id++ }, { x, y, z });
+        }
+      }
+    }
+
+    auto camera = ludo::camera
+    {
+      .view = mat4(vec3_zero, mat3(vec3_unit_y, pi / 4.0f)),
+      .projection = perspective(60.0f, 16.0f / 9.0f, 0.1f, 1000.0f)
+    };
+    auto planes = frustum_planes(camera);
+
+    auto brute_force_count = std::size_t(0);
+    for (auto& position : positions)
+    {
+      auto cell_min = vec3 { std::floor(position[0] / 100.0f), std::floor(position[1] / 100.0f), std::floor(position[2] / 100.0f) } * 100.0f;
+      if (frustum_test(planes, { .min = cell_min, .max = cell_min + vec3 { 100.0f, 100.0f, 100.0f } }) != -1)
+      {
+        brute_force_count++;
+      }
+    }
+
+    auto frustum_test_function = [&](const aabb3& bounds)
+    {
+      return frustum_test(planes, bounds);
+    };
+
+    test_equal("hash_grid3: find frustum", find(grid_2, frustum_test_function).size(), brute_force_count);
+    test_equal("hash_grid3: find frustum region", find(grid_2, aabb3 { .min = { -1000.0f, -1000.0f, -1000.0f }, .max = { 1000.0f, 1000.0f, 1000.0f } }, frustum_test_function).size(), brute_force_count);
+
+    de_init(grid_2);
+
+    // Positions beyond the range of the cell coordinates should be clamped to the outermost cells.
+    auto grid_3 = hash_grid3 { .cell_size = 1.0f };
+    init(grid_3);
+
+    add(grid_3, render_mesh { .id = 1 }, { 1e30f, -1e30f, 0.0f });
+    test_equal("hash_grid3: clamp cell coordinates", grid_3.cells.count({ std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::min(), 0 }), std::size_t(1));
+    test_equal("hash_grid3: find region far (clamped)", find(grid_3, aabb3 { .min = { -1e30f, -1e30f, -1e30f }, .max = { 1e30f, 1e30f, 1e30f } }, [](const aabb3&) { return 1; }).size(), std::size_t(1));
+
+    de_init(grid_3);
+  }
+}
@@ -0,0 +1,152 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <cmath>
+#include <limits>
+
+#include <ludo/spatial/loose_octree.h>
+#include <ludo/testing.h>
+
+#include "loose_octree.h"
+
+namespace ludo
+{
+  void test_spatial_loose_octree()
+  {
+    test_group("loose_octree");
+
+    auto octree_1 = loose_octree { .bounds = { .min = { -8.0f, -8.0f, -8.0f }, .max = { 8.0f, 8.0f, 8.0f } }, .divisions = 3 };
+    init(octree_1);
+
+    auto bounds_1 = aabb3 { .min = { -5.5f, -5.5f, -5.5f }, .max = { -4.5f, -4.5f, -4.5f } };
+    auto bounds_2 = aabb3 { .min = { 4.5f, 4.5f, 4.5f }, .max = { 5.5f, 5.5f, 5.5f } };
+    auto bounds_3 = aabb3 { .min = { -7.0f, -1.0f, -1.0f }, .max = { 7.0f, 1.0f, 1.0f } }; // Too large for any layer other than the root.
+
+    add(octree_1, 1, bounds_1);
+    add(octree_1, 2, bounds_2);
+    add(octree_1, 3, bounds_3);
+    test_equal("loose_octree: add (count)", octree_1.nodes[0].count, uint32_t(3));
+    test_equal("loose_octree: add (root element)", octree_1.slots[octree_1.nodes[0].first_slot].element, uint32_t(3));
+
+    auto find_box = [](const aabb3& box)
+    {
+      return [box](const aabb3& bounds)
+      {
+        return intersect(box, bounds) ? 0 : -1;
+      };
+    };
+
+    auto elements_1 = find(octree_1, find_box({ .min = { -6.0f, -6.0f, -6.0f }, .max = { -5.0f, -5.0f, -5.0f } }));
+    test_equal("loose_octree: find (count)", elements_1.size(), std::size_t(1));
+    test_equal("loose_octree: find (element)", elements_1[0], uint32_t(1));
+
+    auto elements_2 = find(octree_1, find_box({ .min = { -1.0f, -1.0f, -1.0f }, .max = { 0.0f, 0.0f, 0.0f } }));
+    test_equal("loose_octree: find large (count)", elements_2.size(), std::size_t(1));
+    test_equal("loose_octree: find large (element)", elements_2[0], uint32_t(3));
+
+    auto elements_3 = find(octree_1, [](const aabb3& bounds)
+    {
+      return 1;
+    });
+    test_equal("loose_octree: find inside", elements_3.size(), std::size_t(3));
+
+    auto elements_4 = find(octree_1, vec3 { 5.0f, 5.0f, 7.0f }, 1.6f);
+    test_equal("loose_octree: find sphere (count)", elements_4.size(), std::size_t(1));
+    test_equal("loose_octree: find sphere (element)", elements_4[0], uint32_t(2));
+
+    auto elements_5 = find(octree_1, vec3 { 5.0f, 5.0f, 7.0f }, 1.4f);
+    test_equal("loose_octree: find sphere miss", elements_5.size(), std::size_t(0));
+
+    // Moving slightly keeps the element within the same node.
+    auto bounds_1_moved = aabb3 { .min = { -5.25f, -5.5f, -5.5f }, .max = { -4.25f, -4.5f, -4.5f } };
+    auto slot_count = octree_1.slots.size();
+    move(octree_1, 1, bounds_1, bounds_1_moved);
+    test_equal("loose_octree: move within node (slot count)", octree_1.slots.size(), slot_count);
+    test_equal("loose_octree: move within node (count)", octree_1.nodes[0].count, uint32_t(3));
+    test_equal("loose_octree: move within node (find)", find(octree_1, find_box(bounds_1_moved)).size(), std::size_t(1));
+
+    // Moving across the octree changes nodes and re-uses the freed slot.
+    auto bounds_1_far = aabb3 { .min = { 5.5f, -5.5f, -5.5f }, .max = { 6.5f, -4.5f, -4.5f } };
+    move(octree_1, 1, bounds_1_moved, bounds_1_far);
+    test_equal("loose_octree: move across nodes (slot count)", octree_1.slots.size(), slot_count);
+    test_equal("loose_octree: move across nodes (old)", find(octree_1, find_box({ .min = { -6.0f, -6.0f, -6.0f }, .max = { -5.0f, -5.0f, -5.0f } })).size(), std::size_t(0));
+    test_equal("loose_octree: move across nodes (new)", find(octree_1, find_box(bounds_1_far)).size(), std::size_t(1));
+
+    auto hit_1 = raycast(octree_1, { -8.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, 100.0f);
+    test_equal("loose_octree: raycast (element)", hit_1.element, uint32_t(3));
+    test_near("loose_octree: raycast (distance)", hit_1.distance, 1.0f);
+
+    auto hit_2 = raycast(octree_1, { 5.0f, 5.0f, -8.0f }, { 0.0f, 0.0f, 1.0f }, 100.0f);
+    test_equal("loose_octree: raycast 2 (element)", hit_2.element, uint32_t(2));
+    test_near("loose_octree: raycast 2 (distance)", hit_2.distance, 12.5f);
+
+    auto hit_3 = raycast(octree_1, { 5.0f, 5.0f, -8.0f }, { 0.0f, 0.0f, 1.0f }, 10.0f);
+    test_equal("loose_octree: raycast max distance", hit_3.element, std::numeric_limits<uint32_t>::max());
+
+    auto diagonal = 1.0f / std::sqrt(3.0f);
+    auto hits_1 = raycast_all(octree_1, { -7.0f, -7.0f, -7.0f }, { diagonal, diagonal, diagonal }, 100.0f);
+    test_equal("loose_octree: raycast all (count)", hits_1.size(), std::size_t(2));
+    test_equal("loose_octree: raycast all (first)", hits_1[0].element, uint32_t(3));
+    test_equal("loose_octree: raycast all (second)", hits_1[1].element, uint32_t(2));
+
+    auto nearest_1 = nearest(octree_1, { 6.0f, 6.0f, 6.0f }, 2);
+    test_equal("loose_octree: nearest (count)", nearest_1.size(), std::size_t(2));
+    test_equal("loose_octree: nearest (first)", nearest_1[0].element, uint32_t(2));
+    test_near("loose_octree: nearest (first distance)", nearest_1[0].distance, std::sqrt(0.75f));
+    test_equal("loose_octree: nearest (second)", nearest_1[1].element, uint32_t(3));
+
+    remove(octree_1, 3, bounds_3);
+    test_equal("loose_octree: remove (count)", octree_1.nodes[0].count, uint32_t(2));
+    test_equal("loose_octree: remove (find)", find(octree_1, find_box(bounds_3)).size(), std::size_t(0));
+
+    de_init(octree_1);
+
+    // Compare nearest against brute force.
+    auto octree_2 = loose_octree { .bounds = { .min = { -16.0f, -16.0f, -16.0f }, .max = { 16.0f, 16.0f, 16.0f } }, .divisions = 4 };
+    init(octree_2);
+
+    auto element_bounds = std::vector<aabb3>();
+    for (auto index = uint32_t(0); index < 512; index++)
+    {
+      // A deterministic scattering of elements of varying sizes.
+      auto center = vec3
+      {
+        std::fmod(static_cast<float>(index) * 7.31f, 31.0f) - 15.5f,
+        std::fmod(static_cast<float>(index) * 3.17f, 31.0f) - 15.5f,
+        std::fmod(static_cast<float>(index) * 5.53f, 31.0f) - 15.5f
+      };
+      auto half_extent = 0.1f + static_cast<float>(index % 7) * 0.3f;
+      auto bounds = aabb3 { .min = center - vec3 { half_extent, half_extent, half_extent }, .max = center + vec3 { half_extent, half_extent, half_extent } };
+
+      element_bounds.push_back(bounds);
+      add(octree_2, index, bounds);
+    }
+
+    auto position = vec3 { 1.0f, 2.0f, 3.0f };
+    auto brute_force_distances = std::vector<float>();
+    for (auto& bounds : element_bounds)
+    {
+      brute_force_distances.push_back(std::sqrt(distance2(bounds, position)));
+    }
+    std::sort(brute_force_distances.begin(), brute_force_distances.end());
+
+    auto nearest_2 = nearest(octree_2, position, 8);
+    auto nearest_matches = nearest_2.size() == 8;
+    for (auto index = std::size_t(0); nearest_matches && index < nearest_2.size(); index++)
+    {
+      nearest_matches = std::abs(nearest_2[index].distance - brute_force_distances[index]) < 0.0001f;
+    }
+    test_equal("loose_octree: nearest (brute force)", nearest_matches, true);
+
+    auto box = aabb3 { .min = { -4.0f, -6.0f, -2.0f }, .max = { 5.0f, 3.0f, 8.0f } };
+    auto brute_force_count = std::size_t(0);
+    for (auto& bounds : element_bounds)
+    {
+      brute_force_count += intersect(box, bounds) ? 1 : 0;
+    }
+    test_equal("loose_octree: find (brute force)", find(octree_2, find_box(box)).size(), brute_force_count);
+
+    de_init(octree_2);
+  }
+}
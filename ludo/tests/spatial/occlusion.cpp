@@ -0,0 +1,134 @@
+/*
+ * This file is part of ludo. See the LICENSE file for the full license governing this code.
+ */
+
+#include <algorithm>
+
+#include <ludo/rendering.h>
+#include <ludo/spatial/grid3.h>
+#include <ludo/spatial/occlusion.h>
+#include <ludo/testing.h>
+
+#include "occlusion.h"
+
+namespace ludo
+{
+  void test_spatial_occlusion()
+  {
+    test_group("occlusion");
+
+    auto camera = ludo::camera
+    {
+      .view = mat4_identity,
+      .projection = perspective(60.0f, 1.0f, 0.1f, 100.0f)
+    };
+
+    auto occlusion_buffer = ludo::occlusion_buffer { .width = 128, .height = 128 };
+    init(occlusion_buffer);
+
+    test_equal("occlusion: init (levels)", occlusion_buffer.levels.size(), std::size_t(8));
+    test_equal("occlusion: init (last level)", occlusion_buffer.levels.back().size(), std::size_t(1));
+
+    // A square in front of the camera (wound clockwise, which should still occlude).
+    auto positions = std::vector<vec3> { { -2.0f, -2.0f, -10.0f }, { 2.0f, -2.0f, -10.0f }, { 2.0f, 2.0f, -10.0f }, { -2.0f, 2.0f, -10.0f } };
+    auto indices = std::vector<uint32_t> { 0, 2, 1, 0, 3, 2 };
+
+    clear(occlusion_buffer, camera);
+    add_occluders(occlusion_buffer, positions, indices);
+    commit(occlusion_buffer);
+
+    test_equal("occlusion: occluded (behind)", occluded(occlusion_buffer, { .min = { -0.5f, -0.5f, -20.5f }, .max = { 0.5f, 0.5f, -19.5f } }), true);
+    test_equal("occlusion: occluded (in front)", occluded(occlusion_buffer, { .min = { -0.5f, -0.5f, -5.5f }, .max = { 0.5f, 0.5f, -4.5f } }), false);
+    test_equal("occlusion: occluded (straddling)", occluded(occlusion_buffer, { .min = { -0.5f, -0.5f, -20.5f }, .max = { 0.5f, 0.5f, -5.0f } }), false);
+    test_equal("occlusion: occluded (beside)", occluded(occlusion_buffer, { .min = { 7.5f, -0.5f, -20.5f }, .max = { 8.5f, 0.5f, -19.5f } }), false);
+    test_equal("occlusion: occluded (partially hidden)", occluded(occlusion_buffer, { .min = { 1.0f, -0.5f, -20.5f }, .max = { 6.0f, 0.5f, -19.5f } }), false);
+    test_equal("occlusion: occluded (crossing near plane)", occluded(occlusion_buffer, { .min = { -0.5f, -0.5f, -0.5f }, .max = { 0.5f, 0.5f, 0.5f } }), false);
+    test_equal("occlusion: occluded (large)", occluded(occlusion_buffer, { .min = { -3.0f, -3.0f, -40.0f }, .max = { 3.0f, 3.0f, -30.0f } }), true);
+
+    // The batch test should match the individual tests exactly.
+    auto bounds = aabb3_soa();
+    for (auto index = uint32_t(0); index < 2000; index++)
+    {
+      auto x = static_cast<float>(index % 20) - 10.0f;
+      auto y = static_cast<float>((index / 20) % 10) - 5.0f;
+      auto z = -static_cast<float>(index / 200) * 4.0f - 1.0f;
+
+      bounds.min_x.push_back(x - 0.5f);
+      bounds.min_y.push_back(y - 0.5f);
+      bounds.min_z.push_back(z - 0.5f);
+      bounds.max_x.push_back(x + 0.5f);
+      bounds.max_y.push_back(y + 0.5f);
+      bounds.max_z.push_back(z + 0.5f);
+    }
+
+    auto results = occluded(occlusion_buffer, bounds);
+    auto expected = std::vector<uint8_t>();
+    auto occluded_count = uint32_t(0);
+    for (auto index = uint32_t(0); index < 2000; index++)
+    {
+      expected.push_back(occluded(occlusion_buffer, { .min = { bounds.min_x[index], bounds.min_y[index], bounds.min_z[index] }, .max = { bounds.max_x[index], bounds.max_y[index], bounds.max_z[index] } }));
+      occluded_count += expected.back();
+    }
+
+    test_equal("occlusion: occluded (batch)", results == expected, true);
+    test_equal("occlusion: occluded (batch, some occluded)", occluded_count > 0 && occluded_count < 2000, true);
+
+    // The depth of a sloped occluder should be its farthest depth over each pixel, rather than its depth at the pixel's center.
+    auto sloped_positions = std::vector<vec3> { { -2.0f, -2.0f, -6.0f }, { 2.0f, -2.0f, -14.0f }, { 2.0f, 2.0f, -14.0f }, { -2.0f, 2.0f, -6.0f } };
+
+    clear(occlusion_buffer, camera);
+    add_occluders(occlusion_buffer, sloped_positions, { 0, 1, 2, 0, 2, 3 });
+
+    auto view_projection_inverse = occlusion_buffer.view_projection;
+    invert(view_projection_inverse);
+
+    // The depth of the occluder's plane (z = -10 - 2x) at a point in the occlusion buffer.
+    auto sloped_depth = [&](float x, float y)
+    {
+      auto ndc_x = x / 128.0f * 2.0f - 1.0f;
+      auto ndc_y = y / 128.0f * 2.0f - 1.0f;
+      auto near_point = view_projection_inverse * vec4 { ndc_x, ndc_y, -1.0f, 1.0f };
+      auto far_point = view_projection_inverse * vec4 { ndc_x, ndc_y, 1.0f, 1.0f };
+      auto ray_start = vec3 { near_point[0] / near_point[3], near_point[1] / near_point[3], near_point[2] / near_point[3] };
+      auto ray_end = vec3 { far_point[0] / far_point[3], far_point[1] / far_point[3], far_point[2] / far_point[3] };
+
+      auto t = -(ray_start[2] + 2.0f * ray_start[0] + 10.0f) / ((ray_end[2] - ray_start[2]) + 2.0f * (ray_end[0] - ray_start[0]));
+      auto position = ray_start + (ray_end - ray_start) * t;
+      auto clip = occlusion_buffer.view_projection * vec4 { position[0], position[1], position[2], 1.0f };
+
+      return clip[2] / clip[3] * 0.5f + 0.5f;
+    };
+
+    auto farthest_depth = std::max({ sloped_depth(64.0f, 64.0f), sloped_depth(65.0f, 64.0f), sloped_depth(64.0f, 65.0f), sloped_depth(65.0f, 65.0f) });
+    test_equal("occlusion: add occluders (farthest depth)", near(occlusion_buffer.levels[0][64 * 128 + 64], farthest_depth, 0.000001f), true);
+
+    clear(occlusion_buffer, camera);
+    commit(occlusion_buffer);
+
+    test_equal("occlusion: clear", occluded(occlusion_buffer, { .min = { -0.5f, -0.5f, -20.5f }, .max = { 0.5f, 0.5f, -19.5f } }), false);
+
+    // A wall across the whole view should hide the cells of a grid behind it.
+    auto grid = grid3 { .bounds = { .min = { -40.0f, -40.0f, -40.0f }, .max = { 40.0f, 40.0f, 40.0f } }, .cell_count_1d = 8 };
+    init(grid);
+    add(grid, render_mesh { .id = 1, .render_program_id = 100, .indices = { .count = 6 } }, { 0.0f, 0.0f, -35.0f });
+    add(grid, render_mesh { .id = 2, .render_program_id = 100, .indices = { .count = 6 } }, { 0.0f, 0.0f, -5.0f });
+
+    auto render_programs = allocate_array<render_program>(1);
+    add(render_programs, render_program { .id = 100, .command_buffer = allocate(8 * sizeof(render_command)) });
+
+    add_render_commands(grid, render_programs, camera, occlusion_buffer);
+    test_equal("occlusion: grid3 add render commands (no occluders)", render_programs[0].active_commands.count, uint32_t(2));
+
+    clear(occlusion_buffer, camera);
+    add_occluders(occlusion_buffer, { { -100.0f, -100.0f, -12.0f }, { 100.0f, -100.0f, -12.0f }, { 100.0f, 100.0f, -12.0f }, { -100.0f, 100.0f, -12.0f } }, { 0, 1, 2, 0, 2, 3 });
+    commit(occlusion_buffer);
+
+    render_programs[0].active_commands.count = 0;
+    add_render_commands(grid, render_programs, camera, occlusion_buffer);
+    test_equal("occlusion: grid3 add render commands (occluded)", render_programs[0].active_commands.count, uint32_t(1));
+
+    deallocate(render_programs[0].command_buffer);
+    deallocate(render_programs);
+    de_init(grid);
+  }
+}
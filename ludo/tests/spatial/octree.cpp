@@ -2,6 +2,8 @@
  * This file is part of ludo. See the LICENSE file for the full license governing this code.
  */
 
+#include <algorithm>
+
 #include <ludo/spatial/octree.h>
 #include <ludo/testing.h>
 
@@ -68,5 +70,94 @@ namespace ludo
       return intersect(bounds_3, bounds) ? 0 : -1;
     });
     test_equal("octree: find parallel 2", meshes_4.size(), std::size_t(0));
+
+    de_init(octree_1);
+
+    auto octree_2 = octree { .bounds = bounds_1, .track_locations = true };
+    init(octree_2);
+
+    add(octree_2, 1, position_1);
+    add(octree_2, 2, position_1);
+    add(octree_2, 3, position_1);
+
+    // Moving within a cell should not change anything.
+    move(octree_2, 1, position_1, { -0.75f, -0.75f, -0.75f });
+    test_equal("octree: move within cell", cell_elements(octree_2, 0) == std::vector<uint32_t> { 1, 2, 3 }, true);
+
+    // The last element of the cell fills the gap left by the moved element.
+    auto position_2 = vec3 { 0.25f, 0.25f, 0.25f };
+    move(octree_2, 1, { -0.75f, -0.75f, -0.75f }, position_2);
+    test_equal("octree: move across cells (old cell)", cell_elements(octree_2, 0) == std::vector<uint32_t> { 3, 2 }, true);
+    test_equal("octree: move across cells (new cell)", cell_elements(octree_2, 7) == std::vector<uint32_t> { 1 }, true);
+    test_equal("octree: move across cells (location)", octree_2.locations[3].slot, uint32_t(0));
+
+    // Tracked elements are removed from where they are, regardless of the position given.
+    remove(octree_2, 3, position_2);
+    test_equal("octree: remove tracked", cell_elements(octree_2, 0) == std::vector<uint32_t> { 2 }, true);
+    test_equal("octree: remove tracked (location count)", octree_2.locations.size(), std::size_t(2));
+
+    de_init(octree_2);
+
+    // The cells are in Morton order, so an element in the +x octant is found by a region covering only that octant.
+    auto octree_3 = octree { .bounds = bounds_1 };
+    init(octree_3);
+
+    add(octree_3, 1, { 0.5f, -0.5f, -0.5f });
+    test_equal("octree: find +x octant", cell_elements(octree_3, 1) == std::vector<uint32_t> { 1 }, true);
+
+    auto meshes_5 = find(octree_3, [&](const aabb3& bounds)
+    {
+      return intersect(aabb3 { .min = { 0.25f, -0.75f, -0.75f }, .max = { 0.75f, -0.25f, -0.25f } }, bounds) ? 0 : -1;
+    });
+    test_equal("octree: find +x octant (count)", meshes_5.size(), std::size_t(1));
+
+    de_init(octree_3);
+
+    // Building should place the same elements in the same cells as adding them one at a time (including overflow blocks).
+    auto elements = std::vector<uint32_t>();
+    auto positions = std::vector<vec3>();
+    for (auto index = uint32_t(0); index < 500; index++)
+    {
+      elements.push_back(index);
+      positions.push_back(
+      {
+        static_cast<float>((index * 37) % 101) / 50.5f - 1.0f,
+        static_cast<float>((index * 53) % 97) / 48.5f - 1.0f,
+        static_cast<float>((index * 71) % 89) / 44.5f - 1.0f
+      });
+    }
+
+    auto octree_4 = octree { .bounds = bounds_1, .divisions = 2, .cell_capacity = 2 };
+    init(octree_4);
+    for (auto index = uint32_t(0); index < elements.size(); index++)
+    {
+      add(octree_4, elements[index], positions[index]);
+    }
+
+    auto octree_5 = octree { .bounds = bounds_1, .divisions = 2, .cell_capacity = 2, .track_locations = true };
+    init(octree_5);
+    add(octree_5, 1000, position_1); // Replaced by the build.
+    build(octree_5, elements, positions);
+
+    auto build_matches = true;
+    for (auto cell_index = uint32_t(0); cell_index < octree_4.pool.cell_count; cell_index++)
+    {
+      auto added_elements = cell_elements(octree_4, cell_index);
+      auto built_elements = cell_elements(octree_5, cell_index);
+      std::sort(added_elements.begin(), added_elements.end());
+      std::sort(built_elements.begin(), built_elements.end());
+      build_matches = build_matches && added_elements == built_elements;
+    }
+    test_equal("octree: build", build_matches, true);
+    test_equal("octree: build (location count)", octree_5.locations.size(), elements.size());
+    test_equal("octree: build (location)", cell_elements(octree_5, octree_5.locations[42].cell_index)[octree_5.locations[42].slot], uint32_t(42));
+
+    // The built octree can still be modified.
+    remove(octree_5, 42, positions[42]);
+    add(octree_5, 42, positions[42]);
+    test_equal("octree: build then modify", find(octree_5, [](const aabb3& bounds) { return 1; }).size(), elements.size());
+
+    de_init(octree_4);
+    de_init(octree_5);
   }
 }
@@ -2,6 +2,8 @@
  * This file is part of ludo. See the LICENSE file for the full license governing this code.
  */
 
+#include <algorithm>
+
 #include <ludo/spatial/quadtree.h>
 #include <ludo/testing.h>
 
@@ -68,5 +70,51 @@ namespace ludo
       return intersect(bounds_3, bounds) ? 0 : -1;
     });
     test_equal("quadtree: find parallel 2", meshes_4.size(), std::size_t(0));
+
+    // The cells are in Morton order, so an element in the +x quadrant is found by a region covering only that quadrant.
+    add(quadtree_1, 3, { 0.5f, -0.5f });
+    test_equal("quadtree: find +x quadrant", cell_elements(quadtree_1, 1) == std::vector<uint32_t> { 3 }, true);
+
+    auto meshes_5 = find(quadtree_1, [&](const aabb2& bounds)
+    {
+      return intersect(aabb2 { .min = { 0.25f, -0.75f }, .max = { 0.75f, -0.25f } }, bounds) ? 0 : -1;
+    });
+    test_equal("quadtree: find +x quadrant (count)", meshes_5.size(), std::size_t(1));
+
+    de_init(quadtree_1);
+
+    // Building should place the same elements in the same cells as adding them one at a time (including overflow blocks).
+    auto elements = std::vector<uint32_t>();
+    auto positions = std::vector<vec2>();
+    for (auto index = uint32_t(0); index < 500; index++)
+    {
+      elements.push_back(index);
+      positions.push_back({ static_cast<float>((index * 37) % 101) / 50.5f - 1.0f, static_cast<float>((index * 53) % 97) / 48.5f - 1.0f });
+    }
+
+    auto quadtree_2 = quadtree { .bounds = bounds_1, .divisions = 3, .cell_capacity = 2 };
+    init(quadtree_2);
+    for (auto index = uint32_t(0); index < elements.size(); index++)
+    {
+      add(quadtree_2, elements[index], positions[index]);
+    }
+
+    auto quadtree_3 = quadtree { .bounds = bounds_1, .divisions = 3, .cell_capacity = 2 };
+    init(quadtree_3);
+    build(quadtree_3, elements, positions);
+
+    auto build_matches = true;
+    for (auto cell_index = uint32_t(0); cell_index < quadtree_2.pool.cell_count; cell_index++)
+    {
+      auto added_elements = cell_elements(quadtree_2, cell_index);
+      auto built_elements = cell_elements(quadtree_3, cell_index);
+      std::sort(added_elements.begin(), added_elements.end());
+      std::sort(built_elements.begin(), built_elements.end());
+      build_matches = build_matches && added_elements == built_elements;
+    }
+    test_equal("quadtree: build", build_matches, true);
+
+    de_init(quadtree_2);
+    de_init(quadtree_3);
   }
 }
@@ -8,8 +8,21 @@
 #include "math/projection.h"
 #include "math/quat.h"
 #include "math/vec.h"
+#include "meshes/collapse.h"
+#include "meshes/indices.h"
+#include "meshes/lmesh.h"
+#include "meshes/meshlets.h"
+#include "meshes/optimize.h"
+#include "meshes/packing.h"
+#include "meshes/util.h"
+#include "rendering.h"
+#include "spatial/cell_pool.h"
+#include "spatial/frustum.h"
 #include "spatial/grid2.h"
 #include "spatial/grid3.h"
+#include "spatial/hash_grid3.h"
+#include "spatial/loose_octree.h"
+#include "spatial/occlusion.h"
 #include "spatial/octree.h"
 #include "spatial/quadtree.h"
 
@@ -21,8 +34,21 @@ int main()
   ludo::test_math_projection();
   ludo::test_math_quat();
   ludo::test_math_vec();
+  ludo::test_meshes_collapse();
+  ludo::test_meshes_indices();
+  ludo::test_meshes_lmesh();
+  ludo::test_meshes_meshlets();
+  ludo::test_meshes_optimize();
+  ludo::test_meshes_packing();
+  ludo::test_meshes_util();
+  ludo::test_rendering();
+  ludo::test_spatial_cell_pool();
+  ludo::test_spatial_frustum();
   ludo::test_spatial_grid2();
   ludo::test_spatial_grid3();
+  ludo::test_spatial_hash_grid3();
+  ludo::test_spatial_loose_octree();
+  ludo::test_spatial_occlusion();
   ludo::test_spatial_octree();
   ludo::test_spatial_quadtree();
 
@@ -32,6 +58,9 @@ int main()
 // stubs
 namespace ludo
 {
+  bool stub_fences_signaled = true; // Determines if stubbed fences would be waited for.
+  uint64_t stub_fence_id = 1;
+
   compute_program* add_grid_compute_program(instance& instance, const grid3& octree)
   {
     return new compute_program();
@@ -50,4 +79,24 @@ namespace ludo
   void set_instance_texture(render_mesh& render_mesh, const texture& texture, uint32_t instance_index)
   {
   }
+
+  void init(fence& fence)
+  {
+    fence.id = stub_fence_id++;
+  }
+
+  void de_init(fence& fence)
+  {
+    fence.id = 0;
+  }
+
+  void wait(fence& fence)
+  {
+    de_init(fence);
+  }
+
+  bool signaled(const fence& fence)
+  {
+    return stub_fences_signaled;
+  }
 }